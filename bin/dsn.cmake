@@ -263,6 +263,10 @@ function(dsn_setup_system_libs)
     find_package(OpenSSL REQUIRED)
     set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} ${OPENSSL_CRYPTO_LIBRARY})
 
+    # for gzip compression of http responses
+    find_package(ZLIB REQUIRED)
+    set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} ${ZLIB_LIBRARIES})
+
     if(ENABLE_GPERF)
         set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} tcmalloc_and_profiler)
         add_definitions(-DDSN_ENABLE_GPERF)
@@ -149,9 +149,14 @@ inline std::ostream &operator<<(std::ostream &out, const partition_configuration
 
 typedef struct _configuration_query_by_index_request__isset
 {
-    _configuration_query_by_index_request__isset() : app_name(false), partition_indices(false) {}
+    _configuration_query_by_index_request__isset()
+        : app_name(false), partition_indices(false), known_ballot_sum(false), known_app_id(false)
+    {
+    }
     bool app_name : 1;
     bool partition_indices : 1;
+    bool known_ballot_sum : 1;
+    bool known_app_id : 1;
 } _configuration_query_by_index_request__isset;
 
 class configuration_query_by_index_request
@@ -161,11 +166,13 @@ public:
     configuration_query_by_index_request(configuration_query_by_index_request &&);
     configuration_query_by_index_request &operator=(const configuration_query_by_index_request &);
     configuration_query_by_index_request &operator=(configuration_query_by_index_request &&);
-    configuration_query_by_index_request() : app_name() {}
+    configuration_query_by_index_request() : app_name(), known_ballot_sum(0), known_app_id(0) {}
 
     virtual ~configuration_query_by_index_request() throw();
     std::string app_name;
     std::vector<int32_t> partition_indices;
+    int64_t known_ballot_sum;
+    int32_t known_app_id;
 
     _configuration_query_by_index_request__isset __isset;
 
@@ -173,12 +180,24 @@ public:
 
     void __set_partition_indices(const std::vector<int32_t> &val);
 
+    void __set_known_ballot_sum(const int64_t val);
+
+    void __set_known_app_id(const int32_t val);
+
     bool operator==(const configuration_query_by_index_request &rhs) const
     {
         if (!(app_name == rhs.app_name))
             return false;
         if (!(partition_indices == rhs.partition_indices))
             return false;
+        if (__isset.known_ballot_sum != rhs.__isset.known_ballot_sum)
+            return false;
+        else if (__isset.known_ballot_sum && !(known_ballot_sum == rhs.known_ballot_sum))
+            return false;
+        if (__isset.known_app_id != rhs.__isset.known_app_id)
+            return false;
+        else if (__isset.known_app_id && !(known_app_id == rhs.known_app_id))
+            return false;
         return true;
     }
     bool operator!=(const configuration_query_by_index_request &rhs) const
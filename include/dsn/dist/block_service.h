@@ -237,10 +237,17 @@ typedef dsn::ref_ptr<write_future> write_future_ptr;
 /**
  * @brief The upload_request struct
  *  input_local_name: a local filesystem path, you can use a relative or absolute path.
+ *  part_offset/part_length: upload only the range [part_offset, part_offset + part_length)
+ *    of the local file to the same range of the remote file, part_length == -1 means
+ *    the whole file. a ranged upload is a part of a multipart upload, which requires
+ *    {@link block_file::supports_multipart}, and the remote file is visible only after
+ *    {@link block_file::complete_multipart_upload}.
  */
 struct upload_request
 {
     std::string input_local_name;
+    uint64_t part_offset{0};
+    int64_t part_length{-1};
 };
 
 /**
@@ -268,6 +275,10 @@ struct download_request
     std::string output_local_name;
     uint64_t remote_pos;
     int64_t remote_length;
+    // write the range to the same position of output_local_name rather than to a truncated
+    // file, so that the parts of a file can be downloaded separately. requires
+    // {@link block_file::supports_multipart}
+    bool is_part{false};
 };
 /**
  * @brief The download_response struct
@@ -280,6 +291,9 @@ struct download_response
 {
     dsn::error_code err;
     uint64_t downloaded_size;
+    // the md5 of the downloaded file if it's computed on the way by downloading the whole
+    // file, so the caller needn't read the file again to verify it. otherwise it's empty
+    std::string file_md5;
 };
 typedef std::function<void(const download_response &)> download_callback;
 typedef future_task<download_response> download_future;
@@ -452,6 +466,33 @@ public:
                                    const download_callback &cb,
                                    dsn::task_tracker *tracker = nullptr) = 0;
 
+    /**
+     * @brief supports_multipart
+     *    whether the ranged upload and download of {@link upload_request::part_offset} and
+     *    {@link download_request::is_part} are supported, by which a file is transferred in
+     *    parts concurrently and a failed transfer is resumed from the parts not finished.
+     */
+    virtual bool supports_multipart() { return false; }
+
+    /**
+     * @brief complete_multipart_upload
+     *    make the remote file written by the ranged uploads visible, and fetch its metadata.
+     *    only called if {@link #supports_multipart}.
+     * @param req, the request of the whole file, whose part_offset/part_length are ignored
+     * @param code, a task_code, describe how the callback executed
+     * @param callback, called with the size of the whole file
+     * @param tracker
+     * @return a task which represent the async operation
+     */
+    virtual dsn::task_ptr complete_multipart_upload(const upload_request &req,
+                                                    dsn::task_code code,
+                                                    const upload_callback &cb,
+                                                    dsn::task_tracker *tracker = nullptr)
+    {
+        dassert(false, "multipart upload isn't supported by %s", _name.c_str());
+        return nullptr;
+    }
+
 protected:
     std::string _name;
 };
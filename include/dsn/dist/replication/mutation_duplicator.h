@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
 #include <dsn/utility/errors.h>
 #include <dsn/dist/replication/replication_types.h>
 #include <dsn/dist/replication/replica_base.h>
@@ -20,18 +23,101 @@ typedef std::tuple<uint64_t, task_code, blob> mutation_tuple;
 /// mutations are sorted by timestamp in mutation_tuple_set.
 struct mutation_tuple_cmp
 {
-    inline bool operator()(const mutation_tuple &lhs, const mutation_tuple &rhs)
+    inline bool operator()(const mutation_tuple &lhs, const mutation_tuple &rhs) const
     {
-        // different mutations is probable to be batched together
-        // and sharing the same timestamp, so here we also compare
-        // the data pointer.
-        if (std::get<0>(lhs) == std::get<0>(rhs)) {
-            return std::get<2>(lhs).data() < std::get<2>(rhs).data();
-        }
         return std::get<0>(lhs) < std::get<0>(rhs);
     }
 };
-typedef std::set<mutation_tuple, mutation_tuple_cmp> mutation_tuple_set;
+
+/// \brief A flat array of mutations sorted by timestamp, the mutations with the same
+/// timestamp are kept in the order they're added.
+///
+/// The mutations are loaded from the private log in the order of decrees, whose timestamps
+/// are almost always increasing, so adding a mutation is mostly an append without any
+/// allocation for a tree node. A mutation older than the last one is inserted at its place.
+///
+/// The bytes that have to be copied can be put into the arena of the set, so that the
+/// small mutations don't need an allocation each.
+class mutation_tuple_set
+{
+public:
+    typedef std::vector<mutation_tuple>::const_iterator const_iterator;
+    typedef const_iterator iterator;
+
+    static const size_t ARENA_BLOCK_SIZE = 64 * 1024;
+
+    mutation_tuple_set() = default;
+    mutation_tuple_set(mutation_tuple_set &&) = default;
+    mutation_tuple_set &operator=(mutation_tuple_set &&) = default;
+    // a copy shares the blobs, but copies its own bytes into a fresh arena, otherwise both of
+    // them would write to the unused part of the same block
+    mutation_tuple_set(const mutation_tuple_set &other) : _mutations(other._mutations) {}
+    mutation_tuple_set &operator=(const mutation_tuple_set &other)
+    {
+        if (this != &other) {
+            _mutations = other._mutations;
+            _arena.reset();
+            _arena_used = 0;
+        }
+        return *this;
+    }
+
+    void emplace(mutation_tuple mut)
+    {
+        if (_mutations.empty() || !mutation_tuple_cmp()(mut, _mutations.back())) {
+            _mutations.emplace_back(std::move(mut));
+            return;
+        }
+        auto it =
+            std::upper_bound(_mutations.begin(), _mutations.end(), mut, mutation_tuple_cmp());
+        _mutations.insert(it, std::move(mut));
+    }
+
+    void insert(const_iterator first, const_iterator last)
+    {
+        _mutations.reserve(_mutations.size() + (last - first));
+        for (; first != last; ++first) {
+            emplace(*first);
+        }
+    }
+
+    /// Copy the bytes into the arena. The returned blob shares the arena block with the other
+    /// small blobs, while a large one is allocated alone.
+    blob copy_to_arena(const char *data, size_t length)
+    {
+        if (length > ARENA_BLOCK_SIZE / 4) {
+            return blob::create_from_bytes(data, length);
+        }
+        if (_arena == nullptr || _arena_used + length > ARENA_BLOCK_SIZE) {
+            _arena.reset(new char[ARENA_BLOCK_SIZE], std::default_delete<char[]>());
+            _arena_used = 0;
+        }
+        memcpy(_arena.get() + _arena_used, data, length);
+        blob bb(_arena, static_cast<int>(_arena_used), static_cast<unsigned int>(length));
+        _arena_used += length;
+        return bb;
+    }
+
+    void reserve(size_t n) { _mutations.reserve(n); }
+
+    void clear()
+    {
+        _mutations.clear();
+        _arena.reset();
+        _arena_used = 0;
+    }
+
+    const_iterator begin() const { return _mutations.begin(); }
+    const_iterator end() const { return _mutations.end(); }
+    size_t size() const { return _mutations.size(); }
+    bool empty() const { return _mutations.empty(); }
+
+private:
+    std::vector<mutation_tuple> _mutations;
+
+    std::shared_ptr<char> _arena;
+    size_t _arena_used{0};
+};
 
 /// \brief This is an interface for handling the mutation logs intended to
 /// be duplicated to remote cluster.
@@ -44,9 +130,20 @@ public:
     /// Duplicate the provided mutations to the remote cluster.
     /// The implementation must be non-blocking.
     ///
+    /// By default duplicate() is called again only after the callback of the previous call,
+    /// so the batches are applied by the remote cluster in the order of decrees. If
+    /// allows_concurrent_batches() returns true, up to [replication] dup_max_inflight_batches
+    /// calls may be outstanding, and their callbacks may be called in any order and in any
+    /// thread. The implementation then has to keep the mutations on the same key in order
+    /// itself, e.g. by holding back a batch until the earlier batches touching the same hash
+    /// keys are acknowledged, as only it can decode the keys of the mutations.
+    ///
     /// \param cb: Call it when all the given mutations were sent successfully
     virtual void duplicate(mutation_tuple_set mutations, callback cb) = 0;
 
+    /// Whether duplicate() can be called before the previous calls complete, see duplicate().
+    virtual bool allows_concurrent_batches() const { return false; }
+
     // Singleton creator of mutation_duplicator.
     static std::function<std::unique_ptr<mutation_duplicator>(
         replica_base *, string_view /*remote cluster*/, string_view /*app name*/)>
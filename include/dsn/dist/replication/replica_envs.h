@@ -38,6 +38,9 @@ public:
     static const std::string DENY_CLIENT_WRITE;
     static const std::string WRITE_QPS_THROTTLING;
     static const std::string WRITE_SIZE_THROTTLING;
+    static const std::string TABLE_WRITE_QPS_THROTTLING;
+    static const std::string TABLE_WRITE_SIZE_THROTTLING;
+    static const std::string TABLE_READ_QPS_THROTTLING;
     static const uint64_t MIN_SLOW_QUERY_THRESHOLD_MS;
     static const std::string SLOW_QUERY_THRESHOLD;
     static const std::string TABLE_LEVEL_DEFAULT_TTL;
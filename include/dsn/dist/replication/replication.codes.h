@@ -78,6 +78,8 @@ MAKE_EVENT_CODE(LPC_BULK_LOAD_INGESTION, TASK_PRIORITY_HIGH)
 // THREAD_POOL_META_SERVER
 #define CURRENT_THREAD_POOL THREAD_POOL_META_SERVER
 MAKE_EVENT_CODE_RPC(RPC_CM_QUERY_PARTITION_CONFIG_BY_INDEX, TASK_PRIORITY_COMMON)
+MAKE_EVENT_CODE_RPC(RPC_CM_SUBSCRIBE_PARTITION_CONFIG, TASK_PRIORITY_COMMON)
+MAKE_EVENT_CODE(LPC_META_CONFIG_SUBSCRIPTION, TASK_PRIORITY_COMMON)
 MAKE_EVENT_CODE_RPC(RPC_CM_CONFIG_SYNC, TASK_PRIORITY_COMMON)
 MAKE_EVENT_CODE_RPC(RPC_CM_UPDATE_PARTITION_CONFIGURATION, TASK_PRIORITY_COMMON)
 MAKE_EVENT_CODE_RPC(RPC_CM_CREATE_APP, TASK_PRIORITY_COMMON)
@@ -242,6 +242,13 @@ public:
 
     virtual ingestion_status::type get_ingestion_status() { return ingestion_status::IS_INVALID; }
 
+    // The approximate size of data stored in data_dir(), which is reported to meta server
+    // for load balancing. The default implementation sums up the size of all files under
+    // data_dir(), storage engine may override it with its own statistics.
+    //
+    // Must be thread safe.
+    virtual int64_t get_storage_size_mb() const;
+
 public:
     //
     // utility functions to be used by app
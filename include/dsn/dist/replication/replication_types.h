@@ -3057,7 +3057,10 @@ typedef struct _replica_info__isset
           last_prepared_decree(false),
           last_durable_decree(false),
           app_type(false),
-          disk_tag(false)
+          disk_tag(false),
+          read_qps(false),
+          write_qps(false),
+          storage_mb(false)
     {
     }
     bool pid : 1;
@@ -3068,6 +3071,9 @@ typedef struct _replica_info__isset
     bool last_durable_decree : 1;
     bool app_type : 1;
     bool disk_tag : 1;
+    bool read_qps : 1;
+    bool write_qps : 1;
+    bool storage_mb : 1;
 } _replica_info__isset;
 
 class replica_info
@@ -3084,7 +3090,10 @@ public:
           last_prepared_decree(0),
           last_durable_decree(0),
           app_type(),
-          disk_tag()
+          disk_tag(),
+          read_qps(0),
+          write_qps(0),
+          storage_mb(0)
     {
     }
 
@@ -3097,6 +3106,9 @@ public:
     int64_t last_durable_decree;
     std::string app_type;
     std::string disk_tag;
+    int64_t read_qps;
+    int64_t write_qps;
+    int64_t storage_mb;
 
     _replica_info__isset __isset;
 
@@ -3116,6 +3128,12 @@ public:
 
     void __set_disk_tag(const std::string &val);
 
+    void __set_read_qps(const int64_t val);
+
+    void __set_write_qps(const int64_t val);
+
+    void __set_storage_mb(const int64_t val);
+
     bool operator==(const replica_info &rhs) const
     {
         if (!(pid == rhs.pid))
@@ -3134,6 +3152,18 @@ public:
             return false;
         if (!(disk_tag == rhs.disk_tag))
             return false;
+        if (__isset.read_qps != rhs.__isset.read_qps)
+            return false;
+        else if (__isset.read_qps && !(read_qps == rhs.read_qps))
+            return false;
+        if (__isset.write_qps != rhs.__isset.write_qps)
+            return false;
+        else if (__isset.write_qps && !(write_qps == rhs.write_qps))
+            return false;
+        if (__isset.storage_mb != rhs.__isset.storage_mb)
+            return false;
+        else if (__isset.storage_mb && !(storage_mb == rhs.storage_mb))
+            return false;
         return true;
     }
     bool operator!=(const replica_info &rhs) const { return !(*this == rhs); }
@@ -28,6 +28,8 @@ struct http_request
     blob body;
     blob full_url;
     http_method method;
+    // whether the client accepts a gzip compressed body, by the "Accept-Encoding" header
+    bool accept_gzip{false};
 };
 
 enum class http_status_code
@@ -41,9 +43,25 @@ enum class http_status_code
 
 extern std::string http_status_code_to_string(http_status_code code);
 
+// Writes the body of a response piece by piece, see `http_response::body_writer`.
+class http_body_writer
+{
+public:
+    virtual ~http_body_writer() = default;
+
+    virtual void write(const char *data, size_t size) = 0;
+    void write(const std::string &data) { write(data.data(), data.size()); }
+};
+
 struct http_response
 {
     std::string body;
+    // If set, it's called to write the body instead of `body` after the handler returns. The
+    // body isn't streamed: it's collected and sent in a single reply with Content-Length, as an
+    // rpc reply gives no completion to pace the next chunk by. Only the compression is
+    // incremental, the pieces are compressed as they're written if the client accepts gzip, so
+    // a large body isn't held in memory uncompressed.
+    std::function<void(http_body_writer &writer)> body_writer;
     http_status_code status_code{http_status_code::ok};
     std::string content_type = "text/plain";
     std::string location;
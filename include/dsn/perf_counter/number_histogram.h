@@ -0,0 +1,69 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstdint>
+
+namespace dsn {
+
+// A log-linear histogram of non-negative integers, such as latencies in nanoseconds.
+//
+// Values below 16 have their own buckets. Each power-of-2 range above is divided into 16
+// equal buckets, so the width of a bucket is at most 1/16 of its lower bound and any value
+// up to MAX_VALUE is recorded with a relative error below 6.25%. Negative values are recorded
+// as 0, and the values above MAX_VALUE are recorded in the last bucket.
+//
+// Histograms have the same buckets, so they can be merged: the histograms of partitions
+// can be added up to get the percentiles of the table.
+class number_histogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    // 2^41 - 1, about 36 minutes in nanoseconds, which is enough for latencies
+    static const int MAX_VALUE_BITS = 41;
+    static const int64_t MAX_VALUE = (static_cast<int64_t>(1) << MAX_VALUE_BITS) - 1;
+    static const int BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    static int bucket_index(int64_t value)
+    {
+        if (value < SUB_BUCKET_COUNT) {
+            return value < 0 ? 0 : static_cast<int>(value);
+        }
+        if (value > MAX_VALUE) {
+            return BUCKET_COUNT - 1;
+        }
+        int exp = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+        int sub = static_cast<int>(value >> (exp - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+        return (exp - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + sub;
+    }
+
+    static int64_t bucket_lower_bound(int index);
+    // inclusive
+    static int64_t bucket_upper_bound(int index);
+
+    number_histogram() { clear(); }
+
+    void record(int64_t value, uint64_t count = 1);
+    // add the counts of `bucket_index` directly, used to build the histogram from shards
+    void add_bucket(int bucket_index, uint64_t count);
+    void merge(const number_histogram &other);
+    void clear();
+
+    uint64_t count() const { return _total_count; }
+
+    // the value at percentile `p` (in (0, 1]) of the recorded values, approximated by the
+    // middle of the bucket it falls in. return 0 if it's empty.
+    int64_t percentile(double p) const;
+
+private:
+    uint64_t _counts[BUCKET_COUNT];
+    uint64_t _total_count;
+    // the min and max bucket which is not empty
+    int _min_index;
+    int _max_index;
+};
+
+} // namespace dsn
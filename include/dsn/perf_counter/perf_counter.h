@@ -61,6 +61,8 @@ dsn_perf_counter_percentile_type_t dsn_percentile_type_from_string(const char *s
 
 namespace dsn {
 
+class number_histogram;
+
 class perf_counter : public ref_counter
 {
 public:
@@ -81,6 +83,9 @@ public:
     virtual void add(int64_t val) = 0;
     virtual void set(int64_t val) = 0;
     virtual double get_value() = 0;
+    // get the value without resetting it, which is different from get_value() for the
+    // VOLATILE_NUMBER and RATE counters, so reading the counter doesn't disturb the others
+    virtual double peek_value() { return get_value(); }
     virtual int64_t get_integer_value() = 0;
     virtual double get_percentile(dsn_perf_counter_percentile_type_t type) = 0;
 
@@ -95,6 +100,21 @@ public:
     // return the latest sample value
     virtual int64_t get_latest_sample() const { return 0; }
 
+    // get the histogram of the samples in the last computation interval, return false if the
+    // counter doesn't support it
+    virtual bool get_histogram(/*out*/ number_histogram &hist) const { return false; }
+
+    // get the total added to a RATE counter since it's created, return false if the counter
+    // doesn't support it
+    virtual bool get_total(/*out*/ int64_t &total) const { return false; }
+
+    // get the count and the sum of all the samples set to a NUMBER_PERCENTILES counter since
+    // it's created, return false if the counter doesn't support it
+    virtual bool get_samples_total(/*out*/ uint64_t &count, /*out*/ int64_t &sum) const
+    {
+        return false;
+    }
+
     const char *full_name() const { return _full_name.c_str(); }
     const char *app() const { return _app.c_str(); }
     const char *section() const { return _section.c_str(); }
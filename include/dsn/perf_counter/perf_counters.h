@@ -74,6 +74,9 @@ public:
 
     perf_counter_ptr get_counter(const std::string &full_name);
 
+    // get references of all the counters, without taking a snapshot of their values
+    void get_all_counters(std::vector<perf_counter_ptr> *all) const;
+
     struct counter_snapshot
     {
         double value{0.0};
@@ -141,8 +144,6 @@ private:
                               dsn_perf_counter_type_t type,
                               const char *dsptr);
 
-    void get_all_counters(std::vector<perf_counter_ptr> *all) const;
-
     mutable utils::rw_lock_nr _lock;
     // keep counter as a refptr to make the counter can be safely accessed
     // by get_all_counters and remove_counter concurrently
@@ -67,7 +67,8 @@ typedef union msg_context
     {
         uint64_t is_request : 1;           ///< whether the RPC message is a request or response
         uint64_t is_forwarded : 1;         ///< whether the msg is forwarded or not
-        uint64_t unused : 4;               ///< not used yet
+        uint64_t is_trace_sampled : 1;     ///< whether the trace_id is sampled for tracing
+        uint64_t unused : 3;               ///< not used yet
         uint64_t serialize_format : 4;     ///< dsn_msg_serialize_format
         uint64_t is_forward_supported : 1; ///< whether support forwarding a message to real leader
         uint64_t is_backup_request : 1;    ///< whether the RPC is a backup request
@@ -144,6 +145,8 @@ public:
     dsn::task_code local_rpc_code;
     network_header_format hdr_format;
     int send_retry_count;
+    // when the request is received by the rpc engine, 0 if it's not a received request
+    uint64_t receive_ts_ns;
 
     // by message queuing
     dlink dl;
@@ -318,6 +318,7 @@ private:
 public:
     // used by task queue only
     task *next;
+    uint64_t enqueue_ts_ns;
 };
 typedef dsn::ref_ptr<dsn::task> task_ptr;
 
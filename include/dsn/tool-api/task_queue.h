@@ -90,6 +90,31 @@ public:
     int index() const { return _index; }
     volatile int *get_virtual_length_ptr() { return &_virtual_queue_length; }
 
+    // the tasks accepted by the queue, excluding the ones rejected by the throttling
+    uint64_t enqueued_task_count() const
+    {
+        return _enqueued_task_count.load(std::memory_order_relaxed);
+    }
+    // called by the workers after `batch_size` (> 0) tasks are dequeued, `head` is the first
+    void on_dequeue(task *head, int batch_size)
+    {
+        _dequeued_task_count.fetch_add(batch_size, std::memory_order_relaxed);
+        _dequeue_batch_count.fetch_add(1, std::memory_order_relaxed);
+        _last_dequeued_enqueue_ts_ns.store(head->enqueue_ts_ns, std::memory_order_relaxed);
+    }
+    uint64_t dequeued_task_count() const
+    {
+        return _dequeued_task_count.load(std::memory_order_relaxed);
+    }
+    uint64_t dequeue_batch_count() const
+    {
+        return _dequeue_batch_count.load(std::memory_order_relaxed);
+    }
+    // how long the oldest task has been waiting in the queue, 0 if it's empty. it's an upper
+    // bound as the tasks are supposed to be dequeued in FIFO order: the tasks in the queue are
+    // enqueued after the last dequeued one, and after the queue becomes not empty.
+    uint64_t oldest_task_age_ns(uint64_t now_ns) const;
+
     admission_controller *controller() const { return _controller; }
     void set_controller(admission_controller *controller) { _controller = controller; }
 
@@ -106,6 +131,12 @@ private:
     dsn::perf_counter_wrapper _queue_length_counter;
     threadpool_spec *_spec;
     volatile int _virtual_queue_length;
+
+    std::atomic<uint64_t> _enqueued_task_count;
+    std::atomic<uint64_t> _dequeued_task_count;
+    std::atomic<uint64_t> _dequeue_batch_count;
+    std::atomic<uint64_t> _last_dequeued_enqueue_ts_ns;
+    std::atomic<uint64_t> _non_empty_since_ns;
 };
 /*@}*/
 } // end namespace
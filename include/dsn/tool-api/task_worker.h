@@ -83,7 +83,22 @@ public:
     DSN_API const threadpool_spec &pool_spec() const;
     DSN_API static task_worker *current();
 
+    // the time spent in running tasks and in waiting for tasks, including the current period
+    // which is not finished yet. `busy_since_ns` is when the current batch of tasks began to
+    // run, 0 if the worker is waiting.
+    uint64_t processed_task_count() const
+    {
+        return _processed_task_count.load(std::memory_order_relaxed);
+    }
+    DSN_API void get_busy_idle_time(uint64_t now_ns,
+                                    /*out*/ uint64_t &busy_ns,
+                                    /*out*/ uint64_t &idle_ns,
+                                    /*out*/ uint64_t &busy_since_ns) const;
+
 private:
+    void begin_time_update();
+    void end_time_update();
+
     task_worker_pool *_owner_pool;
     task_queue *_input_queue;
     int _index;
@@ -92,7 +107,15 @@ private:
     std::unique_ptr<std::thread> _thread;
     bool _is_running;
     utils::notify_event _started;
-    int _processed_task_count;
+
+    // only updated by the worker thread itself
+    std::atomic<uint64_t> _processed_task_count;
+    std::atomic<uint64_t> _busy_ns;
+    std::atomic<uint64_t> _idle_ns;
+    std::atomic<uint64_t> _busy_since_ns;
+    std::atomic<uint64_t> _idle_since_ns;
+    // guards the consistency of the 4 times above for the readers
+    std::atomic<uint64_t> _time_version;
 
 public:
     DSN_API static void set_name(const char *name);
@@ -50,6 +50,11 @@ is_profile = true
 is_profile = false
 
 </PRE>
+
+The full profiling above is too expensive to be enabled for all the tasks in production.
+With "is_light_profile = true", only the queueing time, the executing time and the count
+of the tasks are recorded for each task code, cheap enough to be always on. They can be
+fetched by get_task_code_stats(), and by "ip:port/profiler/tasks" of the http server.
 */
 
 namespace dsn {
@@ -62,5 +67,22 @@ public:
     virtual void install(service_spec &spec);
 };
 
+struct task_code_stats_info
+{
+    std::string task_code;
+    uint64_t count;
+    uint64_t total_queue_ns;
+    uint64_t total_exec_ns;
+    // the percentiles are accurate within a factor of 2
+    int64_t queue_ns_p50;
+    int64_t queue_ns_p99;
+    int64_t exec_ns_p50;
+    int64_t exec_ns_p99;
+};
+
+// Get the statistics of the `top` task codes with the most total executing time, which
+// are recorded by the light profiling. Return false if the light profiling is not enabled.
+extern bool get_task_code_stats(int top, /*out*/ std::vector<task_code_stats_info> &stats);
+
 } // namespace tools
 } // namespace dsn
@@ -123,6 +123,22 @@ bool link_file(const std::string &src, const std::string &target);
 
 error_code md5sum(const std::string &file_path, /*out*/ std::string &result);
 
+// copy the file `src` to `dst` (created or truncated) in a single pass through a large buffer,
+// computing the md5 of the content on the way, so that no extra read is needed for md5sum.
+error_code copy_file_with_md5(const std::string &src,
+                              const std::string &dst,
+                              /*out*/ int64_t &copied_size,
+                              /*out*/ std::string &md5);
+
+// copy `length` bytes (to the end of `src` if -1) at `offset` of `src` to the same offset of
+// `dst`, which is created if not exists but never truncated, so that the parts of a file can
+// be copied concurrently.
+error_code copy_file_part(const std::string &src,
+                          const std::string &dst,
+                          uint64_t offset,
+                          int64_t length,
+                          /*out*/ int64_t &copied_size);
+
 // return value:
 //  - <A, B>:
 //          A is represent whether operation encounter some local error
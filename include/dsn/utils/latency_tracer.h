@@ -16,18 +16,38 @@
 // under the License.
 
 #pragma once
-#include <dsn/utility/synchronize.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
 #include <dsn/utility/flags.h>
 #include <dsn/dist/fmt_logging.h>
 
 namespace dsn {
 namespace utils {
 
+// The stage of a trace point is interned only once for each call site, so the name of a custom
+// point should be the same every time it's reached.
+//
+// The metric name of the stage, used by the per-stage counters, is "<file>.<function>" of
+// ADD_POINT, e.g. "replica_2pc.init_prepare", or the message of ADD_CUSTOM_POINT, which doesn't
+// change with unrelated edits as the line does. So a function should have at most one ADD_POINT,
+// and the messages should be unique.
 #define ADD_POINT(tracer)                                                                          \
-    (tracer)->add_point(fmt::format("{}:{}:{}", __FILENAME__, __LINE__, __FUNCTION__))
+    do {                                                                                           \
+        static const int __stage_id = ::dsn::utils::latency_tracer::register_stage(               \
+            fmt::format("{}:{}:{}", __FILENAME__, __LINE__, __FUNCTION__),                         \
+            ::dsn::utils::latency_tracer::point_metric_name(__FILENAME__, __FUNCTION__));          \
+        (tracer)->add_point(__stage_id);                                                           \
+    } while (0)
 #define ADD_CUSTOM_POINT(tracer, message)                                                          \
-    (tracer)->add_point(                                                                           \
-        fmt::format("{}:{}:{}[{}]", __FILENAME__, __LINE__, __FUNCTION__, (message)))
+    do {                                                                                           \
+        static const int __stage_id = ::dsn::utils::latency_tracer::register_stage(               \
+            fmt::format("{}:{}:{}[{}]", __FILENAME__, __LINE__, __FUNCTION__, (message)),          \
+            fmt::format("{}", (message)));                                                         \
+        (tracer)->add_point(__stage_id);                                                           \
+    } while (0)
 
 /**
  * latency_tracer is a tool for tracking the time spent in each of the stages during request
@@ -41,19 +61,19 @@ namespace utils {
  *
  * ```
  * class request {
- *      latency_tracer tracer;
+ *      std::shared_ptr<latency_tracer> tracer;
  * }
  * void start(request req){
- *      req.tracer.add_point("start");
+ *      ADD_CUSTOM_POINT(req.tracer, "start");
  * }
  * void stageA(request req){
- *      req.tracer.add_point("stageA");
+ *      ADD_CUSTOM_POINT(req.tracer, "stageA");
  * }
  * void stageB(request req){
- *      req.tracer.add_point("stageB");
+ *      ADD_CUSTOM_POINT(req.tracer, "stageB");
  * }
  * void end(request req){
- *      req.tracer.add_point("end");
+ *      ADD_CUSTOM_POINT(req.tracer, "end");
  * }
  * ```
  *
@@ -63,12 +83,34 @@ namespace utils {
  *  start---->stageA----->stageB---->end
  *
  * "request.tracer" will record the time duration among all trace points.
+ *
+ * The names of the stages are interned into ids by `register_stage`, and a point is just a
+ * stage id and a timestamp in a fixed-size array of the tracer, which is appended without any
+ * lock or allocation, so the tracer is cheap enough to be always enabled. Besides dumping the
+ * slow requests, the spans between the points can be aggregated by `for_each_span`, e.g. into
+ * the per-stage latency histograms.
 **/
 DSN_DECLARE_bool(enable_latency_tracer);
 
 class latency_tracer
 {
 public:
+    // at most MAX_STAGE_COUNT stages can be registered in a process, the stages registered
+    // after that are ignored
+    static const int MAX_STAGE_COUNT = 256;
+    // at most MAX_POINT_COUNT points are recorded by a tracer, the later ones are dropped
+    static const int MAX_POINT_COUNT = 32;
+
+    // get the id of stage `name`, which is registered if it's new. return -1 if there're too
+    // many stages.
+    // -metric_name: the stable name of the stage, see ADD_POINT. it's `name` if empty.
+    static int register_stage(const std::string &name, const std::string &metric_name = "");
+    static const std::string &stage_name(int stage_id);
+    static const std::string &stage_metric_name(int stage_id);
+    // the metric name of ADD_POINT, which is qualified by the file without the extension so
+    // that the functions of the same name in different classes don't collide
+    static std::string point_metric_name(const std::string &file_name, const char *function);
+
     //-is_sub:
     //  if `is_sub`=true means its points will be dumped by parent tracer and won't be dumped
     //  repeatedly in destructor
@@ -81,8 +123,14 @@ public:
     ~latency_tracer();
 
     // add a trace point to the tracer
-    // -name: user specified name of the trace point
-    void add_point(const std::string &stage_name);
+    // -stage_id: the id of the stage returned by `register_stage`
+    void add_point(int stage_id)
+    {
+        if (!FLAGS_enable_latency_tracer || stage_id < 0) {
+            return;
+        }
+        add_point_internal(stage_id);
+    }
 
     // sub_tracer is used for tracking the request which may transfer the other type,
     // for example: rdsn "rpc_message" will be convert to "mutation", the "tracking
@@ -93,16 +141,38 @@ public:
     // stageA[rpc_message]--stageB[rpc_message]--
     void set_sub_tracer(const std::shared_ptr<latency_tracer> &tracer);
 
+    // call `callback(stage_id, span_ns)` for each of the points recorded so far in time
+    // order, `span_ns` is the time elapsed since the previous point, or the start of the
+    // tracer for the first one. the sub tracer is not included.
+    void for_each_span(const std::function<void(int, uint64_t)> &callback) const;
+
 private:
-    void dump_trace_points(/*out*/ std::string &traces);
+    struct point
+    {
+        // 0 until the point is written
+        std::atomic<uint64_t> ts;
+        int stage_id;
+    };
+    struct point_value
+    {
+        uint64_t ts;
+        int stage_id;
+    };
 
-    utils::rw_lock_nr _lock;
+    void add_point_internal(int stage_id);
+    // get the points recorded so far in time order
+    int get_points(/*out*/ point_value *points) const;
+    void dump_trace_points(/*out*/ std::string &traces);
 
     const std::string _name;
     const uint64_t _threshold;
     bool _is_sub;
     const uint64_t _start_time;
-    std::map<int64_t, std::string> _points;
+
+    // a point is claimed by increasing `_point_count`, and it's visible to the readers after
+    // its `ts` is set. there is usually only one writer at a time.
+    std::atomic<int> _point_count;
+    point _points[MAX_POINT_COUNT];
     std::shared_ptr<latency_tracer> _sub_tracer;
 
     friend class latency_tracer_test;
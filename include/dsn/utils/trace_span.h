@@ -0,0 +1,107 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dsn/utility/flags.h>
+#include <dsn/utility/ports.h>
+
+namespace dsn {
+namespace utils {
+
+/**
+ * Sampled tracing of the requests across nodes.
+ *
+ * A request is sampled by setting `is_trace_sampled` in the context of its message header, and
+ * its `trace_id` is then kept by the rpcs sent on behalf of it (e.g. the prepare messages of a
+ * write), so the spans recorded on all of the nodes share the same trace id. The spans are
+ * put into a fixed-size lock-free ring of the process, in which the oldest spans are
+ * overwritten, and can be fetched by the http call "/tracing" in the Chrome trace event
+ * format.
+ *
+ * The callers keep the trace id of a sampled request (0 if it's not sampled), and only record
+ * spans when it's not 0, so an unsampled request just pays a branch.
+ */
+DSN_DECLARE_uint32(trace_sample_interval);
+
+struct trace_span
+{
+    uint64_t trace_id;
+    // should be a string literal, as only the pointer is kept
+    const char *name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    int32_t app_id;
+    int32_t partition_index;
+    int64_t decree;
+    int32_t tid;
+};
+
+class trace_span_ring
+{
+public:
+    // `capacity` is rounded up to a power of 2
+    explicit trace_span_ring(uint32_t capacity);
+
+    void add(const trace_span &span);
+
+    // get the spans in the ring ordered by the time they're added, only the spans of
+    // `trace_id` are returned if it's not 0. the spans being overwritten are skipped.
+    std::vector<trace_span> get_spans(uint64_t trace_id = 0) const;
+
+    uint32_t capacity() const { return _mask + 1; }
+
+private:
+    struct slot
+    {
+        // 2 * index + 1 while the span of `index` is being written, 2 * index + 2 after
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> trace_id;
+        std::atomic<const char *> name;
+        std::atomic<uint64_t> start_ns;
+        std::atomic<uint64_t> end_ns;
+        std::atomic<int32_t> app_id;
+        std::atomic<int32_t> partition_index;
+        std::atomic<int64_t> decree;
+        std::atomic<int32_t> tid;
+    };
+
+    uint32_t _mask;
+    std::unique_ptr<slot[]> _slots;
+    std::atomic<uint64_t> _next_index;
+};
+
+// the ring of the process, its capacity is [replication] trace_span_ring_capacity
+trace_span_ring &process_trace_spans();
+
+bool should_sample_trace_slow();
+
+// whether to sample a new request, one in every `trace_sample_interval` requests is sampled.
+// sampling is disabled if it's 0.
+inline bool should_sample_trace()
+{
+    return dsn_unlikely(FLAGS_trace_sample_interval != 0) && should_sample_trace_slow();
+}
+
+// record a span into the ring of the process
+void add_trace_span(uint64_t trace_id,
+                    const char *name,
+                    uint64_t start_ns,
+                    uint64_t end_ns,
+                    int32_t app_id = 0,
+                    int32_t partition_index = 0,
+                    int64_t decree = 0);
+
+// format the spans in the Chrome trace event format, which can be loaded by chrome://tracing
+// and the other trace viewers. the spans of different nodes can be merged by concatenating
+// the "traceEvents" arrays.
+void format_trace_spans(const std::vector<trace_span> &spans, /*out*/ std::string &json);
+
+} // namespace utils
+} // namespace dsn
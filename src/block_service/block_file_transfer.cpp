@@ -0,0 +1,361 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "block_file_transfer.h"
+
+#include <unistd.h>
+
+#include <fstream>
+
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
+
+namespace dsn {
+namespace dist {
+namespace block_service {
+
+DSN_DEFINE_uint32("replication",
+                  transfer_part_size_mb,
+                  64,
+                  "the size of a part of the files transferred to or from the block service");
+DSN_DEFINE_validator(transfer_part_size_mb, [](uint32_t value) { return value > 0; });
+
+DSN_DEFINE_uint32("replication",
+                  max_transfer_part_retries,
+                  3,
+                  "the max times a failed part of a transferred file is retried");
+
+DEFINE_TASK_CODE(LPC_BLOCK_SERVICE_TRANSFER, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+transfer_budget::transfer_budget(uint32_t max_concurrent_parts,
+                                 uint64_t max_rate_bytes,
+                                 uint64_t burst_bytes)
+    : _max_concurrent_parts(max_concurrent_parts), _burst_bytes(burst_bytes)
+{
+    if (max_rate_bytes > 0) {
+        _token_bucket.reset(new folly::TokenBucket(max_rate_bytes, burst_bytes));
+    }
+}
+
+bool transfer_budget::try_acquire(uint64_t bytes, /*out*/ uint64_t &delay_ms)
+{
+    uint32_t running = _running_parts.load();
+    do {
+        if (running >= _max_concurrent_parts) {
+            return false;
+        }
+    } while (!_running_parts.compare_exchange_weak(running, running + 1));
+
+    delay_ms = 0;
+    if (_token_bucket != nullptr) {
+        // borrow the tokens and delay the part until they're generated, rather than waiting
+        // for the tokens, so the parts are issued in the order they acquire the budget.
+        // the bucket can't borrow more than the burst at once, so a part larger than it (a
+        // whole file without multipart) is charged in slices, the last one waits the longest
+        for (uint64_t charged = 0; charged < bytes;) {
+            uint64_t slice = std::min(bytes - charged, _burst_bytes);
+            auto wait_seconds = _token_bucket->consumeWithBorrowNonBlocking(slice);
+            if (wait_seconds) {
+                delay_ms = std::max(delay_ms, static_cast<uint64_t>(*wait_seconds * 1000));
+            }
+            charged += slice;
+        }
+    }
+    return true;
+}
+
+void transfer_budget::release() { _running_parts.fetch_sub(1); }
+
+block_file_transfer::block_file_transfer(direction dir,
+                                         block_file_ptr file,
+                                         const std::string &local_file_name,
+                                         transfer_budget *budget,
+                                         task_tracker *tracker,
+                                         callback cb)
+    : _dir(dir),
+      _file(std::move(file)),
+      _local_file_name(local_file_name),
+      _budget(budget),
+      _tracker(tracker),
+      _cb(std::move(cb))
+{
+}
+
+void block_file_transfer::start()
+{
+    const uint64_t part_size = static_cast<uint64_t>(FLAGS_transfer_part_size_mb) << 20;
+    if (_dir == direction::UPLOAD) {
+        int64_t file_size = 0;
+        if (!utils::filesystem::file_size(_local_file_name, file_size)) {
+            derror_f("get size of file({}) failed", _local_file_name);
+            _cb(ERR_FILE_OPERATION_FAILED, 0, std::string());
+            return;
+        }
+        _file_size = static_cast<uint64_t>(file_size);
+    } else {
+        _file_size = _file->get_size();
+    }
+
+    _multipart = _file->supports_multipart() && _file_size > part_size;
+    if (!_multipart) {
+        _parts.push_back(part{0, -1, part_status::PENDING, 0});
+        if (_dir == direction::DOWNLOAD) {
+            // the file is downloaded as a whole, the parts of the last download are useless
+            utils::filesystem::remove_path(get_parts_file(_local_file_name));
+        }
+    } else {
+        for (uint64_t offset = 0; offset < _file_size; offset += part_size) {
+            int64_t length = static_cast<int64_t>(std::min(part_size, _file_size - offset));
+            _parts.push_back(part{offset, length, part_status::PENDING, 0});
+        }
+        if (_dir == direction::DOWNLOAD) {
+            error_code err = prepare_download();
+            if (err != ERR_OK) {
+                _cb(err, 0, std::string());
+                return;
+            }
+        }
+    }
+
+    schedule_parts();
+}
+
+error_code block_file_transfer::prepare_download()
+{
+    const std::string parts_file = get_parts_file(_local_file_name);
+    if (utils::filesystem::file_exists(parts_file) &&
+        utils::filesystem::file_exists(_local_file_name)) {
+        load_finished_parts();
+    }
+    if (_transferred_size > 0) {
+        return ERR_OK;
+    }
+
+    // download from scratch: the parts are written to the file of the final size concurrently
+    if (!utils::filesystem::create_file(_local_file_name) ||
+        ::truncate(_local_file_name.c_str(), static_cast<off_t>(_file_size)) != 0) {
+        derror_f("prepare file({}) of size {} for download failed",
+                 _local_file_name,
+                 _file_size);
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    std::ofstream os(parts_file, std::ios::out | std::ios::trunc);
+    os << _file_size << ' ' << _file->get_md5sum() << ' ' << FLAGS_transfer_part_size_mb << '\n';
+    os.close();
+    if (!os) {
+        derror_f("create file({}) failed", parts_file);
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    return ERR_OK;
+}
+
+void block_file_transfer::load_finished_parts()
+{
+    const std::string parts_file = get_parts_file(_local_file_name);
+    std::ifstream is(parts_file);
+    uint64_t file_size = 0;
+    std::string md5;
+    uint32_t part_size_mb = 0;
+    if (!(is >> file_size >> md5 >> part_size_mb) || file_size != _file_size ||
+        md5 != _file->get_md5sum() || part_size_mb != FLAGS_transfer_part_size_mb) {
+        dwarn_f("the parts of file({}) downloaded before are outdated, download it from scratch",
+                _local_file_name);
+        return;
+    }
+
+    int finished_parts = 0;
+    int index = 0;
+    while (is >> index) {
+        if (index >= 0 && index < _parts.size() && _parts[index].status != part_status::DONE) {
+            _parts[index].status = part_status::DONE;
+            _transferred_size += _parts[index].length;
+            finished_parts++;
+        }
+    }
+    ddebug_f("resume downloading file({}), {} of {} parts have been downloaded",
+             _local_file_name,
+             finished_parts,
+             _parts.size());
+}
+
+void block_file_transfer::schedule_parts()
+{
+    block_file_transfer_ptr self(this);
+    while (true) {
+        int index = -1;
+        uint64_t delay_ms = 0;
+        {
+            zauto_lock l(_lock);
+            if (_finished || _waiting_for_budget) {
+                return;
+            }
+            if (_err == ERR_OK) {
+                for (int i = 0; i < _parts.size(); i++) {
+                    if (_parts[i].status == part_status::PENDING) {
+                        index = i;
+                        break;
+                    }
+                }
+            }
+            if (index == -1) {
+                if (_running_parts > 0) {
+                    return;
+                }
+                _finished = true;
+                break;
+            }
+
+            const part &p = _parts[index];
+            uint64_t bytes = p.length == -1 ? _file_size : static_cast<uint64_t>(p.length);
+            if (!_budget->try_acquire(bytes, delay_ms)) {
+                if (_running_parts > 0) {
+                    // scheduled again when a running part is done
+                    return;
+                }
+                _waiting_for_budget = true;
+                tasking::enqueue(LPC_BLOCK_SERVICE_TRANSFER,
+                                 _tracker,
+                                 [this, self]() {
+                                     {
+                                         zauto_lock l(_lock);
+                                         _waiting_for_budget = false;
+                                     }
+                                     schedule_parts();
+                                 },
+                                 0,
+                                 std::chrono::milliseconds(100));
+                return;
+            }
+            _parts[index].status = part_status::RUNNING;
+            _running_parts++;
+        }
+
+        if (delay_ms > 0) {
+            tasking::enqueue(LPC_BLOCK_SERVICE_TRANSFER,
+                             _tracker,
+                             [this, self, index]() { transfer_part(index); },
+                             0,
+                             std::chrono::milliseconds(delay_ms));
+        } else {
+            transfer_part(index);
+        }
+    }
+
+    finish();
+}
+
+void block_file_transfer::transfer_part(int index)
+{
+    block_file_transfer_ptr self(this);
+    // the range of a part is never changed, so it's read without the lock
+    const part &p = _parts[index];
+    if (_dir == direction::UPLOAD) {
+        upload_request req;
+        req.input_local_name = _local_file_name;
+        if (_multipart) {
+            req.part_offset = p.offset;
+            req.part_length = p.length;
+        }
+        _file->upload(req,
+                      TASK_CODE_EXEC_INLINED,
+                      [this, self, index](const upload_response &resp) {
+                          on_part_transferred(index, resp.err, resp.uploaded_size, std::string());
+                      },
+                      _tracker);
+    } else {
+        download_request req{_local_file_name, p.offset, p.length};
+        req.is_part = _multipart;
+        _file->download(req,
+                        TASK_CODE_EXEC_INLINED,
+                        [this, self, index](const download_response &resp) {
+                            on_part_transferred(
+                                index, resp.err, resp.downloaded_size, resp.file_md5);
+                        },
+                        _tracker);
+    }
+}
+
+void block_file_transfer::on_part_transferred(int index,
+                                              error_code err,
+                                              uint64_t transferred_size,
+                                              const std::string &file_md5)
+{
+    _budget->release();
+    {
+        zauto_lock l(_lock);
+        _running_parts--;
+        part &p = _parts[index];
+        if (err == ERR_OK && p.length != -1 && transferred_size != p.length) {
+            dwarn_f("part {} of file({}) is transferred partially, {} of {} bytes",
+                    index,
+                    _local_file_name,
+                    transferred_size,
+                    p.length);
+            err = ERR_FS_INTERNAL;
+        }
+
+        if (err == ERR_OK) {
+            p.status = part_status::DONE;
+            _transferred_size += transferred_size;
+            if (!_multipart) {
+                _file_md5 = file_md5;
+            }
+            if (_dir == direction::DOWNLOAD && _multipart) {
+                std::ofstream os(get_parts_file(_local_file_name), std::ios::out | std::ios::app);
+                os << index << '\n';
+            }
+        } else if (_err == ERR_OK && err != ERR_OBJECT_NOT_FOUND &&
+                   ++p.retries <= FLAGS_max_transfer_part_retries) {
+            dwarn_f("transfer part {} of file({}) failed with error({}), retry it",
+                    index,
+                    _local_file_name,
+                    err.to_string());
+            p.status = part_status::PENDING;
+        } else {
+            derror_f("transfer part {} of file({}) failed with error({})",
+                     index,
+                     _local_file_name,
+                     err.to_string());
+            if (_err == ERR_OK) {
+                _err = err;
+            }
+        }
+    }
+    schedule_parts();
+}
+
+void block_file_transfer::finish()
+{
+    // the parts downloaded are kept if failed, to be resumed by the next download
+    if (_err != ERR_OK) {
+        _cb(_err, 0, std::string());
+        return;
+    }
+    if (!_multipart) {
+        _cb(ERR_OK, _transferred_size, _file_md5);
+        return;
+    }
+
+    if (_dir == direction::DOWNLOAD) {
+        utils::filesystem::remove_path(get_parts_file(_local_file_name));
+        _cb(ERR_OK, _transferred_size, std::string());
+        return;
+    }
+
+    block_file_transfer_ptr self(this);
+    upload_request req;
+    req.input_local_name = _local_file_name;
+    _file->complete_multipart_upload(
+        req,
+        TASK_CODE_EXEC_INLINED,
+        [this, self](const upload_response &resp) {
+            _cb(resp.err, resp.err == ERR_OK ? resp.uploaded_size : 0, std::string());
+        },
+        _tracker);
+}
+
+} // namespace block_service
+} // namespace dist
+} // namespace dsn
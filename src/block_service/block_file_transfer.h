@@ -0,0 +1,141 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <dsn/dist/block_service.h>
+#include <dsn/tool-api/zlocks.h>
+#include <dsn/utility/TokenBucket.h>
+
+namespace dsn {
+namespace dist {
+namespace block_service {
+
+// The budget of the transfers between the local disk and the remote block service of a
+// service node, shared by cold backup, restore and bulk load, so that they together won't
+// saturate the disk or the network however many replicas are transferring at the same time.
+//
+// A transfer acquires the budget for each part of a file: the number of the parts transferred
+// concurrently is limited by [replication] max_concurrent_transfer_parts, and the bytes per
+// second by [replication] max_transfer_rate_mb.
+class transfer_budget
+{
+public:
+    // max_rate_bytes == 0 means unlimited, burst_bytes should be no less than a part
+    transfer_budget(uint32_t max_concurrent_parts, uint64_t max_rate_bytes, uint64_t burst_bytes);
+
+    // return false if all the slots are in use. otherwise a slot is acquired, and the part
+    // should be transferred after `delay_ms` to keep the byte rate.
+    bool try_acquire(uint64_t bytes, /*out*/ uint64_t &delay_ms);
+    void release();
+
+    uint32_t running_parts() const { return _running_parts.load(); }
+
+private:
+    const uint32_t _max_concurrent_parts;
+    std::atomic<uint32_t> _running_parts{0};
+
+    const uint64_t _burst_bytes;
+    std::unique_ptr<folly::TokenBucket> _token_bucket;
+};
+
+// Transfer a file between the local disk and the remote block service in parts of
+// [replication] transfer_part_size_mb, under the transfer_budget.
+//
+// If the block_file doesn't support multipart, the whole file is transferred as a single part.
+// Otherwise the parts are transferred concurrently, and a failed part is retried for several
+// times before the transfer fails. The parts finished by a download are recorded in
+// "<local_file_name>.parts", so that a download interrupted by a failure or a restart is
+// resumed from the unfinished parts, as long as the remote file is not changed.
+//
+// The callback is called exactly once with the error and the size of the file transferred.
+// All the tasks are tracked by `tracker`, so waiting for it waits for the whole transfer.
+class block_file_transfer : public ref_counter
+{
+public:
+    enum class direction
+    {
+        UPLOAD,
+        DOWNLOAD
+    };
+    // file_md5 is the md5 of the downloaded file if it's computed during the download,
+    // otherwise empty
+    typedef std::function<void(
+        error_code err, uint64_t transferred_size, const std::string &file_md5)>
+        callback;
+
+    // for DOWNLOAD, the metadata of `file` should be fetched already
+    block_file_transfer(direction dir,
+                        block_file_ptr file,
+                        const std::string &local_file_name,
+                        transfer_budget *budget,
+                        task_tracker *tracker,
+                        callback cb);
+
+    void start();
+
+    static std::string get_parts_file(const std::string &local_file_name)
+    {
+        return local_file_name + ".parts";
+    }
+
+private:
+    enum class part_status
+    {
+        PENDING,
+        RUNNING,
+        DONE
+    };
+
+    struct part
+    {
+        uint64_t offset;
+        // -1 for the whole file
+        int64_t length;
+        part_status status;
+        int retries;
+    };
+
+    error_code prepare_download();
+    void load_finished_parts();
+
+    // issue the pending parts as the budget allows, and finish the transfer if all done
+    void schedule_parts();
+    void transfer_part(int index);
+    void on_part_transferred(int index,
+                             error_code err,
+                             uint64_t transferred_size,
+                             const std::string &file_md5);
+    void finish();
+
+    const direction _dir;
+    const block_file_ptr _file;
+    const std::string _local_file_name;
+    transfer_budget *_budget;
+    task_tracker *_tracker;
+    callback _cb;
+
+    bool _multipart{false};
+    uint64_t _file_size{0};
+
+    zlock _lock;
+    std::vector<part> _parts;
+    int _running_parts{0};
+    bool _waiting_for_budget{false};
+    bool _finished{false};
+    error_code _err;
+    uint64_t _transferred_size{0};
+    std::string _file_md5;
+};
+
+typedef dsn::ref_ptr<block_file_transfer> block_file_transfer_ptr;
+
+} // namespace block_service
+} // namespace dist
+} // namespace dsn
@@ -9,11 +9,27 @@
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/factory_store.h>
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
 
 namespace dsn {
 namespace dist {
 namespace block_service {
 
+DSN_DEFINE_uint32("replication",
+                  max_concurrent_transfer_parts,
+                  8,
+                  "the max number of the file parts transferred to or from the block service "
+                  "concurrently by a node, shared by cold backup, restore and bulk load");
+DSN_DEFINE_validator(max_concurrent_transfer_parts, [](uint32_t value) { return value > 0; });
+
+DSN_DEFINE_uint32("replication",
+                  max_transfer_rate_mb,
+                  0,
+                  "the max rate(MB/s) of the files transferred to or from the block service by a "
+                  "node, shared by cold backup, restore and bulk load, 0 means unlimited");
+
+DSN_DECLARE_uint32(transfer_part_size_mb);
+
 block_service_registry::block_service_registry()
 {
     bool ans;
@@ -29,7 +45,12 @@ block_service_registry::block_service_registry()
 block_service_manager::block_service_manager()
     : // we got a instance of block_service_registry each time we create a block_service_manger
       // to make sure that the filesystem providers are registered
-      _registry_holder(block_service_registry::instance())
+      _registry_holder(block_service_registry::instance()),
+      _transfer_budget(FLAGS_max_concurrent_transfer_parts,
+                       static_cast<uint64_t>(FLAGS_max_transfer_rate_mb) << 20,
+                       static_cast<uint64_t>(std::max(FLAGS_max_transfer_rate_mb,
+                                                      FLAGS_transfer_part_size_mb))
+                           << 20)
 {
 }
 
@@ -89,128 +110,171 @@ error_code block_service_manager::download_file(const std::string &remote_dir,
                                                 const std::string &local_dir,
                                                 const std::string &file_name,
                                                 block_filesystem *fs,
-                                                /*out*/ uint64_t &download_file_size)
+                                                /*out*/ uint64_t &download_file_size,
+                                                /*out*/ std::string &download_file_md5)
+{
+    return download_file(
+        remote_dir, file_name, local_dir, file_name, fs, download_file_size, download_file_md5);
+}
+
+error_code block_service_manager::download_file(const std::string &remote_dir,
+                                                const std::string &remote_file_name,
+                                                const std::string &local_dir,
+                                                const std::string &local_file_name,
+                                                block_filesystem *fs,
+                                                /*out*/ uint64_t &download_file_size,
+                                                /*out*/ std::string &download_file_md5)
 {
     error_code download_err = ERR_OK;
     task_tracker tracker;
-
-    auto download_file_callback_func = [&download_err, &download_file_size](
-        const download_response &resp, block_file_ptr bf, const std::string &local_file_name) {
-        if (resp.err != ERR_OK) {
-            // during bulk load process, ERR_OBJECT_NOT_FOUND will be considered as a recoverable
-            // error, however, if file damaged on remote file provider, bulk load should stop,
-            // return ERR_CORRUPTION instead
-            if (resp.err == ERR_OBJECT_NOT_FOUND) {
-                derror_f("download file({}) failed, file on remote file provider is damaged",
-                         local_file_name);
-                download_err = ERR_CORRUPTION;
-            } else {
-                download_err = resp.err;
+    download_file_async(
+        remote_dir,
+        remote_file_name,
+        local_dir,
+        local_file_name,
+        fs,
+        &tracker,
+        [&download_err, &download_file_size, &download_file_md5](
+            error_code err, uint64_t file_size, const std::string &file_md5) {
+            download_err = err;
+            if (err == ERR_OK) {
+                download_file_size = file_size;
+                download_file_md5 = file_md5;
             }
-            return;
-        }
+        });
+    tracker.wait_outstanding_tasks();
+    return download_err;
+}
 
-        if (resp.downloaded_size != bf->get_size()) {
-            derror_f(
-                "size not match while downloading file({}), file_size({}) vs downloaded_size({})",
-                bf->file_name(),
-                bf->get_size(),
-                resp.downloaded_size);
-            download_err = ERR_CORRUPTION;
-            return;
+// verify the downloaded file with the remote one
+static void on_file_downloaded(const download_response &resp,
+                               const block_file_ptr &bf,
+                               const std::string &local_file_name,
+                               const block_service_manager::download_file_callback &cb)
+{
+    if (resp.err != ERR_OK) {
+        // during bulk load process, ERR_OBJECT_NOT_FOUND will be considered as a recoverable
+        // error, however, if file damaged on remote file provider, bulk load should stop,
+        // return ERR_CORRUPTION instead
+        if (resp.err == ERR_OBJECT_NOT_FOUND) {
+            derror_f("download file({}) failed, file on remote file provider is damaged",
+                     local_file_name);
+            cb(ERR_CORRUPTION, 0, std::string());
+        } else {
+            cb(resp.err, 0, std::string());
         }
+        return;
+    }
 
-        std::string current_md5;
+    if (resp.downloaded_size != bf->get_size()) {
+        derror_f("size not match while downloading file({}), file_size({}) vs downloaded_size({})",
+                 bf->file_name(),
+                 bf->get_size(),
+                 resp.downloaded_size);
+        cb(ERR_CORRUPTION, 0, std::string());
+        return;
+    }
+
+    // the md5 may be computed during the download, which saves a read of the file
+    std::string current_md5 = resp.file_md5;
+    if (current_md5.empty()) {
         error_code e = utils::filesystem::md5sum(local_file_name, current_md5);
         if (e != ERR_OK) {
             derror_f("calculate file({}) md5 failed", local_file_name);
-            download_err = e;
-            return;
-        }
-        if (current_md5 != bf->get_md5sum()) {
-            derror_f("local file({}) is different from remote file({}), download failed, md5: "
-                     "local({}) VS remote({})",
-                     local_file_name,
-                     bf->file_name(),
-                     current_md5,
-                     bf->get_md5sum());
-            download_err = ERR_CORRUPTION;
+            cb(e, 0, std::string());
             return;
         }
-        ddebug_f("download file({}) succeed, file_size = {}",
-                 local_file_name.c_str(),
-                 resp.downloaded_size);
-        download_err = ERR_OK;
-        download_file_size = resp.downloaded_size;
-    };
+    }
+    if (current_md5 != bf->get_md5sum()) {
+        derror_f("local file({}) is different from remote file({}), download failed, md5: "
+                 "local({}) VS remote({})",
+                 local_file_name,
+                 bf->file_name(),
+                 current_md5,
+                 bf->get_md5sum());
+        cb(ERR_CORRUPTION, 0, std::string());
+        return;
+    }
+    ddebug_f("download file({}) succeed, file_size = {}", local_file_name, resp.downloaded_size);
+    cb(ERR_OK, resp.downloaded_size, current_md5);
+}
 
-    auto create_file_cb = [&local_dir,
-                           &download_err,
-                           &download_file_size,
-                           &download_file_callback_func,
-                           &tracker](const create_file_response &resp, const std::string &fname) {
+void block_service_manager::download_file_async(const std::string &remote_dir,
+                                                const std::string &remote_file_name,
+                                                const std::string &local_dir,
+                                                const std::string &local_file_name,
+                                                block_filesystem *fs,
+                                                task_tracker *tracker,
+                                                download_file_callback cb)
+{
+    const std::string local_file = utils::filesystem::path_combine(local_dir, local_file_name);
+    auto create_file_cb = [this, local_file, tracker, cb](const create_file_response &resp) {
         if (resp.err != ERR_OK) {
-            derror_f("create file({}) failed with error({})", fname, resp.err.to_string());
-            download_err = resp.err;
+            derror_f("create file({}) failed with error({})", local_file, resp.err.to_string());
+            cb(resp.err, 0, std::string());
             return;
         }
 
-        block_file *bf = resp.file_handle.get();
-        if (bf->get_md5sum().empty()) {
-            derror_f("file({}) doesn't exist on remote file provider", bf->file_name());
-            download_err = ERR_CORRUPTION;
+        block_file_ptr file_handle = resp.file_handle;
+        if (file_handle->get_md5sum().empty()) {
+            derror_f("file({}) doesn't exist on remote file provider", file_handle->file_name());
+            cb(ERR_CORRUPTION, 0, std::string());
             return;
         }
 
-        const std::string &local_file_name = utils::filesystem::path_combine(local_dir, fname);
-        // local file exists
-        if (utils::filesystem::file_exists(local_file_name)) {
+        // local file exists, and it's not downloaded partially
+        if (utils::filesystem::file_exists(local_file) &&
+            !utils::filesystem::file_exists(block_file_transfer::get_parts_file(local_file))) {
             std::string current_md5;
-            error_code e = utils::filesystem::md5sum(local_file_name, current_md5);
-            if (e != ERR_OK || current_md5 != bf->get_md5sum()) {
+            error_code e = utils::filesystem::md5sum(local_file, current_md5);
+            if (e != ERR_OK || current_md5 != file_handle->get_md5sum()) {
                 if (e != ERR_OK) {
                     dwarn_f("calculate file({}) md5 failed, should remove and redownload it",
-                            local_file_name);
+                            local_file);
                 } else {
                     dwarn_f("local file({}) is different from remote file({}), md5: local({}) VS "
                             "remote({}), should remove and redownload it",
-                            local_file_name,
-                            bf->file_name(),
+                            local_file,
+                            file_handle->file_name(),
                             current_md5,
-                            bf->get_md5sum());
+                            file_handle->get_md5sum());
                 }
-                if (!utils::filesystem::remove_path(local_file_name)) {
-                    derror_f("failed to remove file({})", local_file_name);
-                    download_err = e;
+                if (!utils::filesystem::remove_path(local_file)) {
+                    derror_f("failed to remove file({})", local_file);
+                    cb(e, 0, std::string());
                     return;
                 }
             } else {
-                download_err = ERR_OK;
-                download_file_size = bf->get_size();
                 ddebug_f("local file({}) has been downloaded, file size = {}",
-                         local_file_name,
-                         download_file_size);
+                         local_file,
+                         file_handle->get_size());
+                cb(ERR_OK, file_handle->get_size(), current_md5);
                 return;
             }
         }
 
-        // download or redownload file
-        bf->download(download_request{local_file_name, 0, -1},
-                     TASK_CODE_EXEC_INLINED,
-                     std::bind(download_file_callback_func,
-                               std::placeholders::_1,
-                               resp.file_handle,
-                               local_file_name),
-                     &tracker);
+        // download, redownload or resume downloading file
+        block_file_transfer_ptr transfer = new block_file_transfer(
+            block_file_transfer::direction::DOWNLOAD,
+            file_handle,
+            local_file,
+            &_transfer_budget,
+            tracker,
+            [file_handle, local_file, cb](
+                error_code err, uint64_t downloaded_size, const std::string &file_md5) {
+                on_file_downloaded(download_response{err, downloaded_size, file_md5},
+                                   file_handle,
+                                   local_file,
+                                   cb);
+            });
+        transfer->start();
     };
 
-    const std::string remote_file_name = utils::filesystem::path_combine(remote_dir, file_name);
-    fs->create_file(create_file_request{remote_file_name, false},
-                    TASK_CODE_EXEC_INLINED,
-                    std::bind(create_file_cb, std::placeholders::_1, file_name),
-                    &tracker);
-    tracker.wait_outstanding_tasks();
-    return download_err;
+    fs->create_file(
+        create_file_request{utils::filesystem::path_combine(remote_dir, remote_file_name), false},
+        TASK_CODE_EXEC_INLINED,
+        create_file_cb,
+        tracker);
 }
 
 } // namespace block_service
@@ -8,6 +8,8 @@
 #include <dsn/utility/singleton_store.h>
 #include <dsn/tool-api/zlocks.h>
 
+#include "block_file_transfer.h"
+
 namespace dsn {
 namespace dist {
 namespace block_service {
@@ -28,19 +30,52 @@ public:
     block_service_manager();
     block_filesystem *get_block_filesystem(const std::string &provider);
 
-    // download files from remote file system
+    // download files from remote file system, in parts under the transfer budget. a download
+    // failed halfway is resumed by the next call with the same local file.
     // \return  ERR_FILE_OPERATION_FAILED: local file system error
     // \return  ERR_FS_INTERNAL: remote file system error
     // \return  ERR_CORRUPTION: file not exist or damaged
-    // if download file succeed, download_err = ERR_OK and set download_file_size
+    // if download file succeed, download_err = ERR_OK and set download_file_size and
+    // download_file_md5, which is verified with the remote file already, so the caller needn't
+    // read the file again to verify it
     error_code download_file(const std::string &remote_dir,
                              const std::string &local_dir,
                              const std::string &file_name,
                              block_filesystem *fs,
-                             /*out*/ uint64_t &download_file_size);
+                             /*out*/ uint64_t &download_file_size,
+                             /*out*/ std::string &download_file_md5);
+
+    // download the remote file `remote_dir/remote_file_name` to `local_dir/local_file_name`,
+    // for the files not named the same as remote, such as the shared files of cold backup
+    error_code download_file(const std::string &remote_dir,
+                             const std::string &remote_file_name,
+                             const std::string &local_dir,
+                             const std::string &local_file_name,
+                             block_filesystem *fs,
+                             /*out*/ uint64_t &download_file_size,
+                             /*out*/ std::string &download_file_md5);
+
+    typedef std::function<void(
+        error_code err, uint64_t download_file_size, const std::string &download_file_md5)>
+        download_file_callback;
+
+    // the asynchronous version of download_file, which makes it possible to download many files
+    // concurrently without a thread for each. the callback is called exactly once with the same
+    // result as download_file, and all the tasks are tracked by `tracker`.
+    void download_file_async(const std::string &remote_dir,
+                             const std::string &remote_file_name,
+                             const std::string &local_dir,
+                             const std::string &local_file_name,
+                             block_filesystem *fs,
+                             task_tracker *tracker,
+                             download_file_callback cb);
+
+    // the budget shared by all the transfers of the node, including the uploads of cold backup
+    transfer_budget *get_transfer_budget() { return &_transfer_budget; }
 
 private:
     block_service_registry &_registry_holder;
+    transfer_budget _transfer_budget;
 
     mutable zrwlock_nr _fs_lock;
     std::map<std::string, std::unique_ptr<block_filesystem>> _fs_map;
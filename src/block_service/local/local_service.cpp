@@ -1,4 +1,5 @@
 #include <memory>
+#include <unistd.h>
 
 #include <dsn/utility/filesystem.h>
 #include <dsn/utility/error_code.h>
@@ -11,8 +12,6 @@
 #include <dsn/tool-api/task_tracker.h>
 #include "local_service.h"
 
-static const int max_length = 2048; // max data length read from file each time
-
 namespace dsn {
 namespace dist {
 namespace block_service {
@@ -443,57 +442,64 @@ dsn::task_ptr local_file_object::upload(const upload_request &req,
     add_ref();
     upload_future_ptr tsk(new upload_future(code, cb, 0));
     tsk->set_tracker(tracker);
+    if (req.part_length != -1) {
+        auto upload_part_func = [this, req, tsk]() {
+            upload_response resp;
+            resp.err = ERR_OK;
+            resp.uploaded_size = 0;
+            // the parts are written concurrently, so the target file mustn't be truncated:
+            // copy_file_part() creates it without O_TRUNC, only its directory is created here
+            int64_t copied_sz = 0;
+            if (!utils::filesystem::file_exists(req.input_local_name)) {
+                dwarn("source file %s doesn't exist", req.input_local_name.c_str());
+                resp.err = ERR_FILE_OPERATION_FAILED;
+            } else if (!utils::filesystem::create_directory(
+                           utils::filesystem::remove_file_name(file_name()))) {
+                dwarn("create directory of target file %s failed", file_name().c_str());
+                resp.err = ERR_FS_INTERNAL;
+            } else if (utils::filesystem::copy_file_part(req.input_local_name,
+                                                         file_name(),
+                                                         req.part_offset,
+                                                         req.part_length,
+                                                         copied_sz) != ERR_OK) {
+                resp.err = ERR_FS_INTERNAL;
+            }
+            resp.uploaded_size = static_cast<uint64_t>(copied_sz);
+            tsk->enqueue_with(resp);
+            release_ref();
+        };
+        ::dsn::tasking::enqueue(LPC_LOCAL_SERVICE_CALL, nullptr, std::move(upload_part_func));
+        return tsk;
+    }
+
     auto upload_file_func = [this, req, tsk]() {
         upload_response resp;
         resp.err = ERR_OK;
-        std::ifstream fin(req.input_local_name, std::ios_base::in);
-        if (!fin.is_open()) {
-            dwarn("open source file %s for read failed, err(%s)",
-                  req.input_local_name.c_str(),
-                  utils::safe_strerror(errno).c_str());
+        resp.uploaded_size = 0;
+        if (!utils::filesystem::file_exists(req.input_local_name)) {
+            dwarn("source file %s doesn't exist", req.input_local_name.c_str());
             resp.err = ERR_FILE_OPERATION_FAILED;
-        }
-
-        utils::filesystem::create_file(file_name());
-        std::ofstream fout(file_name(), std::ios_base::out | std::ios_base::trunc);
-        if (!fout.is_open()) {
-            dwarn("open target file %s for write failed, err(%s)",
-                  file_name().c_str(),
-                  utils::safe_strerror(errno).c_str());
+        } else if (!utils::filesystem::create_file(file_name())) {
+            dwarn("create target file %s failed", file_name().c_str());
             resp.err = ERR_FS_INTERNAL;
-        }
-
-        if (resp.err == ERR_OK) {
+        } else {
             dinfo("start to transfer from src_file(%s) to des_file(%s)",
                   req.input_local_name.c_str(),
                   file_name().c_str());
+            // the md5sum is computed during the copy rather than by reading the source again
             int64_t total_sz = 0;
-            char buf[max_length] = {'\0'};
-            while (!fin.eof()) {
-                fin.read(buf, max_length);
-                total_sz += fin.gcount();
-                fout.write(buf, fin.gcount());
-            }
-            dinfo("finish upload file, file = %s, total_size = %d", file_name().c_str(), total_sz);
-            fout.close();
-            fin.close();
-
-            resp.uploaded_size = static_cast<uint64_t>(total_sz);
-
-            // calc the md5sum by source file for simplicity
-            _size = total_sz;
-            error_code res = utils::filesystem::md5sum(req.input_local_name, _md5_value);
-            if (res == dsn::ERR_OK) {
+            if (utils::filesystem::copy_file_with_md5(
+                    req.input_local_name, file_name(), total_sz, _md5_value) != ERR_OK) {
+                resp.err = ERR_FS_INTERNAL;
+            } else {
+                dinfo("finish upload file, file = %s, total_size = %" PRId64,
+                      file_name().c_str(),
+                      total_sz);
+                resp.uploaded_size = static_cast<uint64_t>(total_sz);
+                _size = total_sz;
                 _has_meta_synced = true;
                 store_metadata();
-            } else {
-                resp.err = ERR_FS_INTERNAL;
             }
-        } else {
-            if (fin.is_open())
-                fin.close();
-            if (fout.is_open())
-                fout.close();
         }
 
         tsk->enqueue_with(resp);
@@ -509,10 +515,36 @@ dsn::task_ptr local_file_object::download(const download_request &req,
                                           const download_callback &cb,
                                           task_tracker *tracker)
 {
-    // download the whole file
     add_ref();
     download_future_ptr tsk(new download_future(code, cb, 0));
     tsk->set_tracker(tracker);
+    if (req.is_part) {
+        auto download_part_func = [this, req, tsk]() {
+            download_response resp;
+            resp.err = ERR_OK;
+            resp.downloaded_size = 0;
+            // the target file is created by the caller and the parts are written to it
+            // concurrently, so it mustn't be truncated
+            int64_t copied_sz = 0;
+            if (!utils::filesystem::file_exists(file_name())) {
+                derror("block file(%s) doesn't exist", file_name().c_str());
+                resp.err = ERR_OBJECT_NOT_FOUND;
+            } else if (utils::filesystem::copy_file_part(file_name(),
+                                                         req.output_local_name,
+                                                         req.remote_pos,
+                                                         req.remote_length,
+                                                         copied_sz) != ERR_OK) {
+                resp.err = ERR_FILE_OPERATION_FAILED;
+            }
+            resp.downloaded_size = static_cast<uint64_t>(copied_sz);
+            tsk->enqueue_with(resp);
+            release_ref();
+        };
+        ::dsn::tasking::enqueue(LPC_LOCAL_SERVICE_CALL, nullptr, std::move(download_part_func));
+        return tsk;
+    }
+
+    // download the whole file
     auto download_file_func = [this, req, tsk]() {
         download_response resp;
         resp.err = ERR_OK;
@@ -532,48 +564,27 @@ dsn::task_ptr local_file_object::download(const download_request &req,
         }
 
         if (resp.err == ERR_OK) {
-            std::ifstream fin(file_name(), std::ifstream::in);
-            if (!fin.is_open()) {
-                derror("open block file(%s) failed, err(%s)",
+            dinfo("start to transfer, src_file(%s), des_file(%s)",
+                  file_name().c_str(),
+                  target_file.c_str());
+            // the md5sum is computed during the copy, and returned to the caller so that the
+            // downloaded file needn't be read again for verification
+            int64_t total_sz = 0;
+            resp.err = utils::filesystem::copy_file_with_md5(
+                file_name(), target_file, total_sz, resp.file_md5);
+            if (resp.err != ERR_OK) {
+                derror("download block file(%s) to %s failed",
                        file_name().c_str(),
-                       utils::safe_strerror(errno).c_str());
-                resp.err = ERR_FS_INTERNAL;
-            }
-
-            std::ofstream fout(target_file, std::ios_base::out | std::ios_base::trunc);
-            if (!fout.is_open()) {
-                if (fin.is_open())
-                    fin.close();
-                derror("open target file(%s) failed, err(%s)",
-                       target_file.c_str(),
-                       utils::safe_strerror(errno).c_str());
+                       target_file.c_str());
                 resp.err = ERR_FILE_OPERATION_FAILED;
-            }
-
-            if (resp.err == ERR_OK) {
-                dinfo("start to transfer, src_file(%s), des_file(%s)",
-                      file_name().c_str(),
-                      target_file.c_str());
-                int64_t total_sz = 0;
-                char buf[max_length] = {'\0'};
-                while (!fin.eof()) {
-                    fin.read(buf, max_length);
-                    total_sz += fin.gcount();
-                    fout.write(buf, fin.gcount());
-                }
-                dinfo("finish download file(%s), total_size = %d", target_file.c_str(), total_sz);
-                fout.close();
-                fin.close();
+            } else {
+                dinfo("finish download file(%s), total_size = %" PRId64,
+                      target_file.c_str(),
+                      total_sz);
                 resp.downloaded_size = static_cast<uint64_t>(total_sz);
-
                 _size = total_sz;
-                if ((resp.err = utils::filesystem::md5sum(target_file, _md5_value)) != ERR_OK) {
-                    dwarn("download %s failed when calculate the md5sum of %s",
-                          file_name().c_str(),
-                          target_file.c_str());
-                } else {
-                    _has_meta_synced = true;
-                }
+                _md5_value = resp.file_md5;
+                _has_meta_synced = true;
             }
         }
 
@@ -584,6 +595,47 @@ dsn::task_ptr local_file_object::download(const download_request &req,
 
     return tsk;
 }
+dsn::task_ptr local_file_object::complete_multipart_upload(const upload_request &req,
+                                                           dsn::task_code code,
+                                                           const upload_callback &cb,
+                                                           task_tracker *tracker)
+{
+    add_ref();
+    upload_future_ptr tsk(new upload_future(code, cb, 0));
+    tsk->set_tracker(tracker);
+    auto complete_func = [this, req, tsk]() {
+        upload_response resp;
+        resp.err = ERR_OK;
+        resp.uploaded_size = 0;
+        int64_t total_sz = 0;
+        if (!utils::filesystem::file_size(req.input_local_name, total_sz)) {
+            dwarn("get size of source file %s failed", req.input_local_name.c_str());
+            resp.err = ERR_FILE_OPERATION_FAILED;
+        } else if (!utils::filesystem::file_exists(file_name()) &&
+                   !utils::filesystem::create_file(file_name())) {
+            // no part is uploaded for an empty file
+            resp.err = ERR_FS_INTERNAL;
+        } else if (::truncate(file_name().c_str(), total_sz) != 0) {
+            // the remote file may be longer than the source if it's uploaded before
+            dwarn("truncate file %s to %" PRId64 " failed, err(%s)",
+                  file_name().c_str(),
+                  total_sz,
+                  utils::safe_strerror(errno).c_str());
+            resp.err = ERR_FS_INTERNAL;
+        } else if ((resp.err = utils::filesystem::md5sum(file_name(), _md5_value)) == ERR_OK) {
+            resp.uploaded_size = static_cast<uint64_t>(total_sz);
+            _size = total_sz;
+            _has_meta_synced = true;
+            resp.err = store_metadata();
+        }
+
+        tsk->enqueue_with(resp);
+        release_ref();
+    };
+    ::dsn::tasking::enqueue(LPC_LOCAL_SERVICE_CALL, nullptr, std::move(complete_func));
+
+    return tsk;
+}
 }
 }
 }
@@ -77,6 +77,13 @@ public:
                                    const download_callback &cb,
                                    dsn::task_tracker *tracker = nullptr) override;
 
+    virtual bool supports_multipart() override { return true; }
+
+    virtual dsn::task_ptr complete_multipart_upload(const upload_request &req,
+                                                    dsn::task_code code,
+                                                    const upload_callback &cb,
+                                                    dsn::task_tracker *tracker = nullptr) override;
+
     error_code load_metadata();
     error_code store_metadata();
 
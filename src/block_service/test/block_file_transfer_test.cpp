@@ -0,0 +1,258 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "block_service/block_file_transfer.h"
+#include "block_service/local/local_service.h"
+
+#include <fstream>
+
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+namespace dist {
+namespace block_service {
+
+DSN_DECLARE_uint32(transfer_part_size_mb);
+
+class block_file_transfer_test : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        _old_part_size_mb = FLAGS_transfer_part_size_mb;
+        FLAGS_transfer_part_size_mb = 1;
+
+        utils::filesystem::remove_path(ROOT_DIR);
+        utils::filesystem::remove_path(LOCAL_DIR);
+        utils::filesystem::create_directory(LOCAL_DIR);
+        _fs = make_unique<local_service>(ROOT_DIR);
+        ASSERT_EQ(ERR_OK, _fs->initialize({}));
+
+        // 3.5 parts
+        _content.resize((7 << 20) / 2);
+        for (size_t i = 0; i < _content.size(); i++) {
+            _content[i] = static_cast<char>(i * 7 % 251);
+        }
+        write_file(SOURCE_FILE, _content);
+        ASSERT_EQ(ERR_OK, utils::filesystem::md5sum(SOURCE_FILE, _md5));
+    }
+
+    void TearDown() override
+    {
+        FLAGS_transfer_part_size_mb = _old_part_size_mb;
+        utils::filesystem::remove_path(ROOT_DIR);
+        utils::filesystem::remove_path(LOCAL_DIR);
+    }
+
+    static void write_file(const std::string &name, const std::string &content)
+    {
+        std::ofstream os(name, std::ios::out | std::ios::trunc);
+        os.write(content.data(), content.size());
+    }
+
+    block_file_ptr create_remote_file()
+    {
+        block_file_ptr file;
+        task_tracker tracker;
+        _fs->create_file(create_file_request{REMOTE_FILE, false},
+                         TASK_CODE_EXEC_INLINED,
+                         [&file](const create_file_response &resp) {
+                             ASSERT_EQ(ERR_OK, resp.err);
+                             file = resp.file_handle;
+                         },
+                         &tracker);
+        tracker.wait_outstanding_tasks();
+        return file;
+    }
+
+    error_code transfer(block_file_transfer::direction dir,
+                        const block_file_ptr &file,
+                        const std::string &local_file_name,
+                        transfer_budget &budget,
+                        /*out*/ uint64_t &transferred_size,
+                        /*out*/ std::string &file_md5)
+    {
+        error_code result = ERR_UNKNOWN;
+        int callback_count = 0;
+        task_tracker tracker;
+        block_file_transfer_ptr t =
+            new block_file_transfer(dir,
+                                    file,
+                                    local_file_name,
+                                    &budget,
+                                    &tracker,
+                                    [&](error_code err, uint64_t size, const std::string &md5) {
+                                        result = err;
+                                        transferred_size = size;
+                                        file_md5 = md5;
+                                        callback_count++;
+                                    });
+        t->start();
+        tracker.wait_outstanding_tasks();
+        EXPECT_EQ(1, callback_count);
+        EXPECT_EQ(0, budget.running_parts());
+        return result;
+    }
+
+    void upload_source_file()
+    {
+        transfer_budget budget(2, 0, 1 << 20);
+        uint64_t size = 0;
+        std::string md5;
+        ASSERT_EQ(ERR_OK,
+                  transfer(block_file_transfer::direction::UPLOAD,
+                           create_remote_file(),
+                           SOURCE_FILE,
+                           budget,
+                           size,
+                           md5));
+        ASSERT_EQ(_content.size(), size);
+    }
+
+public:
+    std::unique_ptr<local_service> _fs;
+    std::string _content;
+    std::string _md5;
+    uint32_t _old_part_size_mb;
+
+    const std::string ROOT_DIR = "transfer_test_root";
+    const std::string LOCAL_DIR = "transfer_test_local";
+    const std::string REMOTE_FILE = "remote_dir/file";
+    const std::string SOURCE_FILE = "transfer_test_local/source";
+    const std::string TARGET_FILE = "transfer_test_local/target";
+};
+
+TEST_F(block_file_transfer_test, budget)
+{
+    uint64_t delay_ms = 0;
+    transfer_budget budget(2, 0, 1 << 20);
+    ASSERT_TRUE(budget.try_acquire(1 << 20, delay_ms));
+    ASSERT_EQ(0, delay_ms);
+    ASSERT_TRUE(budget.try_acquire(1 << 20, delay_ms));
+    ASSERT_FALSE(budget.try_acquire(1 << 20, delay_ms));
+    ASSERT_EQ(2, budget.running_parts());
+    budget.release();
+    ASSERT_TRUE(budget.try_acquire(1 << 20, delay_ms));
+    budget.release();
+    budget.release();
+
+    // 1MB/s, the second part is delayed for about 1 second
+    transfer_budget rate_budget(8, 1 << 20, 1 << 20);
+    ASSERT_TRUE(rate_budget.try_acquire(1 << 20, delay_ms));
+    ASSERT_EQ(0, delay_ms);
+    ASSERT_TRUE(rate_budget.try_acquire(1 << 20, delay_ms));
+    ASSERT_GT(delay_ms, 500);
+    ASSERT_LE(delay_ms, 1000);
+    // a part larger than the burst is charged in full
+    ASSERT_TRUE(rate_budget.try_acquire(100 << 20, delay_ms));
+    ASSERT_GT(delay_ms, 100500);
+    ASSERT_LE(delay_ms, 101000);
+}
+
+TEST_F(block_file_transfer_test, upload_and_download)
+{
+    upload_source_file();
+    block_file_ptr file = create_remote_file();
+    ASSERT_EQ(_content.size(), file->get_size());
+    ASSERT_EQ(_md5, file->get_md5sum());
+
+    // the parts are downloaded one by one if only one slot in the budget
+    transfer_budget budget(1, 0, 1 << 20);
+    uint64_t size = 0;
+    std::string md5;
+    ASSERT_EQ(
+        ERR_OK,
+        transfer(block_file_transfer::direction::DOWNLOAD, file, TARGET_FILE, budget, size, md5));
+    ASSERT_EQ(_content.size(), size);
+    // the md5 isn't computed when the file is downloaded in parts
+    ASSERT_TRUE(md5.empty());
+    ASSERT_EQ(ERR_OK, utils::filesystem::md5sum(TARGET_FILE, md5));
+    ASSERT_EQ(_md5, md5);
+    ASSERT_FALSE(utils::filesystem::file_exists(block_file_transfer::get_parts_file(TARGET_FILE)));
+
+    // upload a smaller file to the same remote file
+    _content.resize(_content.size() / 2);
+    write_file(SOURCE_FILE, _content);
+    ASSERT_EQ(ERR_OK, utils::filesystem::md5sum(SOURCE_FILE, _md5));
+    upload_source_file();
+    file = create_remote_file();
+    ASSERT_EQ(_content.size(), file->get_size());
+    ASSERT_EQ(_md5, file->get_md5sum());
+}
+
+TEST_F(block_file_transfer_test, resume_download)
+{
+    upload_source_file();
+    block_file_ptr file = create_remote_file();
+    const std::string parts_file = block_file_transfer::get_parts_file(TARGET_FILE);
+    const size_t part_size = 1 << 20;
+
+    // part 0 and 2 are downloaded before, the others are garbage
+    std::string downloaded(_content.size(), 'x');
+    downloaded.replace(0, part_size, _content, 0, part_size);
+    downloaded.replace(2 * part_size, part_size, _content, 2 * part_size, part_size);
+    write_file(TARGET_FILE, downloaded);
+    write_file(parts_file, fmt::format("{} {} 1\n0\n2\n", _content.size(), _md5));
+
+    transfer_budget budget(8, 0, 1 << 20);
+    uint64_t size = 0;
+    std::string md5;
+    ASSERT_EQ(
+        ERR_OK,
+        transfer(block_file_transfer::direction::DOWNLOAD, file, TARGET_FILE, budget, size, md5));
+    ASSERT_EQ(_content.size(), size);
+    ASSERT_EQ(ERR_OK, utils::filesystem::md5sum(TARGET_FILE, md5));
+    ASSERT_EQ(_md5, md5);
+    ASSERT_FALSE(utils::filesystem::file_exists(parts_file));
+
+    // the parts of another remote file are outdated, download from scratch
+    write_file(TARGET_FILE, std::string(_content.size(), 'x'));
+    write_file(parts_file, fmt::format("{} outdated_md5 1\n0\n1\n2\n3\n", _content.size()));
+    ASSERT_EQ(
+        ERR_OK,
+        transfer(block_file_transfer::direction::DOWNLOAD, file, TARGET_FILE, budget, size, md5));
+    ASSERT_EQ(ERR_OK, utils::filesystem::md5sum(TARGET_FILE, md5));
+    ASSERT_EQ(_md5, md5);
+}
+
+TEST_F(block_file_transfer_test, whole_file_download_md5)
+{
+    // smaller than a part
+    _content.resize(1000);
+    write_file(SOURCE_FILE, _content);
+    ASSERT_EQ(ERR_OK, utils::filesystem::md5sum(SOURCE_FILE, _md5));
+    upload_source_file();
+    block_file_ptr file = create_remote_file();
+    ASSERT_EQ(_md5, file->get_md5sum());
+
+    // the md5 is computed during the download
+    transfer_budget budget(8, 0, 1 << 20);
+    uint64_t size = 0;
+    std::string md5;
+    ASSERT_EQ(
+        ERR_OK,
+        transfer(block_file_transfer::direction::DOWNLOAD, file, TARGET_FILE, budget, size, md5));
+    ASSERT_EQ(_content.size(), size);
+    ASSERT_EQ(_md5, md5);
+    ASSERT_TRUE(utils::filesystem::verify_file(TARGET_FILE, _md5, _content.size()));
+}
+
+TEST_F(block_file_transfer_test, download_not_exist)
+{
+    block_file_ptr file = new local_file_object(
+        utils::filesystem::path_combine(ROOT_DIR, "not_exist"));
+    transfer_budget budget(8, 0, 1 << 20);
+    uint64_t size = 0;
+    std::string md5;
+    ASSERT_EQ(
+        ERR_OBJECT_NOT_FOUND,
+        transfer(block_file_transfer::direction::DOWNLOAD, file, TARGET_FILE, budget, size, md5));
+}
+
+} // namespace block_service
+} // namespace dist
+} // namespace dsn
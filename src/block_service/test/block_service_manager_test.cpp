@@ -4,6 +4,7 @@
 
 #include "block_service_mock.h"
 #include "block_service/block_service_manager.h"
+#include "block_service/local/local_service.h"
 
 #include <fstream>
 
@@ -29,8 +30,9 @@ public:
     error_code test_download_file()
     {
         uint64_t download_size = 0;
+        std::string download_md5;
         return _block_service_manager.download_file(
-            PROVIDER, LOCAL_DIR, FILE_NAME, _fs.get(), download_size);
+            PROVIDER, LOCAL_DIR, FILE_NAME, _fs.get(), download_size, download_md5);
     }
 
     void create_local_file(const std::string &file_name)
@@ -95,6 +97,135 @@ TEST_F(block_service_manager_test, do_download_succeed)
     ASSERT_EQ(test_download_file(), ERR_OK);
 }
 
+// create the files "<remote_dir>/<i>.sst" on the local block service, return their md5
+static std::vector<std::string> create_checkpoint_files(local_service &fs,
+                                                        const std::string &remote_dir,
+                                                        int file_count,
+                                                        size_t file_size)
+{
+    std::vector<std::string> md5s;
+    for (int i = 0; i < file_count; i++) {
+        std::string content(file_size, static_cast<char>('a' + i));
+        block_file_ptr file;
+        fs.create_file(create_file_request{remote_dir + "/" + std::to_string(i) + ".sst", false},
+                       TASK_CODE_EXEC_INLINED,
+                       [&file](const create_file_response &resp) { file = resp.file_handle; })
+            ->wait();
+        file->write(write_request{blob::create_from_bytes(std::move(content))},
+                    TASK_CODE_EXEC_INLINED,
+                    [](const write_response &resp) { ASSERT_EQ(ERR_OK, resp.err); })
+            ->wait();
+        md5s.emplace_back(file->get_md5sum());
+    }
+    return md5s;
+}
+
+TEST(block_service_manager_async_test, download_file_async)
+{
+    const std::string root_dir = "async_download_root";
+    const std::string local_dir = "async_download_local";
+    const int file_count = 8;
+    const size_t file_size = 64 << 10;
+    utils::filesystem::remove_path(root_dir);
+    utils::filesystem::remove_path(local_dir);
+    ASSERT_TRUE(utils::filesystem::create_directory(local_dir));
+    local_service fs(root_dir);
+    ASSERT_EQ(ERR_OK, fs.initialize({}));
+    std::vector<std::string> md5s = create_checkpoint_files(fs, "chkpt", file_count, file_size);
+
+    block_service_manager manager;
+    std::vector<error_code> errs(file_count, ERR_UNKNOWN);
+    std::vector<uint64_t> sizes(file_count, 0);
+    std::vector<std::string> downloaded_md5s(file_count);
+    task_tracker tracker;
+    for (int i = 0; i < file_count; i++) {
+        const std::string file_name = std::to_string(i) + ".sst";
+        manager.download_file_async(
+            "chkpt",
+            file_name,
+            local_dir,
+            file_name,
+            &fs,
+            &tracker,
+            [&errs, &sizes, &downloaded_md5s, i](
+                error_code err, uint64_t size, const std::string &md5) {
+                errs[i] = err;
+                sizes[i] = size;
+                downloaded_md5s[i] = md5;
+            });
+    }
+    tracker.wait_outstanding_tasks();
+
+    for (int i = 0; i < file_count; i++) {
+        ASSERT_EQ(ERR_OK, errs[i]);
+        ASSERT_EQ(file_size, sizes[i]);
+        ASSERT_EQ(md5s[i], downloaded_md5s[i]);
+        std::string local_md5;
+        ASSERT_EQ(ERR_OK,
+                  utils::filesystem::md5sum(
+                      utils::filesystem::path_combine(local_dir, std::to_string(i) + ".sst"),
+                      local_md5));
+        ASSERT_EQ(md5s[i], local_md5);
+    }
+
+    utils::filesystem::remove_path(root_dir);
+    utils::filesystem::remove_path(local_dir);
+}
+
+// download the checkpoint files of a partition from the local block service one by one, as
+// restore did, and concurrently, as restore does. Run it manually with
+// --gtest_also_run_disabled_tests.
+TEST(block_service_manager_benchmark, DISABLED_restore_download)
+{
+    const std::string root_dir = "restore_benchmark_root";
+    const std::string local_dir = "restore_benchmark_local";
+    const std::string remote_dir = "chkpt";
+    const int file_count = 16;
+    const size_t file_size = 4 << 20;
+    utils::filesystem::remove_path(root_dir);
+    utils::filesystem::remove_path(local_dir);
+    local_service fs(root_dir);
+    ASSERT_EQ(ERR_OK, fs.initialize({}));
+    std::vector<std::string> md5s = create_checkpoint_files(fs, remote_dir, file_count, file_size);
+
+    block_service_manager manager;
+    for (bool concurrent : {false, true}) {
+        ASSERT_TRUE(utils::filesystem::remove_path(local_dir));
+        ASSERT_TRUE(utils::filesystem::create_directory(local_dir));
+        std::atomic<int> succeed_count(0);
+        uint64_t start_ms = dsn_now_ms();
+        task_tracker tracker;
+        for (int i = 0; i < file_count; i++) {
+            const std::string file_name = std::to_string(i) + ".sst";
+            auto cb = [&succeed_count, &md5s, i](
+                error_code err, uint64_t size, const std::string &md5) {
+                if (err == ERR_OK && md5 == md5s[i]) {
+                    succeed_count++;
+                }
+            };
+            if (concurrent) {
+                manager.download_file_async(
+                    remote_dir, file_name, local_dir, file_name, &fs, &tracker, cb);
+            } else {
+                uint64_t size = 0;
+                std::string md5;
+                cb(manager.download_file(remote_dir, local_dir, file_name, &fs, size, md5),
+                   size,
+                   md5);
+            }
+        }
+        tracker.wait_outstanding_tasks();
+        uint64_t elapsed_ms = std::max(dsn_now_ms() - start_ms, static_cast<uint64_t>(1));
+        ASSERT_EQ(file_count, succeed_count.load());
+        std::cout << (concurrent ? "concurrent" : "sequential") << " download of " << file_count
+                  << " files of " << (file_size >> 20) << "MB: " << elapsed_ms << "ms, "
+                  << file_count * (file_size >> 20) * 1000 / elapsed_ms << "MB/s" << std::endl;
+    }
+
+    utils::filesystem::remove_path(root_dir);
+    utils::filesystem::remove_path(local_dir);
+}
+
 } // namespace block_service
 } // namespace dist
 } // namespace dsn
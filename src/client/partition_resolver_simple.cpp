@@ -26,24 +26,62 @@
 
 #include <dsn/utility/utils.h>
 #include <dsn/utility/rand.h>
+#include <dsn/utility/flags.h>
 #include <dsn/tool-api/async_calls.h>
 #include "partition_resolver_simple.h"
 
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_bool("replication",
+                partition_resolver_subscribe_config,
+                false,
+                "subscribe the routing table from meta server and refresh it by the pushes, "
+                "instead of querying meta server on every access failure");
+DSN_DEFINE_uint32("replication",
+                  partition_resolver_subscribe_timeout_ms,
+                  30000,
+                  "rpc timeout of a config subscription, meta server holds the subscription "
+                  "for at most this time if nothing changes");
+DSN_DEFINE_uint32("replication",
+                  partition_resolver_subscribe_query_delay_ms,
+                  100,
+                  "while subscribing config, delay querying meta server for the unresolved "
+                  "partitions by this time, as the new config is likely to be pushed meanwhile");
+
 partition_resolver_simple::partition_resolver_simple(rpc_address meta_server, const char *app_name)
     : partition_resolver(meta_server, app_name),
+      _primary_slots(nullptr),
       _app_id(-1),
       _app_partition_count(-1),
-      _app_is_stateful(true)
+      _app_is_stateful(true),
+      _subscription_started(false),
+      _subscription_alive(false)
 {
 }
 
+partition_resolver_simple::primary_slots::primary_slots(int count)
+    : count(count), primaries(new std::atomic<uint64_t>[count])
+{
+    for (int i = 0; i < count; ++i) {
+        primaries[i].store(0, std::memory_order_relaxed);
+    }
+}
+
 void partition_resolver_simple::resolve(uint64_t partition_hash,
                                         std::function<void(resolve_result &&)> &&callback,
                                         int timeout_ms)
 {
+    const primary_slots *slots = _primary_slots.load(std::memory_order_acquire);
+    if (slots != nullptr) {
+        int idx = get_partition_index(slots->count, partition_hash);
+        rpc_address target;
+        if (get_primary(slots, idx, target)) {
+            callback(resolve_result{ERR_OK, target, {_app_id, idx}});
+            return;
+        }
+    }
+
     int idx = -1;
     if (_app_partition_count != -1) {
         idx = get_partition_index(_app_partition_count, partition_hash);
@@ -89,6 +127,7 @@ void partition_resolver_simple::on_access_failure(int partition_index, error_cod
             if (it != _config_cache.end()) {
                 _config_cache.erase(it);
             }
+            update_primary_slot(partition_index, nullptr);
         }
     }
 }
@@ -97,6 +136,10 @@ partition_resolver_simple::~partition_resolver_simple()
 {
     _tracker.cancel_outstanding_tasks();
     clear_all_pending_requests();
+    delete _primary_slots.load();
+    for (primary_slots *slots : _retired_primary_slots) {
+        delete slots;
+    }
 }
 
 void partition_resolver_simple::clear_all_pending_requests()
@@ -208,7 +251,17 @@ void partition_resolver_simple::call(request_context_ptr &&request, bool from_me
 
             // init configuration query task if necessary
             if (nullptr == it->second->query_config_task) {
-                it->second->query_config_task = query_config(pindex, timeout_ms);
+                int delay_ms = FLAGS_partition_resolver_subscribe_query_delay_ms;
+                if (_subscription_alive && timeout_ms > delay_ms) {
+                    it->second->query_config_task = tasking::enqueue(
+                        LPC_REPLICATION_DELAY_QUERY_CONFIG,
+                        &_tracker,
+                        [this, pindex, timeout_ms]() { delayed_query_config(pindex, timeout_ms); },
+                        0,
+                        std::chrono::milliseconds(delay_ms));
+                } else {
+                    it->second->query_config_task = query_config(pindex, timeout_ms);
+                }
             }
         } else {
             _pending_requests_before_partition_count_unknown.push_back(std::move(request));
@@ -252,6 +305,19 @@ task_ptr partition_resolver_simple::query_config(int partition_index, int timeou
         });
 }
 
+void partition_resolver_simple::delayed_query_config(int partition_index, int timeout_ms)
+{
+    zauto_lock l(_requests_lock);
+    auto it = _pending_requests.find(partition_index);
+    // the requests may have been resolved by a push
+    if (it != _pending_requests.end() &&
+        it->second->query_config_task.get() == task::get_current_task()) {
+        it->second->query_config_task =
+            query_config(partition_index,
+                         timeout_ms - FLAGS_partition_resolver_subscribe_query_delay_ms);
+    }
+}
+
 void partition_resolver_simple::query_config_reply(error_code err,
                                                    dsn::message_ex *request,
                                                    dsn::message_ex *response,
@@ -263,53 +329,8 @@ void partition_resolver_simple::query_config_reply(error_code err,
         configuration_query_by_index_response resp;
         unmarshall(response, resp);
         if (resp.err == ERR_OK) {
-            zauto_write_lock l(_config_lock);
-
-            if (_app_id != -1 && _app_id != resp.app_id) {
-                dassert(false,
-                        "app id is changed (mostly the app was removed and created with the same "
-                        "name), local Vs remote: %u vs %u ",
-                        _app_id,
-                        resp.app_id);
-            }
-            if (_app_partition_count != -1 && _app_partition_count != resp.partition_count) {
-                dassert(false,
-                        "partition count is changed (mostly the app was removed and created with "
-                        "the same name), local Vs remote: %u vs %u ",
-                        _app_partition_count,
-                        resp.partition_count);
-            }
-            _app_id = resp.app_id;
-            _app_partition_count = resp.partition_count;
-            _app_is_stateful = resp.is_stateful;
-
-            for (auto it = resp.partitions.begin(); it != resp.partitions.end(); ++it) {
-                auto &new_config = *it;
-
-                dinfo("%s.client: query config reply, gpid = %d.%d, ballot = %" PRId64
-                      ", primary = %s",
-                      _app_name.c_str(),
-                      new_config.pid.get_app_id(),
-                      new_config.pid.get_partition_index(),
-                      new_config.ballot,
-                      new_config.primary.to_string());
-
-                auto it2 = _config_cache.find(new_config.pid.get_partition_index());
-                if (it2 == _config_cache.end()) {
-                    std::unique_ptr<partition_info> pi(new partition_info);
-                    pi->timeout_count = 0;
-                    pi->config = new_config;
-                    _config_cache.emplace(new_config.pid.get_partition_index(), std::move(pi));
-                } else if (_app_is_stateful && it2->second->config.ballot < new_config.ballot) {
-                    it2->second->timeout_count = 0;
-                    it2->second->config = new_config;
-                } else if (!_app_is_stateful) {
-                    it2->second->timeout_count = 0;
-                    it2->second->config = new_config;
-                } else {
-                    // nothing to do
-                }
-            }
+            update_config_cache(resp);
+            start_subscription();
         } else if (resp.err == ERR_OBJECT_NOT_FOUND) {
             derror("%s.client: query config reply, gpid = %d.%d, err = %s",
                    _app_name.c_str(),
@@ -385,6 +406,172 @@ void partition_resolver_simple::query_config_reply(error_code err,
     }
 }
 
+DEFINE_TASK_CODE_RPC(RPC_CM_SUBSCRIBE_PARTITION_CONFIG, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+DEFINE_TASK_CODE(LPC_REPLICATION_DELAY_SUBSCRIBE_CONFIG, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+void partition_resolver_simple::start_subscription()
+{
+    if (!FLAGS_partition_resolver_subscribe_config || !_app_is_stateful) {
+        return;
+    }
+    if (!_subscription_started.exchange(true)) {
+        ddebug("%s.client: start subscribing config of app(%d)", _app_name.c_str(), _app_id);
+        subscribe_config();
+    }
+}
+
+void partition_resolver_simple::subscribe_config()
+{
+    auto msg = dsn::message_ex::create_request(RPC_CM_SUBSCRIBE_PARTITION_CONFIG,
+                                               FLAGS_partition_resolver_subscribe_timeout_ms);
+    configuration_query_by_index_request req;
+    req.app_name = _app_name;
+    req.__set_known_app_id(_app_id);
+    req.__set_known_ballot_sum(get_known_ballot_sum());
+    marshall(msg, req);
+
+    rpc::call(_meta_server,
+              msg,
+              &_tracker,
+              [this](error_code err, dsn::message_ex *req, dsn::message_ex *resp) {
+                  subscribe_config_reply(err, resp);
+              });
+}
+
+void partition_resolver_simple::subscribe_config_reply(error_code err, dsn::message_ex *response)
+{
+    if (err == ERR_OK) {
+        configuration_query_by_index_response resp;
+        unmarshall(response, resp);
+        err = resp.err;
+        if (err == ERR_OK) {
+            update_config_cache(resp);
+            _subscription_alive = true;
+            handle_resolved_pending_requests();
+            subscribe_config();
+            return;
+        }
+    }
+
+    _subscription_alive = false;
+    if (err == ERR_HANDLER_NOT_FOUND) {
+        // the meta server doesn't support subscription
+        dwarn("%s.client: stop subscribing config as meta server replies %s",
+              _app_name.c_str(),
+              err.to_string());
+        return;
+    }
+
+    dwarn("%s.client: subscribe config failed, err = %s, retry later",
+          _app_name.c_str(),
+          err.to_string());
+    tasking::enqueue(LPC_REPLICATION_DELAY_SUBSCRIBE_CONFIG,
+                     &_tracker,
+                     [this]() { subscribe_config(); },
+                     0,
+                     std::chrono::seconds(1));
+}
+
+void partition_resolver_simple::handle_resolved_pending_requests()
+{
+    std::vector<partition_context *> resolved;
+    {
+        zauto_lock l(_requests_lock);
+        for (auto it = _pending_requests.begin(); it != _pending_requests.end();) {
+            rpc_address addr;
+            if (get_address(it->first, addr) == ERR_OK) {
+                resolved.push_back(it->second);
+                it = _pending_requests.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (partition_context *pc : resolved) {
+        // the reply of the query will find nothing pending
+        if (pc->query_config_task != nullptr) {
+            pc->query_config_task->cancel(false);
+        }
+        handle_pending_requests(pc->requests, ERR_OK);
+        delete pc;
+    }
+}
+
+int64_t partition_resolver_simple::get_known_ballot_sum() const
+{
+    int64_t sum = 0;
+    zauto_read_lock l(_config_lock);
+    for (const auto &kv : _config_cache) {
+        sum += std::max<int64_t>(kv.second->config.ballot, 0);
+    }
+    return sum;
+}
+
+void partition_resolver_simple::update_config_cache(
+    const configuration_query_by_index_response &resp)
+{
+    zauto_write_lock l(_config_lock);
+    if (_app_id != -1 &&
+        (_app_id != resp.app_id || _app_partition_count != resp.partition_count)) {
+        // mostly the app was removed and created with the same name, or got split, the cached
+        // configs are all outdated
+        dwarn("%s.client: app is changed, local Vs remote: app_id = %d vs %d, "
+              "partition_count = %d vs %d, drop the cached configs",
+              _app_name.c_str(),
+              _app_id,
+              resp.app_id,
+              _app_partition_count,
+              resp.partition_count);
+        _config_cache.clear();
+        primary_slots *slots = _primary_slots.load(std::memory_order_relaxed);
+        if (slots != nullptr && slots->count != resp.partition_count) {
+            // resolve() may still be reading the old slots
+            _retired_primary_slots.push_back(slots);
+            _primary_slots.store(nullptr, std::memory_order_release);
+        } else {
+            for (int i = 0; slots != nullptr && i < slots->count; ++i) {
+                update_primary_slot(i, nullptr);
+            }
+        }
+    }
+    _app_id = resp.app_id;
+    _app_partition_count = resp.partition_count;
+    _app_is_stateful = resp.is_stateful;
+    if (_app_is_stateful && _primary_slots.load(std::memory_order_relaxed) == nullptr) {
+        _primary_slots.store(new primary_slots(_app_partition_count), std::memory_order_release);
+    }
+
+    for (auto it = resp.partitions.begin(); it != resp.partitions.end(); ++it) {
+        auto &new_config = *it;
+
+        dinfo("%s.client: query config reply, gpid = %d.%d, ballot = %" PRId64 ", primary = %s",
+              _app_name.c_str(),
+              new_config.pid.get_app_id(),
+              new_config.pid.get_partition_index(),
+              new_config.ballot,
+              new_config.primary.to_string());
+
+        auto it2 = _config_cache.find(new_config.pid.get_partition_index());
+        if (it2 == _config_cache.end()) {
+            std::unique_ptr<partition_info> pi(new partition_info);
+            pi->timeout_count = 0;
+            pi->config = new_config;
+            _config_cache.emplace(new_config.pid.get_partition_index(), std::move(pi));
+            update_primary_slot(new_config.pid.get_partition_index(), &new_config);
+        } else if (_app_is_stateful && it2->second->config.ballot < new_config.ballot) {
+            it2->second->timeout_count = 0;
+            it2->second->config = new_config;
+            update_primary_slot(new_config.pid.get_partition_index(), &new_config);
+        } else if (!_app_is_stateful) {
+            it2->second->timeout_count = 0;
+            it2->second->config = new_config;
+        } else {
+            // nothing to do
+        }
+    }
+}
+
 void partition_resolver_simple::handle_pending_requests(std::deque<request_context_ptr> &reqs,
                                                         error_code err)
 {
@@ -421,8 +608,42 @@ rpc_address partition_resolver_simple::get_address(const partition_configuration
     }
 }
 
+bool partition_resolver_simple::get_primary(const primary_slots *slots,
+                                            int partition_index,
+                                            /*out*/ rpc_address &addr) const
+{
+    uint64_t value = slots->primaries[partition_index].load(std::memory_order_acquire);
+    if (value == 0) {
+        return false;
+    }
+    addr.value() = value;
+    return true;
+}
+
+void partition_resolver_simple::update_primary_slot(int partition_index,
+                                                    const partition_configuration *config)
+{
+    primary_slots *slots = _primary_slots.load(std::memory_order_relaxed);
+    if (slots == nullptr || partition_index < 0 || partition_index >= slots->count) {
+        return;
+    }
+
+    uint64_t value = 0;
+    if (config != nullptr && !config->primary.is_invalid()) {
+        rpc_address primary = config->primary;
+        value = primary.value();
+    }
+    slots->primaries[partition_index].store(value, std::memory_order_release);
+}
+
 error_code partition_resolver_simple::get_address(int partition_index, /*out*/ rpc_address &addr)
 {
+    const primary_slots *slots = _primary_slots.load(std::memory_order_acquire);
+    if (slots != nullptr && partition_index >= 0 && partition_index < slots->count &&
+        get_primary(slots, partition_index, addr)) {
+        return ERR_OK;
+    }
+
     // partition_configuration config;
     {
         zauto_read_lock l(_config_lock);
@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <dsn/tool-api/task_tracker.h>
 #include <dsn/tool-api/zlocks.h>
 #include <dsn/service_api_c.h>
@@ -53,6 +54,8 @@ public:
     int get_partition_count() const { return _app_partition_count; }
 
 private:
+    friend class partition_resolver_simple_test;
+
     struct partition_info
     {
         int timeout_count;
@@ -61,6 +64,22 @@ private:
     mutable dsn::zrwlock_nr _config_lock;
     std::unordered_map<int, std::unique_ptr<partition_info>> _config_cache;
 
+    // Primaries of the partitions indexed by partition index, read by resolve() without any
+    // lock. The slots are allocated once the partition count is known and updated in place
+    // under _config_lock. An empty slot means the primary is unknown, then resolve() falls
+    // back to _config_cache. If the partition count changes, the slots are replaced and the
+    // old ones are kept in _retired_primary_slots until destruction, as readers may still
+    // hold them.
+    struct primary_slots
+    {
+        explicit primary_slots(int count);
+
+        const int count;
+        std::unique_ptr<std::atomic<uint64_t>[]> primaries;
+    };
+    std::atomic<primary_slots *> _primary_slots;
+    std::vector<primary_slots *> _retired_primary_slots;
+
     int _app_id;
     int _app_partition_count;
     bool _app_is_stateful;
@@ -94,14 +113,27 @@ private:
     std::deque<request_context_ptr> _pending_requests_before_partition_count_unknown;
     task_ptr _query_config_task;
 
+    // config subscription, see partition_resolver_subscribe_config
+    std::atomic<bool> _subscription_started;
+    // whether the last subscription succeeded, the cache is refreshed by the pushes then
+    std::atomic<bool> _subscription_alive;
+
     dsn::task_tracker _tracker;
 
 private:
     // local routines
     rpc_address get_address(const partition_configuration &config) const;
     error_code get_address(int partition_index, /*out*/ rpc_address &addr);
+    // lock-free, return false if the primary of the partition is unknown
+    bool get_primary(const primary_slots *slots,
+                     int partition_index,
+                     /*out*/ rpc_address &addr) const;
+    // user should hold the write lock of _config_lock
+    void update_primary_slot(int partition_index, const partition_configuration *config);
     void handle_pending_requests(std::deque<request_context_ptr> &reqs, error_code err);
     void clear_all_pending_requests();
+    void update_config_cache(const configuration_query_by_index_response &resp);
+    int64_t get_known_ballot_sum() const;
 
     // with replica
     void call(request_context_ptr &&request, bool from_meta_ack = false);
@@ -119,6 +151,13 @@ private:
                             dsn::message_ex *request,
                             dsn::message_ex *response,
                             int partition_index);
+    // query the config of a partition unless the pending requests have been resolved
+    void delayed_query_config(int partition_index, int timeout_ms);
+    void start_subscription();
+    void subscribe_config();
+    void subscribe_config_reply(error_code err, dsn::message_ex *response);
+    // finish the pending requests whose partitions have been resolved by the pushes
+    void handle_resolved_pending_requests();
 };
 } // namespace replication
 } // namespace dsn
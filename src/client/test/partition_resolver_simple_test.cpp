@@ -0,0 +1,201 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <dsn/utility/time_utils.h>
+
+#include "client/partition_resolver_simple.h"
+
+namespace dsn {
+namespace replication {
+
+class partition_resolver_simple_test : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        _resolver = new partition_resolver_simple(rpc_address("127.0.0.1", 34601), "test_app");
+    }
+
+    void mock_config(int partition_count, int64_t ballot, uint16_t port_base)
+    {
+        mock_config(APP_ID, partition_count, ballot, port_base);
+    }
+
+    void mock_config(int app_id, int partition_count, int64_t ballot, uint16_t port_base)
+    {
+        configuration_query_by_index_response resp;
+        resp.err = ERR_OK;
+        resp.app_id = app_id;
+        resp.partition_count = partition_count;
+        resp.is_stateful = true;
+        for (int i = 0; i < partition_count; ++i) {
+            partition_configuration pc;
+            pc.pid = gpid(app_id, i);
+            pc.ballot = ballot;
+            pc.primary = rpc_address("127.0.0.1", port_base + i % 3);
+            resp.partitions.push_back(pc);
+        }
+        _resolver->update_config_cache(resp);
+    }
+
+    rpc_address resolve(uint64_t partition_hash)
+    {
+        rpc_address addr;
+        _resolver->resolve(partition_hash,
+                           [&addr](partition_resolver_simple::resolve_result &&result) {
+                               ASSERT_EQ(ERR_OK, result.err);
+                               addr = result.address;
+                           },
+                           1000);
+        return addr;
+    }
+
+    bool has_primary_slot(int partition_index)
+    {
+        rpc_address addr;
+        return _resolver->get_primary(
+            _resolver->_primary_slots.load(), partition_index, addr);
+    }
+
+    int primary_slot_count() { return _resolver->_primary_slots.load()->count; }
+
+    // Resolve in the background threads while the primaries are switched between 2 sets by
+    // the updates of the configuration, return how many resolves got neither of them.
+    uint64_t resolve_while_updating(int thread_count)
+    {
+        std::atomic<bool> stop(false);
+        std::atomic<uint64_t> unexpected(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([this, &stop, &unexpected]() {
+                for (uint64_t hash = 0; !stop.load(); ++hash) {
+                    _resolver->resolve(
+                        hash,
+                        [&unexpected](partition_resolver_simple::resolve_result &&result) {
+                            uint16_t port = result.address.port();
+                            if (result.err != ERR_OK || (port / 10000 != 1 && port / 10000 != 2) ||
+                                port % 10000 > 2) {
+                                unexpected++;
+                            }
+                        },
+                        1000);
+                }
+            });
+        }
+        for (int64_t ballot = 2; ballot < 1000; ++ballot) {
+            mock_config(8, ballot, ballot % 2 == 0 ? 20000 : 10000);
+        }
+        stop.store(true);
+        for (auto &t : threads) {
+            t.join();
+        }
+        return unexpected.load();
+    }
+
+    // return resolves per second of all the threads
+    double resolve_throughput(int thread_count, bool lock_free)
+    {
+        std::atomic<uint64_t> total_count(0);
+        std::vector<std::thread> threads;
+        uint64_t start_us = dsn_now_us();
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([this, t, lock_free, &total_count]() {
+                uint64_t count = 0;
+                for (uint64_t hash = t; count < RESOLVE_PER_THREAD; ++hash, ++count) {
+                    if (lock_free) {
+                        _resolver->resolve(
+                            hash, [](partition_resolver_simple::resolve_result &&) {}, 1000);
+                    } else {
+                        // the lookup of resolve() before lock-free slots
+                        zauto_read_lock l(_resolver->_config_lock);
+                        auto it = _resolver->_config_cache.find(
+                            _resolver->get_partition_index(_resolver->_app_partition_count, hash));
+                        ASSERT_TRUE(it != _resolver->_config_cache.end());
+                    }
+                }
+                total_count += count;
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        return total_count.load() * 1000000.0 / (dsn_now_us() - start_us);
+    }
+
+    const int APP_ID = 1;
+    const uint64_t RESOLVE_PER_THREAD = 1000000;
+    ref_ptr<partition_resolver_simple> _resolver;
+};
+
+TEST_F(partition_resolver_simple_test, resolve_from_cache)
+{
+    mock_config(8, 3, 10000);
+    for (uint64_t hash = 0; hash < 16; ++hash) {
+        ASSERT_EQ(rpc_address("127.0.0.1", 10000 + (hash % 8) % 3), resolve(hash));
+    }
+}
+
+TEST_F(partition_resolver_simple_test, update_by_ballot)
+{
+    mock_config(8, 3, 10000);
+
+    // older configuration is ignored
+    mock_config(8, 2, 20000);
+    ASSERT_EQ(rpc_address("127.0.0.1", 10000), resolve(0));
+
+    mock_config(8, 4, 20000);
+    ASSERT_EQ(rpc_address("127.0.0.1", 20000), resolve(0));
+    ASSERT_EQ(rpc_address("127.0.0.1", 20001), resolve(1));
+}
+
+TEST_F(partition_resolver_simple_test, access_failure_clears_slot)
+{
+    mock_config(8, 3, 10000);
+    ASSERT_TRUE(has_primary_slot(1));
+
+    // the primary won't change on ERR_BUSY
+    _resolver->on_access_failure(1, ERR_BUSY);
+    ASSERT_TRUE(has_primary_slot(1));
+
+    _resolver->on_access_failure(1, ERR_TIMEOUT);
+    ASSERT_FALSE(has_primary_slot(1));
+    ASSERT_TRUE(has_primary_slot(0));
+}
+
+TEST_F(partition_resolver_simple_test, app_recreated)
+{
+    mock_config(8, 5, 10000);
+
+    // the app was dropped and created again with the same name, the ballots start over
+    mock_config(APP_ID + 1, 4, 1, 20000);
+    ASSERT_EQ(rpc_address("127.0.0.1", 20000), resolve(0));
+    ASSERT_EQ(rpc_address("127.0.0.1", 20001), resolve(5));
+    ASSERT_EQ(4, primary_slot_count());
+}
+
+TEST_F(partition_resolver_simple_test, resolve_while_updating)
+{
+    mock_config(8, 1, 10000);
+    ASSERT_EQ(0, resolve_while_updating(4));
+    ASSERT_EQ(rpc_address("127.0.0.1", 10000), resolve(0));
+}
+
+// Run it manually with --gtest_also_run_disabled_tests.
+TEST_F(partition_resolver_simple_test, DISABLED_resolve_benchmark)
+{
+    mock_config(64, 3, 10000);
+    for (int thread_count : {1, 2, 4, 8, 16}) {
+        double locked = resolve_throughput(thread_count, false);
+        double lock_free = resolve_throughput(thread_count, true);
+        std::cout << "threads: " << thread_count << ", rwlock lookup: " << locked / 1000000
+                  << " M/s, lock-free resolve: " << lock_free / 1000000 << " M/s" << std::endl;
+    }
+}
+
+} // namespace replication
+} // namespace dsn
@@ -16,7 +16,6 @@
 // under the License.
 
 #include "backup_utils.h"
-#include "replica/backup/cold_backup_context.h"
 
 namespace dsn {
 namespace replication {
@@ -25,6 +24,7 @@ const std::string cold_backup_constant::APP_BACKUP_STATUS("app_backup_status");
 const std::string cold_backup_constant::CURRENT_CHECKPOINT("current_checkpoint");
 const std::string cold_backup_constant::BACKUP_METADATA("backup_metadata");
 const std::string cold_backup_constant::BACKUP_INFO("backup_info");
+const std::string cold_backup_constant::SHARED_FILES("shared_files");
 const int32_t cold_backup_constant::PROGRESS_FINISHED = 1000;
 
 namespace cold_backup {
@@ -148,6 +148,31 @@ std::string get_remote_chkpt_meta_file(const std::string &root,
     return ss.str();
 }
 
+std::string get_shared_files_path(const std::string &root,
+                                  const std::string &policy_name,
+                                  const std::string &app_name,
+                                  int32_t app_id)
+{
+    std::stringstream ss;
+    ss << get_policy_path(root, policy_name) << "/" << cold_backup_constant::SHARED_FILES << "/"
+       << app_name << "_" << app_id;
+    return ss.str();
+}
+
+std::string get_shared_file_name(const std::string &md5, int64_t size)
+{
+    std::stringstream ss;
+    ss << md5 << "_" << size;
+    return ss.str();
+}
+
+bool is_shared_file(const std::string &file_name)
+{
+    static const std::string suffix(".sst");
+    return file_name.size() > suffix.size() &&
+           file_name.compare(file_name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
 } // namespace cold_backup
 } // namespace replication
 } // namespace dsn
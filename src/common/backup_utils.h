@@ -18,7 +18,9 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <dsn/tool-api/gpid.h>
+#include <dsn/cpp/json_helper.h>
 
 namespace dsn {
 namespace replication {
@@ -31,9 +33,24 @@ public:
     static const std::string CURRENT_CHECKPOINT;
     static const std::string BACKUP_METADATA;
     static const std::string BACKUP_INFO;
+    static const std::string SHARED_FILES;
     static const int32_t PROGRESS_FINISHED;
 };
 
+// the content of the backup_metadata file of a checkpoint on block service
+struct cold_backup_metadata
+{
+    int64_t checkpoint_decree;
+    int64_t checkpoint_timestamp;
+    std::vector<file_meta> files;
+    int64_t checkpoint_total_size;
+    // the names of the files kept in the shared files of the app rather than the checkpoint dir,
+    // see cold_backup::get_shared_files_path
+    std::vector<std::string> shared_files;
+    DEFINE_JSON_SERIALIZATION(
+        checkpoint_decree, checkpoint_timestamp, files, checkpoint_total_size, shared_files)
+};
+
 namespace cold_backup {
 
 //
@@ -58,6 +75,7 @@ namespace cold_backup {
 //                                                      /partition_1/checkpoint@ip:port/backup_metadata
 //                                                      /partition_1/current_checkpoint
 //      <root>/<policy_name>/<backup_id>/backup_info
+//      <root>/<policy_name>/shared_files/<appname_appid>/<md5>_<size>
 //
 
 //
@@ -70,6 +88,11 @@ namespace cold_backup {
 //         file's name, size and md5
 //      4, current_checkpoint : specifing which checkpoint directory is valid
 //      5, backup_info : recording the information of this backup
+//      6, shared_files : the pool of the sst files of an app shared by all its backups of the
+//         policy, named by their content. An sst file not changed since the last backup is not
+//         uploaded again, and the files in the pool referenced by none of the backups left are
+//         removed when a backup is garbage collected. The sst files of a checkpoint kept in the
+//         pool are listed in the shared_files of its backup_metadata
 //
 
 // compose the path for policy on block service
@@ -188,6 +211,25 @@ std::string get_remote_chkpt_meta_file(const std::string &root,
                                        gpid pid,
                                        int64_t backup_id);
 
+// compose the path of the shared files of an app on block service
+// input:
+//  -- root:       the prefix of the path
+// return:
+//      the path: <root>/<policy_name>/shared_files/<appname_appid>
+std::string get_shared_files_path(const std::string &root,
+                                  const std::string &policy_name,
+                                  const std::string &app_name,
+                                  int32_t app_id);
+
+// compose the name of a shared file by its content
+// return:
+//      the name: <md5>_<size>
+std::string get_shared_file_name(const std::string &md5, int64_t size);
+
+// whether a checkpoint file is put into the shared files, only the sst files are, as they're
+// never modified once written, so a file of the same name in two checkpoints is mostly the same
+bool is_shared_file(const std::string &file_name);
+
 } // namespace cold_backup
 } // namespace replication
 } // namespace dsn
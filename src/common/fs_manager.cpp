@@ -37,10 +37,19 @@
 #include <dsn/utility/filesystem.h>
 #include <thread>
 #include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/flags.h>
 
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_uint32("replication",
+                  max_concurrent_downloading_files_per_disk,
+                  4,
+                  "the max number of the files downloaded to a disk from the block service "
+                  "concurrently, shared by all the replicas restored to the disk");
+DSN_DEFINE_validator(max_concurrent_downloading_files_per_disk,
+                     [](uint32_t value) { return value > 0; });
+
 unsigned dir_node::replicas_count() const
 {
     unsigned sum = 0;
@@ -278,6 +287,48 @@ bool fs_manager::for_each_dir_node(const std::function<bool(const dir_node &)> &
     return true;
 }
 
+bool fs_manager::try_acquire_download_slot(const std::string &dir)
+{
+    dir_node *n = get_dir_node(dir);
+    if (nullptr == n) {
+        return true;
+    }
+    std::lock_guard<std::mutex> l(_download_slot_lock);
+    if (n->downloading_file_count >= FLAGS_max_concurrent_downloading_files_per_disk) {
+        return false;
+    }
+    n->downloading_file_count++;
+    return true;
+}
+
+void fs_manager::acquire_download_slot(const std::string &dir)
+{
+    dir_node *n = get_dir_node(dir);
+    if (nullptr == n) {
+        return;
+    }
+    std::unique_lock<std::mutex> l(_download_slot_lock);
+    _download_slot_released.wait(l, [n]() {
+        return n->downloading_file_count < FLAGS_max_concurrent_downloading_files_per_disk;
+    });
+    n->downloading_file_count++;
+}
+
+void fs_manager::release_download_slot(const std::string &dir)
+{
+    dir_node *n = get_dir_node(dir);
+    if (nullptr == n) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> l(_download_slot_lock);
+        dassert_f(n->downloading_file_count > 0, "no download slot of dir({}) to release", dir);
+        n->downloading_file_count--;
+    }
+    // the waiters of all the disks share the condition, so wake them all up
+    _download_slot_released.notify_all();
+}
+
 void fs_manager::update_disk_stat()
 {
     reset_disk_stat();
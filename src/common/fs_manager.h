@@ -37,7 +37,9 @@
 #include <dsn/service_api_cpp.h>
 #include <dsn/tool-api/zlocks.h>
 #include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include "replication_common.h"
 
 namespace dsn {
@@ -54,6 +56,9 @@ public:
     std::map<app_id, std::set<gpid>> holding_replicas;
     std::map<app_id, std::set<gpid>> holding_primary_replicas;
     std::map<app_id, std::set<gpid>> holding_secondary_replicas;
+    // the number of the files being downloaded to the disk, protected by
+    // fs_manager::_download_slot_lock
+    uint32_t downloading_file_count = 0;
 
 public:
     dir_node(const std::string &tag_,
@@ -94,6 +99,16 @@ public:
     void add_replica(const dsn::gpid &pid, const std::string &pid_dir);
     void remove_replica(const dsn::gpid &pid);
     bool for_each_dir_node(const std::function<bool(const dir_node &)> &func) const;
+
+    // the budget of the files downloaded concurrently to a disk from the block service, shared
+    // by the replicas restored to the disk, see [replication]
+    // max_concurrent_downloading_files_per_disk. return false if the budget of the disk which
+    // `dir` belongs to is used up, otherwise the caller should release the slot when the file
+    // is downloaded. a dir not on any disk is not limited.
+    bool try_acquire_download_slot(const std::string &dir);
+    // like try_acquire_download_slot, but blocks until a slot of the disk is released.
+    void acquire_download_slot(const std::string &dir);
+    void release_download_slot(const std::string &dir);
     void update_disk_stat();
 
 private:
@@ -112,6 +127,10 @@ private:
     // but when visit the holding_replicas, you must take care.
     mutable zrwlock_nr _lock;
 
+    // protects dir_node::downloading_file_count
+    std::mutex _download_slot_lock;
+    std::condition_variable _download_slot_released;
+
     int64_t _total_capacity_mb = 0;
     int64_t _total_available_mb = 0;
     int _total_available_ratio = 0;
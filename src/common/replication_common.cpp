@@ -600,6 +600,10 @@ const std::string backup_restore_constant::SKIP_BAD_PARTITION("restore.skip_bad_
 const std::string replica_envs::DENY_CLIENT_WRITE("replica.deny_client_write");
 const std::string replica_envs::WRITE_QPS_THROTTLING("replica.write_throttling");
 const std::string replica_envs::WRITE_SIZE_THROTTLING("replica.write_throttling_by_size");
+const std::string replica_envs::TABLE_WRITE_QPS_THROTTLING("replica.table_write_throttling");
+const std::string
+    replica_envs::TABLE_WRITE_SIZE_THROTTLING("replica.table_write_throttling_by_size");
+const std::string replica_envs::TABLE_READ_QPS_THROTTLING("replica.table_read_throttling");
 const uint64_t replica_envs::MIN_SLOW_QUERY_THRESHOLD_MS = 20;
 const std::string replica_envs::SLOW_QUERY_THRESHOLD("replica.slow_query_threshold");
 const std::string replica_envs::ROCKSDB_USAGE_SCENARIO("rocksdb.usage_scenario");
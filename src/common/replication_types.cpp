@@ -6616,6 +6616,24 @@ void replica_info::__set_app_type(const std::string &val) { this->app_type = val
 
 void replica_info::__set_disk_tag(const std::string &val) { this->disk_tag = val; }
 
+void replica_info::__set_read_qps(const int64_t val)
+{
+    this->read_qps = val;
+    __isset.read_qps = true;
+}
+
+void replica_info::__set_write_qps(const int64_t val)
+{
+    this->write_qps = val;
+    __isset.write_qps = true;
+}
+
+void replica_info::__set_storage_mb(const int64_t val)
+{
+    this->storage_mb = val;
+    __isset.storage_mb = true;
+}
+
 uint32_t replica_info::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -6701,6 +6719,30 @@ uint32_t replica_info::read(::apache::thrift::protocol::TProtocol *iprot)
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 9:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->read_qps);
+                this->__isset.read_qps = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 10:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->write_qps);
+                this->__isset.write_qps = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 11:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->storage_mb);
+                this->__isset.storage_mb = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -6751,6 +6793,21 @@ uint32_t replica_info::write(::apache::thrift::protocol::TProtocol *oprot) const
     xfer += oprot->writeString(this->disk_tag);
     xfer += oprot->writeFieldEnd();
 
+    if (this->__isset.read_qps) {
+        xfer += oprot->writeFieldBegin("read_qps", ::apache::thrift::protocol::T_I64, 9);
+        xfer += oprot->writeI64(this->read_qps);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.write_qps) {
+        xfer += oprot->writeFieldBegin("write_qps", ::apache::thrift::protocol::T_I64, 10);
+        xfer += oprot->writeI64(this->write_qps);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.storage_mb) {
+        xfer += oprot->writeFieldBegin("storage_mb", ::apache::thrift::protocol::T_I64, 11);
+        xfer += oprot->writeI64(this->storage_mb);
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -6767,6 +6824,9 @@ void swap(replica_info &a, replica_info &b)
     swap(a.last_durable_decree, b.last_durable_decree);
     swap(a.app_type, b.app_type);
     swap(a.disk_tag, b.disk_tag);
+    swap(a.read_qps, b.read_qps);
+    swap(a.write_qps, b.write_qps);
+    swap(a.storage_mb, b.storage_mb);
     swap(a.__isset, b.__isset);
 }
 
@@ -6780,6 +6840,9 @@ replica_info::replica_info(const replica_info &other257)
     last_durable_decree = other257.last_durable_decree;
     app_type = other257.app_type;
     disk_tag = other257.disk_tag;
+    read_qps = other257.read_qps;
+    write_qps = other257.write_qps;
+    storage_mb = other257.storage_mb;
     __isset = other257.__isset;
 }
 replica_info::replica_info(replica_info &&other258)
@@ -6792,6 +6855,9 @@ replica_info::replica_info(replica_info &&other258)
     last_durable_decree = std::move(other258.last_durable_decree);
     app_type = std::move(other258.app_type);
     disk_tag = std::move(other258.disk_tag);
+    read_qps = std::move(other258.read_qps);
+    write_qps = std::move(other258.write_qps);
+    storage_mb = std::move(other258.storage_mb);
     __isset = std::move(other258.__isset);
 }
 replica_info &replica_info::operator=(const replica_info &other259)
@@ -6804,6 +6870,9 @@ replica_info &replica_info::operator=(const replica_info &other259)
     last_durable_decree = other259.last_durable_decree;
     app_type = other259.app_type;
     disk_tag = other259.disk_tag;
+    read_qps = other259.read_qps;
+    write_qps = other259.write_qps;
+    storage_mb = other259.storage_mb;
     __isset = other259.__isset;
     return *this;
 }
@@ -6817,6 +6886,9 @@ replica_info &replica_info::operator=(replica_info &&other260)
     last_durable_decree = std::move(other260.last_durable_decree);
     app_type = std::move(other260.app_type);
     disk_tag = std::move(other260.disk_tag);
+    read_qps = std::move(other260.read_qps);
+    write_qps = std::move(other260.write_qps);
+    storage_mb = std::move(other260.storage_mb);
     __isset = std::move(other260.__isset);
     return *this;
 }
@@ -6839,6 +6911,15 @@ void replica_info::printTo(std::ostream &out) const
         << "app_type=" << to_string(app_type);
     out << ", "
         << "disk_tag=" << to_string(disk_tag);
+    out << ", "
+        << "read_qps=";
+    (__isset.read_qps ? (out << to_string(read_qps)) : (out << "<null>"));
+    out << ", "
+        << "write_qps=";
+    (__isset.write_qps ? (out << to_string(write_qps)) : (out << "<null>"));
+    out << ", "
+        << "storage_mb=";
+    (__isset.storage_mb ? (out << to_string(storage_mb)) : (out << "<null>"));
     out << ")";
 }
 
@@ -20,6 +20,13 @@ struct configuration_query_by_index_request
 {
     1:string           app_name;
     2:list<i32>        partition_indices;
+
+    // only used by RPC_CM_SUBSCRIBE_PARTITION_CONFIG: sum of the partition ballots the
+    // client knows, the meta server replies once the app gets a greater sum
+    3:optional i64     known_ballot_sum;
+    // only used by RPC_CM_SUBSCRIBE_PARTITION_CONFIG: app id the client knows, the meta server
+    // replies at once if the app has been recreated with another id
+    4:optional i32     known_app_id;
 }
 
 // for server version > 1.11.2, if err == ERR_FORWARD_TO_OTHERS,
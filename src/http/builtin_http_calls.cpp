@@ -15,10 +15,18 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <cerrno>
+#include <cstdlib>
+
+#include <dsn/tool-api/command_manager.h>
+#include <dsn/toollet/profiler.h>
 #include <dsn/utility/output_utils.h>
+#include <dsn/utility/string_conv.h>
 #include <dsn/utility/time_utils.h>
+#include <dsn/utils/trace_span.h>
 
 #include "builtin_http_calls.h"
+#include "cpu_profiler_http_service.h"
 #include "http_call_registry.h"
 #include "pprof_http_service.h"
 
@@ -50,11 +58,86 @@ namespace dsn {
     resp.status_code = http_status_code::ok;
 }
 
+/*extern*/ void get_trace_spans_handler(const http_request &req, http_response &resp)
+{
+    uint64_t trace_id = 0;
+    auto iter = req.query_args.find("trace_id");
+    if (iter != req.query_args.end()) {
+        char *end = nullptr;
+        errno = 0;
+        trace_id = strtoull(iter->second.c_str(), &end, 16);
+        if (iter->second.empty() || *end != '\0' || errno != 0) {
+            resp.body = "invalid trace_id, it should be in hex";
+            resp.status_code = http_status_code::bad_request;
+            return;
+        }
+    }
+
+    utils::format_trace_spans(utils::process_trace_spans().get_spans(trace_id), resp.body);
+    resp.content_type = "application/json";
+    resp.status_code = http_status_code::ok;
+}
+
+/*extern*/ void get_task_code_stats_handler(const http_request &req, http_response &resp)
+{
+    int top = 20;
+    auto iter = req.query_args.find("top");
+    if (iter != req.query_args.end() && !buf2int32(iter->second, top)) {
+        resp.body = "invalid top, it should be an integer";
+        resp.status_code = http_status_code::bad_request;
+        return;
+    }
+
+    std::vector<tools::task_code_stats_info> stats;
+    if (!tools::get_task_code_stats(top, stats)) {
+        resp.body = "light profiling is not enabled, please set [core] toollets = profiler "
+                    "and [task..default] is_light_profile = true";
+        resp.status_code = http_status_code::not_found;
+        return;
+    }
+
+    utils::table_printer tp("task_code_stats");
+    tp.add_column("task_code");
+    tp.add_column("count", utils::table_printer::alignment::kRight);
+    tp.add_column("total_exec_ns", utils::table_printer::alignment::kRight);
+    tp.add_column("exec_ns_p50", utils::table_printer::alignment::kRight);
+    tp.add_column("exec_ns_p99", utils::table_printer::alignment::kRight);
+    tp.add_column("total_queue_ns", utils::table_printer::alignment::kRight);
+    tp.add_column("queue_ns_p50", utils::table_printer::alignment::kRight);
+    tp.add_column("queue_ns_p99", utils::table_printer::alignment::kRight);
+    for (const auto &info : stats) {
+        tp.add_row(info.task_code);
+        tp.append_data(info.count);
+        tp.append_data(info.total_exec_ns);
+        tp.append_data(info.exec_ns_p50);
+        tp.append_data(info.exec_ns_p99);
+        tp.append_data(info.total_queue_ns);
+        tp.append_data(info.queue_ns_p50);
+        tp.append_data(info.queue_ns_p99);
+    }
+
+    std::ostringstream out;
+    tp.output(out, utils::table_printer::output_format::kJsonCompact);
+    resp.body = out.str();
+    resp.status_code = http_status_code::ok;
+}
+
+/*extern*/ void get_thread_pool_stats_handler(const http_request &req, http_response &resp)
+{
+    if (!command_manager::instance().run_command("system.threadpool", {}, resp.body)) {
+        resp.status_code = http_status_code::internal_server_error;
+        return;
+    }
+    resp.content_type = "application/json";
+    resp.status_code = http_status_code::ok;
+}
+
 /*extern*/ void register_builtin_http_calls()
 {
 #ifdef DSN_ENABLE_GPERF
     static pprof_http_service pprof_svc;
 #endif
+    static cpu_profiler_http_service cpu_profiler_svc;
 
     register_http_call("")
         .with_callback(
@@ -72,6 +155,33 @@ namespace dsn {
             get_perf_counter_handler(req, resp);
         })
         .with_help("Gets the value of a perf counter");
+
+    register_http_call("metrics")
+        .with_callback(
+            [](const http_request &req, http_response &resp) { get_metrics_handler(req, resp); })
+        .with_help("Exports all the perf counters in Prometheus text format");
+
+    register_http_call("tracing")
+        .with_callback([](const http_request &req, http_response &resp) {
+            get_trace_spans_handler(req, resp);
+        })
+        .with_help("Gets the spans of the sampled traces in Chrome trace event format, "
+                   "filtered by ?trace_id=<hex> if given");
+
+    register_http_call("threadPool")
+        .with_callback([](const http_request &req, http_response &resp) {
+            get_thread_pool_stats_handler(req, resp);
+        })
+        .with_help("Gets the busy ratio of the workers and the length, enqueue and dequeue "
+                   "rates, batch size and oldest task age of the queues of each thread pool, the "
+                   "rates are of the period since the last request");
+
+    register_http_call("profiler/tasks")
+        .with_callback([](const http_request &req, http_response &resp) {
+            get_task_code_stats_handler(req, resp);
+        })
+        .with_help("Gets the top N (?top=N, default 20) task codes by the total executing time, "
+                   "with their queueing and executing time recorded by the light profiling");
 }
 
 } // namespace dsn
@@ -28,6 +28,19 @@ extern void register_builtin_http_calls();
 
 extern void get_perf_counter_handler(const http_request &req, http_response &resp);
 
+// Exports all of the perf counters in the Prometheus text format.
+extern void get_metrics_handler(const http_request &req, http_response &resp);
+
+// Gets the spans of the sampled traces recorded in this process.
+extern void get_trace_spans_handler(const http_request &req, http_response &resp);
+
+// Gets the queueing and executing time of the task codes recorded by the light profiling of
+// the profiler toollet, sorted by the total executing time.
+extern void get_task_code_stats_handler(const http_request &req, http_response &resp);
+
+// Gets the saturation of the thread pools, see the remote command "system.threadpool".
+extern void get_thread_pool_stats_handler(const http_request &req, http_response &resp);
+
 extern void get_help_handler(const http_request &req, http_response &resp);
 
 extern void get_recent_start_time_handler(const http_request &req, http_response &resp);
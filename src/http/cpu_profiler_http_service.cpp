@@ -0,0 +1,460 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "cpu_profiler_http_service.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/tool-api/task.h>
+#include <dsn/tool-api/task_spec.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/process_utils.h>
+#include <dsn/utility/safe_strerror_posix.h>
+#include <dsn/utility/string_conv.h>
+
+namespace dsn {
+
+DSN_DEFINE_bool("http",
+                enable_continuous_cpu_profiler,
+                false,
+                "whether to keep the sampling cpu profiler running since the server starts");
+DSN_DEFINE_uint32("http",
+                  continuous_cpu_profiler_frequency,
+                  19,
+                  "the sampling frequency (Hz of cpu time) of the continuous cpu profiler");
+DSN_DEFINE_uint32("http",
+                  continuous_cpu_profiler_window_seconds,
+                  60,
+                  "how many seconds of samples the continuous cpu profiler keeps by default");
+DSN_DEFINE_uint32("http",
+                  cpu_profiler_max_samples,
+                  0,
+                  "how many of the latest samples are kept by the cpu profiler, 0 means the "
+                  "samples of all the cpus in the profiled window");
+
+const int cpu_profiler::MAX_STACK_DEPTH;
+
+struct cpu_profiler::sample
+{
+    // 2 * index + 1 while the sample of `index` is being written, 2 * index + 2 after
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> ts_ms;
+    std::atomic<int32_t> tid;
+    // -1 if no task is running
+    std::atomic<int32_t> task_code;
+    std::atomic<int32_t> depth;
+    std::atomic<uintptr_t> frames[MAX_STACK_DEPTH];
+};
+
+// the max distance between two adjacent frames, farther means the frame pointer is corrupted
+static const uintptr_t MAX_FRAME_SIZE = 1024 * 1024;
+
+static pid_t profiled_pid = 0;
+
+// the samples kept if not specified by [http] cpu_profiler_max_samples
+static uint32_t get_max_samples(uint32_t frequency, uint32_t seconds)
+{
+    if (FLAGS_cpu_profiler_max_samples > 0) {
+        return FLAGS_cpu_profiler_max_samples;
+    }
+    const uint64_t cpus = std::max(1U, std::thread::hardware_concurrency());
+    return static_cast<uint32_t>(
+        std::min<uint64_t>(1 << 20, static_cast<uint64_t>(frequency) * seconds * cpus));
+}
+
+static uint64_t monotonic_now_ms()
+{
+    // clock_gettime is async-signal-safe
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// the address where the thread is interrupted and its frame pointer, 0 if unknown
+static void get_interrupted_frame(void *context, uintptr_t &pc, uintptr_t &fp)
+{
+    auto uc = reinterpret_cast<ucontext_t *>(context);
+#if defined(__x86_64__)
+    pc = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+    fp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RBP]);
+#elif defined(__aarch64__)
+    pc = static_cast<uintptr_t>(uc->uc_mcontext.pc);
+    fp = static_cast<uintptr_t>(uc->uc_mcontext.regs[29]);
+#else
+    pc = 0;
+    fp = 0;
+#endif
+}
+
+// read the memory of this process, return false rather than fault if it's not readable.
+// process_vm_readv is a plain syscall, which is async-signal-safe.
+static bool safe_read(uintptr_t addr, void *buf, size_t size)
+{
+    struct iovec local = {buf, size};
+    struct iovec remote = {reinterpret_cast<void *>(addr), size};
+    return process_vm_readv(profiled_pid, &local, 1, &remote, 1, 0) ==
+           static_cast<ssize_t>(size);
+}
+
+// Walk the frame pointers from the interrupted frame, whose frame record holds the frame
+// pointer and the return address of its caller on both x86-64 and AArch64. Return the depth,
+// frames[0] is the interrupted address, and the others are return addresses.
+static int walk_stack(void *context, uintptr_t *frames, int max_depth)
+{
+    uintptr_t pc = 0, fp = 0;
+    get_interrupted_frame(context, pc, fp);
+    if (pc == 0) {
+        return 0;
+    }
+
+    int depth = 0;
+    frames[depth++] = pc;
+    while (depth < max_depth && fp != 0 && fp % sizeof(uintptr_t) == 0) {
+        uintptr_t record[2];
+        if (!safe_read(fp, record, sizeof(record)) || record[1] == 0) {
+            break;
+        }
+        frames[depth++] = record[1];
+        // the stack grows down, so the frame of the caller must be above
+        if (record[0] <= fp || record[0] - fp > MAX_FRAME_SIZE) {
+            break;
+        }
+        fp = record[0];
+    }
+    return depth;
+}
+
+/*static*/ cpu_profiler &cpu_profiler::instance()
+{
+    static cpu_profiler profiler;
+    return profiler;
+}
+
+cpu_profiler::cpu_profiler() : _running(false), _mask(0), _next_index(0) {}
+
+bool cpu_profiler::start(uint32_t frequency, uint32_t max_samples)
+{
+    if (frequency == 0 || frequency > 1000) {
+        derror_f("invalid cpu profiler frequency {}", frequency);
+        return false;
+    }
+    if (is_running()) {
+        return false;
+    }
+
+    struct sigaction old_action;
+    sigaction(SIGPROF, nullptr, &old_action);
+    if ((old_action.sa_flags & SA_SIGINFO) != 0
+            ? old_action.sa_sigaction != &cpu_profiler::on_sigprof
+            : (old_action.sa_handler != SIG_DFL && old_action.sa_handler != SIG_IGN)) {
+        derror_f("SIGPROF is handled by others, maybe the gperftools profiler is running");
+        return false;
+    }
+
+    // the ring is never freed, as the signals may still be delivered after stop()
+    if (_samples == nullptr) {
+        uint32_t size = 1;
+        while (size < max_samples) {
+            size <<= 1;
+        }
+        _samples.reset(new sample[size]);
+        for (uint32_t i = 0; i < size; ++i) {
+            _samples[i].sequence.store(0, std::memory_order_relaxed);
+        }
+        _mask = size - 1;
+    }
+
+    profiled_pid = getpid();
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = &cpu_profiler::on_sigprof;
+    action.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0) {
+        derror_f("install the SIGPROF handler failed, err = {}", utils::safe_strerror(errno));
+        return false;
+    }
+
+    _running.store(true, std::memory_order_release);
+
+    const uint32_t interval_us = 1000000 / frequency;
+    struct itimerval timer;
+    timer.it_interval.tv_sec = interval_us / 1000000;
+    timer.it_interval.tv_usec = interval_us % 1000000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        derror_f("start the cpu profiling timer failed, err = {}", utils::safe_strerror(errno));
+        _running.store(false, std::memory_order_release);
+        return false;
+    }
+
+    ddebug_f("cpu profiler started, frequency = {}Hz, max_samples = {}", frequency, _mask + 1);
+    return true;
+}
+
+void cpu_profiler::stop()
+{
+    if (!is_running()) {
+        return;
+    }
+
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    _running.store(false, std::memory_order_release);
+
+    // keep the handler installed, the signals already pending are ignored by it
+    ddebug_f("cpu profiler stopped");
+}
+
+/*static*/ void cpu_profiler::on_sigprof(int sig, siginfo_t *info, void *context)
+{
+    cpu_profiler &profiler = instance();
+    if (!profiler.is_running()) {
+        return;
+    }
+
+    int saved_errno = errno;
+
+    int task_code = -1;
+    if (tls_dsn.magic == 0xdeadbeef && tls_dsn.current_task != nullptr) {
+        task_code = tls_dsn.current_task->code().code();
+    }
+
+    uintptr_t frames[MAX_STACK_DEPTH];
+    int depth = walk_stack(context, frames, MAX_STACK_DEPTH);
+
+    uint64_t index = profiler._next_index.fetch_add(1, std::memory_order_relaxed);
+    sample &s = profiler._samples[index & profiler._mask];
+    s.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.ts_ms.store(monotonic_now_ms(), std::memory_order_relaxed);
+    s.tid.store(utils::get_current_tid(), std::memory_order_relaxed);
+    s.task_code.store(task_code, std::memory_order_relaxed);
+    s.depth.store(depth, std::memory_order_relaxed);
+    for (int i = 0; i < depth; ++i) {
+        s.frames[i].store(frames[i], std::memory_order_relaxed);
+    }
+    s.sequence.store(2 * index + 2, std::memory_order_release);
+
+    errno = saved_errno;
+}
+
+namespace {
+
+class symbolizer
+{
+public:
+    // `is_return_address` is true if `addr` is the address after a call instruction,
+    // which may belong to the next function
+    const std::string &symbolize(uintptr_t addr, bool is_return_address)
+    {
+        auto iter = _symbols.find(addr);
+        if (iter != _symbols.end()) {
+            return iter->second;
+        }
+
+        std::string name;
+        Dl_info info;
+        if (dladdr(reinterpret_cast<void *>(is_return_address ? addr - 1 : addr), &info) != 0 &&
+            info.dli_sname != nullptr) {
+            int status = 0;
+            char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            name = (status == 0 && demangled != nullptr) ? demangled : info.dli_sname;
+            free(demangled);
+        } else {
+            name = fmt::format("0x{:x}", addr);
+        }
+        // ';' separates the frames in the folded stacks
+        std::replace(name.begin(), name.end(), ';', ':');
+        return _symbols.emplace(addr, std::move(name)).first->second;
+    }
+
+    const std::string &thread_name(int32_t tid)
+    {
+        auto iter = _thread_names.find(tid);
+        if (iter != _thread_names.end()) {
+            return iter->second;
+        }
+
+        std::string name;
+        std::ifstream comm(fmt::format("/proc/self/task/{}/comm", tid));
+        if (!std::getline(comm, name) || name.empty()) {
+            name = std::to_string(tid);
+        }
+        return _thread_names.emplace(tid, fmt::format("[{}]", name)).first->second;
+    }
+
+private:
+    std::unordered_map<uintptr_t, std::string> _symbols;
+    std::unordered_map<int32_t, std::string> _thread_names;
+};
+
+} // anonymous namespace
+
+bool cpu_profiler::get_folded_stacks(uint32_t seconds, /*out*/ std::string &folded) const
+{
+    folded.clear();
+    if (_samples == nullptr) {
+        return true;
+    }
+
+    // all of the samples if the window is longer than the process has been running
+    const uint64_t now_ms = monotonic_now_ms();
+    const uint64_t window_ms = static_cast<uint64_t>(seconds) * 1000;
+    const uint64_t since_ms = now_ms > window_ms ? now_ms - window_ms : 0;
+    uint64_t end = _next_index.load(std::memory_order_acquire);
+    uint64_t capacity = _mask + 1;
+    uint64_t begin = end > capacity ? end - capacity : 0;
+
+    symbolizer sym;
+    std::map<std::string, uint64_t> stacks;
+    uintptr_t frames[MAX_STACK_DEPTH];
+    // the timestamp of the oldest sample kept
+    uint64_t oldest_ts_ms = 0;
+    for (uint64_t index = begin; index < end; ++index) {
+        const sample &s = _samples[index & _mask];
+        if (s.sequence.load(std::memory_order_acquire) != 2 * index + 2) {
+            continue;
+        }
+        uint64_t ts_ms = s.ts_ms.load(std::memory_order_relaxed);
+        int32_t tid = s.tid.load(std::memory_order_relaxed);
+        int32_t task_code = s.task_code.load(std::memory_order_relaxed);
+        int32_t depth = s.depth.load(std::memory_order_relaxed);
+        for (int i = 0; i < depth; ++i) {
+            frames[i] = s.frames[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.sequence.load(std::memory_order_relaxed) != 2 * index + 2) {
+            continue;
+        }
+        if (oldest_ts_ms == 0) {
+            oldest_ts_ms = ts_ms;
+        }
+        if (ts_ms < since_ms) {
+            continue;
+        }
+
+        std::string stack;
+        task_spec *spec = task_code >= 0 ? task_spec::get(task_code) : nullptr;
+        if (spec != nullptr) {
+            stack.append(spec->pool_code.to_string()).append(";").append(spec->name);
+        } else {
+            stack.append(sym.thread_name(tid));
+        }
+        for (int i = depth - 1; i >= 0; --i) {
+            stack.append(";").append(sym.symbolize(frames[i], i != 0));
+        }
+        stacks[stack]++;
+    }
+
+    for (const auto &kv : stacks) {
+        folded.append(kv.first).append(" ").append(std::to_string(kv.second)).append("\n");
+    }
+    // the samples overwritten are newer than the window if the oldest one kept is in it
+    return begin == 0 || oldest_ts_ms < since_ms;
+}
+
+cpu_profiler_http_service::cpu_profiler_http_service()
+{
+    register_handler("cpu",
+                     std::bind(&cpu_profiler_http_service::cpu_handler,
+                               this,
+                               std::placeholders::_1,
+                               std::placeholders::_2),
+                     "ip:port/profiler/cpu?seconds=<N>&frequency=<HZ>");
+
+    if (FLAGS_enable_continuous_cpu_profiler &&
+        !cpu_profiler::instance().start(
+            FLAGS_continuous_cpu_profiler_frequency,
+            get_max_samples(FLAGS_continuous_cpu_profiler_frequency,
+                            FLAGS_continuous_cpu_profiler_window_seconds))) {
+        derror_f("failed to start the continuous cpu profiler");
+    }
+}
+
+void cpu_profiler_http_service::cpu_handler(const http_request &req, http_response &resp)
+{
+    int32_t seconds = -1;
+    int32_t frequency = 99;
+    cpu_profiler &profiler = cpu_profiler::instance();
+    const bool continuous = FLAGS_enable_continuous_cpu_profiler && profiler.is_running();
+    auto iter = req.query_args.find("seconds");
+    if (iter != req.query_args.end() && (!buf2int32(iter->second, seconds) || seconds <= 0)) {
+        resp.body = "invalid seconds";
+        resp.status_code = http_status_code::bad_request;
+        return;
+    }
+    iter = req.query_args.find("frequency");
+    if (iter != req.query_args.end() && continuous) {
+        resp.body = fmt::format("frequency can't be specified as the cpu profiler is running "
+                                "continuously at {}Hz",
+                                FLAGS_continuous_cpu_profiler_frequency);
+        resp.status_code = http_status_code::bad_request;
+        return;
+    }
+    if (iter != req.query_args.end() &&
+        (!buf2int32(iter->second, frequency) || frequency <= 0 || frequency > 1000)) {
+        resp.body = "invalid frequency, it should be in (0, 1000]";
+        resp.status_code = http_status_code::bad_request;
+        return;
+    }
+
+    resp.content_type = "text/plain";
+
+    // the continuous profiler has already kept the samples of the window
+    if (continuous) {
+        seconds = seconds > 0 ? seconds : FLAGS_continuous_cpu_profiler_window_seconds;
+        if (!profiler.get_folded_stacks(seconds, resp.body)) {
+            dwarn_f("some samples of the last {} seconds have been dropped, increase [http] "
+                    "cpu_profiler_max_samples to keep them",
+                    seconds);
+        }
+        resp.status_code = http_status_code::ok;
+        return;
+    }
+
+    bool in_profiling = false;
+    if (!_in_profiling.compare_exchange_strong(in_profiling, true)) {
+        resp.body = "node is already profiling, please wait and retry";
+        resp.status_code = http_status_code::internal_server_error;
+        return;
+    }
+
+    seconds = seconds > 0 ? seconds : 10;
+    if (!profiler.start(frequency, get_max_samples(frequency, seconds))) {
+        resp.body = "failed to start the cpu profiler, SIGPROF may be in use";
+        resp.status_code = http_status_code::internal_server_error;
+    } else {
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        profiler.stop();
+        if (!profiler.get_folded_stacks(seconds, resp.body)) {
+            dwarn_f("some samples of the {} seconds have been dropped, increase [http] "
+                    "cpu_profiler_max_samples to keep them",
+                    seconds);
+        }
+        resp.status_code = http_status_code::ok;
+    }
+    _in_profiling.store(false);
+}
+
+} // namespace dsn
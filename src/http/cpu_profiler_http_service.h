@@ -0,0 +1,91 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <signal.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <dsn/http/http_server.h>
+
+namespace dsn {
+
+/*
+ * A sampling CPU profiler driven by SIGPROF, which doesn't depend on gperftools.
+ *
+ * ITIMER_PROF sends SIGPROF to the process every 1/frequency second of the CPU time consumed,
+ * and the signal handler captures the stack of the interrupted thread together with the code
+ * of the task it's running (from the TLS context of rDSN) into a fixed-size lock-free ring.
+ * The stack is captured by walking the frame pointers, as backtrace() of glibc is not
+ * async-signal-safe, so the frames of the code built without frame pointers may be missed.
+ * The stacks are symbolized and aggregated only when they're read, so the profiler is cheap
+ * enough to run continuously at a low frequency, and the stacks of any window kept in the
+ * ring can be fetched without a restart.
+ *
+ * ITIMER_PROF and SIGPROF are also used by the CPU profiler of gperftools, so they can't run
+ * at the same time. `start` fails if SIGPROF is handled by others.
+ */
+class cpu_profiler
+{
+public:
+    static const int MAX_STACK_DEPTH = 32;
+
+    static cpu_profiler &instance();
+
+    // start sampling at `frequency` Hz of the CPU time, the ring keeps the latest
+    // `max_samples` samples. return false if it's already started or SIGPROF is in use.
+    // the ring is allocated by the first start, and never resized.
+    bool start(uint32_t frequency, uint32_t max_samples);
+    void stop();
+    bool is_running() const { return _running.load(std::memory_order_acquire); }
+
+    // aggregate the samples taken in the last `seconds` seconds into the folded stacks used
+    // by flame graphs, one line for each distinct stack:
+    //
+    //   <thread pool>;<task code>;<outermost frame>;...;<innermost frame> <count>
+    //
+    // the samples of the threads not running any task are rooted by "[<thread name>]".
+    //
+    // return false if some samples of the window have been overwritten as the ring is full.
+    bool get_folded_stacks(uint32_t seconds, /*out*/ std::string &folded) const;
+
+private:
+    struct sample;
+
+    cpu_profiler();
+
+    static void on_sigprof(int sig, siginfo_t *info, void *context);
+
+    std::atomic<bool> _running;
+    uint32_t _mask;
+    std::unique_ptr<sample[]> _samples;
+    std::atomic<uint64_t> _next_index;
+};
+
+// The http calls of the cpu profiler:
+//
+// - ip:port/profiler/cpu?seconds=<N>&frequency=<HZ>
+//   If the profiler is running continuously ([http] enable_continuous_cpu_profiler), return
+//   the folded stacks of the last N (default [http] continuous_cpu_profiler_window_seconds)
+//   seconds immediately, and `frequency` is rejected as the samples have been taken at
+//   [http] continuous_cpu_profiler_frequency. Otherwise profile the next N (default 10)
+//   seconds at HZ (default 99) and return the folded stacks.
+class cpu_profiler_http_service : public http_service
+{
+public:
+    cpu_profiler_http_service();
+
+    std::string path() const override { return "profiler"; }
+
+    void cpu_handler(const http_request &req, http_response &resp);
+
+private:
+    std::atomic<bool> _in_profiling{false};
+};
+
+} // namespace dsn
@@ -0,0 +1,59 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "gzip_compressor.h"
+
+#include <cstring>
+
+#include <dsn/c/api_utilities.h>
+#include <dsn/dist/fmt_logging.h>
+
+namespace dsn {
+
+gzip_compressor::gzip_compressor() : _finished(false)
+{
+    memset(&_stream, 0, sizeof(_stream));
+    // 15 is the default window bits of zlib, adding 16 to it means to write the gzip header
+    // and trailer rather than the zlib ones
+    int err = deflateInit2(&_stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    dassert_f(err == Z_OK, "deflateInit2 failed, err = {}", err);
+}
+
+gzip_compressor::~gzip_compressor() { deflateEnd(&_stream); }
+
+void gzip_compressor::compress(const char *data, size_t size, /*out*/ std::string &out)
+{
+    dassert_f(!_finished, "can't compress after finished");
+    _stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    _stream.avail_in = static_cast<uInt>(size);
+    deflate_to(Z_NO_FLUSH, out);
+}
+
+void gzip_compressor::finish(/*out*/ std::string &out)
+{
+    if (_finished) {
+        return;
+    }
+    _stream.next_in = nullptr;
+    _stream.avail_in = 0;
+    deflate_to(Z_FINISH, out);
+    _finished = true;
+}
+
+void gzip_compressor::deflate_to(int flush, /*out*/ std::string &out)
+{
+    char buf[16384];
+    int err;
+    do {
+        _stream.next_out = reinterpret_cast<Bytef *>(buf);
+        _stream.avail_out = sizeof(buf);
+        err = deflate(&_stream, flush);
+        dassert_f(err == Z_OK || err == Z_STREAM_END || err == Z_BUF_ERROR,
+                  "deflate failed, err = {}",
+                  err);
+        out.append(buf, sizeof(buf) - _stream.avail_out);
+    } while (_stream.avail_out == 0 || (flush == Z_FINISH && err != Z_STREAM_END));
+}
+
+} // namespace dsn
@@ -0,0 +1,37 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <string>
+
+#include <zlib.h>
+
+namespace dsn {
+
+// Compresses a stream of data into the gzip format (RFC 1952) incrementally.
+//
+// The fastest level of zlib is used, as the responses of the HTTP server are mostly texts
+// which are compressed well even at that level, and the CPU of the server is more precious.
+class gzip_compressor
+{
+public:
+    gzip_compressor();
+    ~gzip_compressor();
+
+    // compress `data` and append the output to `out`. zlib may buffer some of the input,
+    // which is output by later calls.
+    void compress(const char *data, size_t size, /*out*/ std::string &out);
+    // append the rest of the output and the gzip trailer to `out`. no more data can be
+    // compressed after it.
+    void finish(/*out*/ std::string &out);
+
+private:
+    void deflate_to(int flush, /*out*/ std::string &out);
+
+    z_stream _stream;
+    bool _finished;
+};
+
+} // namespace dsn
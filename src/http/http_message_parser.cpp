@@ -77,7 +77,7 @@ http_message_parser::http_message_parser()
         // msg->buffers[0] = header
         // msg->buffers[1] = body (blob())
         msg.reset(message_ex::create_receive_message_with_standalone_header(blob()));
-        msg->buffers.resize(4);
+        msg->buffers.resize(5);
 
         message_header *header = msg->header;
         header->hdr_length = sizeof(message_header);
@@ -99,6 +99,9 @@ http_message_parser::http_message_parser()
         msg_parser->_stage = HTTP_ON_HEADER_FIELD;
         if (strncmp(at, "Content-Type", length) == 0) {
             msg_parser->_is_field_content_type = true;
+        } else if (length == strlen("Accept-Encoding") &&
+                   strncasecmp(at, "Accept-Encoding", length) == 0) {
+            msg_parser->_is_field_accept_encoding = true;
         }
         return 0;
     };
@@ -112,6 +115,11 @@ http_message_parser::http_message_parser()
             // msg->buffers[3] = content-type
             msg->buffers[3] = blob::create_from_bytes(at, length);
             msg_parser->_is_field_content_type = false;
+        } else if (msg_parser->_is_field_accept_encoding) {
+            auto &msg = msg_parser->_current_message;
+            // msg->buffers[4] = accept-encoding
+            msg->buffers[4] = blob::create_from_bytes(at, length);
+            msg_parser->_is_field_accept_encoding = false;
         }
         return 0;
     };
@@ -48,6 +48,7 @@ DEFINE_CUSTOMIZED_ID(network_header_format, NET_HDR_HTTP)
 //    msg->buffers[1] = body
 //    msg->buffers[2] = url
 //    msg->buffers[3] = content-type
+//    msg->buffers[4] = accept-encoding
 //
 
 enum http_parser_stage
@@ -92,6 +93,7 @@ private:
     http_parser _parser;
 
     bool _is_field_content_type{false};
+    bool _is_field_accept_encoding{false};
     std::unique_ptr<message_ex> _current_message;
     http_parser_stage _stage{HTTP_INVALID};
     std::string _url;
@@ -4,10 +4,12 @@
 
 #include <dsn/http/http_server.h>
 #include <dsn/tool_api.h>
+#include <dsn/utility/smart_pointers.h>
 #include <dsn/utility/time_utils.h>
 #include <boost/algorithm/string.hpp>
 #include <fmt/ostream.h>
 
+#include "gzip_compressor.h"
 #include "http_message_parser.h"
 #include "pprof_http_service.h"
 #include "builtin_http_calls.h"
@@ -18,6 +20,11 @@
 namespace dsn {
 
 DSN_DEFINE_bool("http", enable_http_server, true, "whether to enable the embedded HTTP server");
+DSN_DEFINE_uint32("http",
+                  gzip_min_response_size,
+                  1024,
+                  "the responses smaller than it are not compressed even if the client accepts "
+                  "gzip");
 
 /*extern*/ std::string http_status_code_to_string(http_status_code code)
 {
@@ -85,11 +92,13 @@ void http_server::serve(message_ex *msg)
 {
     error_with<http_request> res = http_request::parse(msg);
     http_response resp;
+    bool accept_gzip = false;
     if (!res.is_ok()) {
         resp.status_code = http_status_code::bad_request;
         resp.body = fmt::format("failed to parse request: {}", res.get_error());
     } else {
         const http_request &req = res.get_value();
+        accept_gzip = req.accept_gzip;
         std::shared_ptr<http_call> call = http_call_registry::instance().find(req.path);
         if (call != nullptr) {
             call->callback(req, resp);
@@ -99,12 +108,40 @@ void http_server::serve(message_ex *msg)
         }
     }
 
-    http_response_reply(resp, msg);
+    http_response_reply(resp, msg, accept_gzip);
+}
+
+// Whether gzip is acceptable by the value of the "Accept-Encoding" header, e.g.
+// "gzip;q=0.8, deflate". A coding with "q=0" is explicitly not acceptable, and "*" stands
+// for the codings not listed.
+static bool accepts_gzip(const std::string &accept_encoding)
+{
+    double gzip_q = -1, any_q = -1;
+    std::vector<std::string> codings;
+    boost::split(codings, accept_encoding, boost::is_any_of(","));
+    for (const std::string &coding : codings) {
+        std::vector<std::string> params;
+        boost::split(params, coding, boost::is_any_of(";"));
+        std::string name = boost::to_lower_copy(boost::trim_copy(params[0]));
+        double q = 1;
+        for (size_t i = 1; i < params.size(); i++) {
+            std::string param = boost::trim_copy(params[i]);
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                q = atof(param.c_str() + 2);
+            }
+        }
+        if (name == "gzip" || name == "x-gzip") {
+            gzip_q = q;
+        } else if (name == "*") {
+            any_q = q;
+        }
+    }
+    return gzip_q >= 0 ? gzip_q > 0 : any_q > 0;
 }
 
 /*static*/ error_with<http_request> http_request::parse(message_ex *m)
 {
-    if (m->buffers.size() != 3) {
+    if (m->buffers.size() < 3) {
         return error_s::make(ERR_INVALID_DATA,
                              std::string("buffer size is: ") + std::to_string(m->buffers.size()));
     }
@@ -113,6 +150,9 @@ void http_server::serve(message_ex *msg)
     ret.body = m->buffers[1];
     ret.full_url = m->buffers[2];
     ret.method = static_cast<http_method>(m->header->hdr_type);
+    if (m->buffers.size() > 4) {
+        ret.accept_gzip = accepts_gzip(m->buffers[4].to_string());
+    }
 
     http_parser_url u{0};
     http_parser_parse_url(ret.full_url.data(), ret.full_url.length(), false, &u);
@@ -180,27 +220,95 @@ void http_server::serve(message_ex *msg)
     return ret;
 }
 
-/*extern*/ void http_response_reply(const http_response &resp, message_ex *req)
-{
-    message_ptr resp_msg = req->create_response();
+namespace {
 
-    std::ostringstream os;
-    os << "HTTP/1.1 " << http_status_code_to_string(resp.status_code) << "\r\n";
-    os << "Content-Type: " << resp.content_type << "\r\n";
-    os << "Content-Length: " << resp.body.length() << "\r\n";
+std::string make_response_header(const http_response &resp, bool gzip, size_t size)
+{
+    std::string header = fmt::format("HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\n",
+                                     http_status_code_to_string(resp.status_code),
+                                     resp.content_type,
+                                     size);
+    if (gzip) {
+        header.append("Content-Encoding: gzip\r\n");
+    }
     if (!resp.location.empty()) {
-        os << "Location: " << resp.location << "\r\n";
+        header.append(fmt::format("Location: {}\r\n", resp.location));
     }
-    os << "\r\n";
-    os << resp.body;
+    header.append("\r\n");
+    return header;
+}
 
+// Collects the body written piece by piece, which is sent in a single reply. When gzip is on,
+// the pieces are compressed as they come, so that only the compressed body is held in memory,
+// otherwise the whole body is held.
+class buffered_body_writer : public http_body_writer
+{
+public:
+    explicit buffered_body_writer(bool gzip)
+    {
+        if (gzip) {
+            _gzip = make_unique<gzip_compressor>();
+        }
+    }
+
+    void write(const char *data, size_t size) override
+    {
+        if (_gzip) {
+            _gzip->compress(data, size, _body);
+        } else {
+            _body.append(data, size);
+        }
+    }
+
+    std::string &finish()
+    {
+        if (_gzip) {
+            _gzip->finish(_body);
+        }
+        return _body;
+    }
+
+private:
+    std::string _body;
+    std::unique_ptr<gzip_compressor> _gzip;
+};
+
+void send_response(const http_response &resp, message_ex *req, bool gzip, const std::string &body)
+{
+    std::string header = make_response_header(resp, gzip, body.size());
+
+    message_ptr resp_msg = req->create_response();
     rpc_write_stream writer(resp_msg.get());
-    writer.write(os.str().data(), os.str().length());
+    writer.write(header.data(), header.size());
+    writer.write(body.data(), body.size());
     writer.flush();
 
     dsn_rpc_reply(resp_msg.get());
 }
 
+} // anonymous namespace
+
+/*extern*/ void http_response_reply(const http_response &resp, message_ex *req, bool accept_gzip)
+{
+    if (resp.body_writer) {
+        buffered_body_writer writer(accept_gzip);
+        resp.body_writer(writer);
+        send_response(resp, req, accept_gzip, writer.finish());
+        return;
+    }
+
+    bool gzip = accept_gzip && resp.body.size() >= FLAGS_gzip_min_response_size;
+    if (!gzip) {
+        send_response(resp, req, false, resp.body);
+        return;
+    }
+    std::string compressed;
+    gzip_compressor compressor;
+    compressor.compress(resp.body.data(), resp.body.size(), compressed);
+    compressor.finish(compressed);
+    send_response(resp, req, true, compressed);
+}
+
 /*extern*/ void start_http_server()
 {
     // starts http server as a singleton
@@ -33,7 +33,11 @@ public:
     void serve(message_ex *msg);
 };
 
-extern void http_response_reply(const http_response &resp, message_ex *req);
+// The body is compressed by gzip if `accept_gzip` and it's not too small, or if it's written
+// by `resp.body_writer`.
+extern void http_response_reply(const http_response &resp,
+                                message_ex *req,
+                                bool accept_gzip = false);
 
 /// The rpc code for all the HTTP RPCs.
 /// Since http is used only for system monitoring, it is restricted to lowest priority.
@@ -2,6 +2,10 @@
 // This source code is licensed under the Apache License Version 2.0, which
 // can be found in the LICENSE file in the root directory of this source tree.
 
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
 #include <dsn/utility/output_utils.h>
 #include "builtin_http_calls.h"
 
@@ -41,4 +45,232 @@ void get_perf_counter_handler(const http_request &req, http_response &resp)
     resp.body = out.str();
     resp.status_code = http_status_code::ok;
 }
+
+namespace {
+
+// a counter with its metric name and labels in the Prometheus exposition format
+struct metric_entry
+{
+    std::string family;
+    std::string labels;
+    perf_counter *counter;
+};
+
+// replace the characters which are invalid in a metric name with '_'
+void append_metric_name(std::string &out, const std::string &name)
+{
+    for (char c : name) {
+        out.push_back(isalnum(c) || c == '_' || c == ':' ? c : '_');
+    }
+    while (!out.empty() && out.back() == '_') {
+        out.pop_back();
+    }
+}
+
+void append_label(std::string &labels, const char *name, const std::string &value)
+{
+    if (!labels.empty()) {
+        labels.push_back(',');
+    }
+    labels.append(name).append("=\"");
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            labels.push_back('\\');
+            labels.push_back(c);
+        } else if (c == '\n') {
+            labels.append("\\n");
+        } else {
+            labels.push_back(c);
+        }
+    }
+    labels.push_back('"');
+}
+
+bool is_gpid(const std::string &str, std::string &app_id, std::string &partition_index)
+{
+    size_t dot = str.find('.');
+    if (dot == 0 || dot == std::string::npos || dot + 1 == str.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < str.size(); ++i) {
+        if (i != dot && !isdigit(str[i])) {
+            return false;
+        }
+    }
+    app_id = str.substr(0, dot);
+    partition_index = str.substr(dot + 1);
+    return true;
+}
+
+// The counter "<app>*<section>*<name>@<suffix>" is exported as metric "<section>_<name>" with
+// label "service" of <app>, a RATE counter as the counter "<section>_<name>_total" of its total,
+// which Prometheus computes the rate of. The suffix (also after '#') is turned into labels:
+//   - "app_id" and "partition_index" if it's a gpid, like "1.3"
+//   - "disk_tag" if the counter is about disks, like "disk.available.ratio@ssd1"
+//   - "table" otherwise
+metric_entry to_metric_entry(perf_counter *counter)
+{
+    metric_entry entry;
+    entry.counter = counter;
+
+    std::string name = counter->name();
+    std::string suffix;
+    size_t pos = name.find_last_of("@#");
+    if (pos != std::string::npos) {
+        suffix = name.substr(pos + 1);
+        name.resize(pos);
+    }
+
+    append_metric_name(entry.family, std::string(counter->section()) + "_" + name);
+    if (entry.family.empty() || isdigit(entry.family[0])) {
+        entry.family.insert(0, "_");
+    }
+    if (counter->type() == COUNTER_TYPE_RATE) {
+        entry.family.append("_total");
+    }
+
+    append_label(entry.labels, "service", counter->app());
+    if (!suffix.empty()) {
+        std::string app_id, partition_index;
+        if (is_gpid(suffix, app_id, partition_index)) {
+            append_label(entry.labels, "app_id", app_id);
+            append_label(entry.labels, "partition_index", partition_index);
+        } else if (name.compare(0, 5, "disk.") == 0) {
+            append_label(entry.labels, "disk_tag", suffix);
+        } else {
+            append_label(entry.labels, "table", suffix);
+        }
+    }
+    return entry;
+}
+
+void append_value(std::string &out, double value)
+{
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%.15g", value);
+    out.append(buf, n);
+}
+
+void append_sample(std::string &out,
+                   const std::string &name,
+                   const char *name_suffix,
+                   const std::string &labels,
+                   const char *extra_label,
+                   const std::string &extra_value,
+                   double value)
+{
+    out.append(name).append(name_suffix).push_back('{');
+    out.append(labels);
+    if (extra_label != nullptr) {
+        out.append(",").append(extra_label).append("=\"").append(extra_value).append("\"");
+    }
+    out.append("} ");
+    append_value(out, value);
+    out.push_back('\n');
+}
+
+// The percentiles are computed from the samples of a window which is reset periodically,
+// rather than cumulative buckets, so they are exported as a summary of quantiles whatever the
+// implementation of the counter is. The _sum and _count are cumulative.
+void append_percentile_counter(std::string &out, const metric_entry &entry)
+{
+    static const char *quantiles[COUNTER_PERCENTILE_COUNT] = {
+        "0.5", "0.9", "0.95", "0.99", "0.999"};
+    for (int i = 0; i < COUNTER_PERCENTILE_COUNT; ++i) {
+        append_sample(out,
+                      entry.family,
+                      "",
+                      entry.labels,
+                      "quantile",
+                      quantiles[i],
+                      entry.counter->get_percentile((dsn_perf_counter_percentile_type_t)i));
+    }
+
+    uint64_t count = 0;
+    int64_t sum = 0;
+    if (entry.counter->get_samples_total(count, sum)) {
+        append_sample(out, entry.family, "_sum", entry.labels, nullptr, "", sum);
+        append_sample(out, entry.family, "_count", entry.labels, nullptr, "", count);
+    }
+}
+
+const char *metric_type(const perf_counter *counter)
+{
+    switch (counter->type()) {
+    case COUNTER_TYPE_NUMBER_PERCENTILES:
+        return "summary";
+    case COUNTER_TYPE_RATE:
+        return "counter";
+    default:
+        return "gauge";
+    }
+}
+
+} // anonymous namespace
+
+void get_metrics_handler(const http_request &req, http_response &resp)
+{
+    std::vector<perf_counter_ptr> counters;
+    perf_counters::instance().get_all_counters(&counters);
+
+    // the samples of a metric should be contiguous in the exposition
+    auto entries = std::make_shared<std::vector<metric_entry>>();
+    entries->reserve(counters.size());
+    for (const perf_counter_ptr &c : counters) {
+        entries->emplace_back(to_metric_entry(c.get()));
+    }
+    std::sort(entries->begin(), entries->end(), [](const metric_entry &l, const metric_entry &r) {
+        return l.family < r.family;
+    });
+
+    // no snapshot of the values is taken, the counters are read while the response is written,
+    // which is compressed piece by piece as there may be tens of thousands of counters on a
+    // replica server
+    resp.body_writer = [entries](http_body_writer &writer) {
+        static const size_t flush_size = 16 * 1024;
+        std::string out;
+        out.reserve(flush_size * 2);
+        const std::string *last_family = nullptr;
+        for (const metric_entry &entry : *entries) {
+            if (last_family == nullptr || *last_family != entry.family) {
+                const char *type = metric_type(entry.counter);
+                out.append("# HELP ").append(entry.family).push_back(' ');
+                for (const char *p = entry.counter->dsptr(); *p != '\0'; ++p) {
+                    if (*p == '\n') {
+                        out.append("\\n");
+                    } else if (*p == '\\') {
+                        out.append("\\\\");
+                    } else {
+                        out.push_back(*p);
+                    }
+                }
+                out.append("\n# TYPE ").append(entry.family).append(" ").append(type).push_back(
+                    '\n');
+                last_family = &entry.family;
+            }
+
+            int64_t total = 0;
+            if (entry.counter->type() == COUNTER_TYPE_NUMBER_PERCENTILES) {
+                append_percentile_counter(out, entry);
+            } else if (entry.counter->get_total(total)) {
+                append_sample(out, entry.family, "", entry.labels, nullptr, "", total);
+            } else {
+                // peek_value() doesn't reset the counter, which is reset by the periodic
+                // get_value() of the collectors instead: a VOLATILE_NUMBER counter is exported as
+                // the count since the last collection.
+                append_sample(
+                    out, entry.family, "", entry.labels, nullptr, "", entry.counter->peek_value());
+            }
+
+            if (out.size() >= flush_size) {
+                writer.write(out);
+                out.clear();
+            }
+        }
+        writer.write(out);
+    };
+
+    resp.content_type = "text/plain; version=0.0.4";
+    resp.status_code = http_status_code::ok;
+}
 } // namespace dsn
@@ -0,0 +1,87 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "http/cpu_profiler_http_service.h"
+
+namespace dsn {
+
+static double burn_cpu(int milliseconds)
+{
+    double result = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (int i = 1; i < 10000; ++i) {
+            result += std::sqrt(i);
+        }
+    }
+    return result;
+}
+
+TEST(cpu_profiler_test, folded_stacks)
+{
+    cpu_profiler &profiler = cpu_profiler::instance();
+    ASSERT_TRUE(profiler.start(500, 1024));
+    ASSERT_TRUE(profiler.is_running());
+    // can't be started twice
+    ASSERT_FALSE(profiler.start(500, 1024));
+
+    ASSERT_GT(burn_cpu(500), 0);
+    profiler.stop();
+    ASSERT_FALSE(profiler.is_running());
+
+    std::string folded;
+    // no sample is dropped as the ring is large enough
+    ASSERT_TRUE(profiler.get_folded_stacks(10, folded));
+    ASSERT_FALSE(folded.empty());
+
+    // each line is "<root>;<frame>;...;<frame> <count>", the samples of this thread are
+    // rooted by the thread name as no task is running
+    uint64_t total = 0;
+    size_t begin = 0;
+    while (begin < folded.size()) {
+        size_t end = folded.find('\n', begin);
+        ASSERT_NE(std::string::npos, end);
+        std::string line = folded.substr(begin, end - begin);
+        size_t space = line.rfind(' ');
+        ASSERT_NE(std::string::npos, space);
+        ASSERT_EQ('[', line[0]) << line;
+        ASSERT_NE(std::string::npos, line.find(';')) << line;
+        total += std::stoull(line.substr(space + 1));
+        begin = end + 1;
+    }
+    // about 250 samples are expected
+    ASSERT_GT(total, 50);
+    ASSERT_LE(total, 1024);
+
+    // a window longer than the process has been running includes all of the samples
+    std::string all_folded;
+    profiler.get_folded_stacks(UINT32_MAX, all_folded);
+    ASSERT_EQ(folded, all_folded);
+
+    // the samples out of the window are skipped
+    std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+    profiler.get_folded_stacks(1, folded);
+    ASSERT_TRUE(folded.empty());
+}
+
+TEST(cpu_profiler_test, frequency)
+{
+    cpu_profiler &profiler = cpu_profiler::instance();
+    ASSERT_FALSE(profiler.start(0, 1024));
+    ASSERT_FALSE(profiler.start(1001, 1024));
+
+    // the interval of 1Hz is a whole second, which is out of the range of tv_usec
+    ASSERT_TRUE(profiler.start(1, 1024));
+    ASSERT_TRUE(profiler.is_running());
+    profiler.stop();
+    ASSERT_FALSE(profiler.is_running());
+}
+
+} // namespace dsn
@@ -0,0 +1,63 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <gtest/gtest.h>
+
+#include "http/gzip_compressor.h"
+
+namespace dsn {
+
+static std::string gunzip(const std::string &compressed)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // 15 + 16: decode the gzip format only
+    EXPECT_EQ(Z_OK, inflateInit2(&stream, 15 + 16));
+
+    std::string out;
+    char buf[4096];
+    stream.next_in = (Bytef *)compressed.data();
+    stream.avail_in = compressed.size();
+    int ret = Z_OK;
+    while (ret == Z_OK) {
+        stream.next_out = (Bytef *)buf;
+        stream.avail_out = sizeof(buf);
+        ret = inflate(&stream, Z_NO_FLUSH);
+        out.append(buf, sizeof(buf) - stream.avail_out);
+    }
+    EXPECT_EQ(Z_STREAM_END, ret);
+    inflateEnd(&stream);
+    return out;
+}
+
+TEST(gzip_compressor_test, round_trip)
+{
+    std::string data;
+    for (int i = 0; i < 10000; i++) {
+        data += "replica*app.pegasus*get_qps@1." + std::to_string(i % 100) + ",";
+    }
+
+    gzip_compressor compressor;
+    std::string compressed;
+    // compress in pieces like the body written by http_response::body_writer
+    for (size_t pos = 0; pos < data.size(); pos += 1000) {
+        compressor.compress(data.data() + pos, std::min<size_t>(1000, data.size() - pos),
+                            compressed);
+    }
+    compressor.finish(compressed);
+
+    ASSERT_LT(compressed.size(), data.size() / 10);
+    ASSERT_EQ(data, gunzip(compressed));
+}
+
+TEST(gzip_compressor_test, empty)
+{
+    gzip_compressor compressor;
+    std::string compressed;
+    compressor.finish(compressed);
+    ASSERT_FALSE(compressed.empty());
+    ASSERT_EQ("", gunzip(compressed));
+}
+
+} // namespace dsn
@@ -136,7 +136,7 @@ public:
             ASSERT_EQ(msg->hdr_format, NET_HDR_HTTP);
             ASSERT_EQ(msg->header->hdr_type, http_method::HTTP_METHOD_GET);
             ASSERT_EQ(msg->header->context.u.is_request, 1);
-            ASSERT_EQ(msg->buffers.size(), 4);
+            ASSERT_EQ(msg->buffers.size(), 5);
             ASSERT_EQ(msg->buffers[2].size(), 1); // url
 
             // ensure states are reset
@@ -177,7 +177,7 @@ TEST_F(http_message_parser_test, parse_request)
     ASSERT_EQ(msg->hdr_format, NET_HDR_HTTP);
     ASSERT_EQ(msg->header->hdr_type, http_method::HTTP_METHOD_POST);
     ASSERT_EQ(msg->header->context.u.is_request, 1);
-    ASSERT_EQ(msg->buffers.size(), 4);
+    ASSERT_EQ(msg->buffers.size(), 5);
     ASSERT_EQ(msg->buffers[1].to_string(), "Message Body sdfsdf"); // body
     ASSERT_EQ(                                                     // url
         msg->buffers[2].to_string(),
@@ -228,7 +228,7 @@ TEST_F(http_message_parser_test, eof)
     ASSERT_EQ(msg->hdr_format, NET_HDR_HTTP);
     ASSERT_EQ(msg->header->hdr_type, http_method::HTTP_METHOD_GET);
     ASSERT_EQ(msg->header->context.u.is_request, 1);
-    ASSERT_EQ(msg->buffers.size(), 4);
+    ASSERT_EQ(msg->buffers.size(), 5);
     ASSERT_EQ(msg->buffers[1].to_string(), ""); // body
     ASSERT_EQ(                                  // url
         msg->buffers[2].to_string(),
@@ -237,6 +237,74 @@ TEST_F(http_message_parser_test, eof)
                     "A7%E8%A1%8C%"
                     "E6%94%BF%E5%8D%95%E4%BD%8D&output=json&ak=0l3FSP6qA0WbOzGRaafbmczS"));
     ASSERT_EQ(msg->buffers[3].to_string(), std::string("application/json;charset=utf8"));
+    ASSERT_EQ(msg->buffers[4].to_string(), std::string("deflate,sdch"));
+
+    auto res = http_request::parse(msg.get());
+    ASSERT_TRUE(res.is_ok());
+    ASSERT_FALSE(res.get_value().accept_gzip);
+}
+
+TEST_F(http_message_parser_test, accept_gzip)
+{
+    std::string http_request = "GET /metrics HTTP/1.1\r\n"
+                               "accept-encoding: gzip, deflate\r\n"
+                               "\r\n";
+
+    message_reader reader(64);
+    char *buf = reader.read_buffer_ptr(http_request.size());
+    memcpy(buf, http_request.data(), http_request.size());
+    reader.mark_read(http_request.size());
+
+    http_message_parser parser;
+    int read_next = 0;
+    message_ptr msg = parser.get_message_on_receive(&reader, read_next);
+    ASSERT_NE(msg, nullptr);
+    ASSERT_EQ(msg->buffers[4].to_string(), std::string("gzip, deflate"));
+
+    auto res = http_request::parse(msg.get());
+    ASSERT_TRUE(res.is_ok());
+    ASSERT_EQ("/metrics", res.get_value().path);
+    ASSERT_TRUE(res.get_value().accept_gzip);
+}
+
+TEST_F(http_message_parser_test, accept_encoding_qvalues)
+{
+    struct test_case
+    {
+        std::string accept_encoding;
+        bool accept_gzip;
+    } tests[] = {
+        {"gzip;q=0", false},
+        {"gzip; q=0.0, deflate", false},
+        {"GZIP;q=0.5", true},
+        {"deflate, gzip;q=1.0", true},
+        {"x-gzip", true},
+        {"*", true},
+        {"*;q=0", false},
+        {"gzip;q=0, *", false},
+        {"deflate, *;q=0.1", true},
+        {"identity", false},
+        {"gzipx", false},
+    };
+    for (const auto &test : tests) {
+        std::string http_request = "GET /metrics HTTP/1.1\r\n"
+                                   "Accept-Encoding: " +
+                                   test.accept_encoding + "\r\n\r\n";
+
+        message_reader reader(64);
+        char *buf = reader.read_buffer_ptr(http_request.size());
+        memcpy(buf, http_request.data(), http_request.size());
+        reader.mark_read(http_request.size());
+
+        http_message_parser parser;
+        int read_next = 0;
+        message_ptr msg = parser.get_message_on_receive(&reader, read_next);
+        ASSERT_NE(msg, nullptr);
+
+        auto res = http_request::parse(msg.get());
+        ASSERT_TRUE(res.is_ok());
+        ASSERT_EQ(test.accept_gzip, res.get_value().accept_gzip) << test.accept_encoding;
+    }
 }
 
 TEST_F(http_message_parser_test, parse_bad_request) { parse_bad_request(); }
@@ -259,7 +327,7 @@ TEST_F(http_message_parser_test, parse_long_url)
     ASSERT_EQ(msg->hdr_format, NET_HDR_HTTP);
     ASSERT_EQ(msg->header->hdr_type, http_method::HTTP_METHOD_GET);
     ASSERT_EQ(msg->header->context.u.is_request, 1);
-    ASSERT_EQ(msg->buffers.size(), 4);
+    ASSERT_EQ(msg->buffers.size(), 5);
     ASSERT_EQ(msg->buffers[2].size(), 4097); // url
 }
 
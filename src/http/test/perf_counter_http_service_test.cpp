@@ -5,6 +5,8 @@
 #include <gtest/gtest.h>
 #include <dsn/perf_counter/perf_counters.h>
 #include <dsn/http/http_server.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/utility/flags.h>
 
 #include "http/builtin_http_calls.h"
 
@@ -58,3 +60,82 @@ TEST(perf_counter_http_service_test, get_perf_counter)
     }
 }
 } // namespace dsn
+
+namespace dsn {
+
+DSN_DECLARE_bool(use_histogram);
+
+TEST(perf_counter_http_service_test, get_metrics)
+{
+    bool old_use_histogram = FLAGS_use_histogram;
+    FLAGS_use_histogram = true;
+
+    perf_counter_wrapper log_size1, log_size2, disk_ratio, latency, qps;
+    log_size1.init_global_counter(
+        "replica", "metrics", "private.log.size(MB)@1.3", COUNTER_TYPE_NUMBER, "log size");
+    log_size2.init_global_counter(
+        "replica", "metrics", "private.log.size(MB)@2.0", COUNTER_TYPE_NUMBER, "log size");
+    disk_ratio.init_global_counter(
+        "replica", "metrics", "disk.available.ratio@ssd1", COUNTER_TYPE_NUMBER, "disk ratio");
+    latency.init_global_counter("replica",
+                                "metrics",
+                                "get.latency(ns)@temp",
+                                COUNTER_TYPE_NUMBER_PERCENTILES,
+                                "get latency");
+    qps.init_global_counter("replica", "metrics", "get_qps", COUNTER_TYPE_RATE, "get qps");
+    FLAGS_use_histogram = old_use_histogram;
+
+    log_size1->set(10);
+    log_size2->set(20);
+    disk_ratio->set(80);
+    qps->add(3);
+    latency->set(100);
+    latency->set(200);
+
+    http_request req;
+    http_response resp;
+    get_metrics_handler(req, resp);
+    ASSERT_EQ(http_status_code::ok, resp.status_code);
+    // the body is streamed
+    ASSERT_TRUE(resp.body_writer);
+    struct string_body_writer : public http_body_writer
+    {
+        void write(const char *data, size_t size) override { body.append(data, size); }
+        std::string body;
+    } writer;
+    resp.body_writer(writer);
+    const std::string &body = writer.body;
+
+    auto contains = [&body](const std::string &str) {
+        return body.find(str) != std::string::npos;
+    };
+    // the samples of a metric are put together, with one TYPE line
+    std::string log_size_metric = "# HELP metrics_private_log_size_MB log size\n"
+                                  "# TYPE metrics_private_log_size_MB gauge\n"
+                                  "metrics_private_log_size_MB{service=\"replica\",app_id=\"1\","
+                                  "partition_index=\"3\"} 10\n"
+                                  "metrics_private_log_size_MB{service=\"replica\",app_id=\"2\","
+                                  "partition_index=\"0\"} 20\n";
+    std::string log_size_metric2 = "# HELP metrics_private_log_size_MB log size\n"
+                                   "# TYPE metrics_private_log_size_MB gauge\n"
+                                   "metrics_private_log_size_MB{service=\"replica\",app_id=\"2\","
+                                   "partition_index=\"0\"} 20\n"
+                                   "metrics_private_log_size_MB{service=\"replica\",app_id=\"1\","
+                                   "partition_index=\"3\"} 10\n";
+    ASSERT_TRUE(contains(log_size_metric) || contains(log_size_metric2)) << body;
+    ASSERT_TRUE(
+        contains("metrics_disk_available_ratio{service=\"replica\",disk_tag=\"ssd1\"} 80\n"));
+    // the total of a rate counter, which Prometheus computes the rate of
+    ASSERT_TRUE(contains("# TYPE metrics_get_qps_total counter\n"
+                         "metrics_get_qps_total{service=\"replica\"} 3\n"));
+
+    // the percentiles of a window are not cumulative, so they are a summary even if they are
+    // computed by a histogram
+    ASSERT_TRUE(contains("# TYPE metrics_get_latency_ns summary\n"));
+    ASSERT_TRUE(contains(
+        "metrics_get_latency_ns{service=\"replica\",table=\"temp\",quantile=\"0.99\"} 0\n"));
+    ASSERT_FALSE(contains("metrics_get_latency_ns_bucket"));
+    ASSERT_TRUE(contains("metrics_get_latency_ns_sum{service=\"replica\",table=\"temp\"} 300\n"
+                         "metrics_get_latency_ns_count{service=\"replica\",table=\"temp\"} 2\n"));
+}
+} // namespace dsn
@@ -123,6 +123,21 @@ bool check_write_throttling(const std::string &env_value, std::string &hint_mess
     return true;
 }
 
+bool check_table_throttling(const std::string &env_value, std::string &hint_message)
+{
+    // example: 1000 / 20K / 10M
+    std::string units_str = env_value;
+    if (!units_str.empty() && ('M' == *units_str.rbegin() || 'K' == *units_str.rbegin())) {
+        units_str.pop_back();
+    }
+    int64_t units = 0;
+    if (!buf2int64(units_str, units) || units < 0) {
+        hint_message = fmt::format("{} should be non-negative int", units_str);
+        return false;
+    }
+    return true;
+}
+
 bool app_env_validator::validate_app_env(const std::string &env_name,
                                          const std::string &env_value,
                                          std::string &hint_message)
@@ -151,6 +166,12 @@ void app_env_validator::register_all_validators()
          std::bind(&check_write_throttling, std::placeholders::_1, std::placeholders::_2)},
         {replica_envs::WRITE_SIZE_THROTTLING,
          std::bind(&check_write_throttling, std::placeholders::_1, std::placeholders::_2)},
+        {replica_envs::TABLE_WRITE_QPS_THROTTLING,
+         std::bind(&check_table_throttling, std::placeholders::_1, std::placeholders::_2)},
+        {replica_envs::TABLE_WRITE_SIZE_THROTTLING,
+         std::bind(&check_table_throttling, std::placeholders::_1, std::placeholders::_2)},
+        {replica_envs::TABLE_READ_QPS_THROTTLING,
+         std::bind(&check_table_throttling, std::placeholders::_1, std::placeholders::_2)},
         {replica_envs::ROCKSDB_ITERATION_THRESHOLD_TIME_MS,
          std::bind(&check_rocksdb_iteration, std::placeholders::_1, std::placeholders::_2)},
         // TODO(zhaoliwei): not implemented
@@ -0,0 +1,289 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "backup_shared_files_gc.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/filesystem.h>
+
+#include "common/backup_utils.h"
+
+namespace dsn {
+namespace replication {
+
+using namespace dist::block_service;
+
+DEFINE_TASK_CODE(LPC_BACKUP_SHARED_FILES_GC, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+backup_shared_files_gc::backup_shared_files_gc(block_filesystem *fs,
+                                               const std::string &root,
+                                               const std::string &policy_name,
+                                               const std::string &app_name,
+                                               int32_t app_id,
+                                               std::vector<int64_t> backup_ids)
+    : _fs(fs),
+      _root(root),
+      _policy_name(policy_name),
+      _app_name(app_name),
+      _app_id(app_id),
+      _backup_ids(std::move(backup_ids))
+{
+}
+
+void backup_shared_files_gc::start(task_tracker *tracker, gc_callback cb)
+{
+    _tracker = tracker;
+    _cb = std::move(cb);
+    list_dir(cold_backup::get_shared_files_path(_root, _policy_name, _app_name, _app_id),
+             [this](error_code err, std::vector<ls_entry> entries) {
+                 if (err == ERR_OBJECT_NOT_FOUND) {
+                     finish(ERR_OK);
+                     return;
+                 }
+                 if (err != ERR_OK) {
+                     finish(err);
+                     return;
+                 }
+                 _shared_files = std::move(entries);
+                 collect_backup(0);
+             });
+}
+
+void backup_shared_files_gc::collect_backup(size_t backup_index)
+{
+    if (backup_index == _backup_ids.size()) {
+        remove_files(0);
+        return;
+    }
+
+    const int64_t backup_id = _backup_ids[backup_index];
+    read_file(cold_backup::get_app_backup_status_file(
+                  _root, _policy_name, _app_name, _app_id, backup_id),
+              [this, backup_index, backup_id](error_code err, blob) {
+                  if (err == ERR_OK) {
+                      // the app is backed up completely, all its partitions must be read
+                      read_file(cold_backup::get_app_metadata_file(
+                                    _root, _policy_name, _app_name, _app_id, backup_id),
+                                [this, backup_index](error_code err, blob value) {
+                                    if (err != ERR_OK) {
+                                        finish(err);
+                                        return;
+                                    }
+                                    app_info info;
+                                    if (!json::json_forwarder<app_info>::decode(value, info) ||
+                                        info.partition_count <= 0) {
+                                        finish(ERR_CORRUPTION);
+                                        return;
+                                    }
+                                    _partitions.clear();
+                                    for (int32_t i = 0; i < info.partition_count; i++) {
+                                        _partitions.emplace_back(std::to_string(i));
+                                    }
+                                    _partitions_required = true;
+                                    collect_partition(backup_index, 0);
+                                });
+                      return;
+                  }
+                  if (err != ERR_OBJECT_NOT_FOUND) {
+                      finish(err);
+                      return;
+                  }
+
+                  // the app was skipped by the backup as it was dropped, whose partitions may
+                  // be uploaded partially
+                  dwarn_f("{}: app({}) isn't backed up completely by backup({}), collect the "
+                          "shared files referenced by the partitions uploaded",
+                          _policy_name,
+                          _app_name,
+                          backup_id);
+                  list_dir(cold_backup::get_app_backup_path(
+                               _root, _policy_name, _app_name, _app_id, backup_id),
+                           [this, backup_index](error_code err, std::vector<ls_entry> entries) {
+                               if (err == ERR_OBJECT_NOT_FOUND) {
+                                   collect_backup(backup_index + 1);
+                                   return;
+                               }
+                               if (err != ERR_OK) {
+                                   finish(err);
+                                   return;
+                               }
+                               _partitions.clear();
+                               for (const ls_entry &entry : entries) {
+                                   // the partition dirs are named by the partition index, skip
+                                   // the meta dir
+                                   if (entry.is_directory && !entry.entry_name.empty() &&
+                                       std::all_of(entry.entry_name.begin(),
+                                                   entry.entry_name.end(),
+                                                   ::isdigit)) {
+                                       _partitions.emplace_back(entry.entry_name);
+                                   }
+                               }
+                               _partitions_required = false;
+                               collect_partition(backup_index, 0);
+                           });
+              });
+}
+
+void backup_shared_files_gc::collect_partition(size_t backup_index, size_t partition_index)
+{
+    if (partition_index == _partitions.size()) {
+        collect_backup(backup_index + 1);
+        return;
+    }
+
+    const std::string partition_path = utils::filesystem::path_combine(
+        cold_backup::get_app_backup_path(
+            _root, _policy_name, _app_name, _app_id, _backup_ids[backup_index]),
+        _partitions[partition_index]);
+    // a missing file is an error unless the partition is allowed to be incomplete
+    auto skip_or_fail = [this, backup_index, partition_index, partition_path](error_code err) {
+        if (err == ERR_OBJECT_NOT_FOUND && !_partitions_required) {
+            collect_partition(backup_index, partition_index + 1);
+            return;
+        }
+        derror_f("{}: read the backup metadata of {} failed, err = {}",
+                 _policy_name,
+                 partition_path,
+                 err.to_string());
+        finish(err);
+    };
+
+    read_file(
+        utils::filesystem::path_combine(partition_path, cold_backup_constant::CURRENT_CHECKPOINT),
+        [this, backup_index, partition_index, partition_path, skip_or_fail](error_code err,
+                                                                           blob chkpt_dirname) {
+            if (err != ERR_OK) {
+                skip_or_fail(err);
+                return;
+            }
+            const std::string chkpt_dir =
+                utils::filesystem::path_combine(partition_path, chkpt_dirname.to_string());
+            read_file(
+                utils::filesystem::path_combine(chkpt_dir, cold_backup_constant::BACKUP_METADATA),
+                [this, backup_index, partition_index, partition_path, skip_or_fail](
+                    error_code err, blob value) {
+                    if (err != ERR_OK) {
+                        skip_or_fail(err);
+                        return;
+                    }
+                    cold_backup_metadata metadata;
+                    if (!json::json_forwarder<cold_backup_metadata>::decode(value, metadata)) {
+                        derror_f("{}: decode the backup_metadata of {} failed",
+                                 _policy_name,
+                                 partition_path);
+                        finish(ERR_CORRUPTION);
+                        return;
+                    }
+
+                    std::set<std::string> shared_files(metadata.shared_files.begin(),
+                                                       metadata.shared_files.end());
+                    for (const file_meta &f_meta : metadata.files) {
+                        if (shared_files.count(f_meta.name) > 0) {
+                            _referenced.insert(
+                                cold_backup::get_shared_file_name(f_meta.md5, f_meta.size));
+                        }
+                    }
+                    collect_partition(backup_index, partition_index + 1);
+                });
+        });
+}
+
+void backup_shared_files_gc::remove_files(size_t file_index)
+{
+    while (file_index < _shared_files.size() &&
+           (_shared_files[file_index].is_directory ||
+            _referenced.count(_shared_files[file_index].entry_name) > 0)) {
+        file_index++;
+    }
+    if (file_index == _shared_files.size()) {
+        ddebug_f("{}: gc the shared files of app({}) succeed, {} of {} files are removed",
+                 _policy_name,
+                 _app_name,
+                 _removed_count,
+                 _shared_files.size());
+        finish(ERR_OK);
+        return;
+    }
+
+    const std::string &file_name = _shared_files[file_index].entry_name;
+    remove_file(utils::filesystem::path_combine(
+                    cold_backup::get_shared_files_path(_root, _policy_name, _app_name, _app_id),
+                    file_name),
+                [this, file_index, file_name](error_code err) {
+                    if (err != ERR_OK && err != ERR_OBJECT_NOT_FOUND) {
+                        derror_f("{}: remove shared file({}) of app({}) failed, err = {}",
+                                 _policy_name,
+                                 file_name,
+                                 _app_name,
+                                 err.to_string());
+                        finish(err);
+                        return;
+                    }
+                    _removed_count++;
+                    remove_files(file_index + 1);
+                });
+}
+
+void backup_shared_files_gc::finish(error_code err)
+{
+    if (err != ERR_OK) {
+        derror_f("{}: gc the shared files of app({}) failed, err = {}",
+                 _policy_name,
+                 _app_name,
+                 err.to_string());
+    }
+    _cb(err, _removed_count);
+}
+
+// the callbacks hold a reference of the gc, so that it lives until the gc is finished
+
+void backup_shared_files_gc::list_dir(
+    const std::string &dir, std::function<void(error_code, std::vector<ls_entry>)> cb)
+{
+    auto self = shared_from_this();
+    _fs->list_dir(ls_request{dir},
+                  LPC_BACKUP_SHARED_FILES_GC,
+                  [self, cb](const ls_response &resp) {
+                      cb(resp.err, resp.err == ERR_OK ? *resp.entries : std::vector<ls_entry>());
+                  },
+                  _tracker);
+}
+
+void backup_shared_files_gc::read_file(const std::string &file_name,
+                                       std::function<void(error_code, blob)> cb)
+{
+    auto self = shared_from_this();
+    _fs->create_file(create_file_request{file_name, true},
+                     LPC_BACKUP_SHARED_FILES_GC,
+                     [this, self, cb](const create_file_response &resp) {
+                         if (resp.err != ERR_OK) {
+                             cb(resp.err, blob());
+                             return;
+                         }
+                         block_file_ptr file_handle = resp.file_handle;
+                         file_handle->read(read_request{0, -1},
+                                           LPC_BACKUP_SHARED_FILES_GC,
+                                           [self, file_handle, cb](const read_response &resp) {
+                                               cb(resp.err, resp.buffer);
+                                           },
+                                           _tracker);
+                     },
+                     _tracker);
+}
+
+void backup_shared_files_gc::remove_file(const std::string &file_name,
+                                         std::function<void(error_code)> cb)
+{
+    auto self = shared_from_this();
+    _fs->remove_path(remove_path_request{file_name, false},
+                     LPC_BACKUP_SHARED_FILES_GC,
+                     [self, cb](const remove_path_response &resp) { cb(resp.err); },
+                     _tracker);
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,78 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <dsn/dist/block_service.h>
+
+namespace dsn {
+namespace replication {
+
+// Remove the shared files of an app of a backup policy which are referenced by none of the
+// backups left, see cold_backup::get_shared_files_path.
+//
+// The referenced files are collected from the backup_metadata of all the partitions of the
+// backups left, so it must not run together with a backup of the policy, otherwise the files
+// reused by the running backup may be removed. If the metadata of any partition of a finished
+// backup can't be read, nothing is removed. Only the backups in which the app was skipped as
+// it was dropped are allowed to be incomplete, their files are referenced as far as found.
+//
+// The calls to block service are asynchronous, one at a time.
+class backup_shared_files_gc : public std::enable_shared_from_this<backup_shared_files_gc>
+{
+public:
+    // the error, and the number of the files removed
+    typedef std::function<void(error_code, int)> gc_callback;
+
+    // backup_ids: the backups left which include the app of `app_name`
+    backup_shared_files_gc(dist::block_service::block_filesystem *fs,
+                           const std::string &root,
+                           const std::string &policy_name,
+                           const std::string &app_name,
+                           int32_t app_id,
+                           std::vector<int64_t> backup_ids);
+
+    // `cb` gets ERR_OK if all the unreferenced files are removed, otherwise nothing is removed
+    // unless it fails halfway while removing, and it's safe to retry
+    void start(task_tracker *tracker, gc_callback cb);
+
+private:
+    // add the names of the shared files referenced by the backup to _referenced
+    void collect_backup(size_t backup_index);
+    void collect_partition(size_t backup_index, size_t partition_index);
+    void remove_files(size_t file_index);
+    void finish(error_code err);
+
+    void list_dir(const std::string &dir,
+                  std::function<void(error_code, std::vector<dist::block_service::ls_entry>)> cb);
+    void read_file(const std::string &file_name, std::function<void(error_code, blob)> cb);
+    void remove_file(const std::string &file_name, std::function<void(error_code)> cb);
+
+    dist::block_service::block_filesystem *_fs;
+    const std::string _root;
+    const std::string _policy_name;
+    const std::string _app_name;
+    const int32_t _app_id;
+    const std::vector<int64_t> _backup_ids;
+
+    task_tracker *_tracker{nullptr};
+    gc_callback _cb;
+
+    std::vector<dist::block_service::ls_entry> _shared_files;
+    std::set<std::string> _referenced;
+    // the partition dirs of the backup being collected, all of them must be read if
+    // `_partitions_required`
+    std::vector<std::string> _partitions;
+    bool _partitions_required{false};
+    int _removed_count{0};
+};
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,225 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/tool-api/async_calls.h>
+#include <dsn/utility/flags.h>
+
+#include "config_subscription_service.h"
+#include "server_state.h"
+
+namespace dsn {
+namespace replication {
+
+DSN_DEFINE_uint32("meta_server",
+                  config_subscription_max_hold_ms,
+                  60000,
+                  "max time to hold a config subscription before replying it, the hold time "
+                  "is also limited by the rpc timeout of the client");
+DSN_DEFINE_uint32("meta_server",
+                  config_subscription_coalesce_ms,
+                  100,
+                  "changes of an app happened in this interval are pushed to the subscribers "
+                  "in one reply");
+
+// the client has to receive the reply before its rpc timeout
+static const int32_t hold_margin_ms = 1000;
+
+config_subscription_service::config_subscription_service(server_state *state)
+    : _state(state), _next_id(0), _change_seq(0)
+{
+}
+
+config_subscription_service::~config_subscription_service()
+{
+    _tracker.cancel_outstanding_tasks();
+
+    // reply the held requests, the clients will subscribe again
+    zauto_lock l(_lock);
+    for (auto &app : _apps) {
+        for (auto &kv : app.second.subscribers) {
+            kv.second.rpc.response().err = ERR_TIMEOUT;
+        }
+    }
+    _apps.clear();
+}
+
+bool config_subscription_service::try_fill_response(
+    configuration_query_by_index_rpc &rpc,
+    const std::shared_ptr<const app_config_snapshot> &snapshot,
+    error_code err,
+    bool force)
+{
+    const configuration_query_by_index_request &request = rpc.request();
+    configuration_query_by_index_response &response = rpc.response();
+    if (snapshot == nullptr) {
+        response.err = err;
+        return true;
+    }
+    // the ballots of a recreated app start over, so they are comparable only with the same id
+    bool same_app = !request.__isset.known_app_id || request.known_app_id == snapshot->app_id;
+    if (!force && same_app && snapshot->is_stateful &&
+        snapshot->ballot_sum <= request.known_ballot_sum) {
+        return false;
+    }
+
+    response.err = ERR_OK;
+    response.app_id = snapshot->app_id;
+    response.partition_count = snapshot->partition_count;
+    response.is_stateful = snapshot->is_stateful;
+    response.partitions = snapshot->partitions;
+    return true;
+}
+
+void config_subscription_service::subscribe(configuration_query_by_index_rpc rpc)
+{
+    const configuration_query_by_index_request &request = rpc.request();
+    int32_t hold_ms =
+        std::min<int32_t>(FLAGS_config_subscription_max_hold_ms,
+                          rpc.dsn_request()->header->client.timeout_ms - hold_margin_ms);
+    bool force = !request.__isset.known_ballot_sum || hold_ms <= 0;
+
+    while (true) {
+        uint64_t seq;
+        {
+            zauto_lock l(_lock);
+            seq = _change_seq;
+        }
+
+        error_code err;
+        auto snapshot = _state->get_config_snapshot(request.app_name, err);
+        if (try_fill_response(rpc, snapshot, err, force)) {
+            // replied when rpc is released
+            return;
+        }
+
+        zauto_lock l(_lock);
+        if (seq != _change_seq) {
+            // the app may have changed before we hold the request, check it again
+            continue;
+        }
+
+        uint64_t id = ++_next_id;
+        subscription &sub = _apps[request.app_name].subscribers[id];
+        sub.rpc = rpc;
+        sub.hold_timer = tasking::enqueue(
+            LPC_META_CONFIG_SUBSCRIPTION,
+            &_tracker,
+            [ this, app_name = request.app_name, id ]() { on_hold_timeout(app_name, id); },
+            0,
+            std::chrono::milliseconds(hold_ms));
+        return;
+    }
+}
+
+void config_subscription_service::on_config_changed(const std::string &app_name)
+{
+    auto schedule_notify = [this](const std::string &name, app_subscriptions &app) {
+        if (app.notify_task == nullptr) {
+            app.notify_task = tasking::enqueue(
+                LPC_META_CONFIG_SUBSCRIPTION,
+                &_tracker,
+                [this, name]() { notify(name); },
+                0,
+                std::chrono::milliseconds(FLAGS_config_subscription_coalesce_ms));
+        }
+    };
+
+    zauto_lock l(_lock);
+    ++_change_seq;
+    if (app_name.empty()) {
+        for (auto &kv : _apps) {
+            schedule_notify(kv.first, kv.second);
+        }
+    } else {
+        auto iter = _apps.find(app_name);
+        if (iter != _apps.end()) {
+            schedule_notify(iter->first, iter->second);
+        }
+    }
+}
+
+void config_subscription_service::notify(const std::string &app_name)
+{
+    {
+        zauto_lock l(_lock);
+        auto iter = _apps.find(app_name);
+        if (iter == _apps.end()) {
+            return;
+        }
+        // the changes from now on will be notified by the next round
+        iter->second.notify_task = nullptr;
+    }
+
+    // get the snapshot without holding _lock, as it may lock the server_state
+    error_code err;
+    auto snapshot = _state->get_config_snapshot(app_name, err);
+
+    std::vector<subscription> ready;
+    {
+        zauto_lock l(_lock);
+        auto iter = _apps.find(app_name);
+        if (iter == _apps.end()) {
+            return;
+        }
+        auto &subscribers = iter->second.subscribers;
+        for (auto it = subscribers.begin(); it != subscribers.end();) {
+            if (try_fill_response(it->second.rpc, snapshot, err, false)) {
+                ready.emplace_back(std::move(it->second));
+                it = subscribers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (subscribers.empty() && iter->second.notify_task == nullptr) {
+            _apps.erase(iter);
+        }
+    }
+
+    if (!ready.empty()) {
+        dinfo_f("push routing table of app({}) to {} subscribers", app_name, ready.size());
+    }
+    for (subscription &sub : ready) {
+        sub.hold_timer->cancel(false);
+    }
+    // the responses are sent when ready is destructed
+}
+
+void config_subscription_service::on_hold_timeout(const std::string &app_name, uint64_t id)
+{
+    subscription sub;
+    {
+        zauto_lock l(_lock);
+        auto iter = _apps.find(app_name);
+        if (iter == _apps.end()) {
+            return;
+        }
+        auto it = iter->second.subscribers.find(id);
+        if (it == iter->second.subscribers.end()) {
+            return;
+        }
+        sub = std::move(it->second);
+        iter->second.subscribers.erase(it);
+        if (iter->second.subscribers.empty() && iter->second.notify_task == nullptr) {
+            _apps.erase(iter);
+        }
+    }
+
+    error_code err;
+    auto snapshot = _state->get_config_snapshot(app_name, err);
+    try_fill_response(sub.rpc, snapshot, err, true);
+}
+
+size_t config_subscription_service::subscriber_count() const
+{
+    zauto_lock l(_lock);
+    size_t count = 0;
+    for (const auto &kv : _apps) {
+        count += kv.second.subscribers.size();
+    }
+    return count;
+}
+
+} // namespace replication
+} // namespace dsn
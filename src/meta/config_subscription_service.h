@@ -0,0 +1,74 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <dsn/tool-api/task_tracker.h>
+#include <dsn/tool-api/zlocks.h>
+
+#include "meta_rpc_types.h"
+
+namespace dsn {
+namespace replication {
+
+class server_state;
+struct app_config_snapshot;
+
+// Clients subscribe to the routing table of an app by RPC_CM_SUBSCRIBE_PARTITION_CONFIG,
+// telling the app id and the sum of the partition ballots they know. The request is held on the
+// meta server until the app gets a greater ballot sum or another id (or the hold time expires),
+// then it is replied with the whole routing table, so the clients don't have to poll the meta
+// server after failover.
+//
+// Changes of an app are coalesced: the subscribers are notified at most once in
+// `config_subscription_coalesce_ms`, however many partitions of the app are reconfigured.
+class config_subscription_service
+{
+public:
+    explicit config_subscription_service(server_state *state);
+    ~config_subscription_service();
+
+    void subscribe(configuration_query_by_index_rpc rpc);
+
+    // called when the routing table of the app may have changed, with _lock of server_state
+    // held by the caller. an empty app_name means all of the apps.
+    void on_config_changed(const std::string &app_name);
+
+    size_t subscriber_count() const;
+
+private:
+    struct subscription
+    {
+        configuration_query_by_index_rpc rpc;
+        task_ptr hold_timer;
+    };
+
+    struct app_subscriptions
+    {
+        task_ptr notify_task;
+        std::unordered_map<uint64_t, subscription> subscribers;
+    };
+
+    // fill the response of rpc, return false if the routing table is not newer than the one
+    // the client knows.
+    bool try_fill_response(configuration_query_by_index_rpc &rpc,
+                           const std::shared_ptr<const app_config_snapshot> &snapshot,
+                           error_code err,
+                           bool force);
+    void notify(const std::string &app_name);
+    void on_hold_timeout(const std::string &app_name, uint64_t id);
+
+    server_state *_state;
+
+    mutable zlock _lock;
+    uint64_t _next_id;
+    // increased on every change, used to detect the changes happened during subscribe()
+    uint64_t _change_seq;
+    std::unordered_map<std::string, app_subscriptions> _apps;
+
+    dsn::task_tracker _tracker;
+};
+
+} // namespace replication
+} // namespace dsn
@@ -30,17 +30,45 @@
 #include <dsn/tool-api/command_manager.h>
 #include <dsn/utility/math.h>
 #include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/flags.h>
 #include "greedy_load_balancer.h"
 #include "meta_data.h"
 
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_bool("meta_server",
+                balancer_load_aware,
+                false,
+                "whether to balance the qps and storage of nodes when the replica count is "
+                "balanced");
+DSN_DEFINE_double("meta_server",
+                  balancer_load_start_ratio,
+                  1.3,
+                  "load-aware balancing starts when the load of a node exceeds "
+                  "average * balancer_load_start_ratio");
+DSN_DEFINE_double("meta_server",
+                  balancer_load_stop_ratio,
+                  1.1,
+                  "load-aware balancing stops when the loads of all nodes are under "
+                  "average * balancer_load_stop_ratio");
+DSN_DEFINE_validator(balancer_load_stop_ratio, [](double ratio) { return ratio >= 1.0; });
+DSN_DEFINE_double("meta_server",
+                  balancer_load_min_move_ratio,
+                  0.5,
+                  "the load moved by an exchange should be at least the average load of "
+                  "replicas * balancer_load_min_move_ratio, to avoid trivial moves");
+DSN_DEFINE_uint32("meta_server",
+                  balancer_load_max_exchange_count,
+                  4,
+                  "max count of replica exchanges in a round of load-aware balancing");
+
 greedy_load_balancer::greedy_load_balancer(meta_service *_svc)
     : simple_load_balancer(_svc),
       _ctrl_balancer_in_turn(nullptr),
       _ctrl_only_primary_balancer(nullptr),
       _ctrl_only_move_primary(nullptr),
+      _ctrl_load_aware_balancer(nullptr),
       _get_balance_operation_count(nullptr)
 {
     if (_svc != nullptr) {
@@ -52,6 +80,9 @@ greedy_load_balancer::greedy_load_balancer(meta_service *_svc)
         _only_primary_balancer = false;
         _only_move_primary = false;
     }
+    _load_aware_balancer = FLAGS_balancer_load_aware;
+    _qps_balancing = false;
+    _storage_balancing = false;
 
     ::memset(t_operation_counters, 0, sizeof(t_operation_counters));
 
@@ -82,6 +113,7 @@ greedy_load_balancer::~greedy_load_balancer()
     UNREGISTER_VALID_HANDLER(_ctrl_balancer_in_turn);
     UNREGISTER_VALID_HANDLER(_ctrl_only_primary_balancer);
     UNREGISTER_VALID_HANDLER(_ctrl_only_move_primary);
+    UNREGISTER_VALID_HANDLER(_ctrl_load_aware_balancer);
     UNREGISTER_VALID_HANDLER(_get_balance_operation_count);
 }
 
@@ -115,6 +147,15 @@ void greedy_load_balancer::register_ctrl_commands()
             return remote_command_set_bool_flag(_only_move_primary, "lb.only_move_primary", args);
         });
 
+    _ctrl_load_aware_balancer = dsn::command_manager::instance().register_command(
+        {"meta.lb.load_aware_balancer"},
+        "lb.load_aware_balancer <true|false>",
+        "control whether balance the qps and storage of nodes",
+        [this](const std::vector<std::string> &args) {
+            return remote_command_set_bool_flag(
+                _load_aware_balancer, "lb.load_aware_balancer", args);
+        });
+
     _get_balance_operation_count = dsn::command_manager::instance().register_command(
         {"meta.lb.get_balance_operation_count"},
         "lb.get_balance_operation_count [total | move_pri | copy_pri | copy_sec | detail]",
@@ -135,6 +176,7 @@ void greedy_load_balancer::unregister_ctrl_commands()
     UNREGISTER_VALID_HANDLER(_ctrl_balancer_in_turn);
     UNREGISTER_VALID_HANDLER(_ctrl_only_primary_balancer);
     UNREGISTER_VALID_HANDLER(_ctrl_only_move_primary);
+    UNREGISTER_VALID_HANDLER(_ctrl_load_aware_balancer);
     UNREGISTER_VALID_HANDLER(_get_balance_operation_count);
     UNREGISTER_VALID_HANDLER(_ctrl_balancer_ignored_apps);
 
@@ -902,6 +944,337 @@ void greedy_load_balancer::greedy_balancer(const bool balance_checker)
     }
 }
 
+greedy_load_balancer::partition_load
+greedy_load_balancer::get_partition_load(const config_context &cc)
+{
+    // read qps is only reported by primary, and the reports of replicas may be stale
+    // after reconfiguration, so we take the max value of all serving replicas
+    partition_load load{0, 0, 0};
+    for (const serving_replica &r : cc.serving) {
+        load.read_qps = std::max(load.read_qps, r.read_qps);
+        load.write_qps = std::max(load.write_qps, r.write_qps);
+        load.storage_mb = std::max(load.storage_mb, r.storage_mb);
+    }
+    return load;
+}
+
+bool greedy_load_balancer::can_balance_app(const std::shared_ptr<app_state> &app)
+{
+    return app->status == app_status::AS_AVAILABLE && !app->is_bulk_loading &&
+           !is_ignored_app(app->app_id);
+}
+
+bool greedy_load_balancer::is_load_unbalanced(const std::vector<int64_t> &node_loads,
+                                              bool balancing,
+                                              /*out*/ int &max_id,
+                                              /*out*/ int64_t &average)
+{
+    int64_t total = 0;
+    max_id = 1;
+    for (int id = 1; id <= t_alive_nodes; ++id) {
+        total += node_loads[id];
+        if (node_loads[id] > node_loads[max_id]) {
+            max_id = id;
+        }
+    }
+    average = total / t_alive_nodes;
+    if (average <= 0) {
+        return false;
+    }
+
+    double ratio = balancing ? FLAGS_balancer_load_stop_ratio : FLAGS_balancer_load_start_ratio;
+    return node_loads[max_id] > average * ratio;
+}
+
+bool greedy_load_balancer::exchange_primary_per_qps(std::vector<int64_t> &node_qps,
+                                                    int64_t min_move,
+                                                    bool balance_checker)
+{
+    const node_mapper &nodes = *(t_global_view->nodes);
+    const app_mapper &apps = *(t_global_view->apps);
+
+    bool balancing = _qps_balancing;
+    for (uint32_t i = 0; i < FLAGS_balancer_load_max_exchange_count; ++i) {
+        int hot_id;
+        int64_t average;
+        balancing = is_load_unbalanced(node_qps, balancing, hot_id, average);
+        if (!balancing) {
+            break;
+        }
+
+        const rpc_address &hot = address_vec[hot_id];
+        const node_state &hot_ns = nodes.find(hot)->second;
+
+        // find a primary `p` on the hot node and a primary `q` on node `t`, where t is a
+        // secondary of p and the hot node is a secondary of q, and exchange them. Moving the
+        // primaries transfers (read(p) - read(q)) from the hot node to t, we choose the pair
+        // which makes the loads of these two nodes closest.
+        double best_gain = 0;
+        gpid best_p, best_q;
+        int best_target = -1;
+        int64_t best_delta = 0;
+        for (const auto &kv : apps) {
+            const std::shared_ptr<app_state> &app = kv.second;
+            if (!can_balance_app(app)) {
+                continue;
+            }
+
+            // target node id -> primaries on the target node which have a secondary on hot
+            std::unordered_map<int, std::vector<gpid>> hot_as_secondary;
+            hot_ns.for_each_partition(app->app_id, [&](const gpid &pid) {
+                const partition_configuration &pc = app->partitions[pid.get_partition_index()];
+                if (pc.primary != hot && !pc.primary.is_invalid() &&
+                    t_migration_result->find(pid) == t_migration_result->end()) {
+                    hot_as_secondary[address_id[pc.primary]].push_back(pid);
+                }
+                return true;
+            });
+
+            hot_ns.for_each_primary(app->app_id, [&](const gpid &p) {
+                if (t_migration_result->find(p) != t_migration_result->end()) {
+                    return true;
+                }
+                const partition_configuration &pc = app->partitions[p.get_partition_index()];
+                int64_t p_read =
+                    get_partition_load(app->helpers->contexts[p.get_partition_index()]).read_qps;
+                for (const rpc_address &secondary : pc.secondaries) {
+                    int target = address_id[secondary];
+                    int64_t gap = node_qps[hot_id] - node_qps[target];
+                    auto iter = hot_as_secondary.find(target);
+                    if (iter == hot_as_secondary.end()) {
+                        continue;
+                    }
+                    for (const gpid &q : iter->second) {
+                        int64_t q_read =
+                            get_partition_load(app->helpers->contexts[q.get_partition_index()])
+                                .read_qps;
+                        int64_t delta = p_read - q_read;
+                        if (delta < min_move || delta >= gap) {
+                            continue;
+                        }
+                        // the reduction of square sum of the two nodes' loads
+                        double gain = static_cast<double>(delta) * (gap - delta);
+                        if (gain > best_gain) {
+                            best_gain = gain;
+                            best_p = p;
+                            best_q = q;
+                            best_target = target;
+                            best_delta = delta;
+                        }
+                    }
+                }
+                return true;
+            });
+        }
+
+        if (best_target == -1) {
+            ddebug_f("can't find primaries to exchange for node({}) with qps({}), average({})",
+                     hot.to_string(),
+                     node_qps[hot_id],
+                     average);
+            break;
+        }
+
+        const rpc_address &target = address_vec[best_target];
+        ddebug_f("exchange primary {} on {}(qps={}) with primary {} on {}(qps={}), "
+                 "moved qps = {}",
+                 best_p,
+                 hot.to_string(),
+                 node_qps[hot_id],
+                 best_q,
+                 target.to_string(),
+                 node_qps[best_target],
+                 best_delta);
+        t_migration_result->emplace(
+            best_p,
+            generate_balancer_request(
+                *get_config(apps, best_p), balance_type::move_primary, hot, target));
+        t_migration_result->emplace(
+            best_q,
+            generate_balancer_request(
+                *get_config(apps, best_q), balance_type::move_primary, target, hot));
+        node_qps[hot_id] -= best_delta;
+        node_qps[best_target] += best_delta;
+    }
+
+    if (!balance_checker) {
+        _qps_balancing = balancing;
+    }
+    return !t_migration_result->empty();
+}
+
+bool greedy_load_balancer::exchange_secondary_per_storage(std::vector<int64_t> &node_storage,
+                                                          int64_t min_move,
+                                                          bool balance_checker)
+{
+    const node_mapper &nodes = *(t_global_view->nodes);
+    const app_mapper &apps = *(t_global_view->apps);
+
+    bool balancing = _storage_balancing;
+    for (uint32_t i = 0; i < FLAGS_balancer_load_max_exchange_count; ++i) {
+        int hot_id;
+        int64_t average;
+        balancing = is_load_unbalanced(node_storage, balancing, hot_id, average);
+        if (!balancing) {
+            break;
+        }
+
+        int cold_id = 1;
+        for (int id = 1; id <= t_alive_nodes; ++id) {
+            if (node_storage[id] < node_storage[cold_id]) {
+                cold_id = id;
+            }
+        }
+        const rpc_address &hot = address_vec[hot_id];
+        const rpc_address &cold = address_vec[cold_id];
+        const node_state &hot_ns = nodes.find(hot)->second;
+        const node_state &cold_ns = nodes.find(cold)->second;
+        int64_t gap = node_storage[hot_id] - node_storage[cold_id];
+
+        // copy a secondary `p` from the hot node to the cold node, and a secondary `q` of
+        // the same app from the cold node to the hot node
+        auto collect_secondaries = [this](const std::shared_ptr<app_state> &app,
+                                          const node_state &from,
+                                          const node_state &to) {
+            std::vector<std::pair<int64_t, gpid>> result;
+            from.for_each_partition(app->app_id, [&](const gpid &pid) {
+                if (from.served_as(pid) == partition_status::PS_SECONDARY &&
+                    to.served_as(pid) == partition_status::PS_INACTIVE &&
+                    t_migration_result->find(pid) == t_migration_result->end()) {
+                    const config_context &cc = app->helpers->contexts[pid.get_partition_index()];
+                    result.emplace_back(get_partition_load(cc).storage_mb, pid);
+                }
+                return true;
+            });
+            return result;
+        };
+
+        double best_gain = 0;
+        gpid best_p, best_q;
+        int64_t best_delta = 0;
+        for (const auto &kv : apps) {
+            const std::shared_ptr<app_state> &app = kv.second;
+            if (!can_balance_app(app)) {
+                continue;
+            }
+
+            std::vector<std::pair<int64_t, gpid>> from_hot =
+                collect_secondaries(app, hot_ns, cold_ns);
+            std::vector<std::pair<int64_t, gpid>> from_cold =
+                collect_secondaries(app, cold_ns, hot_ns);
+            for (const auto &p : from_hot) {
+                for (const auto &q : from_cold) {
+                    int64_t delta = p.first - q.first;
+                    if (delta < min_move || delta >= gap) {
+                        continue;
+                    }
+                    double gain = static_cast<double>(delta) * (gap - delta);
+                    if (gain > best_gain) {
+                        best_gain = gain;
+                        best_p = p.second;
+                        best_q = q.second;
+                        best_delta = delta;
+                    }
+                }
+            }
+        }
+
+        if (best_gain == 0) {
+            ddebug_f("can't find secondaries to exchange between node({}) with storage({}MB) "
+                     "and node({}) with storage({}MB)",
+                     hot.to_string(),
+                     node_storage[hot_id],
+                     cold.to_string(),
+                     node_storage[cold_id]);
+            break;
+        }
+
+        ddebug_f("exchange secondary {} on {}(storage={}MB) with secondary {} on "
+                 "{}(storage={}MB), moved storage = {}MB",
+                 best_p,
+                 hot.to_string(),
+                 node_storage[hot_id],
+                 best_q,
+                 cold.to_string(),
+                 node_storage[cold_id],
+                 best_delta);
+        t_migration_result->emplace(
+            best_p,
+            generate_balancer_request(
+                *get_config(apps, best_p), balance_type::copy_secondary, hot, cold));
+        t_migration_result->emplace(
+            best_q,
+            generate_balancer_request(
+                *get_config(apps, best_q), balance_type::copy_secondary, cold, hot));
+        node_storage[hot_id] -= best_delta;
+        node_storage[cold_id] += best_delta;
+    }
+
+    if (!balance_checker) {
+        _storage_balancing = balancing;
+    }
+    return !t_migration_result->empty();
+}
+
+void greedy_load_balancer::load_balancer(bool balance_checker)
+{
+    if (t_alive_nodes <= 2) {
+        return;
+    }
+    for (const auto &kv : *(t_global_view->nodes)) {
+        if (!all_replica_infos_collected(kv.second)) {
+            return;
+        }
+    }
+
+    // the loads of unbalanceable apps are also taken into account, as they
+    // consume the resources of nodes all the same
+    std::vector<int64_t> node_qps(address_vec.size(), 0);
+    std::vector<int64_t> node_storage(address_vec.size(), 0);
+    int64_t total_qps = 0, total_storage = 0, total_replicas = 0;
+    for (const auto &kv : *(t_global_view->apps)) {
+        const std::shared_ptr<app_state> &app = kv.second;
+        if (app->status != app_status::AS_AVAILABLE) {
+            continue;
+        }
+        for (int i = 0; i < app->partition_count; ++i) {
+            const partition_configuration &pc = app->partitions[i];
+            partition_load load = get_partition_load(app->helpers->contexts[i]);
+            if (!pc.primary.is_invalid()) {
+                int id = address_id[pc.primary];
+                node_qps[id] += load.read_qps + load.write_qps;
+                node_storage[id] += load.storage_mb;
+                total_qps += load.read_qps + load.write_qps;
+                total_storage += load.storage_mb;
+                ++total_replicas;
+            }
+            for (const rpc_address &secondary : pc.secondaries) {
+                int id = address_id[secondary];
+                node_qps[id] += load.write_qps;
+                node_storage[id] += load.storage_mb;
+                total_qps += load.write_qps;
+                total_storage += load.storage_mb;
+                ++total_replicas;
+            }
+        }
+    }
+    if (total_replicas == 0) {
+        return;
+    }
+
+    int64_t min_qps_move =
+        std::max<int64_t>(1, total_qps * FLAGS_balancer_load_min_move_ratio / total_replicas);
+    if (exchange_primary_per_qps(node_qps, min_qps_move, balance_checker)) {
+        return;
+    }
+    if (_only_primary_balancer || _only_move_primary) {
+        return;
+    }
+    int64_t min_storage_move =
+        std::max<int64_t>(1, total_storage * FLAGS_balancer_load_min_move_ratio / total_replicas);
+    exchange_secondary_per_storage(node_storage, min_storage_move, balance_checker);
+}
+
 bool greedy_load_balancer::balance(meta_view view, migration_list &list)
 {
     ddebug("balancer round");
@@ -914,6 +1287,9 @@ bool greedy_load_balancer::balance(meta_view view, migration_list &list)
     t_migration_result->clear();
 
     greedy_balancer(false);
+    if (_load_aware_balancer && t_migration_result->empty()) {
+        load_balancer(false);
+    }
     return !t_migration_result->empty();
 }
 
@@ -929,6 +1305,9 @@ bool greedy_load_balancer::check(meta_view view, migration_list &list)
     t_migration_result->clear();
 
     greedy_balancer(true);
+    if (_load_aware_balancer && t_migration_result->empty()) {
+        load_balancer(true);
+    }
     return !t_migration_result->empty();
 }
 
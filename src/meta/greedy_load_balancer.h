@@ -91,6 +91,13 @@ private:
     bool _balancer_in_turn;
     bool _only_primary_balancer;
     bool _only_move_primary;
+    bool _load_aware_balancer;
+
+    // hysteresis states of the load-aware balancer: balancing of a kind of load starts
+    // when the most loaded node exceeds average * balancer_load_start_ratio, and keeps
+    // going until it's under average * balancer_load_stop_ratio
+    bool _qps_balancing;
+    bool _storage_balancing;
 
     // the app set which won't be re-balanced
     std::set<app_id> _balancer_ignored_apps;
@@ -100,6 +107,7 @@ private:
     dsn_handle_t _ctrl_balancer_in_turn;
     dsn_handle_t _ctrl_only_primary_balancer;
     dsn_handle_t _ctrl_only_move_primary;
+    dsn_handle_t _ctrl_load_aware_balancer;
     dsn_handle_t _get_balance_operation_count;
 
     // perf counters
@@ -135,6 +143,35 @@ private:
 
     void greedy_balancer(bool balance_checker);
 
+    // load of a partition, collected from config-sync of its serving replicas
+    struct partition_load
+    {
+        int64_t read_qps;
+        int64_t write_qps;
+        int64_t storage_mb;
+    };
+    partition_load get_partition_load(const config_context &cc);
+
+    // load-aware balancer, which is triggered when the replica counts are balanced.
+    // It exchanges replicas of the same app between the most loaded node and a less
+    // loaded one, so the replica counts keep balanced after the moves:
+    // - exchange primaries to balance the qps, as only primary serves read requests
+    // - exchange secondaries to balance the storage
+    void load_balancer(bool balance_checker);
+    bool exchange_primary_per_qps(std::vector<int64_t> &node_qps,
+                                  int64_t min_move,
+                                  bool balance_checker);
+    bool exchange_secondary_per_storage(std::vector<int64_t> &node_storage,
+                                        int64_t min_move,
+                                        bool balance_checker);
+    // return the node id whose load is the largest, and whether it exceeds the threshold
+    // which is decided by the hysteresis state `balancing`
+    bool is_load_unbalanced(const std::vector<int64_t> &node_loads,
+                            bool balancing,
+                            /*out*/ int &max_id,
+                            /*out*/ int64_t &average);
+    bool can_balance_app(const std::shared_ptr<app_state> &app);
+
     bool all_replica_infos_collected(const node_state &ns);
     // using t_global_view to get disk_tag of node's pid
     const std::string &get_disk_tag(const dsn::rpc_address &node, const dsn::gpid &pid);
@@ -25,6 +25,7 @@
 #include "server_state.h"
 #include "block_service/block_service_manager.h"
 #include "common/backup_utils.h"
+#include "backup_shared_files_gc.h"
 
 namespace dsn {
 namespace replication {
@@ -736,6 +737,20 @@ void policy_context::issue_new_backup_unlocked()
         return;
     }
 
+    if (_is_gc_shared_files) {
+        ddebug("%s: the shared files are under gc, try to issue new backup later",
+               _policy.policy_name.c_str());
+        tasking::enqueue(LPC_DEFAULT_CALLBACK,
+                         &_tracker,
+                         [this]() {
+                             zauto_lock l(_lock);
+                             issue_new_backup_unlocked();
+                         },
+                         0,
+                         _backup_service->backup_option().issue_backup_interval_ms);
+        return;
+    }
+
     if (!should_start_backup_unlocked()) {
         tasking::enqueue(LPC_DEFAULT_CALLBACK,
                          &_tracker,
@@ -932,6 +947,10 @@ void policy_context::gc_backup_info_unlocked(const backup_info &info_to_gc)
                             LPC_DEFAULT_CALLBACK, &_tracker, [this, info_to_gc]() {
                                 zauto_lock l(_lock);
                                 _backup_history.erase(info_to_gc.backup_id);
+                                for (const auto &app : info_to_gc.app_names) {
+                                    _apps_to_gc_shared_files.insert(app);
+                                }
+                                issue_gc_shared_files_task_unlocked();
                                 issue_gc_backup_info_task_unlocked();
                             });
                         sync_remove_backup_info(info_to_gc, remove_local_backup_info_task);
@@ -948,6 +967,64 @@ void policy_context::gc_backup_info_unlocked(const backup_info &info_to_gc)
     sync_backup_to_remote_storage_unlocked(info_to_gc, sync_callback, false);
 }
 
+void policy_context::issue_gc_shared_files_task_unlocked()
+{
+    if (_apps_to_gc_shared_files.empty() || _is_gc_shared_files ||
+        (_cur_backup.start_time_ms > 0 && _cur_backup.end_time_ms <= 0)) {
+        return;
+    }
+
+    // app_id -> the backups left which include the app
+    std::map<int32_t, std::vector<int64_t>> backup_ids;
+    for (const auto &app : _apps_to_gc_shared_files) {
+        std::vector<int64_t> &ids = backup_ids[app.first];
+        for (const auto &kv : _backup_history) {
+            auto iter = kv.second.app_names.find(app.first);
+            if (iter != kv.second.app_names.end() && iter->second == app.second) {
+                ids.emplace_back(kv.first);
+            }
+        }
+    }
+    _is_gc_shared_files = true;
+
+    // the apps are gc-ed concurrently, the last one finished ends the gc
+    std::map<int32_t, std::string> apps = _apps_to_gc_shared_files;
+    auto remaining_count = std::make_shared<int>(apps.size());
+    auto failed_count = std::make_shared<int>(0);
+    for (const auto &app : apps) {
+        const int32_t app_id = app.first;
+        const std::vector<int64_t> &ids = backup_ids.at(app_id);
+        auto gc = std::make_shared<backup_shared_files_gc>(_block_service,
+                                                           _backup_service->backup_root(),
+                                                           _policy.policy_name,
+                                                           app.second,
+                                                           app_id,
+                                                           ids);
+        gc->start(&_tracker,
+                  [this, app_id, ids, remaining_count, failed_count](error_code err, int) {
+                      zauto_lock l(_lock);
+                      if (err != ERR_OK) {
+                          (*failed_count)++;
+                      } else if (std::all_of(ids.begin(), ids.end(), [this](int64_t id) {
+                                     return _backup_history.count(id) > 0;
+                                 })) {
+                          // otherwise gc it again as a backup of the app is removed during
+                          // the gc
+                          _apps_to_gc_shared_files.erase(app_id);
+                      }
+                      if (--(*remaining_count) > 0) {
+                          return;
+                      }
+                      if (*failed_count > 0) {
+                          dwarn("%s: gc the shared files of %d apps failed, retry them later",
+                                _policy.policy_name.c_str(),
+                                *failed_count);
+                      }
+                      _is_gc_shared_files = false;
+                  });
+    }
+}
+
 void policy_context::issue_gc_backup_info_task_unlocked()
 {
     if (_backup_history.size() > _policy.backup_history_count_to_keep) {
@@ -964,6 +1041,8 @@ void policy_context::issue_gc_backup_info_task_unlocked()
         // there is no extra backup to gc, we just issue a new task to call
         // issue_gc_backup_info_task_unlocked later
         dinfo("%s: no need to gc backup info, start it later", _policy.policy_name.c_str());
+        // retry the gc of the shared files skipped or failed before
+        issue_gc_shared_files_task_unlocked();
         tasking::create_task(LPC_DEFAULT_CALLBACK, &_tracker, [this]() {
             zauto_lock l(_lock);
             issue_gc_backup_info_task_unlocked();
@@ -289,6 +289,9 @@ mock_private :
     mock_virtual void gc_backup_info_unlocked(const backup_info &info_to_gc);
     mock_virtual void issue_gc_backup_info_task_unlocked();
     mock_virtual void sync_remove_backup_info(const backup_info &info, dsn::task_ptr sync_callback);
+    // remove the shared files of the apps in _apps_to_gc_shared_files which are referenced by
+    // none of the backups left, if no backup is running
+    mock_virtual void issue_gc_shared_files_task_unlocked();
 
 mock_private :
     friend class backup_service;
@@ -308,6 +311,12 @@ mock_private :
     backup_progress _progress;
     std::string _backup_sig; // policy_name@backup_id, used when print backup related log
 
+    // app_id -> app_name, the apps of the removed backups whose shared files should be gc-ed
+    std::map<int32_t, std::string> _apps_to_gc_shared_files;
+    // no backup is issued while the shared files are gc-ed, otherwise the files reused by the
+    // backup may be removed
+    bool _is_gc_shared_files{false};
+
     perf_counter_wrapper _counter_policy_recent_backup_duration_ms;
 //clang-format on
     dsn::task_tracker _tracker;
@@ -4,12 +4,26 @@
 
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/fail_point.h>
+#include <dsn/utility/flags.h>
 
 #include "meta_bulk_load_service.h"
 
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_bool("meta_server",
+                bulk_load_ingest_partition_early,
+                false,
+                "whether to ingest a partition as soon as all its replicas finish downloading, "
+                "rather than after all the partitions of the app finish downloading");
+DSN_DEFINE_uint32("meta_server",
+                  bulk_load_max_early_ingesting_partitions,
+                  4,
+                  "the max count of partitions of an app ingesting while the other partitions "
+                  "are still downloading");
+DSN_DEFINE_validator(bulk_load_max_early_ingesting_partitions,
+                     [](uint32_t value) { return value > 0; });
+
 bulk_load_service::bulk_load_service(meta_service *meta_svc, const std::string &bulk_load_dir)
     : _meta_svc(meta_svc), _state(meta_svc->get_server_state()), _bulk_load_root(bulk_load_dir)
 {
@@ -391,7 +405,13 @@ void bulk_load_service::on_partition_bulk_load_reply(error_code err,
     bulk_load_status::type app_status = get_app_bulk_load_status(response.pid.get_app_id());
     switch (app_status) {
     case bulk_load_status::BLS_DOWNLOADING:
-        handle_app_downloading(response, primary_addr);
+        if (request.meta_bulk_load_status == bulk_load_status::BLS_INGESTING) {
+            // the partition is ingesting early while the others are still downloading
+            handle_app_ingestion(response, primary_addr);
+            interval = bulk_load_constant::BULK_LOAD_REQUEST_SHORT_INTERVAL;
+        } else {
+            handle_app_downloading(response, primary_addr);
+        }
         break;
     case bulk_load_status::BLS_DOWNLOADED:
         update_partition_status_on_remote_storage(
@@ -506,10 +526,50 @@ void bulk_load_service::handle_app_downloading(const bulk_load_response &respons
     if (total_progress >= bulk_load_constant::PROGRESS_FINISHED) {
         ddebug_f(
             "app({}) partirion({}) download all files from remote provider succeed", app_name, pid);
-        update_partition_status_on_remote_storage(app_name, pid, bulk_load_status::BLS_DOWNLOADED);
+        if (FLAGS_bulk_load_ingest_partition_early) {
+            try_ingest_partition_early(app_name, pid);
+        } else {
+            update_partition_status_on_remote_storage(
+                app_name, pid, bulk_load_status::BLS_DOWNLOADED);
+        }
     }
 }
 
+// ThreadPool: THREAD_POOL_META_STATE
+void bulk_load_service::try_ingest_partition_early(const std::string &app_name, const gpid &pid)
+{
+    {
+        zauto_read_lock l(_lock);
+        if (get_partition_bulk_load_status_unlocked(pid) == bulk_load_status::BLS_INGESTING) {
+            return;
+        }
+        const uint32_t ingesting_count = get_early_ingesting_count_unlocked(pid.get_app_id());
+        if (ingesting_count >= FLAGS_bulk_load_max_early_ingesting_partitions) {
+            ddebug_f("app({}) has {} partitions ingesting early, partition({}) will ingest later",
+                     app_name,
+                     ingesting_count,
+                     pid);
+            return;
+        }
+    }
+    update_partition_status_on_remote_storage(app_name, pid, bulk_load_status::BLS_INGESTING);
+}
+
+uint32_t bulk_load_service::get_early_ingesting_count_unlocked(int32_t app_id) const
+{
+    uint32_t count = 0;
+    for (const auto &kv : _partition_bulk_load_info) {
+        if (kv.first.get_app_id() != app_id ||
+            kv.second.status != bulk_load_status::BLS_INGESTING) {
+            continue;
+        }
+        if (!kv.second.ingestion_finished_early) {
+            count++;
+        }
+    }
+    return count;
+}
+
 // ThreadPool: THREAD_POOL_META_STATE
 void bulk_load_service::handle_app_ingestion(const bulk_load_response &response,
                                              const rpc_address &primary_addr)
@@ -564,10 +624,44 @@ void bulk_load_service::handle_app_ingestion(const bulk_load_response &response,
 
     if (response.is_group_ingestion_finished) {
         ddebug_f("app({}) partition({}) ingestion files succeed", app_name, pid);
+        {
+            zauto_write_lock l(_lock);
+            if (get_app_bulk_load_status_unlocked(pid.get_app_id()) ==
+                bulk_load_status::BLS_DOWNLOADING) {
+                // ingested early, the partition turns to succeed after the app turns to ingesting
+                if (!_partition_bulk_load_info[pid].ingestion_finished_early) {
+                    update_partition_ingestion_finished_early(app_name, pid);
+                }
+                return;
+            }
+        }
         update_partition_status_on_remote_storage(app_name, pid, bulk_load_status::BLS_SUCCEED);
     }
 }
 
+// ThreadPool: THREAD_POOL_META_STATE
+// user should hold the write lock of _lock
+void bulk_load_service::update_partition_ingestion_finished_early(const std::string &app_name,
+                                                                  const gpid &pid)
+{
+    // the status is being updated, the next response of the partition will retry
+    if (_partitions_pending_sync_flag[pid]) {
+        return;
+    }
+
+    _partitions_pending_sync_flag[pid] = true;
+    partition_bulk_load_info pinfo = _partition_bulk_load_info[pid];
+    pinfo.ingestion_finished_early = true;
+    blob value = json::json_forwarder<partition_bulk_load_info>::encode(pinfo);
+    _meta_svc->get_meta_storage()->set_data(
+        get_partition_bulk_load_path(pid), std::move(value), [this, app_name, pid]() {
+            zauto_write_lock l(_lock);
+            _partitions_pending_sync_flag[pid] = false;
+            _partition_bulk_load_info[pid].ingestion_finished_early = true;
+            ddebug_f("app({}) partition({}) finished ingestion early", app_name, pid);
+        });
+}
+
 // ThreadPool: THREAD_POOL_META_STATE
 void bulk_load_service::handle_bulk_load_finish(const bulk_load_response &response,
                                                 const rpc_address &primary_addr)
@@ -822,6 +916,14 @@ void bulk_load_service::update_partition_status_on_remote_storage(const std::str
 
     _partitions_pending_sync_flag[pid] = true;
     pinfo.status = new_status;
+    // persisted, so that the partition keeps ingesting after meta server failover
+    pinfo.ingest_early = (new_status == bulk_load_status::BLS_INGESTING &&
+                          get_app_bulk_load_status_unlocked(pid.get_app_id()) ==
+                              bulk_load_status::BLS_DOWNLOADING &&
+                          !_apps_rolling_back[pid.get_app_id()]);
+    if (new_status == bulk_load_status::BLS_DOWNLOADING) {
+        pinfo.ingestion_finished_early = false;
+    }
     blob value = json::json_forwarder<partition_bulk_load_info>::encode(pinfo);
 
     _meta_svc->get_meta_storage()->set_data(
@@ -842,10 +944,16 @@ void bulk_load_service::update_partition_status_on_remote_storage_reply(
     bulk_load_status::type new_status,
     bool should_send_request)
 {
+    bool ingest_early = false;
     {
         zauto_write_lock l(_lock);
         auto old_status = _partition_bulk_load_info[pid].status;
+        ingest_early = (new_status == bulk_load_status::BLS_INGESTING &&
+                        get_app_bulk_load_status_unlocked(pid.get_app_id()) ==
+                            bulk_load_status::BLS_DOWNLOADING &&
+                        !_apps_rolling_back[pid.get_app_id()]);
         _partition_bulk_load_info[pid].status = new_status;
+        _partition_bulk_load_info[pid].ingest_early = ingest_early;
         _partitions_pending_sync_flag[pid] = false;
 
         ddebug_f("app({}) update partition({}) status from {} to {}",
@@ -868,6 +976,7 @@ void bulk_load_service::update_partition_status_on_remote_storage_reply(
             _partitions_bulk_load_state.erase(pid);
             _partitions_total_download_progress[pid] = 0;
             _partitions_cleaned_up[pid] = false;
+            _partition_bulk_load_info[pid].ingestion_finished_early = false;
 
             if (--_apps_in_progress_count[pid.get_app_id()] == 0) {
                 _apps_in_progress_count[pid.get_app_id()] =
@@ -881,6 +990,11 @@ void bulk_load_service::update_partition_status_on_remote_storage_reply(
             break;
         }
     }
+    if (ingest_early) {
+        tasking::enqueue(LPC_BULK_LOAD_INGESTION,
+                         _meta_svc->tracker(),
+                         std::bind(&bulk_load_service::partition_ingestion, this, app_name, pid));
+    }
     if (should_send_request) {
         partition_bulk_load(app_name, pid);
     }
@@ -957,7 +1071,9 @@ void bulk_load_service::update_app_status_on_remote_storage_reply(const app_bulk
              dsn::enum_to_string(old_status),
              dsn::enum_to_string(new_status));
 
-    if (new_status == bulk_load_status::BLS_INGESTING) {
+    // the partitions ingested early have been sent ingestion request when they turned to ingesting
+    if (new_status == bulk_load_status::BLS_INGESTING &&
+        old_status != bulk_load_status::BLS_DOWNLOADING) {
         for (int i = 0; i < partition_count; ++i) {
             tasking::enqueue(LPC_BULK_LOAD_INGESTION,
                              _meta_svc->tracker(),
@@ -1592,17 +1708,39 @@ void bulk_load_service::do_continue_app_bulk_load(
     const int32_t same_count = pinfo_map.size() - different_count;
     const int32_t invalid_count = partition_count - pinfo_map.size();
 
+    // partitions turned to ingesting while app is downloading, see `try_ingest_partition_early`
+    std::unordered_set<int32_t> ingest_early_pidx_set;
+    // the ones of them which have finished ingestion, they mustn't ingest again, otherwise the
+    // writes after the ingestion would be overwritten
+    std::unordered_set<int32_t> ingestion_finished_pidx_set;
+    if (app_status == bulk_load_status::BLS_DOWNLOADING) {
+        for (auto pidx : different_status_pidx_set) {
+            const auto &pinfo = pinfo_map.at(pidx);
+            if (pinfo.status == bulk_load_status::BLS_INGESTING && pinfo.ingest_early) {
+                ingest_early_pidx_set.insert(pidx);
+                if (pinfo.ingestion_finished_early) {
+                    ingestion_finished_pidx_set.insert(pidx);
+                }
+            }
+        }
+    }
+    const int32_t ingest_early_count = ingest_early_pidx_set.size();
+    // partitions ingesting early are not different from downloading app, unless there are other
+    // different partitions, which means bulk load was rolling back to downloading
+    const bool has_different_status = different_count > ingest_early_count;
+
     ddebug_f(
         "app({}) continue bulk load, app_id = {}, partition_count = {}, status = {}, there are {} "
         "partitions have bulk_load_info, {} partitions have same status with app, {} "
-        "partitions different",
+        "partitions different, {} partitions ingesting early",
         ainfo.app_name,
         app_id,
         partition_count,
         dsn::enum_to_string(app_status),
         pinfo_map.size(),
         same_count,
-        different_count);
+        different_count,
+        ingest_early_count);
 
     // _apps_in_progress_count is used for updating app bulk load, when _apps_in_progress_count = 0
     // means app bulk load status can transfer to next stage, for example, when app status is
@@ -1613,13 +1751,17 @@ void bulk_load_service::do_continue_app_bulk_load(
         if (invalid_count > 0) {
             // create missing partition, so the in_progress_count should be invalid_count
             in_progress_partition_count = invalid_count;
-        } else if (different_count > 0) {
+        } else if (has_different_status) {
             // it is hard to distinguish that bulk load is normal downloading or rollback to
             // downloading before meta server crash, when app status is downloading, we consider
             // bulk load as rolling back to downloading for convenience, for partitions whose status
             // is not downloading, update them to downloading, so the in_progress_count should be
             // different_count
             in_progress_partition_count = different_count;
+        } else {
+            // partitions ingesting early keep ingesting, app will turn to ingesting after the
+            // others turn to ingesting
+            in_progress_partition_count = partition_count - ingest_early_count;
         }
     } else if (app_status == bulk_load_status::BLS_DOWNLOADED ||
                app_status == bulk_load_status::BLS_INGESTING ||
@@ -1632,6 +1774,10 @@ void bulk_load_service::do_continue_app_bulk_load(
     {
         zauto_write_lock l(_lock);
         _apps_in_progress_count[app_id] = in_progress_partition_count;
+        // meta server crashed after the last partition turned to ingesting early
+        if (in_progress_partition_count == 0 && app_status == bulk_load_status::BLS_DOWNLOADING) {
+            update_app_status_on_remote_storage_unlocked(app_id, bulk_load_status::BLS_INGESTING);
+        }
     }
 
     // if app is paused, no need to send bulk_load_request, just return
@@ -1654,7 +1800,7 @@ void bulk_load_service::do_continue_app_bulk_load(
          app_status == bulk_load_status::BLS_CANCELED ||
          app_status == bulk_load_status::BLS_PAUSING ||
          app_status == bulk_load_status::BLS_DOWNLOADING) &&
-        different_count > 0) {
+        has_different_status) {
         for (auto pidx : different_status_pidx_set) {
             update_partition_status_on_remote_storage(
                 ainfo.app_name, gpid(app_id, pidx), app_status);
@@ -1665,7 +1811,9 @@ void bulk_load_service::do_continue_app_bulk_load(
     for (auto i = 0; i < partition_count; ++i) {
         gpid pid = gpid(app_id, i);
         partition_bulk_load(ainfo.app_name, pid);
-        if (app_status == bulk_load_status::BLS_INGESTING) {
+        if (app_status == bulk_load_status::BLS_INGESTING ||
+            (!has_different_status && ingest_early_pidx_set.count(i) > 0 &&
+             ingestion_finished_pidx_set.count(i) == 0)) {
             tasking::enqueue(
                 LPC_BULK_LOAD_INGESTION,
                 _meta_svc->tracker(),
@@ -31,7 +31,13 @@ struct partition_bulk_load_info
 {
     bulk_load_status::type status;
     bulk_load_metadata metadata;
-    DEFINE_JSON_SERIALIZATION(status, metadata)
+    // whether the partition turned to ingesting while the app was downloading, see
+    // `try_ingest_partition_early`
+    bool ingest_early{false};
+    // whether the partition ingesting early has finished ingestion, it won't be sent ingestion
+    // request again after meta server failover
+    bool ingestion_finished_early{false};
+    DEFINE_JSON_SERIALIZATION(status, metadata, ingest_early, ingestion_finished_early)
 };
 
 // Used for remote file provider
@@ -77,6 +83,10 @@ struct bulk_load_info
 ///                  |
 ///                  v
 ///            bulk load end
+///
+/// if [meta_server] bulk_load_ingest_partition_early is true, a partition turns from downloading
+/// to ingesting once it's downloaded, and the app turns from downloading to ingesting directly
+/// when all its partitions are ingesting, see `try_ingest_partition_early`.
 
 class bulk_load_service
 {
@@ -130,8 +140,22 @@ private:
     void handle_app_downloading(const bulk_load_response &response,
                                 const rpc_address &primary_addr);
 
+    // Called when all the replicas of a partition finish downloading and
+    // [meta_server] bulk_load_ingest_partition_early is true: the partition turns to ingesting
+    // directly, unless [meta_server] bulk_load_max_early_ingesting_partitions of the app are
+    // ingesting, then it's retried by the next bulk load response. The partitions have disjoint
+    // key ranges, so ingesting one while the others are downloading overlaps the ingestion with
+    // the download of the app, and only the ingesting partitions reject writes.
+    void try_ingest_partition_early(const std::string &app_name, const gpid &pid);
+
+    // count of partitions of the app ingesting early and not finished
+    uint32_t get_early_ingesting_count_unlocked(int32_t app_id) const;
+
     void handle_app_ingestion(const bulk_load_response &response, const rpc_address &primary_addr);
 
+    // persist that the partition finished ingestion while the app is downloading
+    void update_partition_ingestion_finished_early(const std::string &app_name, const gpid &pid);
+
     // when app status is `succeed, `failed`, `canceled`, meta and replica should cleanup bulk load
     // states
     void handle_bulk_load_finish(const bulk_load_response &response,
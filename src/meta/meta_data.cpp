@@ -344,12 +344,15 @@ bool config_context::remove_from_serving(const rpc_address &node)
 void config_context::collect_serving_replica(const rpc_address &node, const replica_info &info)
 {
     auto iter = find_from_serving(node);
-    if (iter != serving.end()) {
-        iter->disk_tag = info.disk_tag;
-        iter->storage_mb = 0;
-    } else {
-        serving.emplace_back(serving_replica{node, 0, info.disk_tag});
+    if (iter == serving.end()) {
+        serving.emplace_back(serving_replica{node, 0, info.disk_tag, 0, 0});
+        iter = serving.end() - 1;
     }
+    iter->disk_tag = info.disk_tag;
+    // replica servers of old version don't report load statistics
+    iter->storage_mb = info.__isset.storage_mb ? info.storage_mb : 0;
+    iter->read_qps = info.__isset.read_qps ? info.read_qps : 0;
+    iter->write_qps = info.__isset.write_qps ? info.write_qps : 0;
 }
 
 void config_context::adjust_proposal(const rpc_address &node, const replica_info &info)
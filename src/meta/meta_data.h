@@ -179,9 +179,11 @@ inline int dropped_cmp(const dropped_replica &d1, const dropped_replica &d2)
 struct serving_replica
 {
     dsn::rpc_address node;
-    // TODO: report the storage size of replica
     int64_t storage_mb;
     std::string disk_tag;
+    // read qps is only served by primary, so it's 0 on secondaries
+    int64_t read_qps;
+    int64_t write_qps;
 };
 
 class config_context
@@ -415,6 +415,9 @@ void meta_service::register_rpc_handlers()
     register_rpc_handler_with_rpc_holder(RPC_CM_QUERY_PARTITION_CONFIG_BY_INDEX,
                                          "query_configuration_by_index",
                                          &meta_service::on_query_configuration_by_index);
+    register_rpc_handler_with_rpc_holder(RPC_CM_SUBSCRIBE_PARTITION_CONFIG,
+                                         "subscribe_configuration",
+                                         &meta_service::on_subscribe_configuration);
     register_rpc_handler(RPC_CM_UPDATE_PARTITION_CONFIGURATION,
                          "update_configuration",
                          &meta_service::on_update_configuration);
@@ -635,6 +638,22 @@ void meta_service::on_query_configuration_by_index(configuration_query_by_index_
     }
 }
 
+// client => meta server
+void meta_service::on_subscribe_configuration(configuration_query_by_index_rpc rpc)
+{
+    rpc_address forward_address;
+    if (!check_status(rpc, &forward_address)) {
+        if (!forward_address.is_invalid()) {
+            partition_configuration config;
+            config.primary = forward_address;
+            rpc.response().partitions.push_back(std::move(config));
+        }
+        return;
+    }
+
+    _state->subscribe_configuration(std::move(rpc));
+}
+
 // partition sever => meta sever
 // as get stale configuration is not allowed for partition server, we need to dispatch it to the
 // meta state thread pool
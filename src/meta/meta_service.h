@@ -135,6 +135,7 @@ private:
 
     // client => meta server
     void on_query_configuration_by_index(configuration_query_by_index_rpc rpc);
+    void on_subscribe_configuration(configuration_query_by_index_rpc rpc);
 
     // partition server => meta server
     void on_config_sync(configuration_query_by_node_rpc rpc);
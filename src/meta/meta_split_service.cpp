@@ -104,6 +104,7 @@ void meta_split_service::do_app_partition_split(std::shared_ptr<app_state> app,
                  app->partition_count * 2);
 
         zauto_write_lock l(app_lock());
+        _state->invalidate_config_snapshot(app->app_name);
         app->partition_count *= 2;
         app->helpers->contexts.resize(app->partition_count);
         app->partitions.resize(app->partition_count);
@@ -36,6 +36,7 @@
 
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/factory_store.h>
+#include <dsn/utility/flags.h>
 #include <dsn/utility/string_conv.h>
 #include <dsn/tool-api/task.h>
 #include <dsn/tool-api/command_manager.h>
@@ -50,12 +51,19 @@
 #include "dump_file.h"
 #include "app_env_validator.h"
 #include "meta_bulk_load_service.h"
+#include "config_subscription_service.h"
 
 using namespace dsn;
 
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_uint32("meta_server",
+                  recovery_query_node_concurrency,
+                  32,
+                  "max count of replica nodes queried at the same time when the meta server "
+                  "recovers from replica nodes");
+
 static const char *lock_state = "lock";
 static const char *unlock_state = "unlock";
 
@@ -67,6 +75,7 @@ server_state::server_state()
       _ctrl_add_secondary_enable_flow_control(nullptr),
       _ctrl_add_secondary_max_count_for_one_node(nullptr)
 {
+    _config_subscription_svc = make_unique<config_subscription_service>(this);
 }
 
 server_state::~server_state()
@@ -268,6 +277,7 @@ void server_state::transition_staging_state(std::shared_ptr<app_state> &app)
            app->get_logname(),
            enum_to_string(old_status),
            enum_to_string(app->status));
+    invalidate_config_snapshot(app->app_name);
 #undef send_response
 }
 
@@ -575,7 +585,7 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
                                 pc.pid.get_partition_index() == partition_id,
                             "invalid partition config");
                     {
-                        zauto_write_lock l(_lock);
+                        state_write_lock l(this);
                         app->partitions[partition_id] = pc;
                         for (const dsn::rpc_address &addr : pc.last_drops) {
                             app->helpers->contexts[partition_id].record_drop_history(addr);
@@ -620,7 +630,7 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
                             "invalid json data");
                     std::shared_ptr<app_state> app = app_state::create(info);
                     {
-                        zauto_write_lock l(_lock);
+                        state_write_lock l(this);
                         _all_apps.emplace(app->app_id, app);
                         if (app->status == app_status::AS_AVAILABLE) {
                             app->status = app_status::AS_CREATING;
@@ -697,7 +707,7 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
 
 void server_state::initialize_node_state()
 {
-    zauto_write_lock l(_lock);
+    state_write_lock l(this);
     for (auto &app_pair : _all_apps) {
         app_state &app = *(app_pair.second);
         for (partition_configuration &pc : app.partitions) {
@@ -911,15 +921,27 @@ bool server_state::query_configuration_by_gpid(dsn::gpid id,
     return false;
 }
 
-void server_state::query_configuration_by_index(
-    const configuration_query_by_index_request &request,
-    /*out*/ configuration_query_by_index_response &response)
+std::shared_ptr<const app_config_snapshot>
+server_state::get_config_snapshot(const std::string &app_name, /*out*/ error_code &err)
 {
+    std::shared_ptr<const app_config_snapshot> snapshot;
+    {
+        utils::auto_read_lock l(_snapshot_lock);
+        auto iter = _config_snapshots.find(app_name);
+        if (iter != _config_snapshots.end()) {
+            snapshot = iter->second;
+        }
+    }
+    if (snapshot != nullptr) {
+        err = ERR_OK;
+        return snapshot;
+    }
+
     zauto_read_lock l(_lock);
-    auto iter = _exist_apps.find(request.app_name.c_str());
+    auto iter = _exist_apps.find(app_name);
     if (iter == _exist_apps.end()) {
-        response.err = ERR_OBJECT_NOT_FOUND;
-        return;
+        err = ERR_OBJECT_NOT_FOUND;
+        return nullptr;
     }
 
     std::shared_ptr<app_state> &app = iter->second;
@@ -932,28 +954,61 @@ void server_state::query_configuration_by_index(
         switch (app->status) {
         case app_status::AS_CREATING:
         case app_status::AS_RECALLING:
-            response.err = ERR_BUSY_CREATING;
+            err = ERR_BUSY_CREATING;
             break;
         case app_status::AS_DROPPING:
-            response.err = ERR_BUSY_DROPPING;
+            err = ERR_BUSY_DROPPING;
             break;
         default:
-            response.err = ERR_UNKNOWN;
+            err = ERR_UNKNOWN;
         }
+        return nullptr;
+    }
+
+    auto new_snapshot = std::make_shared<app_config_snapshot>();
+    new_snapshot->app_id = app->app_id;
+    new_snapshot->partition_count = app->partition_count;
+    new_snapshot->is_stateful = app->is_stateful;
+    new_snapshot->partitions = app->partitions;
+    new_snapshot->ballot_sum = 0;
+    for (const partition_configuration &pc : app->partitions) {
+        new_snapshot->ballot_sum += std::max<int64_t>(pc.ballot, 0);
+    }
+    snapshot = new_snapshot;
+
+    // writers can't invalidate the snapshot before we release _lock, so it's safe to
+    // publish it here
+    utils::auto_write_lock sl(_snapshot_lock);
+    _config_snapshots[app->app_name] = snapshot;
+    err = ERR_OK;
+    return snapshot;
+}
+
+void server_state::query_configuration_by_index(
+    const configuration_query_by_index_request &request,
+    /*out*/ configuration_query_by_index_response &response)
+{
+    std::shared_ptr<const app_config_snapshot> snapshot =
+        get_config_snapshot(request.app_name, response.err);
+    if (snapshot == nullptr) {
         return;
     }
 
-    response.err = ERR_OK;
-    response.app_id = app->app_id;
-    response.partition_count = app->partition_count;
-    response.is_stateful = app->is_stateful;
+    response.app_id = snapshot->app_id;
+    response.partition_count = snapshot->partition_count;
+    response.is_stateful = snapshot->is_stateful;
 
     for (const int32_t &index : request.partition_indices) {
-        if (index >= 0 && index < app->partitions.size())
-            response.partitions.push_back(app->partitions[index]);
+        if (index >= 0 && index < snapshot->partitions.size())
+            response.partitions.push_back(snapshot->partitions[index]);
     }
     if (response.partitions.empty())
-        response.partitions = app->partitions;
+        response.partitions = snapshot->partitions;
+}
+
+void server_state::subscribe_configuration(configuration_query_by_index_rpc rpc)
+{
+    _config_subscription_svc->subscribe(std::move(rpc));
 }
 
 void server_state::init_app_partition_node(std::shared_ptr<app_state> &app,
@@ -964,7 +1019,7 @@ void server_state::init_app_partition_node(std::shared_ptr<app_state> &app,
         dinfo("create partition node: gpid(%d.%d), result: %s", app->app_id, pidx, ec.to_string());
         if (ERR_OK == ec || ERR_NODE_ALREADY_EXIST == ec) {
             {
-                zauto_write_lock l(_lock);
+                state_write_lock l(this);
                 process_one_partition(app);
             }
             if (callback) {
@@ -1047,7 +1102,7 @@ void server_state::create_app(dsn::message_ex *msg)
         response.err = ERR_INVALID_PARAMETERS;
         will_create_app = false;
     } else {
-        zauto_write_lock l(_lock);
+        state_write_lock l(this);
         app = get_app(request.app_name);
         if (nullptr != app) {
             switch (app->status) {
@@ -1104,7 +1159,7 @@ void server_state::do_app_drop(std::shared_ptr<app_state> &app)
 {
     auto after_mark_app_dropped = [this, app](error_code ec) mutable {
         if (ERR_OK == ec) {
-            zauto_write_lock l(_lock);
+            state_write_lock l(this);
             _exist_apps.erase(app->app_name);
             for (int i = 0; i < app->partition_count; ++i) {
                 drop_partition(app, i);
@@ -1137,7 +1192,7 @@ void server_state::drop_app(dsn::message_ex *msg)
     dsn::unmarshall(msg, request);
     ddebug("drop app request, name(%s)", request.app_name.c_str());
     {
-        zauto_write_lock l(_lock);
+        state_write_lock l(this);
         app = get_app(request.app_name);
         if (nullptr == app) {
             response.err = request.options.success_if_not_exist ? ERR_OK : ERR_APP_NOT_EXIST;
@@ -1186,7 +1241,7 @@ void server_state::drop_app(dsn::message_ex *msg)
 void server_state::do_app_recall(std::shared_ptr<app_state> &app)
 {
     auto after_recall_app = [this, app](dsn::error_code ec) mutable {
-        zauto_write_lock l(_lock);
+        state_write_lock l(this);
         for (int i = 0; i < app->partition_count; ++i) {
             recall_partition(app, i);
         }
@@ -1209,7 +1264,7 @@ void server_state::recall_app(dsn::message_ex *msg)
 
     bool do_recalling = false;
     {
-        zauto_write_lock l(_lock);
+        state_write_lock l(this);
         target_app = get_app(request.app_id);
         if (target_app == nullptr) {
             response.err = ERR_APP_NOT_EXIST;
@@ -1361,6 +1416,7 @@ void server_state::update_configuration_locally(
     dsn::gpid &gpid = config_request->config.pid;
     partition_configuration &old_cfg = app.partitions[gpid.get_partition_index()];
     partition_configuration &new_cfg = config_request->config;
+    invalidate_config_snapshot(app.app_name);
 
     int min_2pc_count = _meta_svc->get_options().mutation_2pc_min_replica_count;
     health_status old_health_status = partition_health_status(old_cfg, min_2pc_count);
@@ -1592,7 +1648,7 @@ void server_state::recall_partition(std::shared_ptr<app_state> &app, int pidx)
 {
     auto on_recall_partition = [this, app, pidx](dsn::error_code error) mutable {
         if (error == dsn::ERR_OK) {
-            zauto_write_lock l(_lock);
+            state_write_lock l(this);
             app->partitions[pidx].partition_flags &= (~pc_flags::dropped);
             process_one_partition(app);
         } else if (error == dsn::ERR_TIMEOUT) {
@@ -1878,7 +1934,7 @@ void server_state::on_partition_node_dead(std::shared_ptr<app_state> &app,
 void server_state::on_change_node_state(rpc_address node, bool is_alive)
 {
     dinfo("change node(%s) state to %s", node.to_string(), is_alive ? "alive" : "dead");
-    zauto_write_lock l(_lock);
+    state_write_lock l(this);
     if (!is_alive) {
         auto iter = _nodes.find(node);
         if (iter == _nodes.end()) {
@@ -1904,7 +1960,7 @@ void server_state::on_change_node_state(rpc_address node, bool is_alive)
 void server_state::on_propose_balancer(const configuration_balancer_request &request,
                                        configuration_balancer_response &response)
 {
-    zauto_write_lock l(_lock);
+    state_write_lock l(this);
     std::shared_ptr<app_state> app = get_app(request.gpid.get_app_id());
     if (app == nullptr || app->status != app_status::AS_AVAILABLE ||
         request.gpid.get_partition_index() < 0 ||
@@ -1923,46 +1979,63 @@ void server_state::on_propose_balancer(const configuration_balancer_request &req
     }
 }
 
-error_code
-server_state::construct_apps(const std::vector<query_app_info_response> &query_app_responses,
-                             const std::vector<dsn::rpc_address> &replica_nodes,
-                             std::string &hint_message)
+void recovery_collection::merge(const rpc_address &node,
+                                query_app_info_response &&app_resp,
+                                query_replica_info_response &&replica_resp)
 {
-    int max_app_id = 0;
-    for (unsigned int i = 0; i < query_app_responses.size(); ++i) {
-        query_app_info_response query_resp = query_app_responses[i];
-        if (query_resp.err != dsn::ERR_OK)
-            continue;
-
-        for (const app_info &info : query_resp.apps) {
-            dassert(info.app_id >= 1, "invalid app_id, app_id = %d", info.app_id);
-            auto iter = _all_apps.find(info.app_id);
-            if (iter == _all_apps.end()) {
-                std::shared_ptr<app_state> app = app_state::create(info);
-                ddebug("create app info from (%s) for id(%d): %s",
-                       replica_nodes[i].to_string(),
-                       info.app_id,
-                       boost::lexical_cast<std::string>(info).c_str());
-                _all_apps.emplace(app->app_id, app);
-                max_app_id = std::max(app->app_id, max_app_id);
-            } else {
-                app_info *old_info = iter->second.get();
-                // all info in all replica servers should be the same
-                // coz the app info is only initialized when the replica is
-                // created, and it will NEVER change even if the app is dropped/recalled...
-                if (info != *old_info) // app_info::operator !=
-                {
-                    dassert(false,
-                            "conflict app info from (%s) for id(%d): new_info(%s), old_info(%s)",
-                            replica_nodes[i].to_string(),
-                            info.app_id,
-                            boost::lexical_cast<std::string>(info).c_str(),
-                            boost::lexical_cast<std::string>(*old_info).c_str());
-                }
+    for (app_info &info : app_resp.apps) {
+        dassert(info.app_id >= 1, "invalid app_id, app_id = %d", info.app_id);
+        auto iter = apps.find(info.app_id);
+        if (iter == apps.end()) {
+            apps.emplace(info.app_id, std::make_pair(std::move(info), node));
+        } else {
+            // all info in all replica servers should be the same
+            // coz the app info is only initialized when the replica is
+            // created, and it will NEVER change even if the app is dropped/recalled...
+            const app_info &old_info = iter->second.first;
+            if (info != old_info) // app_info::operator !=
+            {
+                dassert(false,
+                        "conflict app info from (%s) for id(%d): new_info(%s), old_info(%s)",
+                        node.to_string(),
+                        info.app_id,
+                        boost::lexical_cast<std::string>(info).c_str(),
+                        boost::lexical_cast<std::string>(old_info).c_str());
             }
         }
     }
 
+    replicas.reserve(replicas.size() + replica_resp.replicas.size());
+    for (replica_info &r : replica_resp.replicas) {
+        replicas.emplace_back(node, std::move(r));
+    }
+}
+
+error_code server_state::construct_apps(const recovery_collection &collection,
+                                        std::string &hint_message)
+{
+    int max_app_id = 0;
+    for (const auto &kv : collection.apps) {
+        const app_info &info = kv.second.first;
+        auto iter = _all_apps.find(info.app_id);
+        if (iter == _all_apps.end()) {
+            std::shared_ptr<app_state> app = app_state::create(info);
+            ddebug("create app info from (%s) for id(%d): %s",
+                   kv.second.second.to_string(),
+                   info.app_id,
+                   boost::lexical_cast<std::string>(info).c_str());
+            _all_apps.emplace(app->app_id, app);
+            max_app_id = std::max(app->app_id, max_app_id);
+        } else if (info != *iter->second) {
+            dassert(false,
+                    "conflict app info from (%s) for id(%d): new_info(%s), old_info(%s)",
+                    kv.second.second.to_string(),
+                    info.app_id,
+                    boost::lexical_cast<std::string>(info).c_str(),
+                    boost::lexical_cast<std::string>(*iter->second).c_str());
+        }
+    }
+
     // create placeholder for dropped table
     for (int app_id = 1; app_id <= max_app_id; ++app_id) {
         auto iter = _all_apps.find(app_id);
@@ -2015,30 +2088,24 @@ server_state::construct_apps(const std::vector<query_app_info_response> &query_a
     return dsn::ERR_OK;
 }
 
-error_code server_state::construct_partitions(
-    const std::vector<query_replica_info_response> &query_replica_responses,
-    const std::vector<dsn::rpc_address> &replica_nodes,
-    bool skip_lost_partitions,
-    std::string &hint_message)
+error_code server_state::construct_partitions(const recovery_collection &collection,
+                                              bool skip_lost_partitions,
+                                              std::string &hint_message)
 {
-    for (unsigned int i = 0; i < query_replica_responses.size(); ++i) {
-        query_replica_info_response query_resp = query_replica_responses[i];
-        if (query_resp.err != dsn::ERR_OK)
-            continue;
-
-        for (replica_info &r : query_resp.replicas) {
-            dassert(_all_apps.find(r.pid.get_app_id()) != _all_apps.end(), "");
-            bool is_accepted = _meta_svc->get_balancer()->collect_replica(
-                {&_all_apps, &_nodes}, replica_nodes[i], r);
-            if (is_accepted) {
-                ddebug("accept replica(%s) from node(%s)",
-                       boost::lexical_cast<std::string>(r).c_str(),
-                       replica_nodes[i].to_string());
-            } else {
-                ddebug("ignore replica(%s) from node(%s)",
-                       boost::lexical_cast<std::string>(r).c_str(),
-                       replica_nodes[i].to_string());
-            }
+    for (const auto &kv : collection.replicas) {
+        const rpc_address &node = kv.first;
+        const replica_info &r = kv.second;
+        dassert(_all_apps.find(r.pid.get_app_id()) != _all_apps.end(), "");
+        bool is_accepted =
+            _meta_svc->get_balancer()->collect_replica({&_all_apps, &_nodes}, node, r);
+        if (is_accepted) {
+            ddebug("accept replica(%s) from node(%s)",
+                   boost::lexical_cast<std::string>(r).c_str(),
+                   node.to_string());
+        } else {
+            ddebug("ignore replica(%s) from node(%s)",
+                   boost::lexical_cast<std::string>(r).c_str(),
+                   node.to_string());
         }
     }
 
@@ -2112,32 +2179,77 @@ server_state::sync_apps_from_replica_nodes(const std::vector<dsn::rpc_address> &
                                            bool skip_lost_partitions,
                                            std::string &hint_message)
 {
-    int n_replicas = replica_nodes.size();
-    std::vector<query_app_info_response> query_app_responses(n_replicas);
-    std::vector<query_replica_info_response> query_replica_responses(n_replicas);
-    std::vector<dsn::error_code> query_app_errors(n_replicas);
-    std::vector<dsn::error_code> query_replica_errors(n_replicas);
+    // the responses of a replica node, it's merged into the collection once both of the
+    // queries are responded
+    struct node_query
+    {
+        std::atomic<int> pending_count{2};
+        dsn::error_code app_err;
+        dsn::error_code replica_err;
+        query_app_info_response app_resp;
+        query_replica_info_response replica_resp;
+    };
 
+    int n_replicas = replica_nodes.size();
+    std::vector<node_query> queries(n_replicas);
+    recovery_collection collection;
+    zlock collection_lock;
+
+    std::atomic<int> next_node(0);
+    std::atomic<int> finished_count(0);
+    std::atomic<int> failed_count(0);
+    const int progress_step = std::max(1, n_replicas / 10);
+    utils::notify_event all_finished;
     dsn::task_tracker tracker;
-    for (int i = 0; i < n_replicas; ++i) {
+
+    std::function<void()> query_next_node;
+    auto on_node_queried = [&](int i) {
+        node_query &q = queries[i];
+        if (q.app_err == dsn::ERR_OK && q.replica_err == dsn::ERR_OK) {
+            zauto_lock l(collection_lock);
+            collection.merge(replica_nodes[i], std::move(q.app_resp), std::move(q.replica_resp));
+        } else {
+            ++failed_count;
+        }
+
+        // send the next query before this node is counted as finished, so all of the
+        // queries have been sent once all of the nodes are finished
+        query_next_node();
+        int finished = ++finished_count;
+        if (finished % progress_step == 0 || finished == n_replicas) {
+            ddebug("query replica nodes progress: %d/%d finished, %d failed",
+                   finished,
+                   n_replicas,
+                   failed_count.load());
+        }
+        if (finished == n_replicas) {
+            all_finished.notify();
+        }
+    };
+
+    query_next_node = [&]() {
+        int i = next_node++;
+        if (i >= n_replicas) {
+            return;
+        }
         ddebug("send query app and replica request to node(%s)", replica_nodes[i].to_string());
 
         query_app_info_request app_query;
         app_query.meta_server = dsn_primary_address();
-
         rpc::call(replica_nodes[i],
                   RPC_QUERY_APP_INFO,
                   app_query,
                   &tracker,
-                  [i, &replica_nodes, &query_app_errors, &query_app_responses](
+                  [i, &replica_nodes, &queries, &on_node_queried](
                       dsn::error_code err, query_app_info_response &&resp) mutable {
                       ddebug("received query app response from node(%s), err(%s), apps_count(%d)",
                              replica_nodes[i].to_string(),
                              err.to_string(),
                              (int)resp.apps.size());
-                      query_app_errors[i] = err;
-                      if (err == dsn::ERR_OK) {
-                          query_app_responses[i] = std::move(resp);
+                      queries[i].app_err = err;
+                      queries[i].app_resp = std::move(resp);
+                      if (--queries[i].pending_count == 0) {
+                          on_node_queried(i);
                       }
                   });
 
@@ -2148,40 +2260,52 @@ server_state::sync_apps_from_replica_nodes(const std::vector<dsn::rpc_address> &
             RPC_QUERY_REPLICA_INFO,
             replica_query,
             &tracker,
-            [i, &replica_nodes, &query_replica_errors, &query_replica_responses](
+            [i, &replica_nodes, &queries, &on_node_queried](
                 dsn::error_code err, query_replica_info_response &&resp) mutable {
                 ddebug("received query replica response from node(%s), err(%s), replicas_count(%d)",
                        replica_nodes[i].to_string(),
                        err.to_string(),
                        (int)resp.replicas.size());
-                query_replica_errors[i] = err;
-                if (err == dsn::ERR_OK) {
-                    query_replica_responses[i] = std::move(resp);
+                queries[i].replica_err = err;
+                queries[i].replica_resp = std::move(resp);
+                if (--queries[i].pending_count == 0) {
+                    on_node_queried(i);
                 }
             });
-    }
+    };
 
+    // at most FLAGS_recovery_query_node_concurrency nodes are queried at the same time, a new
+    // node is queried once a node is finished
+    uint64_t start_ms = dsn_now_ms();
+    int concurrency =
+        std::min<int>(n_replicas, std::max(1u, FLAGS_recovery_query_node_concurrency));
+    ddebug("start to query %d replica nodes, concurrency = %d", n_replicas, concurrency);
+    for (int i = 0; i < concurrency; ++i) {
+        query_next_node();
+    }
+    if (n_replicas > 0) {
+        all_finished.wait();
+    }
+    // wait for the callbacks to return, all of the rpcs have been sent by now
     tracker.wait_outstanding_tasks();
-    int failed_count = 0;
+    uint64_t query_ms = dsn_now_ms() - start_ms;
+
     int succeed_count = 0;
     for (int i = 0; i < n_replicas; ++i) {
         error_code err = dsn::ERR_OK;
-        if (query_app_errors[i] != dsn::ERR_OK) {
+        if (queries[i].app_err != dsn::ERR_OK) {
             dwarn("query app info from node(%s) failed, reason: %s",
                   replica_nodes[i].to_string(),
-                  query_app_errors[i].to_string());
-            err = query_app_errors[i];
+                  queries[i].app_err.to_string());
+            err = queries[i].app_err;
         }
-        if (query_replica_errors[i] != dsn::ERR_OK) {
+        if (queries[i].replica_err != dsn::ERR_OK) {
             dwarn("query replica info from node(%s) failed, reason: %s",
                   replica_nodes[i].to_string(),
-                  query_replica_errors[i].to_string());
-            err = query_replica_errors[i];
+                  queries[i].replica_err.to_string());
+            err = queries[i].replica_err;
         }
         if (err != dsn::ERR_OK) {
-            failed_count++;
-            query_app_errors[i] = err;
-            query_replica_errors[i] = err;
             std::ostringstream oss;
             if (skip_bad_nodes) {
                 oss << "WARNING: collect app and replica info from node("
@@ -2199,29 +2323,40 @@ server_state::sync_apps_from_replica_nodes(const std::vector<dsn::rpc_address> &
     }
 
     ddebug("sync apps and replicas from replica nodes done, succeed_count = %d, failed_count = %d, "
-           "skip_bad_nodes = %s",
+           "skip_bad_nodes = %s, time_used = %" PRIu64 " ms",
            succeed_count,
-           failed_count,
-           (skip_bad_nodes ? "true" : "false"));
+           failed_count.load(),
+           (skip_bad_nodes ? "true" : "false"),
+           query_ms);
 
     if (failed_count > 0 && !skip_bad_nodes) {
         return dsn::ERR_TRY_AGAIN;
     }
 
-    zauto_write_lock l(_lock);
+    state_write_lock l(this);
 
-    dsn::error_code err = construct_apps(query_app_responses, replica_nodes, hint_message);
+    start_ms = dsn_now_ms();
+    dsn::error_code err = construct_apps(collection, hint_message);
     if (err != dsn::ERR_OK) {
         derror("construct apps failed, err = %s", err.to_string());
         return err;
     }
+    uint64_t construct_apps_ms = dsn_now_ms() - start_ms;
 
-    err = construct_partitions(
-        query_replica_responses, replica_nodes, skip_lost_partitions, hint_message);
+    start_ms = dsn_now_ms();
+    err = construct_partitions(collection, skip_lost_partitions, hint_message);
     if (err != dsn::ERR_OK) {
         derror("construct partitions failed, err = %s", err.to_string());
         return err;
     }
+    uint64_t construct_partitions_ms = dsn_now_ms() - start_ms;
+
+    std::ostringstream oss;
+    oss << "INFO: recover from " << n_replicas << " nodes, query nodes: " << query_ms
+        << " ms, construct apps: " << construct_apps_ms
+        << " ms, construct partitions: " << construct_partitions_ms << " ms" << std::endl;
+    ddebug("%s", oss.str().c_str());
+    hint_message += oss.str();
 
     return dsn::ERR_OK;
 }
@@ -2257,7 +2392,7 @@ void server_state::on_start_recovery(const configuration_recovery_request &req,
 void server_state::clear_proposals()
 {
     ddebug("clear all exist proposals");
-    zauto_write_lock l(_lock);
+    state_write_lock l(this);
     for (auto &kv : _exist_apps) {
         std::shared_ptr<app_state> &app = kv.second;
         app->helpers->clear_proposals();
@@ -2315,7 +2450,7 @@ bool server_state::check_all_partitions()
     int total_partitions = 0;
     meta_function_level::type level = _meta_svc->get_function_level();
 
-    zauto_write_lock l(_lock);
+    state_write_lock l(this);
 
     update_partition_perf_counter();
 
@@ -2562,9 +2697,49 @@ void server_state::lock_read(zauto_read_lock &other)
 void server_state::lock_write(zauto_write_lock &other)
 {
     zauto_write_lock l(_lock);
+    invalidate_config_snapshot();
     l.swap(other);
 }
 
+void server_state::invalidate_config_snapshot()
+{
+    {
+        utils::auto_write_lock l(_snapshot_lock);
+        _config_snapshots.clear();
+    }
+    _config_subscription_svc->on_config_changed(std::string());
+}
+
+void server_state::invalidate_config_snapshot(const std::string &app_name)
+{
+    {
+        utils::auto_write_lock l(_snapshot_lock);
+        _config_snapshots.erase(app_name);
+    }
+    _config_subscription_svc->on_config_changed(app_name);
+}
+
+void server_state::invalidate_stale_config_snapshots()
+{
+    std::vector<std::string> stale_apps;
+    {
+        utils::auto_read_lock l(_snapshot_lock);
+        for (const auto &kv : _config_snapshots) {
+            const app_config_snapshot &snapshot = *kv.second;
+            auto iter = _exist_apps.find(kv.first);
+            if (iter == _exist_apps.end() || iter->second->status != app_status::AS_AVAILABLE ||
+                iter->second->app_id != snapshot.app_id ||
+                iter->second->partition_count != snapshot.partition_count ||
+                iter->second->partitions != snapshot.partitions) {
+                stale_apps.push_back(kv.first);
+            }
+        }
+    }
+    for (const std::string &app_name : stale_apps) {
+        invalidate_config_snapshot(app_name);
+    }
+}
+
 void server_state::do_update_app_info(const std::string &app_path,
                                       const app_info &info,
                                       const std::function<void(error_code ec)> &cb)
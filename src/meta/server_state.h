@@ -35,12 +35,14 @@
 
 #pragma once
 
+#include <map>
 #include <unordered_map>
 #include <boost/lexical_cast.hpp>
 
 #include <dsn/dist/replication/replication_other_types.h>
 #include <dsn/dist/block_service.h>
 #include <dsn/tool-api/task_tracker.h>
+#include <dsn/utility/synchronize.h>
 #include <dsn/perf_counter/perf_counter_wrapper.h>
 
 #include "common/replication_common.h"
@@ -59,6 +61,35 @@ typedef std::function<void(const app_mapper & /*new_config*/)> config_change_sub
 typedef std::function<void(const migration_list &)> replica_migration_subscriber;
 
 class meta_service;
+class config_subscription_service;
+
+// An immutable copy of the routing table of an available app. Clients query it through
+// query_configuration_by_index() without taking server_state::_lock, so the queries don't
+// contend with config updates. It is rebuilt lazily after the app changes.
+struct app_config_snapshot
+{
+    int32_t app_id;
+    int32_t partition_count;
+    bool is_stateful;
+    std::vector<partition_configuration> partitions;
+    // sum of the ballots, increases whenever a partition gets reconfigured
+    int64_t ballot_sum;
+};
+
+// The apps and replicas collected from the replica nodes when the meta server recovers from
+// them. The responses of a node are merged into it as soon as they arrive.
+struct recovery_collection
+{
+    // app_id -> <app info, the node which reports the app first>
+    std::map<int32_t, std::pair<app_info, rpc_address>> apps;
+    // <the node which reports the replica, replica info>
+    std::vector<std::pair<rpc_address, replica_info>> replicas;
+
+    // merge the responses of a node, both of them should be ERR_OK
+    void merge(const rpc_address &node,
+               query_app_info_response &&app_resp,
+               query_replica_info_response &&replica_resp);
+};
 
 //
 // Notes for server_state
@@ -104,6 +135,14 @@ class meta_service;
 //
 // C. persistence of meta data
 // D. thread-model of meta server
+//
+// All of the apps, partitions and nodes are guarded by _lock. The routing tables served to
+// clients are additionally cached as app_config_snapshot under the light-weight
+// _snapshot_lock, the lock order is always _lock -> _snapshot_lock. Any writer of _lock must
+// invalidate the snapshots it affects before releasing _lock: state_write_lock drops the ones
+// no longer matching the apps when it's released, update_configuration_locally() and
+// transition_staging_state() drop the one of the app they change.
+//
 // E. load balancer
 
 class server_state
@@ -140,6 +179,11 @@ public:
     void query_configuration_by_index(const configuration_query_by_index_request &request,
                                       /*out*/ configuration_query_by_index_response &response);
     bool query_configuration_by_gpid(const dsn::gpid id, /*out*/ partition_configuration &config);
+    // return nullptr and set err if the app is not available
+    std::shared_ptr<const app_config_snapshot> get_config_snapshot(const std::string &app_name,
+                                                                   /*out*/ error_code &err);
+    // hold the request until the routing table of the app changes
+    void subscribe_configuration(configuration_query_by_index_rpc rpc);
 
     // app options
     void create_app(dsn::message_ex *msg);
@@ -216,14 +260,10 @@ private:
 
     void check_consistency(const dsn::gpid &gpid);
 
-    error_code construct_apps(const std::vector<query_app_info_response> &query_app_responses,
-                              const std::vector<dsn::rpc_address> &replica_nodes,
-                              std::string &hint_message);
-    error_code construct_partitions(
-        const std::vector<query_replica_info_response> &query_replica_info_responses,
-        const std::vector<dsn::rpc_address> &replica_nodes,
-        bool skip_lost_partitions,
-        std::string &hint_message);
+    error_code construct_apps(const recovery_collection &collection, std::string &hint_message);
+    error_code construct_partitions(const recovery_collection &collection,
+                                    bool skip_lost_partitions,
+                                    std::string &hint_message);
 
     void do_app_create(std::shared_ptr<app_state> &app);
     void do_app_drop(std::shared_ptr<app_state> &app);
@@ -291,12 +331,31 @@ private:
     void process_one_partition(std::shared_ptr<app_state> &app);
     void transition_staging_state(std::shared_ptr<app_state> &app);
 
+    // user should hold the write lock of _lock
+    void invalidate_config_snapshot();
+    void invalidate_config_snapshot(const std::string &app_name);
+    // drop the snapshots which differ from the current state of their apps
+    void invalidate_stale_config_snapshots();
+
+    // write lock of _lock which drops the stale app_config_snapshot before it's released
+    class state_write_lock
+    {
+    public:
+        explicit state_write_lock(server_state *state) : _state(state), _l(state->_lock) {}
+        ~state_write_lock() { _state->invalidate_stale_config_snapshots(); }
+
+    private:
+        server_state *_state;
+        zauto_write_lock _l;
+    };
+
 private:
     friend class test::test_checker;
     friend class meta_service_test_app;
     friend class meta_test_base;
     friend class meta_duplication_service_test;
     friend class meta_load_balance_test;
+    friend class config_subscription_test;
     friend class meta_duplication_service;
     friend class meta_split_service;
     friend class bulk_load_service;
@@ -315,6 +374,11 @@ private:
     //_exist_apps + dropped apps: app_id -> app_state
     app_mapper _all_apps;
 
+    // available app name -> app_config_snapshot
+    mutable utils::rw_lock_nr _snapshot_lock;
+    std::unordered_map<std::string, std::shared_ptr<const app_config_snapshot>> _config_snapshots;
+    std::unique_ptr<config_subscription_service> _config_subscription_svc;
+
     // for load balancer
     migration_list _temporary_list;
 
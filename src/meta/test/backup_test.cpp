@@ -1,11 +1,15 @@
 #include <gtest/gtest.h>
 #include <dsn/service_api_cpp.h>
 #include <dsn/utility/time_utils.h>
+#include <dsn/utility/filesystem.h>
 
+#include "block_service/local/local_service.h"
+#include "meta/backup_shared_files_gc.h"
 #include "meta/meta_backup_service.h"
 #include "meta/meta_service.h"
 #include "meta_service_test_app.h"
 #include "meta/test/misc/misc.h"
+#include "common/backup_utils.h"
 
 namespace dsn {
 namespace replication {
@@ -747,5 +751,177 @@ void meta_service_test_app::backup_service_test()
         ASSERT_TRUE(p.policy_name == test_policy_name);
     }
 }
+static void write_remote_file(dist::block_service::block_filesystem *fs,
+                              const std::string &file_name,
+                              std::string content)
+{
+    using namespace dist::block_service;
+    block_file_ptr file;
+    fs->create_file(create_file_request{file_name, false},
+                    TASK_CODE_EXEC_INLINED,
+                    [&file](const create_file_response &resp) {
+                        ASSERT_EQ(ERR_OK, resp.err);
+                        file = resp.file_handle;
+                    })
+        ->wait();
+    file->write(write_request{blob::create_from_bytes(std::move(content))},
+                TASK_CODE_EXEC_INLINED,
+                [](const write_response &resp) { ASSERT_EQ(ERR_OK, resp.err); })
+        ->wait();
+}
+
+static std::set<std::string> list_remote_dir(dist::block_service::block_filesystem *fs,
+                                             const std::string &dir)
+{
+    using namespace dist::block_service;
+    std::set<std::string> names;
+    fs->list_dir(ls_request{dir},
+                 TASK_CODE_EXEC_INLINED,
+                 [&names](const ls_response &resp) {
+                     ASSERT_EQ(ERR_OK, resp.err);
+                     for (const ls_entry &entry : *resp.entries) {
+                         names.insert(entry.entry_name);
+                     }
+                 })
+        ->wait();
+    return names;
+}
+
+static error_code gc_shared_files(dist::block_service::block_filesystem *fs,
+                                  const std::string &backup_root,
+                                  const std::string &app_name,
+                                  int32_t app_id,
+                                  const std::vector<int64_t> &backup_ids,
+                                  /*out*/ int &removed_count)
+{
+    auto gc = std::make_shared<backup_shared_files_gc>(
+        fs, backup_root, test_policy_name, app_name, app_id, backup_ids);
+    error_code result;
+    utils::notify_event finished;
+    gc->start(nullptr, [&result, &removed_count, &finished](error_code err, int count) {
+        result = err;
+        removed_count = count;
+        finished.notify();
+    });
+    finished.wait();
+    return result;
+}
+
+static std::string encode_backup_metadata(
+    const std::vector<std::tuple<std::string, int64_t, std::string>> &files,
+    const std::vector<std::string> &shared_files)
+{
+    cold_backup_metadata metadata;
+    metadata.checkpoint_decree = 100;
+    metadata.checkpoint_timestamp = 0;
+    metadata.checkpoint_total_size = 0;
+    for (const auto &f : files) {
+        file_meta f_meta;
+        f_meta.name = std::get<0>(f);
+        f_meta.size = std::get<1>(f);
+        f_meta.md5 = std::get<2>(f);
+        metadata.files.emplace_back(f_meta);
+        metadata.checkpoint_total_size += f_meta.size;
+    }
+    metadata.shared_files = shared_files;
+    return json::json_forwarder<cold_backup_metadata>::encode(metadata).to_string();
+}
+
+TEST(backup_shared_files_gc, gc_app)
+{
+    const std::string root_dir = "gc_shared_files_root";
+    const std::string backup_root = "root";
+    const std::string app_name = "app1";
+    const int32_t app_id = 1;
+    utils::filesystem::remove_path(root_dir);
+    dist::block_service::local_service fs(root_dir);
+    ASSERT_EQ(ERR_OK, fs.initialize({}));
+
+    app_info info;
+    info.app_name = app_name;
+    info.app_id = app_id;
+    info.partition_count = 2;
+    const std::string app_metadata = json::json_forwarder<app_info>::encode(info).to_string();
+
+    // backup 1 is finished, partition 0 references 1.sst and 2.sst, and partition 1 doesn't
+    // reference any shared file
+    const std::string backup1_path =
+        cold_backup::get_app_backup_path(backup_root, test_policy_name, app_name, app_id, 1);
+    write_remote_file(&fs, backup1_path + "/meta/app_metadata", app_metadata);
+    write_remote_file(&fs, backup1_path + "/meta/app_backup_status", "{}");
+    write_remote_file(&fs, backup1_path + "/0/current_checkpoint", "chkpt");
+    write_remote_file(&fs,
+                      backup1_path + "/0/chkpt/backup_metadata",
+                      encode_backup_metadata({std::make_tuple("1.sst", 1, "md5_1"),
+                                              std::make_tuple("2.sst", 2, "md5_2"),
+                                              std::make_tuple("CURRENT", 10, "md5_current")},
+                                             {"1.sst", "2.sst"}));
+    write_remote_file(&fs, backup1_path + "/1/current_checkpoint", "chkpt");
+    write_remote_file(&fs,
+                      backup1_path + "/1/chkpt/backup_metadata",
+                      encode_backup_metadata({std::make_tuple("CURRENT", 10, "md5_current")}, {}));
+
+    // the app is skipped by backup 2 as it was dropped during the backup, whose partition 0 is
+    // uploaded and references 3.sst, and the checkpoint of partition 1 isn't uploaded
+    const std::string backup2_path =
+        cold_backup::get_app_backup_path(backup_root, test_policy_name, app_name, app_id, 2);
+    write_remote_file(&fs, backup2_path + "/meta/app_metadata", app_metadata);
+    write_remote_file(&fs, backup2_path + "/0/current_checkpoint", "chkpt");
+    write_remote_file(&fs,
+                      backup2_path + "/0/chkpt/backup_metadata",
+                      encode_backup_metadata({std::make_tuple("3.sst", 3, "md5_3")}, {"3.sst"}));
+    write_remote_file(&fs, backup2_path + "/1/chkpt/1.sst", "1");
+
+    const std::string shared_files_path =
+        cold_backup::get_shared_files_path(backup_root, test_policy_name, app_name, app_id);
+    for (const auto &name : {"md5_1_1", "md5_2_2", "md5_3_3", "md5_4_4"}) {
+        write_remote_file(&fs, shared_files_path + "/" + name, "x");
+    }
+
+    // the app is skipped by backup 3 before anything is uploaded
+    int removed_count = 0;
+    ASSERT_EQ(ERR_OK,
+              gc_shared_files(&fs, backup_root, app_name, app_id, {1, 2, 3}, removed_count));
+    ASSERT_EQ(1, removed_count);
+    ASSERT_EQ(std::set<std::string>({"md5_1_1", "md5_2_2", "md5_3_3"}),
+              list_remote_dir(&fs, shared_files_path));
+
+    // the shared files of another app
+    ASSERT_EQ(ERR_OK, gc_shared_files(&fs, backup_root, "app2", 2, {1}, removed_count));
+    ASSERT_EQ(0, removed_count);
+
+    // a partition of a finished backup is missing, nothing is removed
+    utils::filesystem::remove_path(
+        utils::filesystem::path_combine(root_dir, backup1_path + "/1/chkpt/backup_metadata"));
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND,
+              gc_shared_files(&fs, backup_root, app_name, app_id, {1}, removed_count));
+    ASSERT_EQ(0, removed_count);
+    utils::filesystem::remove_path(
+        utils::filesystem::path_combine(root_dir, backup1_path + "/1/current_checkpoint"));
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND,
+              gc_shared_files(&fs, backup_root, app_name, app_id, {1}, removed_count));
+    ASSERT_EQ(3, list_remote_dir(&fs, shared_files_path).size());
+
+    // so is the app_metadata of a finished backup
+    utils::filesystem::remove_path(
+        utils::filesystem::path_combine(root_dir, backup1_path + "/meta/app_metadata"));
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND,
+              gc_shared_files(&fs, backup_root, app_name, app_id, {1}, removed_count));
+    ASSERT_EQ(3, list_remote_dir(&fs, shared_files_path).size());
+
+    // a damaged backup_metadata fails the gc
+    write_remote_file(&fs, backup2_path + "/0/chkpt/backup_metadata", "damaged");
+    ASSERT_EQ(ERR_CORRUPTION,
+              gc_shared_files(&fs, backup_root, app_name, app_id, {2}, removed_count));
+    ASSERT_EQ(3, list_remote_dir(&fs, shared_files_path).size());
+
+    // all the backups are removed
+    ASSERT_EQ(ERR_OK, gc_shared_files(&fs, backup_root, app_name, app_id, {}, removed_count));
+    ASSERT_EQ(3, removed_count);
+    ASSERT_TRUE(list_remote_dir(&fs, shared_files_path).empty());
+
+    utils::filesystem::remove_path(root_dir);
+}
+
 } // namespace replication
 } // namespace dsn
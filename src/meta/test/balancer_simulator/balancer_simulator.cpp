@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <gtest/gtest.h>
+#include <dsn/utility/flags.h>
 
 #include "meta/meta_data.h"
 #include "meta/server_load_balancer.h"
@@ -8,6 +9,13 @@
 
 using namespace dsn::replication;
 
+namespace dsn {
+namespace replication {
+DSN_DECLARE_bool(balancer_load_aware);
+DSN_DECLARE_double(balancer_load_start_ratio);
+} // namespace replication
+} // namespace dsn
+
 #ifdef ASSERT_EQ
 #undef ASSERT_EQ
 #endif
@@ -166,9 +174,143 @@ void greedy_balancer_perfect_move_primary()
     }
 }
 
+// simulate the config-sync of replica servers, which report the load of each partition:
+// read qps is only served by primary
+void sync_serving_load(app_mapper &apps,
+                       const std::vector<int64_t> &read_qps,
+                       const std::vector<int64_t> &write_qps,
+                       const std::vector<int64_t> &storage_mb)
+{
+    app_state &the_app = *(apps.begin()->second);
+    for (int i = 0; i < the_app.partition_count; ++i) {
+        const dsn::partition_configuration &pc = the_app.partitions[i];
+        config_context &cc = the_app.helpers->contexts[i];
+        cc.serving.clear();
+
+        replica_info ri;
+        ri.disk_tag = "disk1";
+        ri.__set_write_qps(write_qps[i]);
+        ri.__set_storage_mb(storage_mb[i]);
+        ri.__set_read_qps(0);
+        for (const dsn::rpc_address &addr : pc.secondaries) {
+            cc.collect_serving_replica(addr, ri);
+        }
+        ri.__set_read_qps(read_qps[i]);
+        cc.collect_serving_replica(pc.primary, ri);
+    }
+}
+
+void calc_node_loads(const app_mapper &apps,
+                     const std::vector<int64_t> &read_qps,
+                     const std::vector<int64_t> &write_qps,
+                     const std::vector<int64_t> &storage_mb,
+                     /*out*/ std::map<dsn::rpc_address, int64_t> &node_qps,
+                     /*out*/ std::map<dsn::rpc_address, int64_t> &node_storage)
+{
+    node_qps.clear();
+    node_storage.clear();
+    const app_state &the_app = *(apps.begin()->second);
+    for (int i = 0; i < the_app.partition_count; ++i) {
+        const dsn::partition_configuration &pc = the_app.partitions[i];
+        node_qps[pc.primary] += read_qps[i] + write_qps[i];
+        node_storage[pc.primary] += storage_mb[i];
+        for (const dsn::rpc_address &addr : pc.secondaries) {
+            node_qps[addr] += write_qps[i];
+            node_storage[addr] += storage_mb[i];
+        }
+    }
+}
+
+double max_to_average(const std::map<dsn::rpc_address, int64_t> &loads)
+{
+    int64_t total = 0, max_load = 0;
+    for (const auto &kv : loads) {
+        total += kv.second;
+        max_load = std::max(max_load, kv.second);
+    }
+    return static_cast<double>(max_load) * loads.size() / total;
+}
+
+void greedy_balancer_load_aware_skewed_workload()
+{
+    app_mapper apps;
+    node_mapper nodes;
+    std::vector<dsn::rpc_address> node_list;
+
+    generate_node_list(node_list, 10, 20);
+    generate_balanced_apps(apps, nodes, node_list);
+
+    // skewed workload: the primaries on the first node are hot spots of read,
+    // and the partitions which have a replica on the second node are much larger
+    const app_state &the_app = *(apps.begin()->second);
+    std::vector<int64_t> read_qps(the_app.partition_count);
+    std::vector<int64_t> write_qps(the_app.partition_count, 50);
+    std::vector<int64_t> storage_mb(the_app.partition_count);
+    for (int i = 0; i < the_app.partition_count; ++i) {
+        const dsn::partition_configuration &pc = the_app.partitions[i];
+        read_qps[i] = (pc.primary == node_list[0] ? 1000 : 100);
+        storage_mb[i] = (is_member(pc, node_list[1]) ? 1000 : 200);
+    }
+
+    std::map<dsn::rpc_address, int64_t> node_qps, node_storage;
+    calc_node_loads(apps, read_qps, write_qps, storage_mb, node_qps, node_storage);
+    double qps_ratio = max_to_average(node_qps);
+    double storage_ratio = max_to_average(node_storage);
+    dinfo("before load balance: qps max/average = %.3f, storage max/average = %.3f",
+          qps_ratio,
+          storage_ratio);
+    ASSERT_TRUE(qps_ratio > FLAGS_balancer_load_start_ratio);
+    ASSERT_TRUE(storage_ratio > FLAGS_balancer_load_start_ratio);
+
+    FLAGS_balancer_load_aware = true;
+    greedy_load_balancer glb(nullptr);
+    migration_list ml;
+
+    // the balancer should converge in limited rounds rather than thrash
+    int round = 0;
+    sync_serving_load(apps, read_qps, write_qps, storage_mb);
+    while (glb.balance({&apps, &nodes}, ml)) {
+        ASSERT_TRUE(++round < 1000);
+        migration_check_and_apply(apps, nodes, ml, nullptr);
+        sync_serving_load(apps, read_qps, write_qps, storage_mb);
+    }
+
+    calc_node_loads(apps, read_qps, write_qps, storage_mb, node_qps, node_storage);
+    double new_qps_ratio = max_to_average(node_qps);
+    double new_storage_ratio = max_to_average(node_storage);
+    dinfo("after %d rounds of load balance: qps max/average = %.3f, storage max/average = %.3f",
+          round,
+          new_qps_ratio,
+          new_storage_ratio);
+    ASSERT_TRUE(new_qps_ratio < FLAGS_balancer_load_start_ratio);
+    ASSERT_TRUE(new_storage_ratio < FLAGS_balancer_load_start_ratio);
+
+    // the replica counts are kept balanced by the exchanges
+    unsigned pri_min = the_app.partition_count + 1, pri_max = 0;
+    unsigned part_min = the_app.partition_count + 1, part_max = 0;
+    for (const auto &kv : nodes) {
+        pri_min = std::min(pri_min, kv.second.primary_count());
+        pri_max = std::max(pri_max, kv.second.primary_count());
+        part_min = std::min(part_min, kv.second.partition_count());
+        part_max = std::max(part_max, kv.second.partition_count());
+    }
+    ASSERT_TRUE(pri_max - pri_min <= 1);
+    ASSERT_TRUE(part_max - part_min <= 1);
+
+    // small fluctuation of the workload won't trigger the balancer again
+    for (int i = 0; i < the_app.partition_count; ++i) {
+        read_qps[i] += random32(0, 10);
+    }
+    sync_serving_load(apps, read_qps, write_qps, storage_mb);
+    ASSERT_FALSE(glb.balance({&apps, &nodes}, ml));
+
+    FLAGS_balancer_load_aware = false;
+}
+
 int main(int, char **)
 {
     dsn_run_config("config.ini", false);
     greedy_balancer_perfect_move_primary();
+    greedy_balancer_load_aware_skewed_workload();
     return 0;
 }
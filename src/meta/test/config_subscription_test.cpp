@@ -0,0 +1,225 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <gtest/gtest.h>
+#include <dsn/utility/time_utils.h>
+
+#include "meta/config_subscription_service.h"
+#include "meta/server_state.h"
+#include "meta_test_base.h"
+
+namespace dsn {
+namespace replication {
+
+class config_subscription_test : public meta_test_base
+{
+public:
+    void SetUp() override
+    {
+        meta_test_base::SetUp();
+        create_app(APP_NAME, PARTITION_COUNT);
+    }
+
+    configuration_query_by_index_rpc subscribe(const std::string &app_name,
+                                               int64_t known_ballot_sum,
+                                               int timeout_ms = 30000,
+                                               int32_t known_app_id = -1)
+    {
+        auto request = make_unique<configuration_query_by_index_request>();
+        request->app_name = app_name;
+        if (known_ballot_sum >= 0) {
+            request->__set_known_ballot_sum(known_ballot_sum);
+        }
+        if (known_app_id >= 0) {
+            request->__set_known_app_id(known_app_id);
+        }
+        configuration_query_by_index_rpc rpc(std::move(request),
+                                             RPC_CM_SUBSCRIBE_PARTITION_CONFIG,
+                                             std::chrono::milliseconds(timeout_ms));
+        _ss->subscribe_configuration(rpc);
+        return rpc;
+    }
+
+    int64_t current_ballot_sum()
+    {
+        error_code err;
+        auto snapshot = _ss->get_config_snapshot(APP_NAME, err);
+        return snapshot == nullptr ? -1 : snapshot->ballot_sum;
+    }
+
+    static int64_t ballot_sum(const configuration_query_by_index_response &resp)
+    {
+        int64_t sum = 0;
+        for (const partition_configuration &pc : resp.partitions) {
+            sum += std::max<int64_t>(pc.ballot, 0);
+        }
+        return sum;
+    }
+
+    void reconfigure_partition(const std::string &app_name, int pidx)
+    {
+        zauto_write_lock l;
+        _ss->lock_write(l);
+        ++_ss->get_app(app_name)->partitions[pidx].ballot;
+        _ss->invalidate_config_snapshot(app_name);
+    }
+
+    // mock a failover, which reconfigures the partitions one by one
+    void reconfigure_all_partitions()
+    {
+        for (int pidx = 0; pidx < PARTITION_COUNT; ++pidx) {
+            reconfigure_partition(APP_NAME, pidx);
+        }
+    }
+
+    size_t subscriber_count() const { return _ss->_config_subscription_svc->subscriber_count(); }
+
+    bool wait_subscriber_count(size_t expected, int timeout_ms)
+    {
+        uint64_t deadline = dsn_now_ms() + timeout_ms;
+        while (subscriber_count() != expected) {
+            if (dsn_now_ms() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    const std::string APP_NAME = "subscription_table";
+    const uint32_t PARTITION_COUNT = 8;
+};
+
+TEST_F(config_subscription_test, reply_immediately)
+{
+    // without known ballot sum
+    auto rpc = subscribe(APP_NAME, -1);
+    ASSERT_EQ(ERR_OK, rpc.response().err);
+    ASSERT_EQ(PARTITION_COUNT, rpc.response().partitions.size());
+
+    // the client knows an older routing table
+    reconfigure_all_partitions();
+    rpc = subscribe(APP_NAME, current_ballot_sum() - 1);
+    ASSERT_EQ(ERR_OK, rpc.response().err);
+    ASSERT_EQ(PARTITION_COUNT, rpc.response().partition_count);
+    ASSERT_EQ(current_ballot_sum(), ballot_sum(rpc.response()));
+
+    rpc = subscribe("table_not_exist", 0);
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, rpc.response().err);
+
+    // the app was recreated, whose ballots are not comparable with the known ones
+    int32_t app_id = _ss->get_app(APP_NAME)->app_id;
+    rpc = subscribe(APP_NAME, current_ballot_sum() + 100, 30000, app_id + 1);
+    ASSERT_EQ(ERR_OK, rpc.response().err);
+    ASSERT_EQ(app_id, rpc.response().app_id);
+
+    // the rpc timeout is too short to hold
+    rpc = subscribe(APP_NAME, current_ballot_sum(), 100);
+    ASSERT_EQ(PARTITION_COUNT, rpc.response().partitions.size());
+    ASSERT_EQ(0, subscriber_count());
+}
+
+TEST_F(config_subscription_test, push_on_change)
+{
+    int64_t known_sum = current_ballot_sum();
+    auto rpc = subscribe(APP_NAME, known_sum);
+    ASSERT_EQ(1, subscriber_count());
+    ASSERT_TRUE(rpc.response().partitions.empty());
+
+    reconfigure_all_partitions();
+    ASSERT_TRUE(wait_subscriber_count(0, 10000));
+    ASSERT_EQ(ERR_OK, rpc.response().err);
+    ASSERT_EQ(known_sum + PARTITION_COUNT, ballot_sum(rpc.response()));
+}
+
+TEST_F(config_subscription_test, reply_on_hold_timeout)
+{
+    // held for 1500 - 1000 ms
+    auto rpc = subscribe(APP_NAME, current_ballot_sum(), 1500);
+    ASSERT_EQ(1, subscriber_count());
+    ASSERT_TRUE(wait_subscriber_count(0, 10000));
+    ASSERT_EQ(ERR_OK, rpc.response().err);
+    ASSERT_EQ(current_ballot_sum(), ballot_sum(rpc.response()));
+}
+
+TEST_F(config_subscription_test, unchanged_app_is_not_pushed)
+{
+    create_app("another_table", 4);
+    auto rpc = subscribe(APP_NAME, current_ballot_sum());
+
+    // changes of other apps only make the subscribers recheck
+    reconfigure_partition("another_table", 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    ASSERT_EQ(1, subscriber_count());
+    ASSERT_TRUE(rpc.response().partitions.empty());
+}
+
+// Thousands of resolvers subscribe to a table, then all partitions of the table are
+// reconfigured. Each of them should be pushed once with the final routing table.
+TEST_F(config_subscription_test, thousands_of_subscribers_during_reconfiguration)
+{
+    const int resolver_count = 5000;
+    int64_t known_sum = current_ballot_sum();
+
+    std::vector<configuration_query_by_index_rpc> rpcs;
+    rpcs.reserve(resolver_count);
+    for (int i = 0; i < resolver_count; ++i) {
+        rpcs.emplace_back(subscribe(APP_NAME, known_sum));
+    }
+    ASSERT_EQ(resolver_count, subscriber_count());
+
+    reconfigure_all_partitions();
+    ASSERT_TRUE(wait_subscriber_count(0, 30000));
+
+    for (const auto &rpc : rpcs) {
+        ASSERT_EQ(ERR_OK, rpc.response().err);
+        // changes of all the partitions are coalesced into one push
+        ASSERT_EQ(known_sum + PARTITION_COUNT, ballot_sum(rpc.response()));
+    }
+}
+
+// Run it manually with --gtest_also_run_disabled_tests, it compares the push latency of
+// thousands of subscribers with the load of the polling clients which query the meta server
+// again on access failures.
+TEST_F(config_subscription_test, DISABLED_push_vs_polling_benchmark)
+{
+    const int resolver_count = 5000;
+    int64_t known_sum = current_ballot_sum();
+
+    std::vector<configuration_query_by_index_rpc> rpcs;
+    rpcs.reserve(resolver_count);
+    uint64_t start_us = dsn_now_us();
+    for (int i = 0; i < resolver_count; ++i) {
+        rpcs.emplace_back(subscribe(APP_NAME, known_sum));
+    }
+    uint64_t subscribe_us = dsn_now_us() - start_us;
+
+    start_us = dsn_now_us();
+    reconfigure_all_partitions();
+    ASSERT_TRUE(wait_subscriber_count(0, 30000));
+    uint64_t push_us = dsn_now_us() - start_us;
+
+    // polling: every resolver queries once per failed partition
+    reconfigure_all_partitions();
+    start_us = dsn_now_us();
+    for (int i = 0; i < resolver_count; ++i) {
+        for (int pidx = 0; pidx < PARTITION_COUNT; ++pidx) {
+            configuration_query_by_index_request request;
+            configuration_query_by_index_response response;
+            request.app_name = APP_NAME;
+            request.partition_indices.push_back(pidx);
+            _ss->query_configuration_by_index(request, response);
+            ASSERT_EQ(ERR_OK, response.err);
+        }
+    }
+    uint64_t poll_us = dsn_now_us() - start_us;
+
+    std::cout << "resolvers: " << resolver_count << ", partitions: " << PARTITION_COUNT
+              << ", subscribe: " << subscribe_us << " us, push after reconfiguration: " << push_us
+              << " us (" << resolver_count << " replies), polling: " << poll_us << " us ("
+              << resolver_count * PARTITION_COUNT << " queries)" << std::endl;
+}
+
+} // namespace replication
+} // namespace dsn
@@ -112,6 +112,14 @@ TEST_F(meta_app_envs_test, update_app_envs_test)
          "20M*delay*100"},
         {replica_envs::WRITE_QPS_THROTTLING, "20M*reject*100", ERR_OK, "", "20M*reject*100"},
         {replica_envs::WRITE_SIZE_THROTTLING, "300*delay*100", ERR_OK, "", "300*delay*100"},
+        {replica_envs::TABLE_WRITE_QPS_THROTTLING, "20K", ERR_OK, "", "20K"},
+        {replica_envs::TABLE_WRITE_QPS_THROTTLING,
+         "20A",
+         ERR_INVALID_PARAMETERS,
+         "20A should be non-negative int",
+         "20K"},
+        {replica_envs::TABLE_WRITE_SIZE_THROTTLING, "10M", ERR_OK, "", "10M"},
+        {replica_envs::TABLE_READ_QPS_THROTTLING, "1000", ERR_OK, "", "1000"},
         {replica_envs::SLOW_QUERY_THRESHOLD, "30", ERR_OK, "", "30"},
         {replica_envs::SLOW_QUERY_THRESHOLD, "20", ERR_OK, "", "20"},
         {replica_envs::SLOW_QUERY_THRESHOLD,
@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/fail_point.h>
+#include <dsn/utility/flags.h>
 
 #include "meta_test_base.h"
 #include "meta_service_test_app.h"
@@ -14,6 +15,10 @@
 
 namespace dsn {
 namespace replication {
+
+DSN_DECLARE_bool(bulk_load_ingest_partition_early);
+DSN_DECLARE_uint32(bulk_load_max_early_ingesting_partitions);
+
 class bulk_load_service_test : public meta_test_base
 {
 public:
@@ -105,6 +110,26 @@ public:
         return bulk_svc().get_app_bulk_load_status_unlocked(app_id);
     }
 
+    bulk_load_status::type get_partition_bulk_load_status(const gpid &pid)
+    {
+        return bulk_svc().get_partition_bulk_load_status_unlocked(pid);
+    }
+
+    void set_partition_bulk_load_status(const gpid &pid, bulk_load_status::type status)
+    {
+        bulk_svc()._partition_bulk_load_info[pid].status = status;
+    }
+
+    uint32_t get_early_ingesting_count(int32_t app_id)
+    {
+        return bulk_svc().get_early_ingesting_count_unlocked(app_id);
+    }
+
+    bool is_ingestion_finished_early(const gpid &pid)
+    {
+        return bulk_svc()._partition_bulk_load_info[pid].ingestion_finished_early;
+    }
+
     void test_on_partition_ingestion_reply(ingestion_response &resp,
                                            const gpid &pid,
                                            error_code rpc_err = ERR_OK)
@@ -584,6 +609,61 @@ TEST_F(bulk_load_process_test, start_ingesting)
     ASSERT_EQ(get_app_bulk_load_status(_app_id), bulk_load_status::BLS_INGESTING);
 }
 
+TEST_F(bulk_load_process_test, ingest_partition_early)
+{
+    fail::cfg("meta_bulk_load_partition_ingestion", "return()");
+    FLAGS_bulk_load_ingest_partition_early = true;
+    const uint32_t old_max_count = FLAGS_bulk_load_max_early_ingesting_partitions;
+    FLAGS_bulk_load_max_early_ingesting_partitions = 1;
+    const gpid pid(_app_id, _pidx);
+    const gpid other_pid(_app_id, _pidx + 1);
+
+    // partition 1 is ingesting, partition 0 waits even if it's downloaded
+    mock_meta_bulk_load_context(_app_id, _partition_count, bulk_load_status::BLS_DOWNLOADING);
+    set_partition_bulk_load_status(other_pid, bulk_load_status::BLS_INGESTING);
+    mock_response_progress(ERR_OK, true);
+    create_request(bulk_load_status::BLS_DOWNLOADING);
+    on_partition_bulk_load_reply(ERR_OK, _req, _resp);
+    wait_all();
+    ASSERT_EQ(bulk_load_status::BLS_DOWNLOADING, get_partition_bulk_load_status(pid));
+    ASSERT_EQ(1, get_early_ingesting_count(_app_id));
+
+    // partition 1 finishes ingestion, but it turns to succeed after the app turns to ingesting
+    mock_response_ingestion_status(ingestion_status::IS_SUCCEED);
+    _resp.pid = other_pid;
+    create_request(bulk_load_status::BLS_INGESTING);
+    _req.pid = other_pid;
+    on_partition_bulk_load_reply(ERR_OK, _req, _resp);
+    wait_all();
+    ASSERT_EQ(bulk_load_status::BLS_INGESTING, get_partition_bulk_load_status(other_pid));
+    ASSERT_TRUE(is_ingestion_finished_early(other_pid));
+    ASSERT_EQ(0, get_early_ingesting_count(_app_id));
+
+    // partition 0 ingests while the others are downloading
+    mock_response_progress(ERR_OK, true);
+    create_request(bulk_load_status::BLS_DOWNLOADING);
+    on_partition_bulk_load_reply(ERR_OK, _req, _resp);
+    wait_all();
+    ASSERT_EQ(bulk_load_status::BLS_INGESTING, get_partition_bulk_load_status(pid));
+    ASSERT_EQ(bulk_load_status::BLS_DOWNLOADING, get_app_bulk_load_status(_app_id));
+    ASSERT_EQ(1, get_early_ingesting_count(_app_id));
+
+    FLAGS_bulk_load_ingest_partition_early = false;
+    FLAGS_bulk_load_max_early_ingesting_partitions = old_max_count;
+}
+
+TEST_F(bulk_load_process_test, ingest_last_partition_early)
+{
+    fail::cfg("meta_bulk_load_partition_ingestion", "return()");
+    FLAGS_bulk_load_ingest_partition_early = true;
+    // the app turns from downloading to ingesting when its last partition turns to ingesting
+    mock_response_progress(ERR_OK, true);
+    test_on_partition_bulk_load_reply(1, bulk_load_status::BLS_DOWNLOADING);
+    ASSERT_EQ(bulk_load_status::BLS_INGESTING, get_partition_bulk_load_status(gpid(_app_id, 0)));
+    ASSERT_EQ(bulk_load_status::BLS_INGESTING, get_app_bulk_load_status(_app_id));
+    FLAGS_bulk_load_ingest_partition_early = false;
+}
+
 TEST_F(bulk_load_process_test, ingestion_running)
 {
     mock_response_ingestion_status(ingestion_status::IS_RUNNING);
@@ -805,6 +885,9 @@ public:
         for (auto iter = pstatus_map.begin(); iter != pstatus_map.end(); ++iter) {
             partition_bulk_load_info pinfo;
             pinfo.status = iter->second;
+            pinfo.ingest_early = (_ingest_early_pidx_set.count(iter->first) > 0);
+            pinfo.ingestion_finished_early =
+                (_ingestion_finished_early_pidx_set.count(iter->first) > 0);
             pinfo_map[iter->first] = pinfo;
         }
         _partition_bulk_load_info_map[app_id] = pinfo_map;
@@ -840,6 +923,8 @@ public:
         _app_bulk_load_info_map.clear();
         _partition_bulk_load_info_map.clear();
         _pstatus_map.clear();
+        _ingest_early_pidx_set.clear();
+        _ingestion_finished_early_pidx_set.clear();
         _app_id_set.clear();
     }
 
@@ -853,6 +938,8 @@ public:
     std::unordered_map<app_id, std::unordered_map<int32_t, partition_bulk_load_info>>
         _partition_bulk_load_info_map;
     std::unordered_map<int32_t, bulk_load_status::type> _pstatus_map;
+    std::unordered_set<int32_t> _ingest_early_pidx_set;
+    std::unordered_set<int32_t> _ingestion_finished_early_pidx_set;
 };
 
 TEST_F(bulk_load_failover_test, sync_bulk_load)
@@ -955,6 +1042,66 @@ TEST_F(bulk_load_failover_test, app_downloading_test)
     }
 }
 
+TEST_F(bulk_load_failover_test, app_downloading_ingest_early_test)
+{
+    // Test cases:
+    // - partition[0,1]=ingesting early, partition[2,3]=downloading
+    // - partition[0,1]=ingesting early, partition[2]=ingesting, partition[3]=downloading
+    // - partition[0~3]=ingesting early
+    struct app_downloading_ingest_early_test
+    {
+        int32_t ingest_early_end_index;
+        int32_t ingesting_pidx;
+        bulk_load_status::type expected_app_status;
+        bulk_load_status::type expected_pstatus;
+        int32_t expected_in_process_count;
+    } tests[] = {
+        {1, -1, bulk_load_status::BLS_DOWNLOADING, bulk_load_status::BLS_INGESTING, 2},
+        {1, 2, bulk_load_status::BLS_DOWNLOADING, bulk_load_status::BLS_DOWNLOADING, 4},
+        {3, -1, bulk_load_status::BLS_INGESTING, bulk_load_status::BLS_INGESTING, 4}};
+
+    for (const auto &test : tests) {
+        SetUp();
+        mock_pstatus_map(bulk_load_status::BLS_DOWNLOADING, SYNC_PARTITION_COUNT - 1);
+        mock_pstatus_map(bulk_load_status::BLS_INGESTING, test.ingest_early_end_index);
+        for (auto i = 0; i <= test.ingest_early_end_index; ++i) {
+            _ingest_early_pidx_set.insert(i);
+        }
+        if (test.ingesting_pidx > 0) {
+            _pstatus_map[test.ingesting_pidx] = bulk_load_status::BLS_INGESTING;
+        }
+        try_to_continue_bulk_load(bulk_load_status::BLS_DOWNLOADING);
+        ASSERT_TRUE(app_is_bulk_loading(SYNC_APP_NAME));
+        ASSERT_EQ(test.expected_app_status, get_app_bulk_load_status(SYNC_APP_ID));
+        ASSERT_EQ(test.expected_pstatus,
+                  get_partition_bulk_load_status(gpid(SYNC_APP_ID, test.ingest_early_end_index)));
+        ASSERT_EQ(test.expected_in_process_count, get_app_in_process_count(SYNC_APP_ID));
+        TearDown();
+    }
+}
+
+// partition[0,1]=ingesting early, partition[0] has finished ingestion,
+// partition[2,3]=downloading
+TEST_F(bulk_load_failover_test, app_downloading_ingestion_finished_early_test)
+{
+    fail::cfg("meta_bulk_load_partition_ingestion", "return()");
+    mock_pstatus_map(bulk_load_status::BLS_DOWNLOADING, SYNC_PARTITION_COUNT - 1);
+    mock_pstatus_map(bulk_load_status::BLS_INGESTING, 1);
+    _ingest_early_pidx_set.insert({0, 1});
+    _ingestion_finished_early_pidx_set.insert(0);
+
+    try_to_continue_bulk_load(bulk_load_status::BLS_DOWNLOADING);
+    ASSERT_TRUE(app_is_bulk_loading(SYNC_APP_NAME));
+    ASSERT_EQ(bulk_load_status::BLS_DOWNLOADING, get_app_bulk_load_status(SYNC_APP_ID));
+    ASSERT_EQ(2, get_app_in_process_count(SYNC_APP_ID));
+    ASSERT_EQ(bulk_load_status::BLS_INGESTING,
+              get_partition_bulk_load_status(gpid(SYNC_APP_ID, 0)));
+    ASSERT_TRUE(is_ingestion_finished_early(gpid(SYNC_APP_ID, 0)));
+    ASSERT_FALSE(is_ingestion_finished_early(gpid(SYNC_APP_ID, 1)));
+    // only partition[1] is still ingesting
+    ASSERT_EQ(1, get_early_ingesting_count(SYNC_APP_ID));
+}
+
 TEST_F(bulk_load_failover_test, app_downloaded_test)
 {
     // Test cases:
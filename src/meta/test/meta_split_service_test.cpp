@@ -57,6 +57,15 @@ public:
         return rpc.response();
     }
 
+    configuration_query_by_index_response query_config(const std::string &app_name)
+    {
+        configuration_query_by_index_request request;
+        request.app_name = app_name;
+        configuration_query_by_index_response response;
+        _ss->query_configuration_by_index(request, response);
+        return response;
+    }
+
     register_child_response
     register_child(ballot req_parent_ballot, ballot child_ballot, bool wait_zk = false)
     {
@@ -137,6 +146,23 @@ TEST_F(meta_split_service_test, start_split_succeed)
     ASSERT_EQ(resp.partition_count, NEW_PARTITION_COUNT);
 }
 
+TEST_F(meta_split_service_test, query_config_after_split)
+{
+    // cache the routing table before split
+    auto query_resp = query_config(NAME);
+    ASSERT_EQ(query_resp.err, ERR_OK);
+    ASSERT_EQ(query_resp.partition_count, PARTITION_COUNT);
+    ASSERT_EQ(query_resp.partitions.size(), PARTITION_COUNT);
+
+    auto resp = start_partition_split(NAME, NEW_PARTITION_COUNT);
+    ASSERT_EQ(resp.err, ERR_OK);
+
+    query_resp = query_config(NAME);
+    ASSERT_EQ(query_resp.err, ERR_OK);
+    ASSERT_EQ(query_resp.partition_count, NEW_PARTITION_COUNT);
+    ASSERT_EQ(query_resp.partitions.size(), NEW_PARTITION_COUNT);
+}
+
 TEST_F(meta_split_service_test, register_child_with_wrong_ballot)
 {
     auto resp = register_child(PARENT_BALLOT - 1, invalid_ballot);
@@ -262,8 +262,14 @@ void meta_service_test_app::state_sync_test()
         ss2->query_configuration_by_index(req, resp);
         ASSERT_EQ(dsn::ERR_OK, resp.err);
 
+        // the routing table of an available app is served from the snapshot cache
         app->status = dsn::app_status::AS_DROPPING;
         ss2->query_configuration_by_index(req, resp);
+        ASSERT_EQ(dsn::ERR_OK, resp.err);
+
+        // which must be dropped by the writers
+        ss2->invalidate_config_snapshot(app->app_name);
+        ss2->query_configuration_by_index(req, resp);
         ASSERT_EQ(dsn::ERR_BUSY_DROPPING, resp.err);
 
         app->status = dsn::app_status::AS_RECALLING;
@@ -328,16 +334,23 @@ void meta_service_test_app::construct_apps_test()
         create_app_info(dsn::app_status::AS_AVAILABLE, "test", 4, 20),
         create_app_info(dsn::app_status::AS_AVAILABLE, "test", 6, 30)};
 
-    query_app_info_response resp;
-    resp.apps = apps;
-    resp.err = dsn::ERR_OK;
-
     std::shared_ptr<meta_service> svc(new meta_service());
 
     std::vector<dsn::rpc_address> nodes;
     std::string hint_message;
-    generate_node_list(nodes, 1, 1);
-    svc->_state->construct_apps({resp}, nodes, hint_message);
+    generate_node_list(nodes, 2, 2);
+
+    // the apps are reported by two nodes, and merged as the responses arrive
+    recovery_collection collection;
+    for (int i = 0; i < 2; ++i) {
+        query_app_info_response resp;
+        resp.err = dsn::ERR_OK;
+        resp.apps = {apps[i], apps[2]};
+        collection.merge(nodes[i], std::move(resp), query_replica_info_response());
+    }
+    ASSERT_EQ(3, collection.apps.size());
+    ASSERT_EQ(nodes[0], collection.apps[apps[2].app_id].second);
+    svc->_state->construct_apps(collection, hint_message);
 
     meta_view mv = svc->_state->get_meta_view();
     const app_mapper &mapper = *(mv.apps);
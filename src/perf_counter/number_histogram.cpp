@@ -0,0 +1,95 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <dsn/perf_counter/number_histogram.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace dsn {
+
+const int number_histogram::SUB_BUCKET_BITS;
+const int number_histogram::SUB_BUCKET_COUNT;
+const int number_histogram::MAX_VALUE_BITS;
+const int64_t number_histogram::MAX_VALUE;
+const int number_histogram::BUCKET_COUNT;
+
+/*static*/ int64_t number_histogram::bucket_lower_bound(int index)
+{
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    int shift = index / SUB_BUCKET_COUNT - 1;
+    int sub = index % SUB_BUCKET_COUNT;
+    return static_cast<int64_t>(SUB_BUCKET_COUNT + sub) << shift;
+}
+
+/*static*/ int64_t number_histogram::bucket_upper_bound(int index)
+{
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    int shift = index / SUB_BUCKET_COUNT - 1;
+    return bucket_lower_bound(index) + ((static_cast<int64_t>(1) << shift) - 1);
+}
+
+void number_histogram::record(int64_t value, uint64_t count)
+{
+    add_bucket(bucket_index(value), count);
+}
+
+void number_histogram::add_bucket(int bucket_index, uint64_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    _counts[bucket_index] += count;
+    _total_count += count;
+    _min_index = std::min(_min_index, bucket_index);
+    _max_index = std::max(_max_index, bucket_index);
+}
+
+void number_histogram::merge(const number_histogram &other)
+{
+    if (other._total_count == 0) {
+        return;
+    }
+    for (int i = other._min_index; i <= other._max_index; ++i) {
+        _counts[i] += other._counts[i];
+    }
+    _total_count += other._total_count;
+    _min_index = std::min(_min_index, other._min_index);
+    _max_index = std::max(_max_index, other._max_index);
+}
+
+void number_histogram::clear()
+{
+    memset(_counts, 0, sizeof(_counts));
+    _total_count = 0;
+    _min_index = BUCKET_COUNT;
+    _max_index = -1;
+}
+
+int64_t number_histogram::percentile(double p) const
+{
+    if (_total_count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p * _total_count));
+    rank = std::max<uint64_t>(1, std::min(rank, _total_count));
+
+    uint64_t seen = 0;
+    for (int i = _min_index; i <= _max_index; ++i) {
+        seen += _counts[i];
+        if (seen >= rank) {
+            int64_t lower = bucket_lower_bound(i);
+            return lower + (bucket_upper_bound(i) - lower) / 2;
+        }
+    }
+    return bucket_upper_bound(_max_index);
+}
+
+} // namespace dsn
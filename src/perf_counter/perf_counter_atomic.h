@@ -2,12 +2,16 @@
 // This source code is licensed under the Apache License Version 2.0, which
 // can be found in the LICENSE file in the root directory of this source tree.
 
+#include <sched.h>
 #include <atomic>
+#include <thread>
 #include <boost/make_shared.hpp>
 #include <dsn/utility/utils.h>
 #include <dsn/utility/config_api.h>
 #include <dsn/c/api_utilities.h>
 #include <dsn/perf_counter/perf_counter.h>
+#include <dsn/perf_counter/number_histogram.h>
+#include <dsn/utility/synchronize.h>
 #include <dsn/utility/time_utils.h>
 #include "utils/shared_io_service.h"
 
@@ -18,7 +22,65 @@ namespace dsn {
 
 // -----------   NUMBER perf counter ---------------------------------
 
-#define DIVIDE_CONTAINER 107
+// The slots of a counter, one for each CPU up to MAX_SLOT_COUNT. The threads add to the slot
+// of the CPU they run on, and each slot is aligned to a whole cache line, so the updates from
+// different CPUs don't false-share. A thread may be migrated between choosing a slot and
+// updating it, which is still correct as the slots are atomic.
+//
+// A counter takes slot_count() * 64 bytes, at most 1KB.
+class per_cpu_counter_slots
+{
+public:
+    static const int CACHELINE_SIZE = 64;
+    static const int MAX_SLOT_COUNT = 16;
+
+    per_cpu_counter_slots()
+    {
+        void *mem = nullptr;
+        int err = posix_memalign(&mem, CACHELINE_SIZE, sizeof(slot) * slot_count());
+        dassert(err == 0, "posix_memalign failed, err = %d", err);
+        _slots = static_cast<slot *>(mem);
+        for (int i = 0; i < slot_count(); i++) {
+            new (&_slots[i]) slot();
+            _slots[i].value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    ~per_cpu_counter_slots() { free(_slots); }
+
+    per_cpu_counter_slots(const per_cpu_counter_slots &) = delete;
+    per_cpu_counter_slots &operator=(const per_cpu_counter_slots &) = delete;
+
+    static int slot_count()
+    {
+        static const int count = std::max(1, (int)std::thread::hardware_concurrency());
+        return count < MAX_SLOT_COUNT ? count : MAX_SLOT_COUNT;
+    }
+
+    std::atomic<int64_t> &local()
+    {
+        int cpu = sched_getcpu();
+        if (dsn_unlikely(cpu < 0)) {
+            cpu = utils::get_current_tid();
+        }
+        return _slots[cpu % slot_count()].value;
+    }
+
+    std::atomic<int64_t> &operator[](int index) { return _slots[index].value; }
+    const std::atomic<int64_t> &operator[](int index) const { return _slots[index].value; }
+
+private:
+    struct slot
+    {
+        std::atomic<int64_t> value;
+        char padding[CACHELINE_SIZE - sizeof(std::atomic<int64_t>)];
+    };
+    static_assert(sizeof(slot) == CACHELINE_SIZE, "a slot should take a whole cache line");
+
+    // allocated by posix_memalign, which aligns the slots to the cache line
+    slot *_slots;
+};
+
 class perf_counter_number_atomic : public perf_counter
 {
 public:
@@ -29,40 +91,25 @@ public:
                                const char *dsptr)
         : perf_counter(app, section, name, type, dsptr)
     {
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
-            _val[i].store(0);
-        }
     }
     ~perf_counter_number_atomic(void) {}
 
-    virtual void increment()
-    {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_add(1, std::memory_order_relaxed);
-    }
-    virtual void decrement()
-    {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_sub(1, std::memory_order_relaxed);
-    }
-    virtual void add(int64_t val)
-    {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_add(val, std::memory_order_relaxed);
-    }
+    virtual void increment() { _val.local().fetch_add(1, std::memory_order_relaxed); }
+    virtual void decrement() { _val.local().fetch_sub(1, std::memory_order_relaxed); }
+    virtual void add(int64_t val) { _val.local().fetch_add(val, std::memory_order_relaxed); }
     virtual void set(int64_t val)
     {
         // the set-op of number is reset the number to zero.
         // for simplicity, only set other zero, not add the lock to protect, if needed, should add
         // lock.
-        for (int i = 0; i < DIVIDE_CONTAINER; i++)
+        for (int i = 0; i < per_cpu_counter_slots::slot_count(); i++)
             _val[i].store(0, std::memory_order_relaxed);
         _val[0].store(val, std::memory_order_relaxed);
     }
     virtual double get_value()
     {
         double val = 0;
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
+        for (int i = 0; i < per_cpu_counter_slots::slot_count(); i++) {
             val += static_cast<double>(_val[i].load(std::memory_order_relaxed));
         }
         return val;
@@ -70,7 +117,7 @@ public:
     virtual int64_t get_integer_value()
     {
         int64_t val = 0;
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
+        for (int i = 0; i < per_cpu_counter_slots::slot_count(); i++) {
             val += _val[i].load(std::memory_order_relaxed);
         }
         return val;
@@ -82,7 +129,7 @@ public:
     }
 
 protected:
-    std::atomic<int64_t> _val[DIVIDE_CONTAINER];
+    per_cpu_counter_slots _val;
 };
 
 // -----------   VOLATILE_NUMBER perf counter ---------------------------------
@@ -100,10 +147,12 @@ public:
     }
     ~perf_counter_volatile_number_atomic(void) {}
 
+    virtual double peek_value() { return perf_counter_number_atomic::get_value(); }
+
     virtual double get_value()
     {
         double val = 0;
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
+        for (int i = 0; i < per_cpu_counter_slots::slot_count(); i++) {
             val += static_cast<double>(_val[i].exchange(0, std::memory_order_relaxed));
         }
         return val;
@@ -111,7 +160,7 @@ public:
     virtual int64_t get_integer_value()
     {
         int64_t val = 0;
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
+        for (int i = 0; i < per_cpu_counter_slots::slot_count(); i++) {
             val += _val[i].exchange(0, std::memory_order_relaxed);
         }
         return val;
@@ -128,31 +177,17 @@ public:
                              const char *name,
                              dsn_perf_counter_type_t type,
                              const char *dsptr)
-        : perf_counter(app, section, name, type, dsptr), _rate(0)
+        : perf_counter(app, section, name, type, dsptr), _rate(0), _last_total(0)
     {
         _last_time = utils::get_current_physical_time_ns();
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
-            _val[i].store(0, std::memory_order_relaxed);
-        }
     }
     ~perf_counter_rate_atomic(void) {}
 
-    virtual void increment()
-    {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_add(1, std::memory_order_relaxed);
-    }
-    virtual void decrement()
-    {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_sub(1, std::memory_order_relaxed);
-    }
-    virtual void add(int64_t val)
-    {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_add(val, std::memory_order_relaxed);
-    }
+    virtual void increment() { _val.local().fetch_add(1, std::memory_order_relaxed); }
+    virtual void decrement() { _val.local().fetch_sub(1, std::memory_order_relaxed); }
+    virtual void add(int64_t val) { _val.local().fetch_add(val, std::memory_order_relaxed); }
     virtual void set(int64_t val) { dassert(false, "invalid execution flow"); }
+    // the slots are never reset, the rate is computed from the total of the last call
     virtual double get_value()
     {
         uint64_t now = utils::get_current_physical_time_ns();
@@ -160,15 +195,25 @@ public:
         if (interval <= 0.1)
             return _rate;
 
-        double val = 0;
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
-            val += _val[i].fetch_and(0, std::memory_order_relaxed);
-        }
-
-        _rate = val / interval;
+        int64_t total = sum_slots();
+        _rate = (total - _last_total.exchange(total)) / interval;
         _last_time = now;
         return _rate;
     }
+    // the rate since the last get_value(), without updating the state of get_value()
+    virtual double peek_value()
+    {
+        uint64_t now = utils::get_current_physical_time_ns();
+        double interval = (now - _last_time) / 1e9;
+        if (interval <= 0.1)
+            return _rate;
+        return (sum_slots() - _last_total.load()) / interval;
+    }
+    virtual bool get_total(/*out*/ int64_t &total) const override
+    {
+        total = sum_slots();
+        return true;
+    }
     virtual int64_t get_integer_value() { return (int64_t)get_value(); }
     virtual double get_percentile(dsn_perf_counter_percentile_type_t type)
     {
@@ -177,9 +222,19 @@ public:
     }
 
 private:
+    int64_t sum_slots() const
+    {
+        int64_t total = 0;
+        for (int i = 0; i < per_cpu_counter_slots::slot_count(); i++) {
+            total += _val[i].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
     std::atomic<double> _rate;
     std::atomic<uint64_t> _last_time;
-    std::atomic<int64_t> _val[DIVIDE_CONTAINER];
+    std::atomic<int64_t> _last_total;
+    per_cpu_counter_slots _val;
 };
 
 // -----------   NUMBER_PERCENTILE perf counter ---------------------------------
@@ -198,7 +253,7 @@ public:
                                           const char *name,
                                           dsn_perf_counter_type_t type,
                                           const char *dsptr)
-        : perf_counter(app, section, name, type, dsptr), _tail(0)
+        : perf_counter(app, section, name, type, dsptr), _tail(0), _sum(0)
     {
         _results[COUNTER_PERCENTILE_50] = 0;
         _results[COUNTER_PERCENTILE_90] = 0;
@@ -228,6 +283,7 @@ public:
     {
         uint64_t idx = _tail.fetch_add(1, std::memory_order_relaxed);
         _samples[idx % MAX_QUEUE_LENGTH] = val;
+        _sum.fetch_add(val, std::memory_order_relaxed);
     }
 
     virtual double get_value()
@@ -276,6 +332,13 @@ public:
         return _samples[idx];
     }
 
+    virtual bool get_samples_total(/*out*/ uint64_t &count, /*out*/ int64_t &sum) const override
+    {
+        count = _tail.load(std::memory_order_relaxed);
+        sum = _sum.load(std::memory_order_relaxed);
+        return true;
+    }
+
 private:
     struct compute_context
     {
@@ -431,10 +494,215 @@ private:
 
     std::shared_ptr<boost::asio::deadline_timer> _timer;
     std::atomic<uint64_t> _tail; // should use unsigned int to avoid out of bound
+    std::atomic<int64_t> _sum;
     int64_t _samples[MAX_QUEUE_LENGTH];
     int64_t _results[COUNTER_PERCENTILE_COUNT];
     int _counter_computation_interval_seconds;
 };
 
+// -----------   NUMBER_PERCENTILE perf counter by histogram ---------------------------------
+
+// Another implementation of COUNTER_TYPE_NUMBER_PERCENTILES, chosen by
+// [components.pegasus_perf_counter_number_percentile_atomic] use_histogram.
+//
+// The samples are recorded into a number_histogram by an atomic increment of the shard of the
+// CPU the recording thread runs on, like per_cpu_counter_slots, so the threads on different
+// CPUs never contend with each other. The percentiles are
+// computed from all of the samples recorded in the last computation interval rather than the
+// latest MAX_QUEUE_LENGTH ones, and the histogram of the interval can be merged with the ones
+// of other counters by get_histogram().
+//
+// A shard takes BUCKET_COUNT * 8 bytes (about 4.8KB), and is allocated on the first sample
+// recorded on its CPU, so a counter takes at most per_cpu_counter_slots::slot_count() shards.
+// The shards are freed with the counter.
+class perf_counter_number_histogram_atomic : public perf_counter
+{
+public:
+    perf_counter_number_histogram_atomic(const char *app,
+                                         const char *section,
+                                         const char *name,
+                                         dsn_perf_counter_type_t type,
+                                         const char *dsptr)
+        : perf_counter(app, section, name, type, dsptr), _latest_sample(0)
+    {
+        for (int i = 0; i < per_cpu_counter_slots::MAX_SLOT_COUNT; i++) {
+            _shards[i].store(nullptr, std::memory_order_relaxed);
+        }
+        for (int i = 0; i < COUNTER_PERCENTILE_COUNT; i++) {
+            _results[i].store(0, std::memory_order_relaxed);
+        }
+
+        _counter_computation_interval_seconds = (int)dsn_config_get_value_uint64(
+            "components.pegasus_perf_counter_number_percentile_atomic",
+            "counter_computation_interval_seconds",
+            10,
+            "period (seconds) the system computes the percentiles of the "
+            "pegasus_perf_counter_number_percentile_atomic counters");
+        _timer.reset(new boost::asio::deadline_timer(tools::shared_io_service::instance().ios));
+        _timer->expires_from_now(
+            boost::posix_time::seconds(rand() % _counter_computation_interval_seconds + 1));
+        _timer->async_wait(std::bind(&perf_counter_number_histogram_atomic::on_timer,
+                                     this,
+                                     _timer,
+                                     std::placeholders::_1));
+    }
+
+    ~perf_counter_number_histogram_atomic(void)
+    {
+        _timer->cancel();
+        for (int i = 0; i < per_cpu_counter_slots::MAX_SLOT_COUNT; i++) {
+            delete _shards[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    virtual void increment() { dassert(false, "invalid execution flow"); }
+    virtual void decrement() { dassert(false, "invalid execution flow"); }
+    virtual void add(int64_t val) { dassert(false, "invalid execution flow"); }
+    virtual void set(int64_t val)
+    {
+        shard *s = get_shard();
+        s->buckets[number_histogram::bucket_index(val)].fetch_add(1, std::memory_order_relaxed);
+        s->count.fetch_add(1, std::memory_order_relaxed);
+        s->sum.fetch_add(val, std::memory_order_relaxed);
+        _latest_sample.store(val, std::memory_order_relaxed);
+    }
+
+    virtual double get_value()
+    {
+        dassert(false, "invalid execution flow");
+        return 0.0;
+    }
+    virtual int64_t get_integer_value() { return (int64_t)get_value(); }
+
+    virtual double get_percentile(dsn_perf_counter_percentile_type_t type)
+    {
+        if ((type < 0) || (type >= COUNTER_PERCENTILE_COUNT)) {
+            dassert(false, "send a wrong counter percentile type");
+            return 0.0;
+        }
+        return (double)_results[type].load(std::memory_order_relaxed);
+    }
+
+    // the raw samples are not kept
+    virtual int64_t get_latest_sample() const override
+    {
+        return _latest_sample.load(std::memory_order_relaxed);
+    }
+
+    virtual bool get_histogram(/*out*/ number_histogram &hist) const override
+    {
+        utils::auto_lock<utils::ex_lock_nr> l(_window_lock);
+        hist = _last_window;
+        return true;
+    }
+
+    virtual bool get_samples_total(/*out*/ uint64_t &count, /*out*/ int64_t &sum) const override
+    {
+        count = 0;
+        sum = 0;
+        for (int i = 0; i < per_cpu_counter_slots::slot_count(); i++) {
+            shard *s = _shards[i].load(std::memory_order_acquire);
+            if (s != nullptr) {
+                count += s->count.load(std::memory_order_relaxed);
+                sum += s->sum.load(std::memory_order_relaxed);
+            }
+        }
+        return true;
+    }
+
+    // collect the samples recorded since the last call, and compute the percentiles of them.
+    // called by the timer periodically.
+    void calc()
+    {
+        number_histogram window;
+        for (int i = 0; i < per_cpu_counter_slots::slot_count(); i++) {
+            shard *s = _shards[i].load(std::memory_order_acquire);
+            if (s == nullptr) {
+                continue;
+            }
+            for (int j = 0; j < number_histogram::BUCKET_COUNT; j++) {
+                if (s->buckets[j].load(std::memory_order_relaxed) != 0) {
+                    window.add_bucket(j, s->buckets[j].exchange(0, std::memory_order_relaxed));
+                }
+            }
+        }
+
+        // keep the last results if there's no sample in the interval
+        if (window.count() != 0) {
+            static const double percentiles[COUNTER_PERCENTILE_COUNT] = {
+                0.5, 0.9, 0.95, 0.99, 0.999};
+            for (int i = 0; i < COUNTER_PERCENTILE_COUNT; i++) {
+                _results[i].store(window.percentile(percentiles[i]), std::memory_order_relaxed);
+            }
+        }
+
+        utils::auto_lock<utils::ex_lock_nr> l(_window_lock);
+        _last_window = window;
+    }
+
+private:
+    struct shard
+    {
+        shard() : count(0), sum(0)
+        {
+            for (int i = 0; i < number_histogram::BUCKET_COUNT; i++) {
+                buckets[i].store(0, std::memory_order_relaxed);
+            }
+        }
+        // reset by calc()
+        std::atomic<uint64_t> buckets[number_histogram::BUCKET_COUNT];
+        // cumulative since the counter is created
+        std::atomic<uint64_t> count;
+        std::atomic<int64_t> sum;
+    };
+
+    shard *get_shard()
+    {
+        int cpu = sched_getcpu();
+        if (dsn_unlikely(cpu < 0)) {
+            cpu = utils::get_current_tid();
+        }
+        std::atomic<shard *> &slot = _shards[cpu % per_cpu_counter_slots::slot_count()];
+        shard *s = slot.load(std::memory_order_acquire);
+        if (dsn_unlikely(s == nullptr)) {
+            // the threads on the same CPU may race to allocate it, only one of them wins
+            shard *created = new shard();
+            if (slot.compare_exchange_strong(s, created, std::memory_order_acq_rel)) {
+                s = created;
+            } else {
+                delete created;
+            }
+        }
+        return s;
+    }
+
+    void on_timer(std::shared_ptr<boost::asio::deadline_timer> timer,
+                  const boost::system::error_code &ec)
+    {
+        if (!ec) {
+            calc();
+
+            timer->expires_from_now(
+                boost::posix_time::seconds(_counter_computation_interval_seconds));
+            timer->async_wait(std::bind(&perf_counter_number_histogram_atomic::on_timer,
+                                        this,
+                                        timer,
+                                        std::placeholders::_1));
+        } else if (boost::system::errc::operation_canceled != ec) {
+            dassert(false, "on_timer error!!!");
+        }
+    }
+
+    std::shared_ptr<boost::asio::deadline_timer> _timer;
+    // the first slot_count() of them are used
+    std::atomic<shard *> _shards[per_cpu_counter_slots::MAX_SLOT_COUNT];
+    std::atomic<int64_t> _latest_sample;
+    std::atomic<int64_t> _results[COUNTER_PERCENTILE_COUNT];
+    int _counter_computation_interval_seconds;
+
+    mutable utils::ex_lock_nr _window_lock;
+    number_histogram _last_window;
+};
+
 #pragma pack(pop)
 } // namespace
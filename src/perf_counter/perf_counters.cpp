@@ -35,6 +35,7 @@
 
 #include <dsn/tool-api/command_manager.h>
 #include <dsn/tool-api/task.h>
+#include <dsn/utility/flags.h>
 #include <dsn/utility/string_view.h>
 #include <dsn/utility/time_utils.h>
 
@@ -44,6 +45,12 @@
 
 namespace dsn {
 
+DSN_DEFINE_bool("components.pegasus_perf_counter_number_percentile_atomic",
+                use_histogram,
+                false,
+                "whether to compute the percentiles by histograms of all the samples in the "
+                "computation interval, rather than the latest samples");
+
 perf_counters::perf_counters()
 {
     command_manager::instance().register_command(
@@ -182,8 +189,11 @@ perf_counter *perf_counters::new_counter(const char *app,
         return new perf_counter_volatile_number_atomic(app, section, name, type, dsptr);
     else if (type == dsn_perf_counter_type_t::COUNTER_TYPE_RATE)
         return new perf_counter_rate_atomic(app, section, name, type, dsptr);
-    else if (type == dsn_perf_counter_type_t::COUNTER_TYPE_NUMBER_PERCENTILES)
+    else if (type == dsn_perf_counter_type_t::COUNTER_TYPE_NUMBER_PERCENTILES) {
+        if (FLAGS_use_histogram)
+            return new perf_counter_number_histogram_atomic(app, section, name, type, dsptr);
         return new perf_counter_number_percentile_atomic(app, section, name, type, dsptr);
+    }
     else {
         dassert(false, "invalid type(%d)", type);
         return nullptr;
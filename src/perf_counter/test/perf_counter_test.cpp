@@ -36,8 +36,10 @@
 #include <dsn/tool_api.h>
 #include <gtest/gtest.h>
 #include <thread>
+#include <algorithm>
 #include <cmath>
 #include <vector>
+#include <dsn/perf_counter/number_histogram.h>
 
 #include "perf_counter/perf_counter_atomic.h"
 
@@ -169,3 +171,158 @@ TEST(perf_counter, print_type)
         dsn_percentile_type_from_string(dsn_percentile_type_to_string(COUNTER_PERCENTILE_999)));
     ASSERT_EQ(COUNTER_PERCENTILE_INVALID, dsn_percentile_type_from_string("afafda"));
 }
+
+TEST(perf_counter, number_histogram)
+{
+    // every value is in its bucket, and the buckets are continuous
+    for (int i = 0; i + 1 < number_histogram::BUCKET_COUNT; ++i) {
+        ASSERT_EQ(number_histogram::bucket_upper_bound(i) + 1,
+                  number_histogram::bucket_lower_bound(i + 1));
+        ASSERT_EQ(i, number_histogram::bucket_index(number_histogram::bucket_lower_bound(i)));
+        ASSERT_EQ(i, number_histogram::bucket_index(number_histogram::bucket_upper_bound(i)));
+    }
+    ASSERT_EQ(0, number_histogram::bucket_index(-1));
+    ASSERT_EQ(number_histogram::MAX_VALUE,
+              number_histogram::bucket_upper_bound(number_histogram::BUCKET_COUNT - 1));
+    // the values above MAX_VALUE are in the last bucket
+    ASSERT_EQ(number_histogram::BUCKET_COUNT - 1, number_histogram::bucket_index(INT64_MAX));
+
+    number_histogram hist;
+    ASSERT_EQ(0, hist.percentile(0.99));
+
+    std::vector<int64_t> samples;
+    number_histogram hist1, hist2;
+    for (int i = 0; i < 100000; ++i) {
+        int64_t value = rand() % 1000000000;
+        samples.push_back(value);
+        hist.record(value);
+        (i % 2 == 0 ? hist1 : hist2).record(value);
+    }
+    hist1.merge(hist2);
+    ASSERT_EQ(samples.size(), hist1.count());
+
+    std::sort(samples.begin(), samples.end());
+    for (double p : {0.5, 0.9, 0.95, 0.99, 0.999}) {
+        int64_t expected = samples[(size_t)std::ceil(p * samples.size()) - 1];
+        ASSERT_NEAR(expected, hist.percentile(p), expected / 16.0);
+        ASSERT_EQ(hist.percentile(p), hist1.percentile(p));
+    }
+}
+
+TEST(perf_counter, perf_counter_number_histogram_atomic)
+{
+    ref_ptr<perf_counter_number_histogram_atomic> counter =
+        new perf_counter_number_histogram_atomic(
+            "", "", "", dsn_perf_counter_type_t::COUNTER_TYPE_NUMBER_PERCENTILES, "");
+
+    // 10 threads record 0..99999 in total
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 10; ++t) {
+        threads.emplace_back([counter, t]() {
+            for (int i = t; i < 100000; i += 10) {
+                counter->set(i);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    counter->calc();
+
+    number_histogram hist;
+    ASSERT_TRUE(counter->get_histogram(hist));
+    ASSERT_EQ(100000, hist.count());
+    ASSERT_NEAR(50000, counter->get_percentile(COUNTER_PERCENTILE_50), 50000 / 16.0);
+    ASSERT_NEAR(99000, counter->get_percentile(COUNTER_PERCENTILE_99), 99000 / 16.0);
+    ASSERT_NEAR(99900, counter->get_percentile(COUNTER_PERCENTILE_999), 99900 / 16.0);
+
+    // the percentiles are kept when there's no sample in the interval
+    counter->calc();
+    ASSERT_TRUE(counter->get_histogram(hist));
+    ASSERT_EQ(0, hist.count());
+    ASSERT_NEAR(99000, counter->get_percentile(COUNTER_PERCENTILE_99), 99000 / 16.0);
+}
+
+// the previous implementation of NUMBER counter: 107 packed slots chosen by thread id
+class tid_sharded_number_counter
+{
+public:
+    tid_sharded_number_counter()
+    {
+        for (int i = 0; i < 107; i++) {
+            _val[i].store(0);
+        }
+    }
+    void increment()
+    {
+        uint64_t task_id = static_cast<int>(utils::get_current_tid());
+        _val[task_id % 107].fetch_add(1, std::memory_order_relaxed);
+    }
+    int64_t get_integer_value()
+    {
+        int64_t val = 0;
+        for (int i = 0; i < 107; i++) {
+            val += _val[i].load(std::memory_order_relaxed);
+        }
+        return val;
+    }
+
+private:
+    std::atomic<int64_t> _val[107];
+};
+
+// return increments per second of all the threads
+template <typename TCounter>
+static double increment_throughput(TCounter &counter, int thread_count, int count)
+{
+    uint64_t start_ns = dsn_now_ns();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&counter, count]() {
+            for (int i = 0; i < count; ++i) {
+                counter.increment();
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    double qps = thread_count * count * 1e9 / (dsn_now_ns() - start_ns);
+    EXPECT_EQ((int64_t)thread_count * count, counter.get_integer_value());
+    return qps;
+}
+
+TEST(perf_counter, per_cpu_counter_slots)
+{
+    const int max_slot_count = per_cpu_counter_slots::MAX_SLOT_COUNT;
+    const uintptr_t cacheline_size = per_cpu_counter_slots::CACHELINE_SIZE;
+    per_cpu_counter_slots slots;
+    ASSERT_GE(per_cpu_counter_slots::slot_count(), 1);
+    ASSERT_LE(per_cpu_counter_slots::slot_count(), max_slot_count);
+    // every slot is on its own cache line
+    for (int i = 0; i < per_cpu_counter_slots::slot_count(); i++) {
+        ASSERT_EQ(0, reinterpret_cast<uintptr_t>(&slots[i]) % cacheline_size);
+        ASSERT_EQ(0, slots[i].load());
+    }
+
+    perf_counter_number_atomic counter(
+        "", "", "", dsn_perf_counter_type_t::COUNTER_TYPE_NUMBER, "");
+    increment_throughput(counter, 8, 10000);
+    counter.set(5);
+    ASSERT_EQ(5, counter.get_integer_value());
+}
+
+// a benchmark rather than a test, run it by --gtest_also_run_disabled_tests
+TEST(perf_counter, DISABLED_number_atomic_benchmark)
+{
+    const int count = 1000000;
+    for (int thread_count : {1, 2, 4, 8, 16, 32}) {
+        tid_sharded_number_counter old_counter;
+        perf_counter_number_atomic new_counter(
+            "", "", "", dsn_perf_counter_type_t::COUNTER_TYPE_NUMBER, "");
+        double old_qps = increment_throughput(old_counter, thread_count, count);
+        double new_qps = increment_throughput(new_counter, thread_count, count);
+        std::cout << "threads: " << thread_count << ", slots by thread id: " << old_qps / 1e6
+                  << " M/s, padded slots by cpu: " << new_qps / 1e6 << " M/s" << std::endl;
+    }
+}
@@ -22,10 +22,17 @@
 #include "block_service/block_service_manager.h"
 
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
 
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_bool("replication",
+                cold_backup_share_sst_files,
+                true,
+                "whether to keep the sst files of the cold backups in the shared files of the "
+                "app, so that an sst file unchanged since the last backup isn't uploaded again");
+
 const char *cold_backup_status_to_string(cold_backup_status status)
 {
     switch (status) {
@@ -622,6 +629,10 @@ void cold_backup_context::prepare_upload()
         f_meta.md5 = file_md5;
         f_meta.size = file_size;
         _metadata.files.emplace_back(f_meta);
+        if (FLAGS_cold_backup_share_sst_files && cold_backup::is_shared_file(file)) {
+            _metadata.shared_files.emplace_back(file);
+            _shared_files.insert(file);
+        }
         _file_status.insert(std::make_pair(file, FileUploadUncomplete));
         _file_infos.insert(std::make_pair(file, std::make_pair(file_size, file_md5)));
     }
@@ -630,10 +641,24 @@ void cold_backup_context::prepare_upload()
 
 void cold_backup_context::upload_file(const std::string &local_filename)
 {
-    std::string remote_chkpt_dir = cold_backup::get_remote_chkpt_dir(
-        backup_root, request.policy.policy_name, request.app_name, request.pid, request.backup_id);
     dist::block_service::create_file_request req;
-    req.file_name = ::dsn::utils::filesystem::path_combine(remote_chkpt_dir, local_filename);
+    // a shared file is uploaded to the pool named by its content, so it's skipped below if
+    // uploaded by any backup before
+    bool shared = _shared_files.count(local_filename) > 0;
+    if (shared) {
+        std::string shared_files_path = cold_backup::get_shared_files_path(
+            backup_root, request.policy.policy_name, request.app_name, request.pid.get_app_id());
+        const auto &info = _file_infos.at(local_filename);
+        req.file_name = ::dsn::utils::filesystem::path_combine(
+            shared_files_path, cold_backup::get_shared_file_name(info.second, info.first));
+    } else {
+        std::string remote_chkpt_dir = cold_backup::get_remote_chkpt_dir(backup_root,
+                                                                         request.policy.policy_name,
+                                                                         request.app_name,
+                                                                         request.pid,
+                                                                         request.backup_id);
+        req.file_name = ::dsn::utils::filesystem::path_combine(remote_chkpt_dir, local_filename);
+    }
     req.ignore_metadata = false;
 
     add_ref();
@@ -641,7 +666,7 @@ void cold_backup_context::upload_file(const std::string &local_filename)
     block_service->create_file(
         std::move(req),
         LPC_BACKGROUND_COLD_BACKUP,
-        [this, local_filename](const dist::block_service::create_file_response &resp) {
+        [this, local_filename, shared](const dist::block_service::create_file_response &resp) {
             if (resp.err == ERR_OK) {
                 const dist::block_service::block_file_ptr &file_handle = resp.file_handle;
                 dassert(file_handle != nullptr, "");
@@ -651,9 +676,14 @@ void cold_backup_context::upload_file(const std::string &local_filename)
                     ::dsn::utils::filesystem::path_combine(checkpoint_dir, local_filename);
                 if (md5 == file_handle->get_md5sum() &&
                     local_file_size == file_handle->get_size()) {
-                    ddebug("%s: checkpoint file already exist on remote, file = %s",
+                    ddebug("%s: checkpoint file already exist on remote, file = %s, shared = %s",
                            name,
-                           full_path_local_file.c_str());
+                           full_path_local_file.c_str(),
+                           shared ? "true" : "false");
+                    if (shared && _owner_replica != nullptr) {
+                        _owner_replica->get_replica_stub()
+                            ->_counter_cold_backup_recent_reuse_file_size->add(local_file_size);
+                    }
                     on_upload_file_complete(local_filename);
                 } else {
                     ddebug("%s: start upload checkpoint file to remote, file = %s",
@@ -715,66 +745,82 @@ void cold_backup_context::upload_file(const std::string &local_filename)
 void cold_backup_context::on_upload(const dist::block_service::block_file_ptr &file_handle,
                                     const std::string &full_path_local_file)
 {
-    dist::block_service::upload_request req;
-    req.input_local_name = full_path_local_file;
-
     add_ref();
 
-    file_handle->upload(
-        std::move(req),
-        LPC_BACKGROUND_COLD_BACKUP,
-        [this, file_handle, full_path_local_file](
-            const dist::block_service::upload_response &resp) {
-            if (resp.err == ERR_OK) {
-                std::string local_filename =
-                    ::dsn::utils::filesystem::get_file_name(full_path_local_file);
-                dassert(_file_infos.at(local_filename).first ==
-                            static_cast<int64_t>(resp.uploaded_size),
-                        "");
-                ddebug("%s: upload checkpoint file complete, file = %s",
-                       name,
-                       full_path_local_file.c_str());
-                on_upload_file_complete(local_filename);
-            } else if (resp.err == ERR_TIMEOUT) {
-                derror("%s: upload checkpoint file timeout, retry after 10s, file = %s",
-                       name,
-                       full_path_local_file.c_str());
-                add_ref();
+    auto on_uploaded = [this, file_handle, full_path_local_file](
+        const dist::block_service::upload_response &resp) {
+        if (resp.err == ERR_OK) {
+            std::string local_filename =
+                ::dsn::utils::filesystem::get_file_name(full_path_local_file);
+            dassert(_file_infos.at(local_filename).first ==
+                        static_cast<int64_t>(resp.uploaded_size),
+                    "");
+            ddebug("%s: upload checkpoint file complete, file = %s",
+                   name,
+                   full_path_local_file.c_str());
+            on_upload_file_complete(local_filename);
+        } else if (resp.err == ERR_TIMEOUT) {
+            derror("%s: upload checkpoint file timeout, retry after 10s, file = %s",
+                   name,
+                   full_path_local_file.c_str());
+            add_ref();
+
+            tasking::enqueue(LPC_BACKGROUND_COLD_BACKUP,
+                             nullptr,
+                             [this, file_handle, full_path_local_file]() {
+                                 if (!is_ready_for_upload()) {
+                                     derror("%s: backup status has changed to %s, stop upload "
+                                            "checkpoint file to remote, file = %s",
+                                            name,
+                                            cold_backup_status_to_string(status()),
+                                            full_path_local_file.c_str());
+                                     std::string local_filename =
+                                         ::dsn::utils::filesystem::get_file_name(
+                                             full_path_local_file);
+                                     file_upload_uncomplete(local_filename);
+                                 } else {
+                                     on_upload(file_handle, full_path_local_file);
+                                 }
+                                 release_ref();
+                             },
+                             0,
+                             std::chrono::seconds(10));
+        } else {
+            derror("%s: upload checkpoint file to remote failed, file = %s, err = %s",
+                   name,
+                   full_path_local_file.c_str(),
+                   resp.err.to_string());
+            fail_upload("upload checkpoint file to remote failed");
+        }
+        if (resp.err != ERR_OK && _owner_replica != nullptr) {
+            _owner_replica->get_replica_stub()
+                ->_counter_cold_backup_recent_upload_file_fail_count->increment();
+        }
+        release_ref();
+        return;
+    };
 
-                tasking::enqueue(LPC_BACKGROUND_COLD_BACKUP,
-                                 nullptr,
-                                 [this, file_handle, full_path_local_file]() {
-                                     if (!is_ready_for_upload()) {
-                                         derror("%s: backup status has changed to %s, stop upload "
-                                                "checkpoint file to remote, file = %s",
-                                                name,
-                                                cold_backup_status_to_string(status()),
-                                                full_path_local_file.c_str());
-                                         std::string local_filename =
-                                             ::dsn::utils::filesystem::get_file_name(
-                                                 full_path_local_file);
-                                         file_upload_uncomplete(local_filename);
-                                     } else {
-                                         on_upload(file_handle, full_path_local_file);
-                                     }
-                                     release_ref();
-                                 },
-                                 0,
-                                 std::chrono::seconds(10));
-            } else {
-                derror("%s: upload checkpoint file to remote failed, file = %s, err = %s",
-                       name,
-                       full_path_local_file.c_str(),
-                       resp.err.to_string());
-                fail_upload("upload checkpoint file to remote failed");
-            }
-            if (resp.err != ERR_OK && _owner_replica != nullptr) {
-                _owner_replica->get_replica_stub()
-                    ->_counter_cold_backup_recent_upload_file_fail_count->increment();
-            }
-            release_ref();
-            return;
-        });
+    if (_owner_replica == nullptr) {
+        dist::block_service::upload_request req;
+        req.input_local_name = full_path_local_file;
+        file_handle->upload(req, LPC_BACKGROUND_COLD_BACKUP, on_uploaded);
+        return;
+    }
+
+    // upload in parts under the transfer budget shared with restore and bulk load
+    dist::block_service::block_file_transfer_ptr transfer =
+        new dist::block_service::block_file_transfer(
+            dist::block_service::block_file_transfer::direction::UPLOAD,
+            file_handle,
+            full_path_local_file,
+            _owner_replica->get_replica_stub()->_block_service_manager.get_transfer_budget(),
+            nullptr,
+            [on_uploaded](error_code err, uint64_t uploaded_size, const std::string &) {
+                tasking::enqueue(LPC_BACKGROUND_COLD_BACKUP, nullptr, [=]() {
+                    on_uploaded(dist::block_service::upload_response{err, uploaded_size});
+                });
+            });
+    transfer->start();
 }
 
 void cold_backup_context::write_backup_metadata()
@@ -856,7 +902,9 @@ void cold_backup_context::write_current_chkpt_file(const std::string &value)
     // _file_status and _file_infos, because even if write current checkpoint file failed, the
     // backup_metadata is uploading succeed, so we will not re-upload
     _metadata.files.clear();
+    _metadata.shared_files.clear();
     _file_infos.clear();
+    _shared_files.clear();
     _file_status.clear();
 
     if (!is_ready_for_upload()) {
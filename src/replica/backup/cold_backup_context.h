@@ -71,15 +71,6 @@ enum cold_backup_status
 };
 const char *cold_backup_status_to_string(cold_backup_status status);
 
-struct cold_backup_metadata
-{
-    int64_t checkpoint_decree;
-    int64_t checkpoint_timestamp;
-    std::vector<file_meta> files;
-    int64_t checkpoint_total_size;
-    DEFINE_JSON_SERIALIZATION(checkpoint_decree, checkpoint_timestamp, files, checkpoint_total_size)
-};
-
 //
 // the process of uploading the checkpoint directory to block filesystem:
 //      1, upload all the file of the checkpoint to block filesystem
@@ -357,6 +348,8 @@ private:
     int32_t _max_concurrent_uploading_file_cnt;
     // filename -> <filesize, md5>
     std::map<std::string, std::pair<int64_t, std::string>> _file_infos;
+    // the files uploaded to the shared files of the app
+    std::set<std::string> _shared_files;
 
     zlock _lock; // lock the structure below
     std::map<std::string, file_status> _file_status;
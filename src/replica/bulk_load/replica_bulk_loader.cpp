@@ -386,8 +386,9 @@ error_code replica_bulk_loader::download_sst_files(const std::string &app_name,
 
     // download metadata file synchronously
     uint64_t file_size = 0;
+    std::string file_md5;
     error_code err = _stub->_block_service_manager.download_file(
-        remote_dir, local_dir, bulk_load_constant::BULK_LOAD_METADATA, fs, file_size);
+        remote_dir, local_dir, bulk_load_constant::BULK_LOAD_METADATA, fs, file_size, file_md5);
     if (err != ERR_OK) {
         derror_replica("download bulk load metadata file failed, error = {}", err.to_string());
         return err;
@@ -407,12 +408,18 @@ error_code replica_bulk_loader::download_sst_files(const std::string &app_name,
         auto bulk_load_download_task = tasking::enqueue(
             LPC_BACKGROUND_BULK_LOAD, tracker(), [this, remote_dir, local_dir, f_meta, fs]() {
                 uint64_t f_size = 0;
+                std::string f_md5;
                 error_code ec = _stub->_block_service_manager.download_file(
-                    remote_dir, local_dir, f_meta.name, fs, f_size);
-                const std::string &file_name =
-                    utils::filesystem::path_combine(local_dir, f_meta.name);
-                if (ec == ERR_OK &&
-                    !utils::filesystem::verify_file(file_name, f_meta.md5, f_meta.size)) {
+                    remote_dir, local_dir, f_meta.name, fs, f_size, f_md5);
+                // verify with the size and md5 returned by the download, rather than reading
+                // the file again
+                if (ec == ERR_OK && (f_size != f_meta.size || f_md5 != f_meta.md5)) {
+                    derror_replica("file({}) is damaged, size: {} VS {}, md5: {} VS {}",
+                                   f_meta.name,
+                                   f_size,
+                                   f_meta.size,
+                                   f_md5,
+                                   f_meta.md5);
                     ec = ERR_CORRUPTION;
                 }
                 if (ec != ERR_OK) {
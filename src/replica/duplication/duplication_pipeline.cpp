@@ -4,6 +4,7 @@
 
 #include <dsn/dist/replication/replication_app_base.h>
 #include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/flags.h>
 
 #include "replica/replica_stub.h"
 #include "duplication_pipeline.h"
@@ -12,6 +13,22 @@
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_uint32("replication",
+                  dup_max_inflight_batches,
+                  1,
+                  "the max number of batches each duplication ships concurrently, only for the "
+                  "mutation_duplicator which allows concurrent batches, see "
+                  "mutation_duplicator::duplicate()");
+DSN_DEFINE_validator(dup_max_inflight_batches, [](uint32_t value) { return value > 0; });
+DSN_DEFINE_uint32("replication",
+                  dup_min_batch_bytes,
+                  64 * 1024,
+                  "the min size of a batch of mutations shipped by duplication");
+DSN_DEFINE_uint32("replication",
+                  dup_max_batch_bytes,
+                  1024 * 1024,
+                  "the max size of a batch of mutations shipped by duplication");
+
 //                     //
 // mutation_duplicator //
 //                     //
@@ -26,7 +43,9 @@ namespace replication {
 
 void load_mutation::run()
 {
-    decree last_decree = _duplicator->progress().last_decree;
+    // the mutations that are loaded but not shipped yet are held by ship_mutation
+    decree last_decree =
+        std::max(_duplicator->progress().last_decree, _duplicator->_ship->last_loaded_decree());
     _start_decree = last_decree + 1;
     if (_replica->private_log()->max_commit_on_disk() < _start_decree) {
         // wait 100ms for next try if no mutation was added.
@@ -51,44 +70,142 @@ load_mutation::load_mutation(replica_duplicator *duplicator,
 // ship_mutation //
 //               //
 
-void ship_mutation::ship(mutation_tuple_set &&in)
+void ship_mutation::ship()
 {
-    _mutation_duplicator->duplicate(std::move(in), [this](size_t total_shipped_size) mutable {
-        update_progress();
-        _counter_dup_shipped_bytes_rate->add(total_shipped_size);
-        step_down_next_stage();
-    });
+    if (!_has_pending || _inflight_count >= max_inflight_batches()) {
+        return;
+    }
+    bool caught_up = _last_decree >= _replica->private_log()->max_commit_on_disk();
+    if (_pending_bytes < _batch_bytes && !caught_up) {
+        // wait for more mutations to be loaded
+        return;
+    }
+
+    shipping_batch batch{_next_batch_id++, _last_decree, _pending_bytes, dsn_now_ms(), false};
+    mutation_tuple_set mutations = std::move(_pending);
+    _pending.clear();
+    _pending_bytes = 0;
+    _has_pending = false;
+
+    if (mutations.empty()) {
+        // all of the loaded mutations are WRITE_EMPTY
+        if (_batches.empty()) {
+            update_progress(batch.last_decree);
+        } else {
+            batch.shipped = true;
+            _batches.push_back(batch);
+        }
+        return;
+    }
+
+    _batches.push_back(batch);
+    _inflight_count++;
+    _counter_dup_inflight_batches->increment();
+    _mutation_duplicator->duplicate(
+        std::move(mutations), [ this, id = batch.id ](size_t total_shipped_size) {
+            // the callback may be called in any thread
+            schedule(
+                [this, id, total_shipped_size]() { on_batch_shipped(id, total_shipped_size); });
+        });
 }
 
 void ship_mutation::run(decree &&last_decree, mutation_tuple_set &&in)
 {
     _last_decree = last_decree;
 
-    if (in.empty()) {
-        update_progress();
+    for (const mutation_tuple &mut : in) {
+        _pending_bytes += std::get<2>(mut).length();
+    }
+    if (_pending.empty()) {
+        _pending = std::move(in);
+    } else {
+        _pending.insert(in.begin(), in.end());
+    }
+    // update the progress even for an empty batch
+    _has_pending = true;
+
+    ship();
+
+    if (_inflight_count < max_inflight_batches()) {
+        step_down_next_stage();
+    } else {
+        // continue loading once a batch is shipped
+        _waiting_for_window = true;
+    }
+}
+
+void ship_mutation::on_batch_shipped(uint64_t id, size_t total_shipped_size)
+{
+    _counter_dup_shipped_bytes_rate->add(total_shipped_size);
+    _counter_dup_inflight_batches->decrement();
+    _inflight_count--;
+
+    for (shipping_batch &batch : _batches) {
+        if (batch.id == id) {
+            batch.shipped = true;
+            update_batch_bytes(batch);
+            break;
+        }
+    }
+
+    // the progress moves forward only when all the preceding batches are shipped
+    decree shipped_decree = invalid_decree;
+    while (!_batches.empty() && _batches.front().shipped) {
+        shipped_decree = _batches.front().last_decree;
+        _batches.pop_front();
+    }
+    if (shipped_decree != invalid_decree) {
+        update_progress(shipped_decree);
+    }
+
+    ship();
+
+    if (_waiting_for_window && _inflight_count < max_inflight_batches()) {
+        _waiting_for_window = false;
         step_down_next_stage();
+    }
+}
+
+uint32_t ship_mutation::max_inflight_batches() const
+{
+    return _mutation_duplicator->allows_concurrent_batches() ? FLAGS_dup_max_inflight_batches : 1;
+}
+
+void ship_mutation::update_batch_bytes(const shipping_batch &batch)
+{
+    uint64_t latency_ms = dsn_now_ms() - batch.start_time_ms;
+    if (_avg_latency_ms == 0) {
+        _avg_latency_ms = std::max<uint64_t>(latency_ms, 1);
         return;
     }
 
-    ship(std::move(in));
+    if (latency_ms > 2 * _avg_latency_ms) {
+        // the remote cluster is slowing down, smaller batches are less likely to time out
+        // and cheaper to retry
+        _batch_bytes = std::max<size_t>(_batch_bytes / 2, FLAGS_dup_min_batch_bytes);
+    } else if (batch.bytes >= _batch_bytes) {
+        _batch_bytes = std::min<size_t>(_batch_bytes + _batch_bytes / 4, FLAGS_dup_max_batch_bytes);
+    }
+    _avg_latency_ms = std::max<uint64_t>((_avg_latency_ms * 7 + latency_ms) / 8, 1);
 }
 
-void ship_mutation::update_progress()
+void ship_mutation::update_progress(decree last_decree)
 {
     dcheck_eq_replica(
-        _duplicator->update_progress(duplication_progress().set_last_decree(_last_decree)),
+        _duplicator->update_progress(duplication_progress().set_last_decree(last_decree)),
         error_s::ok());
 
     // committed decree never decreases
     decree last_committed_decree = _replica->last_committed_decree();
-    dcheck_ge_replica(last_committed_decree, _last_decree);
+    dcheck_ge_replica(last_committed_decree, last_decree);
 }
 
 ship_mutation::ship_mutation(replica_duplicator *duplicator)
     : replica_base(duplicator),
       _duplicator(duplicator),
       _replica(duplicator->_replica),
-      _stub(duplicator->_replica->get_replica_stub())
+      _stub(duplicator->_replica->get_replica_stub()),
+      _batch_bytes(FLAGS_dup_max_batch_bytes)
 {
     _mutation_duplicator = new_mutation_duplicator(
         duplicator, _duplicator->remote_cluster_name(), _replica->get_app_info()->app_name);
@@ -98,6 +215,17 @@ ship_mutation::ship_mutation(replica_duplicator *duplicator)
                                                      "dup.shipped_bytes_rate",
                                                      COUNTER_TYPE_RATE,
                                                      "shipping rate of private log in bytes");
+    _counter_dup_inflight_batches.init_app_counter(
+        "eon.replica_stub",
+        "dup.inflight_batches",
+        COUNTER_TYPE_NUMBER,
+        "number of mutation batches that are being shipped by duplication");
+}
+
+ship_mutation::~ship_mutation()
+{
+    // the batches in flight are abandoned
+    _counter_dup_inflight_batches->add(-static_cast<int64_t>(_inflight_count));
 }
 
 } // namespace replication
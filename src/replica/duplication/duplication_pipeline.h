@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <deque>
+
 #include <dsn/cpp/pipeline.h>
 #include <dsn/dist/replication/replica_base.h>
 #include <dsn/dist/replication/mutation_duplicator.h>
@@ -43,6 +45,17 @@ private:
 // ship_mutation is a pipeline stage receiving a set of mutations,
 // sending them to the remote cluster. After finished, the pipeline
 // will restart from load_mutation.
+//
+// The loaded mutations are accumulated into a batch until it reaches the batch size or
+// the duplication catches up with the private log. If the mutation_duplicator allows
+// concurrent batches, up to [replication] dup_max_inflight_batches batches can be shipped
+// concurrently, and the loading goes on while the window isn't full, so the throughput isn't
+// bounded by the RTT to the remote cluster. The progress is still updated in the order of
+// decrees, only when all the preceding batches have been shipped.
+//
+// The batch size adapts to the latency of the remote cluster: it's halved when a batch
+// takes more than twice the average latency, and grows back gradually while the full
+// batches are shipped in time, within [dup_min_batch_bytes, dup_max_batch_bytes].
 // ThreadPool: THREAD_POOL_REPLICATION
 class ship_mutation final : public replica_base,
                             public pipeline::when<decree, mutation_tuple_set>,
@@ -55,10 +68,32 @@ public:
 
     explicit ship_mutation(replica_duplicator *duplicator);
 
-    void ship(mutation_tuple_set &&in);
+    ~ship_mutation();
+
+    // ship the pending batch if it's ready and the window isn't full.
+    void ship();
+
+    // the max decree that's been loaded, which may not be shipped yet.
+    decree last_loaded_decree() const { return _last_decree; }
 
 private:
-    void update_progress();
+    struct shipping_batch
+    {
+        uint64_t id;
+        decree last_decree;
+        size_t bytes;
+        uint64_t start_time_ms;
+        bool shipped;
+    };
+
+    void on_batch_shipped(uint64_t id, size_t total_shipped_size);
+
+    // 1 unless the mutation_duplicator keeps the order of the concurrent batches itself
+    uint32_t max_inflight_batches() const;
+
+    void update_batch_bytes(const shipping_batch &batch);
+
+    void update_progress(decree last_decree);
 
     friend class ship_mutation_test;
     friend class replica_duplicator_test;
@@ -71,7 +106,24 @@ private:
 
     decree _last_decree{invalid_decree};
 
+    // the loaded mutations that are not shipped yet
+    mutation_tuple_set _pending;
+    size_t _pending_bytes{0};
+    bool _has_pending{false};
+
+    // the shipping batches in the order of decrees, the front ones are removed when
+    // they're shipped
+    std::deque<shipping_batch> _batches;
+    uint64_t _next_batch_id{0};
+    uint32_t _inflight_count{0};
+    // whether the loading is stopped because the window is full
+    bool _waiting_for_window{false};
+
+    size_t _batch_bytes;
+    uint64_t _avg_latency_ms{0};
+
     perf_counter_wrapper _counter_dup_shipped_bytes_rate;
+    perf_counter_wrapper _counter_dup_inflight_batches;
 };
 
 } // namespace replication
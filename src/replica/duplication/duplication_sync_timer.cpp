@@ -40,14 +40,24 @@ void duplication_sync_timer::run()
 
     // collects confirm points from all primaries on this server
     uint64_t pending_muts_cnt = 0;
+    int64_t max_ship_lag = 0;
+    int64_t max_time_to_catch_up = 0;
     for (const replica_ptr &r : get_all_primaries()) {
         auto confirmed = r->get_duplication_manager()->get_duplication_confirms_to_update();
         if (!confirmed.empty()) {
             req->confirm_list[r->get_gpid()] = std::move(confirmed);
         }
-        pending_muts_cnt += r->get_duplication_manager()->get_pending_mutations_count();
+        int64_t replica_pending_muts_cnt =
+            r->get_duplication_manager()->get_pending_mutations_count();
+        pending_muts_cnt += replica_pending_muts_cnt;
+        max_ship_lag = std::max(max_ship_lag, replica_pending_muts_cnt);
+        max_time_to_catch_up = replica_duplicator_manager::merge_time_to_catch_up(
+            max_time_to_catch_up,
+            r->get_duplication_manager()->get_max_time_to_catch_up_seconds());
     }
     _stub->_counter_dup_pending_mutations_count->set(pending_muts_cnt);
+    _stub->_counter_dup_max_ship_lag_decrees->set(max_ship_lag);
+    _stub->_counter_dup_max_time_to_catch_up_seconds->set(max_time_to_catch_up);
 
     duplication_sync_rpc rpc(std::move(req), RPC_CM_DUPLICATION_SYNC, 3_s);
     rpc_address meta_server_address(_stub->get_meta_server_address());
@@ -173,6 +183,7 @@ duplication_sync_timer::get_dup_states(int app_id, /*out*/ bool *app_found)
             state.not_confirmed = std::max(decree(0), last_committed_decree - s.confirmed_decree);
             state.not_duplicated = std::max(decree(0), last_committed_decree - s.last_decree);
             state.fail_mode = s.fail_mode;
+            state.time_to_catch_up_seconds = s.time_to_catch_up_seconds;
             result.emplace(std::make_pair(s.dupid, state));
         }
     }
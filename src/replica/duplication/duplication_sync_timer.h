@@ -37,6 +37,7 @@ public:
         decree not_duplicated{0};
         decree not_confirmed{0};
         duplication_fail_mode::type fail_mode{duplication_fail_mode::FAIL_SLOW};
+        int64_t time_to_catch_up_seconds{0};
     };
     std::multimap<dupid_t, replica_dup_state> get_dup_states(int app_id, /*out*/ bool *app_found);
 
@@ -3,6 +3,7 @@
 // can be found in the LICENSE file in the root directory of this source tree.
 
 #include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/flags.h>
 
 #include "replica/replica_stub.h"
 #include "replica/replica.h"
@@ -13,6 +14,18 @@
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_uint32("replication",
+                  dup_catch_up_min_lag_decrees,
+                  10000,
+                  "duplication switches to the catch-up mode when the mutations not loaded from "
+                  "the private log are more than this, and switches back when they're less than "
+                  "half of it");
+DSN_DEFINE_uint32("replication",
+                  dup_catch_up_max_blocks,
+                  8,
+                  "the max number of log blocks duplication loads each time in the catch-up mode");
+DSN_DEFINE_validator(dup_catch_up_max_blocks, [](uint32_t value) { return value > 0; });
+
 /*static*/ constexpr int load_from_private_log::MAX_ALLOWED_BLOCK_REPEATS;
 /*static*/ constexpr int load_from_private_log::MAX_ALLOWED_FILE_REPEATS;
 
@@ -65,9 +78,55 @@ void load_from_private_log::run()
         }
     }
 
+    update_catch_up_mode();
     replay_log_block();
 }
 
+void load_from_private_log::update_catch_up_mode()
+{
+    decree max_commit_on_disk = _private_log->max_commit_on_disk();
+    decree lag = max_commit_on_disk - _start_decree + 1;
+    if (!_catching_up && lag >= FLAGS_dup_catch_up_min_lag_decrees) {
+        ddebug_replica("start catching up [start_decree: {}, max_commit_on_disk: {}]",
+                       _start_decree,
+                       max_commit_on_disk);
+        _catching_up = true;
+        _catch_up_start_ms = dsn_now_ms();
+        _catch_up_start_decree = _start_decree - 1;
+        _catch_up_start_committed_decree = max_commit_on_disk;
+    } else if (_catching_up && lag < FLAGS_dup_catch_up_min_lag_decrees / 2) {
+        ddebug_replica("stop catching up in {}s [start_decree: {}, max_commit_on_disk: {}]",
+                       (dsn_now_ms() - _catch_up_start_ms) / 1000,
+                       _start_decree,
+                       max_commit_on_disk);
+        _catching_up = false;
+        _duplicator->set_time_to_catch_up_seconds(0);
+    }
+}
+
+void load_from_private_log::update_catch_up_progress(decree loaded_decrees)
+{
+    _counter_dup_catch_up_decrees_rate->add(loaded_decrees);
+
+    uint64_t elapsed_ms = dsn_now_ms() - _catch_up_start_ms;
+    if (elapsed_ms < 1000) {
+        // too short to estimate
+        return;
+    }
+    decree last_decree = _mutation_batch.last_decree();
+    decree max_commit_on_disk = _private_log->max_commit_on_disk();
+    // the rate of the lag decreasing, which is the loading rate minus the writing rate
+    int64_t lag_decreased = (last_decree - _catch_up_start_decree) -
+                            (max_commit_on_disk - _catch_up_start_committed_decree);
+    if (lag_decreased <= 0) {
+        // it's falling behind
+        _duplicator->set_time_to_catch_up_seconds(-1);
+        return;
+    }
+    _duplicator->set_time_to_catch_up_seconds((max_commit_on_disk - last_decree) * elapsed_ms /
+                                              lag_decreased / 1000);
+}
+
 void load_from_private_log::find_log_file_to_start()
 {
     // `file_map` has already excluded the useless log files during replica init.
@@ -116,7 +175,7 @@ void load_from_private_log::find_log_file_to_start(std::map<int, log_file_ptr> l
     start_from_log_file(_current);
 }
 
-void load_from_private_log::replay_log_block()
+error_s load_from_private_log::read_log_block()
 {
     error_s err =
         mutation_log::replay_block(_current,
@@ -129,11 +188,32 @@ void load_from_private_log::replay_log_block()
                                    },
                                    _start_offset,
                                    _current_global_end_offset);
-    if (!err.is_ok()) {
-        if (err.code() == ERR_HANDLE_EOF && switch_to_next_log_file()) {
-            repeat();
-            return;
+    if (err.is_ok()) {
+        _start_offset =
+            static_cast<size_t>(_current_global_end_offset - _current->start_offset());
+    }
+    return err;
+}
+
+void load_from_private_log::replay_log_block()
+{
+    decree start_last_decree = _mutation_batch.last_decree();
+    uint32_t max_blocks = _catching_up ? FLAGS_dup_catch_up_max_blocks : 1;
+    uint32_t blocks = 0;
+    error_s err;
+    // stop early in the catch-up mode if all the committed mutations on disk are loaded,
+    // rather than reading into the end of the last file
+    while (blocks < max_blocks &&
+           (blocks == 0 || _mutation_batch.last_decree() < _private_log->max_commit_on_disk())) {
+        err = read_log_block();
+        if (err.is_ok()) {
+            blocks++;
+        } else if (err.code() != ERR_HANDLE_EOF || !switch_to_next_log_file()) {
+            break;
         }
+    }
+
+    if (blocks == 0) {
 
         // Error handling on loading failure:
         // - If block loading failed for `MAX_ALLOWED_REPEATS` times, it restarts reading the file.
@@ -179,8 +259,11 @@ void load_from_private_log::replay_log_block()
         repeat(_repeat_delay);
         return;
     }
+    // the failure after some blocks are loaded is handled in the next round
 
-    _start_offset = static_cast<size_t>(_current_global_end_offset - _current->start_offset());
+    if (_catching_up) {
+        update_catch_up_progress(_mutation_batch.last_decree() - start_last_decree);
+    }
 
     // update last_decree even for empty batch.
     step_down_next_stage(_mutation_batch.last_decree(), _mutation_batch.move_all_mutations());
@@ -212,6 +295,11 @@ load_from_private_log::load_from_private_log(replica *r, replica_duplicator *dup
         "dup.load_skipped_bytes_count",
         COUNTER_TYPE_VOLATILE_NUMBER,
         "bytes of mutations that were skipped because of failure during duplication");
+    _counter_dup_catch_up_decrees_rate.init_app_counter(
+        "eon.replica_stub",
+        "dup.catch_up_decrees_rate",
+        COUNTER_TYPE_RATE,
+        "loading rate of mutations in decrees when duplication is catching up");
 }
 
 void load_from_private_log::set_start_decree(decree start_decree)
@@ -22,6 +22,11 @@ class replica_stub;
 /// It works in THREAD_POOL_REPLICATION_LONG (LPC_DUPLICATION_LOAD_MUTATIONS),
 /// which permits tasks to be executed in a blocking way.
 /// NOTE: The resulted `mutation_tuple_set` may be empty.
+///
+/// Normally one log block is loaded each time, so the duplication tails the private log
+/// closely. When it falls behind by [replication] dup_catch_up_min_lag_decrees, it switches
+/// to the catch-up mode, where up to dup_catch_up_max_blocks consecutive blocks (across log
+/// files) are loaded each time, until it's close to the head again.
 class load_from_private_log final : public replica_base,
                                     public pipeline::when<>,
                                     public pipeline::result<decree, mutation_tuple_set>
@@ -43,6 +48,15 @@ public:
 
     void replay_log_block();
 
+    // Reads the block at `_start_offset` of the current file.
+    error_s read_log_block();
+
+    // Switches between the tailing mode and the catch-up mode according to the lag.
+    void update_catch_up_mode();
+
+    // Updates the estimated time to catch up after loading in the catch-up mode.
+    void update_catch_up_progress(decree loaded_decrees);
+
     // Switches to the log file with index = current_log_index + 1.
     // Returns true if succeeds.
     bool switch_to_next_log_file();
@@ -81,10 +95,17 @@ private:
 
     decree _start_decree{0};
 
+    bool _catching_up{false};
+    uint64_t _catch_up_start_ms{0};
+    // the last loaded decree and the max committed decree when the catch-up started
+    decree _catch_up_start_decree{0};
+    decree _catch_up_start_committed_decree{0};
+
     perf_counter_wrapper _counter_dup_load_file_failed_count;
     perf_counter_wrapper _counter_dup_load_skipped_bytes_count;
     perf_counter_wrapper _counter_dup_log_read_bytes_rate;
     perf_counter_wrapper _counter_dup_log_read_mutations_rate;
+    perf_counter_wrapper _counter_dup_catch_up_decrees_rate;
 
     std::chrono::milliseconds _repeat_delay{10_s};
 };
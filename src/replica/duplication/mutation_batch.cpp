@@ -116,7 +116,7 @@ add_mutation_if_valid(mutation_ptr &mu, mutation_tuple_set &mutations, decree st
         if (update.data.buffer() != nullptr) {
             bb = std::move(update.data);
         } else {
-            bb = blob::create_from_bytes(update.data.data(), update.data.length());
+            bb = mutations.copy_to_arena(update.data.data(), update.data.length());
         }
 
         mutations.emplace(std::make_tuple(mu->data.header.timestamp, update.code, std::move(bb)));
@@ -113,6 +113,18 @@ public:
     // For metric "dup.pending_mutations_count"
     uint64_t get_pending_mutations_count() const;
 
+    // The estimated seconds to catch up with the private log, updated by load_from_private_log
+    // in the catch-up mode. It's 0 if not catching up, and -1 if it's falling behind.
+    // Thread-safe
+    int64_t time_to_catch_up_seconds() const
+    {
+        return _time_to_catch_up_seconds.load(std::memory_order_relaxed);
+    }
+    void set_time_to_catch_up_seconds(int64_t seconds)
+    {
+        _time_to_catch_up_seconds.store(seconds, std::memory_order_relaxed);
+    }
+
 private:
     friend class replica_duplicator_test;
     friend class duplication_sync_timer_test;
@@ -136,6 +148,8 @@ private:
     mutable zrwlock_nr _lock;
     duplication_progress _progress;
 
+    std::atomic<int64_t> _time_to_catch_up_seconds{0};
+
     /// === pipeline === ///
     std::unique_ptr<load_mutation> _load;
     std::unique_ptr<ship_mutation> _ship;
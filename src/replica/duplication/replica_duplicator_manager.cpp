@@ -131,6 +131,18 @@ int64_t replica_duplicator_manager::get_pending_mutations_count() const
     return total;
 }
 
+int64_t replica_duplicator_manager::get_max_time_to_catch_up_seconds() const
+{
+    zauto_lock l(_lock);
+
+    int64_t max_seconds = 0;
+    for (const auto &dup : _duplications) {
+        max_seconds =
+            merge_time_to_catch_up(max_seconds, dup.second->time_to_catch_up_seconds());
+    }
+    return max_seconds;
+}
+
 std::vector<replica_duplicator_manager::dup_state>
 replica_duplicator_manager::get_dup_states() const
 {
@@ -146,6 +158,7 @@ replica_duplicator_manager::get_dup_states() const
         state.last_decree = progress.last_decree;
         state.confirmed_decree = progress.confirmed_decree;
         state.fail_mode = dup.second->fail_mode();
+        state.time_to_catch_up_seconds = dup.second->time_to_catch_up_seconds();
         ret.emplace_back(state);
     }
     return ret;
@@ -58,6 +58,17 @@ public:
     /// on this replica, for metric "dup.pending_mutations_count".
     int64_t get_pending_mutations_count() const;
 
+    /// The max estimated time to catch up of the duplications on this replica,
+    /// for metric "dup.max_time_to_catch_up_seconds". It's -1 if any of them is falling
+    /// behind.
+    int64_t get_max_time_to_catch_up_seconds() const;
+
+    /// Merges two estimated times to catch up, -1 (falling behind) wins over any estimation.
+    static int64_t merge_time_to_catch_up(int64_t a, int64_t b)
+    {
+        return (a < 0 || b < 0) ? -1 : std::max(a, b);
+    }
+
     struct dup_state
     {
         dupid_t dupid{0};
@@ -65,6 +76,7 @@ public:
         decree last_decree{invalid_decree};
         decree confirmed_decree{invalid_decree};
         duplication_fail_mode::type fail_mode{duplication_fail_mode::FAIL_SLOW};
+        int64_t time_to_catch_up_seconds{0};
     };
     std::vector<dup_state> get_dup_states() const;
 
@@ -5,6 +5,7 @@
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/defer.h>
 #include <dsn/utility/fail_point.h>
+#include <dsn/utility/flags.h>
 
 #define BOOST_NO_CXX11_SCOPED_ENUMS
 #include <boost/filesystem/operations.hpp>
@@ -19,6 +20,8 @@ namespace replication {
 
 DEFINE_STORAGE_WRITE_RPC_CODE(RPC_RRDB_RRDB_PUT, ALLOW_BATCH, IS_IDEMPOTENT)
 
+DSN_DECLARE_uint32(dup_catch_up_min_lag_decrees);
+
 class load_from_private_log_test : public duplication_test_base
 {
 public:
@@ -185,6 +188,58 @@ public:
         ASSERT_EQ(load._current->index(), 2);
     }
 
+    // ensure it switches to the catch-up mode when it falls far behind, and switches back
+    // when it's close to the head.
+    void test_catch_up(int num_entries)
+    {
+        uint32_t old_min_lag = FLAGS_dup_catch_up_min_lag_decrees;
+        FLAGS_dup_catch_up_min_lag_decrees = 100;
+
+        {
+            mutation_log_ptr mlog = create_private_log();
+            // the last entry commits all the former ones
+            for (int i = 1; i <= num_entries + 1; i++) {
+                mutation_ptr mu = create_test_mutation(i, "hello!");
+                mlog->append(mu, LPC_AIO_IMMEDIATE_CALLBACK, nullptr, nullptr, 0);
+            }
+            mlog->tracker()->wait_outstanding_tasks();
+            mlog->close();
+        }
+        _replica->init_private_log(create_private_log());
+        ASSERT_EQ(_replica->private_log()->max_commit_on_disk(), num_entries);
+        duplicator = create_test_duplicator(0);
+
+        load_from_private_log load(_replica.get(), duplicator.get());
+        load.set_start_decree(1);
+
+        int rounds = 0;
+        int catch_up_rounds = 0;
+        int loaded = 0;
+        pipeline::do_when<decree, mutation_tuple_set> end_stage(
+            [&](decree &&d, mutation_tuple_set &&mutations) {
+                rounds++;
+                catch_up_rounds += load._catching_up ? 1 : 0;
+                loaded += mutations.size();
+                if (d < num_entries) {
+                    // like load_mutation
+                    load.set_start_decree(d + 1);
+                    load.run();
+                }
+            });
+        duplicator->from(load).link(end_stage);
+        duplicator->run_pipeline();
+        duplicator->wait_all();
+
+        ASSERT_EQ(loaded, num_entries);
+        ASSERT_GT(catch_up_rounds, 0);
+        // back to the tailing mode
+        ASSERT_LT(catch_up_rounds, rounds);
+        ASSERT_FALSE(load._catching_up);
+        ASSERT_EQ(duplicator->time_to_catch_up_seconds(), 0);
+
+        FLAGS_dup_catch_up_min_lag_decrees = old_min_lag;
+    }
+
     mutation_log_ptr create_private_log(gpid id) { return create_private_log(1, id); }
 
     mutation_log_ptr create_private_log(int private_log_size_mb = 1, gpid id = gpid(1, 1))
@@ -337,6 +392,8 @@ TEST_F(load_from_private_log_test, handle_real_private_log)
 
 TEST_F(load_from_private_log_test, restart_duplication) { test_restart_duplication(); }
 
+TEST_F(load_from_private_log_test, catch_up) { test_catch_up(5000); }
+
 TEST_F(load_from_private_log_test, restart_duplication2) { test_restart_duplication2(); }
 
 TEST_F(load_from_private_log_test, ignore_useless)
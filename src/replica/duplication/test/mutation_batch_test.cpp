@@ -24,6 +24,9 @@
  * THE SOFTWARE.
  */
 
+#include <chrono>
+#include <iostream>
+
 #include "duplication_test_base.h"
 #include "replica/duplication/mutation_batch.h"
 
@@ -71,5 +74,154 @@ TEST_F(mutation_batch_test, ignore_non_idempotent_write)
     ASSERT_EQ(result.size(), 0);
 }
 
+TEST_F(mutation_batch_test, mutation_tuple_set_order)
+{
+    mutation_tuple_set result;
+    for (int64_t d : {1, 3, 5, 2, 4, 3, 0}) {
+        mutation_ptr mu = create_test_mutation(d, std::to_string(d));
+        add_mutation_if_valid(mu, result, 0);
+    }
+    ASSERT_EQ(result.size(), 7);
+
+    // sorted by timestamp, and the ones with the same timestamp are in the order added
+    std::vector<uint64_t> timestamps;
+    for (const mutation_tuple &mut : result) {
+        timestamps.push_back(std::get<0>(mut));
+        ASSERT_EQ(std::get<2>(mut).to_string(), std::to_string(std::get<0>(mut)));
+    }
+    ASSERT_EQ(timestamps, std::vector<uint64_t>({0, 1, 2, 3, 3, 4, 5}));
+
+    mutation_tuple_set merged;
+    merged.emplace(std::make_tuple(6, RPC_DUPLICATION_IDEMPOTENT_WRITE, blob()));
+    merged.insert(result.begin(), result.end());
+    ASSERT_EQ(merged.size(), 8);
+    ASSERT_EQ(std::get<0>(*merged.begin()), 0);
+}
+
+TEST_F(mutation_batch_test, mutation_tuple_set_arena)
+{
+    mutation_tuple_set result;
+    blob b1 = result.copy_to_arena("hello", 5);
+    blob b2 = result.copy_to_arena("world", 5);
+    ASSERT_EQ(b1.to_string(), "hello");
+    ASSERT_EQ(b2.to_string(), "world");
+    // the small ones share an arena block
+    ASSERT_EQ(b1.buffer(), b2.buffer());
+    ASSERT_EQ(b1.data() + 5, b2.data());
+
+    // a large one is allocated alone
+    std::string large(mutation_tuple_set::ARENA_BLOCK_SIZE / 4 + 1, 'a');
+    blob b3 = result.copy_to_arena(large.data(), large.size());
+    ASSERT_EQ(b3.to_string(), large);
+    ASSERT_NE(b3.buffer(), b1.buffer());
+
+    // the blobs stay valid after the set is cleared, and a new block is used
+    result.clear();
+    blob b4 = result.copy_to_arena("again", 5);
+    ASSERT_NE(b4.buffer(), b1.buffer());
+    ASSERT_EQ(b1.to_string(), "hello");
+    ASSERT_EQ(b4.to_string(), "again");
+
+    // a block that is full is replaced
+    result.clear();
+    std::string piece(mutation_tuple_set::ARENA_BLOCK_SIZE / 4, 'b');
+    blob first = result.copy_to_arena(piece.data(), piece.size());
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(result.copy_to_arena(piece.data(), piece.size()).buffer(), first.buffer());
+    }
+    ASSERT_NE(result.copy_to_arena(piece.data(), piece.size()).buffer(), first.buffer());
+
+    // a copy shares the blobs but not the rest of the arena block
+    result.clear();
+    blob b5 = result.copy_to_arena("hello", 5);
+    result.emplace(std::make_tuple(1, RPC_DUPLICATION_IDEMPOTENT_WRITE, b5));
+    mutation_tuple_set copied = result;
+    ASSERT_EQ(1, copied.size());
+    ASSERT_EQ(b5.buffer(), std::get<2>(*copied.begin()).buffer());
+    blob b6 = copied.copy_to_arena("world", 5);
+    ASSERT_NE(b5.buffer(), b6.buffer());
+    ASSERT_EQ(b5.to_string(), "hello");
+}
+
+// The implementation of mutation_tuple_set before it's flattened.
+struct legacy_mutation_tuple_cmp
+{
+    bool operator()(const mutation_tuple &lhs, const mutation_tuple &rhs) const
+    {
+        if (std::get<0>(lhs) == std::get<0>(rhs)) {
+            return std::get<2>(lhs).data() < std::get<2>(rhs).data();
+        }
+        return std::get<0>(lhs) < std::get<0>(rhs);
+    }
+};
+typedef std::set<mutation_tuple, legacy_mutation_tuple_cmp> legacy_mutation_tuple_set;
+
+static void legacy_add_mutation_if_valid(mutation_ptr &mu, legacy_mutation_tuple_set &mutations)
+{
+    for (mutation_update &update : mu->data.updates) {
+        if (!task_spec::get(update.code)->rpc_request_is_write_idempotent) {
+            continue;
+        }
+        blob bb = blob::create_from_bytes(update.data.data(), update.data.length());
+        mutations.emplace(std::make_tuple(mu->data.header.timestamp, update.code, std::move(bb)));
+    }
+}
+
+template <typename T>
+static size_t handoff(T mutations)
+{
+    size_t total_size = 0;
+    for (const mutation_tuple &mut : mutations) {
+        total_size += std::get<2>(mut).length();
+    }
+    return total_size;
+}
+
+// Compare the throughput of loading the mutations into batches and handing them off to
+// the duplicator, with the flat mutation_tuple_set and the legacy one. Run it manually with
+// --gtest_also_run_disabled_tests.
+TEST_F(mutation_batch_test, DISABLED_mutation_tuple_set_benchmark)
+{
+    const int batch_count = 100;
+    const int batch_size = 1000;
+    std::vector<mutation_ptr> mutations;
+    for (int i = 0; i < batch_count * batch_size; i++) {
+        mutations.push_back(create_test_mutation(i + 1, std::string(100, 'a')));
+    }
+
+    size_t flat_size = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < batch_count; b++) {
+        mutation_tuple_set batch;
+        for (int i = b * batch_size; i < (b + 1) * batch_size; i++) {
+            add_mutation_if_valid(mutations[i], batch, 0);
+        }
+        flat_size += handoff(std::move(batch));
+    }
+    double flat_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    size_t legacy_size = 0;
+    start = std::chrono::steady_clock::now();
+    for (int b = 0; b < batch_count; b++) {
+        legacy_mutation_tuple_set batch;
+        for (int i = b * batch_size; i < (b + 1) * batch_size; i++) {
+            legacy_add_mutation_if_valid(mutations[i], batch);
+        }
+        legacy_size += handoff(std::move(batch));
+    }
+    double legacy_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+
+    ASSERT_EQ(flat_size, legacy_size);
+    ASSERT_EQ(flat_size, batch_count * batch_size * 100);
+    std::cout << "mutations: " << batch_count * batch_size
+              << ", flat: " << batch_count * batch_size / flat_us << " M/s"
+              << ", legacy std::set: " << batch_count * batch_size / legacy_us << " M/s"
+              << std::endl;
+}
+
 } // namespace replication
 } // namespace dsn
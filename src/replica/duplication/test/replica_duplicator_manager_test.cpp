@@ -148,6 +148,34 @@ public:
             assert_test(tt);
         }
     }
+
+    void test_max_time_to_catch_up_seconds()
+    {
+        auto r = stub->add_primary_replica(2, 1);
+        auto &mgr = r->get_replica_duplicator_manager();
+        ASSERT_EQ(0, mgr.get_max_time_to_catch_up_seconds());
+
+        std::vector<int64_t> seconds = {0, 30, 10};
+        for (int id = 1; id <= seconds.size(); id++) {
+            duplication_entry ent;
+            ent.dupid = id;
+            ent.status = duplication_status::DS_PAUSE;
+            ent.progress[r->get_gpid().get_partition_index()] = 0;
+
+            auto dup = make_unique<replica_duplicator>(ent, r);
+            dup->set_time_to_catch_up_seconds(seconds[id - 1]);
+            add_dup(r, std::move(dup));
+        }
+        ASSERT_EQ(30, mgr.get_max_time_to_catch_up_seconds());
+
+        // the one falling behind isn't hidden by the others
+        mgr._duplications[1]->set_time_to_catch_up_seconds(-1);
+        ASSERT_EQ(-1, mgr.get_max_time_to_catch_up_seconds());
+
+        ASSERT_EQ(-1, replica_duplicator_manager::merge_time_to_catch_up(100, -1));
+        ASSERT_EQ(-1, replica_duplicator_manager::merge_time_to_catch_up(-1, 0));
+        ASSERT_EQ(100, replica_duplicator_manager::merge_time_to_catch_up(100, 0));
+    }
 };
 
 TEST_F(replica_duplicator_manager_test, get_duplication_confirms)
@@ -167,5 +195,10 @@ TEST_F(replica_duplicator_manager_test, remove_non_existed_duplications)
 
 TEST_F(replica_duplicator_manager_test, min_confirmed_decree) { test_min_confirmed_decree(); }
 
+TEST_F(replica_duplicator_manager_test, max_time_to_catch_up_seconds)
+{
+    test_max_time_to_catch_up_seconds();
+}
+
 } // namespace replication
 } // namespace dsn
@@ -2,6 +2,8 @@
 // This source code is licensed under the Apache License Version 2.0, which
 // can be found in the LICENSE file in the root directory of this source tree.
 
+#include <dsn/utility/flags.h>
+
 #include "replica/duplication/mutation_batch.h"
 #include "replica/duplication/duplication_pipeline.h"
 #include "duplication_test_base.h"
@@ -9,7 +11,12 @@
 namespace dsn {
 namespace replication {
 
+DSN_DECLARE_uint32(dup_max_inflight_batches);
+DSN_DECLARE_uint32(dup_max_batch_bytes);
+DSN_DECLARE_uint32(dup_min_batch_bytes);
+
 /*static*/ mock_mutation_duplicator::duplicate_function mock_mutation_duplicator::_func;
+/*static*/ bool mock_mutation_duplicator::_concurrent = false;
 
 struct mock_stage : pipeline::when<>
 {
@@ -34,7 +41,9 @@ public:
         mock_stage end;
 
         pipeline::base base;
-        base.thread_pool(LPC_REPLICATION_LONG_LOW).task_tracker(_replica->tracker());
+        base.thread_pool(LPC_REPLICATION_LOW)
+            .task_tracker(_replica->tracker())
+            .thread_hash(_replica->get_gpid().thread_hash());
         base.from(shipper).link(end);
 
         mutation_batch batch(duplicator.get());
@@ -61,12 +70,150 @@ public:
                 cb(0);
             });
 
-        shipper.run(2, std::move(in));
+        shipper.async(2, std::move(in));
 
         base.wait_all();
         ASSERT_EQ(duplicator->progress().last_decree, 2);
     }
 
+    // ensure multiple batches are shipped concurrently within the window.
+    // ensure the progress is updated in order of decrees.
+    void test_ship_in_window()
+    {
+        uint32_t old_max_inflight_batches = FLAGS_dup_max_inflight_batches;
+        FLAGS_dup_max_inflight_batches = 2;
+        mock_mutation_duplicator::_concurrent = true;
+
+        ship_mutation shipper(duplicator.get());
+        std::atomic<int> load_count{0};
+        pipeline::do_when<> load([&load_count]() { load_count++; });
+
+        pipeline::base base;
+        base.thread_pool(LPC_REPLICATION_LOW)
+            .task_tracker(_replica->tracker())
+            .thread_hash(_replica->get_gpid().thread_hash());
+        base.from(shipper).link(load);
+
+        zlock callbacks_lock;
+        std::vector<mutation_duplicator::callback> callbacks;
+        mock_mutation_duplicator::mock(
+            [&](mutation_tuple_set muts, mutation_duplicator::callback cb) {
+                ASSERT_EQ(1, muts.size());
+                zauto_lock l(callbacks_lock);
+                callbacks.push_back(std::move(cb));
+            });
+
+        _replica->set_last_committed_decree(4);
+        decree start_decree = duplicator->progress().last_decree;
+        auto ship_batch = [&](decree d) {
+            mutation_batch batch(duplicator.get());
+            batch.add(create_test_mutation(d - 1, "hello"));
+            batch.add(create_test_mutation(d, "hello"));
+            shipper.async(std::move(d), batch.move_all_mutations());
+            base.wait_all();
+        };
+
+        // the loading goes on while the window isn't full
+        ship_batch(2);
+        ASSERT_EQ(1, load_count);
+        ship_batch(4);
+        ASSERT_EQ(1, load_count);
+        ASSERT_EQ(2, callbacks.size());
+        ASSERT_EQ(2, shipper._inflight_count);
+
+        // the second batch is shipped first, the progress waits for the first one
+        callbacks[1](100);
+        base.wait_all();
+        ASSERT_EQ(2, load_count);
+        ASSERT_EQ(start_decree, duplicator->progress().last_decree);
+
+        callbacks[0](100);
+        base.wait_all();
+        ASSERT_EQ(4, duplicator->progress().last_decree);
+        ASSERT_EQ(0, shipper._inflight_count);
+        ASSERT_TRUE(shipper._batches.empty());
+        ASSERT_EQ(4, shipper.last_loaded_decree());
+
+        FLAGS_dup_max_inflight_batches = old_max_inflight_batches;
+        mock_mutation_duplicator::_concurrent = false;
+    }
+
+    // ensure the batches are shipped one by one if the duplicator doesn't allow concurrent
+    // batches, whatever dup_max_inflight_batches is.
+    void test_ship_serially()
+    {
+        uint32_t old_max_inflight_batches = FLAGS_dup_max_inflight_batches;
+        FLAGS_dup_max_inflight_batches = 2;
+
+        ship_mutation shipper(duplicator.get());
+        std::atomic<int> load_count{0};
+        pipeline::do_when<> load([&load_count]() { load_count++; });
+
+        pipeline::base base;
+        base.thread_pool(LPC_REPLICATION_LOW)
+            .task_tracker(_replica->tracker())
+            .thread_hash(_replica->get_gpid().thread_hash());
+        base.from(shipper).link(load);
+
+        zlock callbacks_lock;
+        std::vector<mutation_duplicator::callback> callbacks;
+        mock_mutation_duplicator::mock(
+            [&](mutation_tuple_set muts, mutation_duplicator::callback cb) {
+                zauto_lock l(callbacks_lock);
+                callbacks.push_back(std::move(cb));
+            });
+
+        _replica->set_last_committed_decree(2);
+        mutation_batch batch(duplicator.get());
+        batch.add(create_test_mutation(1, "hello"));
+        batch.add(create_test_mutation(2, "hello"));
+        shipper.async(2, batch.move_all_mutations());
+        base.wait_all();
+
+        // the loading waits for the first batch
+        ASSERT_EQ(1, callbacks.size());
+        ASSERT_EQ(0, load_count);
+        callbacks[0](100);
+        base.wait_all();
+        ASSERT_EQ(1, load_count);
+        ASSERT_EQ(2, duplicator->progress().last_decree);
+
+        FLAGS_dup_max_inflight_batches = old_max_inflight_batches;
+    }
+
+    void test_adaptive_batch_bytes()
+    {
+        ship_mutation shipper(duplicator.get());
+        ASSERT_EQ(FLAGS_dup_max_batch_bytes, shipper._batch_bytes);
+
+        // the first batch initializes the average latency
+        ship_mutation::shipping_batch batch{0, 1, shipper._batch_bytes, dsn_now_ms(), true};
+        shipper.update_batch_bytes(batch);
+        ASSERT_GT(shipper._avg_latency_ms, 0);
+
+        // the batch size is halved when the remote cluster slows down
+        shipper._avg_latency_ms = 10;
+        batch.start_time_ms = dsn_now_ms() - 100;
+        shipper.update_batch_bytes(batch);
+        ASSERT_EQ(FLAGS_dup_max_batch_bytes / 2, shipper._batch_bytes);
+
+        // and grows back while the full batches are shipped in time
+        shipper._avg_latency_ms = 1000;
+        batch.start_time_ms = dsn_now_ms();
+        for (int i = 0; i < 10; i++) {
+            batch.bytes = shipper._batch_bytes;
+            shipper.update_batch_bytes(batch);
+        }
+        ASSERT_EQ(FLAGS_dup_max_batch_bytes, shipper._batch_bytes);
+
+        for (int i = 0; i < 20; i++) {
+            shipper._avg_latency_ms = 10;
+            batch.start_time_ms = dsn_now_ms() - 100;
+            shipper.update_batch_bytes(batch);
+        }
+        ASSERT_EQ(FLAGS_dup_min_batch_bytes, shipper._batch_bytes);
+    }
+
     ship_mutation *mock_ship_mutation()
     {
         duplicator->_ship = make_unique<ship_mutation>(duplicator.get());
@@ -78,6 +225,12 @@ public:
 
 TEST_F(ship_mutation_test, ship_mutation_tuple_set) { test_ship_mutation_tuple_set(); }
 
+TEST_F(ship_mutation_test, ship_in_window) { test_ship_in_window(); }
+
+TEST_F(ship_mutation_test, ship_serially) { test_ship_serially(); }
+
+TEST_F(ship_mutation_test, adaptive_batch_bytes) { test_adaptive_batch_bytes(); }
+
 void retry(pipeline::base *base)
 {
     base->schedule([base]() { retry(base); }, 10_s);
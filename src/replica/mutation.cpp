@@ -38,6 +38,7 @@
 #include "replica.h"
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/flags.h>
+#include <dsn/utils/trace_span.h>
 
 namespace dsn {
 namespace replication {
@@ -58,7 +59,11 @@ mutation::mutation()
     strcpy(_name, "0.0.0.0");
     _appro_data_bytes = sizeof(mutation_header);
     _create_ts_ns = dsn_now_ns();
+    _receive_ts_ns = _create_ts_ns;
     _tid = ++s_tid;
+    _trace_id = 0;
+    _trace_start_ns = 0;
+    log_append_start_ns = 0;
     tracer =
         std::make_shared<dsn::utils::latency_tracer>(fmt::format("{}[{}]", "mutation", _tid),
                                                      false,
@@ -98,6 +103,17 @@ mutation::~mutation()
     }
 }
 
+void mutation::add_trace_span_internal(const char *name, uint64_t start_ns) const
+{
+    dsn::utils::add_trace_span(_trace_id,
+                               name,
+                               start_ns,
+                               dsn_now_ns(),
+                               data.header.pid.get_app_id(),
+                               data.header.pid.get_partition_index(),
+                               data.header.decree);
+}
+
 void mutation::set_id(ballot b, decree c)
 {
     data.header.ballot = b;
@@ -118,6 +134,9 @@ void mutation::copy_from(mutation_ptr &old)
     client_requests = old->client_requests;
     _appro_data_bytes = old->_appro_data_bytes;
     _create_ts_ns = old->_create_ts_ns;
+    _receive_ts_ns = old->_receive_ts_ns;
+    _trace_id = old->_trace_id;
+    _trace_start_ns = old->_trace_start_ns;
 
     for (auto &r : client_requests) {
         if (r != nullptr) {
@@ -147,7 +166,16 @@ void mutation::copy_from(mutation_ptr &old)
 void mutation::add_client_request(task_code code, dsn::message_ex *request)
 {
     if (request != nullptr) {
-        ADD_CUSTOM_POINT(tracer, request->header->id);
+        ADD_POINT(tracer);
+        if (request->receive_ts_ns != 0 && request->receive_ts_ns < _receive_ts_ns) {
+            _receive_ts_ns = request->receive_ts_ns;
+        }
+        // trace the mutation by the first sampled request in it
+        if (dsn_unlikely(request->header->context.u.is_trace_sampled) && _trace_id == 0) {
+            _trace_id = request->header->trace_id;
+            _trace_start_ns =
+                request->receive_ts_ns != 0 ? request->receive_ts_ns : _create_ts_ns;
+        }
     }
     data.updates.push_back(mutation_update());
     mutation_update &update = data.updates.back();
@@ -253,6 +281,9 @@ void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
 
     mu->client_requests.resize(mu->data.updates.size());
     mu->add_prepare_request(from);
+    if (from != nullptr && dsn_unlikely(from->header->context.u.is_trace_sampled)) {
+        mu->_trace_id = from->header->trace_id;
+    }
 
     snprintf_p(mu->_name,
                sizeof(mu->_name),
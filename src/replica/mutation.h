@@ -89,6 +89,22 @@ public:
         return dsn_now_ms() + gap_ms >= _prepare_ts_ms + timeout_ms;
     }
     uint64_t create_ts_ns() const { return _create_ts_ns; }
+    // when the earliest client request in the mutation is received, or create_ts_ns() if none
+    uint64_t receive_ts_ns() const { return _receive_ts_ns; }
+    // the trace id if the mutation carries a request sampled for tracing, otherwise 0
+    uint64_t trace_id() const { return _trace_id; }
+    // when the sampled request is received, which is before it's throttled or queued
+    uint64_t trace_start_ns() const { return _trace_start_ns; }
+    // record a span from `start_ns` to now if the mutation is sampled.
+    // `name` should be a string literal.
+    void add_trace_span(const char *name, uint64_t start_ns) const
+    {
+        if (dsn_unlikely(_trace_id != 0)) {
+            add_trace_span_internal(name, start_ns);
+        }
+    }
+    // the start time of the span, or 0 if it's not sampled
+    uint64_t trace_span_start_ns() const { return _trace_id != 0 ? dsn_now_ns() : 0; }
     ballot get_ballot() const { return data.header.ballot; }
     decree get_decree() const { return data.header.decree; }
 
@@ -148,7 +164,12 @@ public:
     void set_is_sync_to_child(bool sync_to_child) { _is_sync_to_child = sync_to_child; }
     bool is_sync_to_child() { return _is_sync_to_child; }
 
+    // the start time of appending the mutation to the shared log, for tracing only
+    uint64_t log_append_start_ns;
+
 private:
+    void add_trace_span_internal(const char *name, uint64_t start_ns) const;
+
     union
     {
         struct
@@ -167,7 +188,10 @@ private:
     char _name[60];                                   // app_id.partition_index.ballot.decree
     int _appro_data_bytes;
     uint64_t _create_ts_ns; // for profiling
+    uint64_t _receive_ts_ns;
     uint64_t _tid;          // trace id, unique in process
+    uint64_t _trace_id;     // the trace id for sampled tracing, 0 if not sampled
+    uint64_t _trace_start_ns;
     static std::atomic<uint64_t> s_tid;
     bool _is_sync_to_child; // for partition split
 };
@@ -28,6 +28,7 @@
 #include "mutation.h"
 #include "mutation_log.h"
 #include "replica_stub.h"
+#include "table_throttler.h"
 #include "duplication/replica_duplicator_manager.h"
 #include "backup/replica_backup_manager.h"
 #include "backup/cold_backup_context.h"
@@ -37,6 +38,7 @@
 #include <dsn/cpp/json_helper.h>
 #include <dsn/dist/replication/replication_app_base.h>
 #include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/flags.h>
 #include <dsn/utility/rand.h>
 #include <dsn/utility/string_conv.h>
 #include <dsn/utility/strings.h>
@@ -45,6 +47,12 @@
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_uint32("replication",
+                  storage_size_refresh_interval_seconds,
+                  300,
+                  "the interval to walk the data dir of a replica for the storage size reported "
+                  "to meta server, besides the refresh once a checkpoint is made");
+
 replica::replica(
     replica_stub *stub, gpid gpid, const app_info &app, const char *dir, bool need_restore)
     : serverlet<replica>("replica"),
@@ -73,6 +81,7 @@ replica::replica(
     _config.pid = gpid;
     _partition_version = app.partition_count - 1;
     _bulk_loader = make_unique<replica_bulk_loader>(this);
+    _table_throttler = stub->get_table_throttler(gpid.get_app_id(), app.app_name);
 
     std::string counter_str = fmt::format("private.log.size(MB)@{}", gpid);
     _counter_private_log_size.init_app_counter(
@@ -86,6 +95,14 @@ replica::replica(
     _counter_recent_write_throttling_reject_count.init_app_counter(
         "eon.replica", counter_str.c_str(), COUNTER_TYPE_VOLATILE_NUMBER, counter_str.c_str());
 
+    counter_str = fmt::format("recent.write.adaptive.throttling.reject.count@{}", gpid);
+    _counter_recent_write_adaptive_throttling_reject_count.init_app_counter(
+        "eon.replica", counter_str.c_str(), COUNTER_TYPE_VOLATILE_NUMBER, counter_str.c_str());
+
+    counter_str = fmt::format("write.adaptive.throttling.limit@{}", gpid);
+    _counter_write_adaptive_throttling_limit.init_app_counter(
+        "eon.replica", counter_str.c_str(), COUNTER_TYPE_NUMBER, counter_str.c_str());
+
     counter_str = fmt::format("dup.disabled_non_idempotent_write_count@{}", _app_info.app_name);
     _counter_dup_disabled_non_idempotent_write_count.init_app_counter(
         "eon.replica", counter_str.c_str(), COUNTER_TYPE_VOLATILE_NUMBER, counter_str.c_str());
@@ -122,6 +139,55 @@ void replica::update_commit_qps(int count)
     _stub->_counter_replicas_commit_qps->add((uint64_t)count);
 }
 
+void replica::get_load_stats(/*out*/ int64_t &read_qps,
+                             /*out*/ int64_t &write_qps,
+                             /*out*/ int64_t &storage_mb)
+{
+    zauto_lock l(_load_stats_lock);
+    uint64_t now_ms = dsn_now_ms();
+    uint64_t interval_ms = now_ms - _load_stats_update_time_ms;
+    if (_load_stats_update_time_ms == 0 || interval_ms >= _options->config_sync_interval_ms / 2) {
+        if (_load_stats_update_time_ms != 0 && interval_ms > 0) {
+            _read_qps = _recent_read_count.exchange(0) * 1000 / interval_ms;
+            _write_qps = _recent_write_count.exchange(0) * 1000 / interval_ms;
+        } else {
+            _recent_read_count.store(0);
+            _recent_write_count.store(0);
+        }
+        _load_stats_update_time_ms = now_ms;
+    }
+
+    read_qps = _read_qps;
+    write_qps = _write_qps;
+    storage_mb = _storage_mb.load(std::memory_order_relaxed);
+}
+
+// ThreadPool: THREAD_POOL_REPLICATION
+void replica::update_storage_size()
+{
+    _checker.only_one_thread_access();
+
+    if (_app == nullptr) {
+        return;
+    }
+
+    // walking the data dir is expensive, so it's done only when the files are likely to have
+    // changed: a new checkpoint is made, or the refresh interval passes
+    uint64_t now_ms = dsn_now_ms();
+    decree durable_decree = last_durable_decree();
+    if (_storage_size_update_time_ms != 0 && durable_decree == _storage_size_durable_decree &&
+        now_ms < _storage_size_update_time_ms +
+                     FLAGS_storage_size_refresh_interval_seconds * 1000ULL) {
+        return;
+    }
+
+    // walk the data dir here rather than in `get_load_stats`, which is called under the
+    // `_replicas_lock` of replica_stub
+    _storage_mb.store(_app->get_storage_size_mb(), std::memory_order_relaxed);
+    _storage_size_update_time_ms = now_ms;
+    _storage_size_durable_decree = durable_decree;
+}
+
 void replica::init_state()
 {
     _inactive_is_transient = false;
@@ -185,6 +251,15 @@ void replica::on_client_read(dsn::message_ex *request)
         _counter_backup_request_qps->increment();
     }
 
+    // the reads of secondaries are backup requests, which are not counted in the share of the
+    // node computed from the local primaries
+    if (status() == partition_status::PS_PRIMARY && !_table_throttler->consume_read()) {
+        response_client_read(request, ERR_BUSY);
+        return;
+    }
+
+    _recent_read_count.fetch_add(1, std::memory_order_relaxed);
+
     uint64_t start_time_ns = dsn_now_ns();
     dassert(_app != nullptr, "");
     _app->on_request(request);
@@ -226,6 +301,7 @@ void replica::execute_mutation(mutation_ptr &mu)
           mu->name(),
           static_cast<int>(mu->client_requests.size()));
     ADD_POINT(mu->tracer);
+    uint64_t apply_start_ns = mu->trace_span_start_ns();
 
     error_code err = ERR_OK;
     decree d = mu->data.header.decree;
@@ -301,6 +377,14 @@ void replica::execute_mutation(mutation_ptr &mu)
 
     dinfo(
         "TwoPhaseCommit, %s: mutation %s committed, err = %s", name(), mu->name(), err.to_string());
+    if (status() == partition_status::PS_PRIMARY) {
+        mu->add_trace_span("primary.apply", apply_start_ns);
+        // the whole write on primary, from the request is received to it's replied, including
+        // the throttling and the queueing before the mutation is created
+        mu->add_trace_span("primary.write", mu->trace_start_ns());
+    } else {
+        mu->add_trace_span("secondary.apply", apply_start_ns);
+    }
 
     if (err != ERR_OK) {
         handle_local_failure(err);
@@ -317,6 +401,7 @@ void replica::execute_mutation(mutation_ptr &mu)
 
     // update table level latency perf-counters for primary partition
     ADD_CUSTOM_POINT(mu->tracer, "completed");
+    update_table_level_stage_latency(mu);
     if (partition_status::PS_PRIMARY == status()) {
         uint64_t now_ns = dsn_now_ns();
         for (auto update : mu->data.updates) {
@@ -383,6 +468,8 @@ void replica::close()
     cleanup_preparing_mutations(true);
     dassert(_primary_states.is_cleaned(), "primary context is not cleared");
 
+    _table_throttler->remove(get_gpid().get_partition_index());
+
     if (partition_status::PS_INACTIVE == status()) {
         dassert(_secondary_states.is_cleaned(), "secondary context is not cleared");
         dassert(_potential_secondary_states.is_cleaned(),
@@ -438,6 +525,8 @@ void replica::init_table_level_latency_counters()
 {
     int max_task_code = task_code::max();
     _counters_table_level_latency.resize(max_task_code + 1);
+    _counters_table_level_stage_latency.assign(dsn::utils::latency_tracer::MAX_STAGE_COUNT,
+                                               nullptr);
 
     for (int code = 0; code <= max_task_code; code++) {
         _counters_table_level_latency[code] = nullptr;
@@ -456,5 +545,35 @@ void replica::init_table_level_latency_counters()
         }
     }
 }
+
+// The latency of the stages traced by the latency tracer, such as
+// `table.level.stage.replica_2pc.init_prepare.latency(ns)@test_table`, which is the time
+// elapsed from the previous stage to it. The stages are named by their stable metric names
+// rather than the file and line, see ADD_POINT. The counters are also shared by the replicas of
+// a table.
+void replica::update_table_level_stage_latency(const mutation_ptr &mu)
+{
+    if (!dsn::utils::FLAGS_enable_latency_tracer) {
+        return;
+    }
+
+    mu->tracer->for_each_span([this](int stage_id, uint64_t span_ns) {
+        perf_counter *&counter = _counters_table_level_stage_latency[stage_id];
+        if (dsn_unlikely(counter == nullptr)) {
+            std::string counter_str =
+                fmt::format("table.level.stage.{}.latency(ns)@{}",
+                            dsn::utils::latency_tracer::stage_metric_name(stage_id),
+                            _app_info.app_name);
+            counter = dsn::perf_counters::instance()
+                          .get_app_counter("eon.replica",
+                                           counter_str.c_str(),
+                                           COUNTER_TYPE_NUMBER_PERCENTILES,
+                                           counter_str.c_str(),
+                                           true)
+                          .get();
+        }
+        counter->set(span_ns);
+    });
+}
 } // namespace replication
 } // namespace dsn
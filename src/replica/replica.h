@@ -54,6 +54,7 @@
 #include "mutation_log.h"
 #include "prepare_list.h"
 #include "replica_context.h"
+#include "utils/adaptive_throttling_controller.h"
 #include "utils/throttling_controller.h"
 
 namespace dsn {
@@ -64,6 +65,7 @@ class replica_stub;
 class replica_duplicator_manager;
 class replica_backup_manager;
 class replica_bulk_loader;
+class table_throttler;
 
 class cold_backup_context;
 typedef dsn::ref_ptr<cold_backup_context> cold_backup_context_ptr;
@@ -116,6 +118,9 @@ public:
     /// \return true if request is throttled.
     /// \see replica::on_client_write
     bool throttle_request(throttling_controller &c, message_ex *request, int32_t req_units);
+    /// throttle write requests by the adaptive limit
+    /// \return true if request is rejected.
+    bool throttle_request_adaptively(message_ex *request);
     /// update throttling controllers
     /// \see replica::update_app_envs
     void update_throttle_envs(const std::map<std::string, std::string> &envs);
@@ -205,6 +210,19 @@ public:
     //
     void update_commit_qps(int count);
 
+    // Get the read/write qps and storage size of this replica, which are reported to
+    // meta server through config-sync for load-aware balancing.
+    // The qps is averaged over the time since the last refresh, and the statistics are
+    // refreshed at most once per half of `config_sync_interval_ms`. The storage size is the one
+    // cached by `update_storage_size`, so it's cheap to call under the locks of replica_stub.
+    void get_load_stats(/*out*/ int64_t &read_qps,
+                        /*out*/ int64_t &write_qps,
+                        /*out*/ int64_t &storage_mb);
+
+    // Walk the data dir to refresh the storage size reported by `get_load_stats`, if a checkpoint
+    // is made since the last walk or [replication] storage_size_refresh_interval_seconds passes.
+    void update_storage_size();
+
     // routine for get extra envs from replica
     const std::map<std::string, std::string> &get_replica_extra_envs() const { return _extra_envs; }
 
@@ -445,6 +463,9 @@ private:
     void child_handle_async_learn_error();
 
     void init_table_level_latency_counters();
+    // aggregate the latency of each stage traced by the tracer of `mu` into the table level
+    // latency counters of the stages
+    void update_table_level_stage_latency(const mutation_ptr &mu);
 
 private:
     friend class ::dsn::replication::test::test_checker;
@@ -529,6 +550,12 @@ private:
     bool _deny_client_write;     // if deny all write requests
     throttling_controller _write_qps_throttling_controller;  // throttling by requests-per-second
     throttling_controller _write_size_throttling_controller; // throttling by bytes-per-second
+    // throttling by requests-per-second adjusted from the write latency, bounded by
+    // _write_qps_throttling_controller
+    adaptive_throttling_controller _write_adaptive_throttling_controller;
+    // table-level throttling shared with the other local partitions of the table, see
+    // replica_stub::get_table_throttler
+    std::shared_ptr<table_throttler> _table_throttler;
 
     // duplication
     std::unique_ptr<replica_duplicator_manager> _duplication_mgr;
@@ -554,11 +581,27 @@ private:
     bool _is_bulk_load_ingestion{false};
     uint64_t _bulk_load_ingestion_start_time_ms{0};
 
+    // load statistics, see `get_load_stats`
+    std::atomic<uint64_t> _recent_read_count{0};
+    std::atomic<uint64_t> _recent_write_count{0};
+    ::dsn::zlock _load_stats_lock;
+    uint64_t _load_stats_update_time_ms{0};
+    int64_t _read_qps{0};
+    int64_t _write_qps{0};
+    // updated by `update_storage_size` on config sync
+    std::atomic<int64_t> _storage_mb{0};
+    uint64_t _storage_size_update_time_ms{0};
+    decree _storage_size_durable_decree{0};
+
     // perf counters
     perf_counter_wrapper _counter_private_log_size;
     perf_counter_wrapper _counter_recent_write_throttling_delay_count;
     perf_counter_wrapper _counter_recent_write_throttling_reject_count;
+    perf_counter_wrapper _counter_recent_write_adaptive_throttling_reject_count;
+    perf_counter_wrapper _counter_write_adaptive_throttling_limit;
     std::vector<perf_counter *> _counters_table_level_latency;
+    // indexed by the stage id of latency_tracer, created when the stage is first reached
+    std::vector<perf_counter *> _counters_table_level_stage_latency;
     perf_counter_wrapper _counter_dup_disabled_non_idempotent_write_count;
     perf_counter_wrapper _counter_backup_request_qps;
 
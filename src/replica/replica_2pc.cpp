@@ -28,14 +28,20 @@
 #include "mutation.h"
 #include "mutation_log.h"
 #include "replica_stub.h"
+#include "table_throttler.h"
 #include "bulk_load/replica_bulk_loader.h"
 #include <dsn/utils/latency_tracer.h>
+#include <dsn/utils/trace_span.h>
+#include <dsn/utility/rand.h>
 #include <dsn/dist/replication/replication_app_base.h>
 #include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/flags.h>
 
 namespace dsn {
 namespace replication {
 
+DSN_DECLARE_bool(enable_adaptive_write_throttling);
+
 void replica::on_client_write(dsn::message_ex *request, bool ignore_throttling)
 {
     _checker.only_one_thread_access();
@@ -121,6 +127,22 @@ void replica::on_client_write(dsn::message_ex *request, bool ignore_throttling)
         if (throttle_request(_write_size_throttling_controller, request, request->body_size())) {
             return;
         }
+        if (throttle_request_adaptively(request)) {
+            return;
+        }
+        if (!_table_throttler->consume_write(request->body_size())) {
+            response_client_write(request, ERR_BUSY);
+            return;
+        }
+    }
+
+    _recent_write_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (!request->header->context.u.is_trace_sampled && utils::should_sample_trace()) {
+        request->header->context.u.is_trace_sampled = 1;
+        if (request->header->trace_id == 0) {
+            request->header->trace_id = rand::next_u64(1, std::numeric_limits<uint64_t>::max());
+        }
     }
 
     dinfo("%s: got write request from %s", name(), request->header->from_address.to_string());
@@ -137,6 +159,7 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation, bool pop_all_c
             enum_to_string(status()));
 
     ADD_POINT(mu->tracer);
+    mu->add_trace_span("primary.queue", mu->create_ts_ns());
 
     error_code err = ERR_OK;
     uint8_t count = 0;
@@ -241,6 +264,7 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation, bool pop_all_c
                 mu->data.header.log_offset);
         dassert(mu->log_task() == nullptr, "");
         int64_t pending_size;
+        mu->log_append_start_ns = mu->trace_span_start_ns();
         mu->log_task() = _stub->_log->append(mu,
                                              LPC_WRITE_REPLICATION_LOG,
                                              &_tracker,
@@ -285,7 +309,7 @@ void replica::send_prepare_message(::dsn::rpc_address addr,
                                    bool pop_all_committed_mutations,
                                    int64_t learn_signature)
 {
-    ADD_CUSTOM_POINT(mu->tracer, addr.to_string());
+    ADD_POINT(mu->tracer);
     dsn::message_ex *msg = dsn::message_ex::create_request(
         RPC_PREPARE, timeout_milliseconds, get_gpid().thread_hash());
     replica_configuration rconfig;
@@ -299,11 +323,19 @@ void replica::send_prepare_message(::dsn::rpc_address addr,
         mu->write_to(writer, msg);
     }
 
+    // the prepare message is traced with the client request
+    if (mu->trace_id() != 0) {
+        msg->header->trace_id = mu->trace_id();
+        msg->header->context.u.is_trace_sampled = 1;
+    }
+    uint64_t send_start_ns = mu->trace_span_start_ns();
+
     mu->remote_tasks()[addr] =
         rpc::call(addr,
                   msg,
                   &_tracker,
                   [=](error_code err, dsn::message_ex *request, dsn::message_ex *reply) {
+                      mu->add_trace_span("primary.prepare_rpc", send_start_ns);
                       on_prepare_reply(std::make_pair(mu, rconfig.status), err, request, reply);
                   },
                   get_gpid().thread_hash());
@@ -476,6 +508,7 @@ void replica::on_prepare(dsn::message_ex *request)
     }
 
     dassert(mu->log_task() == nullptr, "");
+    mu->log_append_start_ns = mu->trace_span_start_ns();
     mu->log_task() = _stub->_log->append(mu,
                                          LPC_WRITE_REPLICATION_LOG,
                                          &_tracker,
@@ -499,6 +532,9 @@ void replica::on_append_log_completed(mutation_ptr &mu, error_code err, size_t s
           err.to_string());
 
     ADD_POINT(mu->tracer);
+    mu->add_trace_span(status() == partition_status::PS_PRIMARY ? "primary.append_log"
+                                                                 : "secondary.append_log",
+                       mu->log_append_start_ns);
 
     if (err == ERR_OK) {
         mu->set_logged();
@@ -514,6 +550,12 @@ void replica::on_append_log_completed(mutation_ptr &mu, error_code err, size_t s
         switch (status()) {
         case partition_status::PS_PRIMARY:
             if (err == ERR_OK) {
+                if (FLAGS_enable_adaptive_write_throttling) {
+                    // from the receipt of the requests, so that the time they wait before
+                    // the mutation is created is counted as well
+                    _write_adaptive_throttling_controller.add_latency(
+                        (dsn_now_ns() - mu->receive_ts_ns()) / 1000);
+                }
                 do_possible_commit_on_primary(mu);
             } else {
                 handle_local_failure(err);
@@ -556,7 +598,7 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
     mutation_ptr mu = pr.first;
     partition_status::type target_status = pr.second;
 
-    ADD_CUSTOM_POINT(mu->tracer, request->to_address.to_string());
+    ADD_POINT(mu->tracer);
 
     // skip callback for old mutations
     if (partition_status::PS_PRIMARY != status() || mu->data.header.ballot < get_ballot() ||
@@ -592,7 +634,7 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
               enum_to_string(target_status),
               resp.err.to_string());
     } else {
-        ADD_CUSTOM_POINT(mu->tracer, fmt::format("error:{}", request->to_address.to_string()));
+        ADD_CUSTOM_POINT(mu->tracer, "error");
         derror("%s: mutation %s on_prepare_reply from %s, appro_data_bytes = %d, "
                "target_status = %s, err = %s",
                name(),
@@ -714,7 +756,8 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
 
 void replica::ack_prepare_message(error_code err, mutation_ptr &mu)
 {
-    ADD_CUSTOM_POINT(mu->tracer, name());
+    ADD_POINT(mu->tracer);
+    mu->add_trace_span("secondary.prepare", mu->create_ts_ns());
     prepare_ack resp;
     resp.pid = get_gpid();
     resp.err = err;
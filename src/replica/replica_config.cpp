@@ -38,6 +38,7 @@
 #include "mutation.h"
 #include "mutation_log.h"
 #include "replica_stub.h"
+#include "table_throttler.h"
 #include "bulk_load/replica_bulk_loader.h"
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/dist/replication/replication_app_base.h>
@@ -963,6 +964,10 @@ bool replica::update_local_configuration(const replica_configuration &config,
            boost::lexical_cast<std::string>(_config).c_str());
 
     if (status() != old_status) {
+        // the share of the table quotas changes with the local primaries, see table_throttler
+        _table_throttler->update_primary(get_gpid().get_partition_index(),
+                                         status() == partition_status::PS_PRIMARY);
+
         bool is_closing =
             (status() == partition_status::PS_ERROR ||
              (status() == partition_status::PS_INACTIVE && get_ballot() > old_ballot));
@@ -1019,6 +1024,7 @@ void replica::on_config_sync(const app_info &info, const partition_configuration
         return;
 
     update_app_envs(info.envs);
+    update_storage_size();
     _duplicating = info.duplicating;
 
     if (status() == partition_status::PS_PRIMARY ||
@@ -49,6 +49,7 @@ void replica_http_service::query_duplication_handler(const http_request &req, ht
             {"not_confirmed_mutations_num", s.second.not_confirmed},
             {"not_duplicated_mutations_num", s.second.not_duplicated},
             {"fail_mode", duplication_fail_mode_to_string(s.second.fail_mode)},
+            {"time_to_catch_up_seconds", s.second.time_to_catch_up_seconds},
         };
     }
     resp.status_code = http_status_code::ok;
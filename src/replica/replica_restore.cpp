@@ -108,20 +108,62 @@ error_code replica::download_checkpoint(const configuration_restore_request &req
         return err;
     }
 
-    // download checkpoint files
-    task_tracker tracker;
+    // the shared files are downloaded from the shared files of the app, named by their content
+    const std::set<std::string> shared_files(backup_metadata.shared_files.begin(),
+                                             backup_metadata.shared_files.end());
+    const std::string shared_files_path = cold_backup::get_shared_files_path(
+        req.cluster_name, req.policy_name, req.app_name, req.app_id);
+
+    // download the checkpoint files concurrently, the larger ones first so that the restore
+    // isn't kept waiting for a large file at last. the files being downloaded are limited by
+    // the download slots of the disk, shared by all the replicas restored to the disk.
+    std::vector<const file_meta *> files;
     for (const auto &f_meta : backup_metadata.files) {
-        tasking::enqueue(
-            TASK_CODE_EXEC_INLINED,
+        files.emplace_back(&f_meta);
+    }
+    std::sort(files.begin(), files.end(), [](const file_meta *f1, const file_meta *f2) {
+        return f1->size > f2->size;
+    });
+
+    zlock err_lock;
+    std::atomic<uint64_t> last_report_ms(dsn_now_ms());
+    task_tracker tracker;
+    for (const file_meta *f : files) {
+        // woken up by the download callbacks releasing the slots
+        _stub->_fs_manager.acquire_download_slot(local_chkpt_dir);
+        {
+            // stop downloading the remaining files if any fails
+            zauto_lock l(err_lock);
+            if (err != ERR_OK) {
+                _stub->_fs_manager.release_download_slot(local_chkpt_dir);
+                break;
+            }
+        }
+
+        const file_meta &f_meta = *f;
+        bool shared = shared_files.count(f_meta.name) > 0;
+        const std::string &remote_dir = shared ? shared_files_path : remote_chkpt_dir;
+        const std::string remote_file_name =
+            shared ? cold_backup::get_shared_file_name(f_meta.md5, f_meta.size) : f_meta.name;
+        _stub->_block_service_manager.download_file_async(
+            remote_dir,
+            remote_file_name,
+            local_chkpt_dir,
+            f_meta.name,
+            fs,
             &tracker,
-            [this, &err, remote_chkpt_dir, local_chkpt_dir, f_meta, fs]() {
-                uint64_t f_size = 0;
-                error_code download_err = _stub->_block_service_manager.download_file(
-                    remote_chkpt_dir, local_chkpt_dir, f_meta.name, fs, f_size);
-                const std::string file_name =
-                    utils::filesystem::path_combine(local_chkpt_dir, f_meta.name);
-                if (download_err == ERR_OK &&
-                    !utils::filesystem::verify_file(file_name, f_meta.md5, f_meta.size)) {
+            [this, &err, &err_lock, &last_report_ms, local_chkpt_dir, f_meta](
+                error_code download_err, uint64_t f_size, const std::string &f_md5) {
+                _stub->_fs_manager.release_download_slot(local_chkpt_dir);
+                // verify with the size and md5 returned by the download, rather than reading
+                // the file again
+                if (download_err == ERR_OK && (f_size != f_meta.size || f_md5 != f_meta.md5)) {
+                    derror_replica("file({}) is damaged, size: {} VS {}, md5: {} VS {}",
+                                   f_meta.name,
+                                   f_size,
+                                   f_meta.size,
+                                   f_md5,
+                                   f_meta.md5);
                     download_err = ERR_CORRUPTION;
                 }
 
@@ -130,16 +172,23 @@ error_code replica::download_checkpoint(const configuration_restore_request &req
                         "failed to download file({}), error = {}", f_meta.name, download_err);
                     // ERR_CORRUPTION means we should rollback restore, so we can't change err if it
                     // is ERR_CORRUPTION now, otherwise it will be overridden by other errors
+                    zauto_lock l(err_lock);
                     if (err != ERR_CORRUPTION) {
                         err = download_err;
-                        return;
                     }
+                    return;
                 }
 
                 // update progress if download file succeed
                 update_restore_progress(f_size);
-                // report current status to meta server
-                report_restore_status_to_meta();
+                // report current status to meta server, at most once a second as the files
+                // are downloaded concurrently
+                uint64_t last_ms = last_report_ms.load();
+                uint64_t now_ms = dsn_now_ms();
+                if (now_ms >= last_ms + 1000 &&
+                    last_report_ms.compare_exchange_strong(last_ms, now_ms)) {
+                    report_restore_status_to_meta();
+                }
             });
     }
     tracker.wait_outstanding_tasks();
@@ -161,12 +210,14 @@ error_code replica::get_backup_metadata(block_filesystem *fs,
 {
     // download metadata file
     uint64_t download_file_size = 0;
+    std::string download_file_md5;
     error_code err =
         _stub->_block_service_manager.download_file(remote_chkpt_dir,
                                                     local_chkpt_dir,
                                                     cold_backup_constant::BACKUP_METADATA,
                                                     fs,
-                                                    download_file_size);
+                                                    download_file_size,
+                                                    download_file_md5);
     if (err != ERR_OK) {
         derror_replica("download backup_metadata failed, file({}), reason({})",
                        utils::filesystem::path_combine(remote_chkpt_dir,
@@ -254,6 +254,17 @@ void replica_stub::install_perf_counters()
         "dup.pending_mutations_count",
         COUNTER_TYPE_VOLATILE_NUMBER,
         "number of mutations pending for duplication");
+    _counter_dup_max_ship_lag_decrees.init_app_counter(
+        "eon.replica_stub",
+        "dup.max_ship_lag_decrees",
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "the max number of decrees that a primary replica lags behind in duplication");
+    _counter_dup_max_time_to_catch_up_seconds.init_app_counter(
+        "eon.replica_stub",
+        "dup.max_time_to_catch_up_seconds",
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "the max estimated seconds for a catching-up duplication to catch up, -1 if any "
+        "duplication is falling behind");
 
     // <- Cold Backup Metrics ->
 
@@ -301,6 +312,12 @@ void replica_stub::install_perf_counters()
         "cold.backup.recent.upload.file.size",
         COUNTER_TYPE_VOLATILE_NUMBER,
         "current cold backup upload file size in the recent perriod");
+    _counter_cold_backup_recent_reuse_file_size.init_app_counter(
+        "eon.replica_stub",
+        "cold.backup.recent.reuse.file.size",
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "current cold backup size of the shared files reused from the previous backups in the "
+        "recent period");
     _counter_cold_backup_max_duration_time_ms.init_app_counter(
         "eon.replica_stub",
         "cold.backup.max.duration.time.ms",
@@ -1197,6 +1214,12 @@ void replica_stub::get_replica_info(replica_info &info, replica_ptr r)
     if (dsn::ERR_OK != err) {
         dwarn("get disk tag of %s failed: %s", r->dir().c_str(), err.to_string());
     }
+
+    int64_t read_qps, write_qps, storage_mb;
+    r->get_load_stats(read_qps, write_qps, storage_mb);
+    info.__set_read_qps(read_qps);
+    info.__set_write_qps(write_qps);
+    info.__set_storage_mb(storage_mb);
 }
 
 void replica_stub::get_local_replicas(std::vector<replica_info> &replicas)
@@ -2765,5 +2788,26 @@ void replica_stub::on_group_bulk_load(group_bulk_load_rpc rpc)
     }
 }
 
+std::shared_ptr<table_throttler> replica_stub::get_table_throttler(int32_t app_id,
+                                                                   const std::string &app_name)
+{
+    zauto_lock l(_table_throttlers_lock);
+    std::shared_ptr<table_throttler> throttler = _table_throttlers[app_id].lock();
+    if (throttler == nullptr) {
+        throttler = std::make_shared<table_throttler>(app_name);
+        _table_throttlers[app_id] = throttler;
+    }
+
+    // drop the entries of the tables whose replicas are all gone
+    for (auto it = _table_throttlers.begin(); it != _table_throttlers.end();) {
+        if (it->second.expired()) {
+            it = _table_throttlers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return throttler;
+}
+
 } // namespace replication
 } // namespace dsn
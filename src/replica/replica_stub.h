@@ -42,6 +42,7 @@
 #include "common/fs_manager.h"
 #include "block_service/block_service_manager.h"
 #include "replica.h"
+#include "table_throttler.h"
 
 namespace dsn {
 namespace replication {
@@ -176,6 +177,11 @@ public:
                                         bool allow_empty_args,
                                         std::function<std::string(const replica_ptr &rep)> func);
 
+    // the throttler shared by all the local partitions of the table, it's destroyed along with
+    // its perf-counters once the last local replica of the table is gone
+    std::shared_ptr<table_throttler> get_table_throttler(int32_t app_id,
+                                                         const std::string &app_name);
+
     //
     // partition split
     //
@@ -370,6 +376,9 @@ private:
     // write body size exceed this threshold will be logged and reject, 0 means no check
     uint64_t _max_allowed_write_size;
 
+    zlock _table_throttlers_lock;
+    std::unordered_map<int32_t, std::weak_ptr<table_throttler>> _table_throttlers;
+
     // replica count exectuting bulk load downloading concurrently
     std::atomic_int _bulk_load_downloading_count;
 
@@ -412,6 +421,8 @@ private:
     //               if we need to duplicate to multiple clusters someday.
     perf_counter_wrapper _counter_dup_confirmed_rate;
     perf_counter_wrapper _counter_dup_pending_mutations_count;
+    perf_counter_wrapper _counter_dup_max_ship_lag_decrees;
+    perf_counter_wrapper _counter_dup_max_time_to_catch_up_seconds;
 
     perf_counter_wrapper _counter_cold_backup_running_count;
     perf_counter_wrapper _counter_cold_backup_recent_start_count;
@@ -422,6 +433,7 @@ private:
     perf_counter_wrapper _counter_cold_backup_recent_upload_file_succ_count;
     perf_counter_wrapper _counter_cold_backup_recent_upload_file_fail_count;
     perf_counter_wrapper _counter_cold_backup_recent_upload_file_size;
+    perf_counter_wrapper _counter_cold_backup_recent_reuse_file_size;
     perf_counter_wrapper _counter_cold_backup_max_duration_time_ms;
     perf_counter_wrapper _counter_cold_backup_max_upload_file_size;
 
@@ -6,14 +6,22 @@
 #include "mutation.h"
 #include "mutation_log.h"
 #include "replica_stub.h"
+#include "table_throttler.h"
 
 #include <dsn/dist/replication/replication_app_base.h>
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/dist/replication/replica_envs.h>
+#include <dsn/utility/flags.h>
 
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_bool("replication",
+                enable_adaptive_write_throttling,
+                false,
+                "whether to throttle the writes of a replica by a limit adjusted from the write "
+                "latency, the write qps throttling of app-envs is its upper limit");
+
 bool replica::throttle_request(throttling_controller &controller,
                                message_ex *request,
                                int32_t request_units)
@@ -51,12 +59,34 @@ bool replica::throttle_request(throttling_controller &controller,
     return false;
 }
 
+bool replica::throttle_request_adaptively(message_ex *request)
+{
+    if (!FLAGS_enable_adaptive_write_throttling) {
+        return false;
+    }
+
+    bool admitted = _write_adaptive_throttling_controller.control(dsn_now_ms());
+    _counter_write_adaptive_throttling_limit->set(_write_adaptive_throttling_controller.limit());
+    if (admitted) {
+        return false;
+    }
+    response_client_write(request, ERR_BUSY);
+    _counter_recent_write_adaptive_throttling_reject_count->increment();
+    return true;
+}
+
 void replica::update_throttle_envs(const std::map<std::string, std::string> &envs)
 {
     update_throttle_env_internal(
         envs, replica_envs::WRITE_QPS_THROTTLING, _write_qps_throttling_controller);
     update_throttle_env_internal(
         envs, replica_envs::WRITE_SIZE_THROTTLING, _write_size_throttling_controller);
+    _write_adaptive_throttling_controller.set_upper_limit(
+        _write_qps_throttling_controller.limit_units());
+    _table_throttler->update(get_gpid().get_partition_index(),
+                             _app_info.partition_count,
+                             status() == partition_status::PS_PRIMARY,
+                             envs);
 }
 
 void replica::update_throttle_env_internal(const std::map<std::string, std::string> &envs,
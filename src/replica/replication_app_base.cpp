@@ -329,6 +329,24 @@ bool replication_app_base::is_primary() const
 
 bool replication_app_base::is_duplicating() const { return _replica->is_duplicating(); }
 
+int64_t replication_app_base::get_storage_size_mb() const
+{
+    std::vector<std::string> files;
+    if (!dsn::utils::filesystem::get_subfiles(_dir_data, files, true)) {
+        dwarn("%s: get files of data dir %s failed", replica_name(), _dir_data.c_str());
+        return 0;
+    }
+
+    int64_t total_size = 0;
+    for (const std::string &file : files) {
+        int64_t file_size = 0;
+        if (dsn::utils::filesystem::file_size(file, file_size)) {
+            total_size += file_size;
+        }
+    }
+    return total_size >> 20;
+}
+
 error_code replication_app_base::open_internal(replica *r)
 {
     if (!dsn::utils::filesystem::directory_exists(_dir_data)) {
@@ -0,0 +1,173 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "table_throttler.h"
+
+#include <algorithm>
+
+#include <dsn/c/api_utilities.h>
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/dist/replication/replica_envs.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/string_conv.h>
+
+namespace dsn {
+namespace replication {
+
+DSN_DEFINE_uint32("replication",
+                  table_throttling_burst_seconds,
+                  1,
+                  "the seconds of quota a table is able to accumulate on a node for bursts");
+DSN_DEFINE_validator(table_throttling_burst_seconds, [](uint32_t value) { return value > 0; });
+
+/*static*/ bool table_throttler::parse_units(std::string env_value, /*out*/ int64_t &units)
+{
+    int64_t unit_multiplier = 1;
+    if (!env_value.empty()) {
+        if (*env_value.rbegin() == 'M') {
+            unit_multiplier = 1000 * 1000;
+        } else if (*env_value.rbegin() == 'K') {
+            unit_multiplier = 1000;
+        }
+        if (unit_multiplier != 1) {
+            env_value.pop_back();
+        }
+    }
+    if (!buf2int64(env_value, units) || units < 0) {
+        return false;
+    }
+    units *= unit_multiplier;
+    return true;
+}
+
+table_throttler::table_throttler(const std::string &app_name) : _app_name(app_name)
+{
+    _counter_recent_write_reject_count.init_app_counter(
+        "eon.replica",
+        fmt::format("recent.table.write.throttling.reject.count@{}", app_name).c_str(),
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "writes rejected by the table-level throttling");
+    _counter_recent_write_reject_bytes.init_app_counter(
+        "eon.replica",
+        fmt::format("recent.table.write.throttling.reject.bytes@{}", app_name).c_str(),
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "bytes of the writes rejected by the table-level throttling");
+    _counter_recent_read_reject_count.init_app_counter(
+        "eon.replica",
+        fmt::format("recent.table.read.throttling.reject.count@{}", app_name).c_str(),
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "reads rejected by the table-level throttling");
+}
+
+void table_throttler::update(int32_t pidx,
+                             int32_t partition_count,
+                             bool is_primary,
+                             const std::map<std::string, std::string> &envs)
+{
+    zauto_lock l(_lock);
+    _partition_count = partition_count;
+    if (is_primary) {
+        _primaries.insert(pidx);
+    } else {
+        _primaries.erase(pidx);
+    }
+    update_quota(envs, replica_envs::TABLE_WRITE_QPS_THROTTLING, _write_qps);
+    update_quota(envs, replica_envs::TABLE_WRITE_SIZE_THROTTLING, _write_size);
+    update_quota(envs, replica_envs::TABLE_READ_QPS_THROTTLING, _read_qps);
+    update_rates();
+}
+
+void table_throttler::update_primary(int32_t pidx, bool is_primary)
+{
+    zauto_lock l(_lock);
+    if (is_primary) {
+        _primaries.insert(pidx);
+    } else {
+        _primaries.erase(pidx);
+    }
+    update_rates();
+}
+
+void table_throttler::remove(int32_t pidx)
+{
+    zauto_lock l(_lock);
+    _primaries.erase(pidx);
+    update_rates();
+}
+
+bool table_throttler::consume_write(int64_t request_bytes)
+{
+    if (consume(_write_qps, 1)) {
+        if (consume(_write_size, request_bytes)) {
+            return true;
+        }
+        give_back(_write_qps, 1);
+    }
+    _counter_recent_write_reject_count->increment();
+    _counter_recent_write_reject_bytes->add(request_bytes);
+    return false;
+}
+
+bool table_throttler::consume_read()
+{
+    if (!consume(_read_qps, 1)) {
+        _counter_recent_read_reject_count->increment();
+        return false;
+    }
+    return true;
+}
+
+void table_throttler::update_quota(const std::map<std::string, std::string> &envs,
+                                   const std::string &key,
+                                   quota &q)
+{
+    int64_t units = 0;
+    auto iter = envs.find(key);
+    if (iter != envs.end() && !parse_units(iter->second, units)) {
+        dwarn_f("{}: parse env failed, key = \"{}\", value = \"{}\"", _app_name, key, iter->second);
+        units = 0;
+    }
+    if (units != q.table_units) {
+        ddebug_f("{}: switch {} from {} to {}", _app_name, key, q.table_units, units);
+        q.table_units = units;
+    }
+}
+
+void table_throttler::update_rates()
+{
+    // a primary reported late still gets its share
+    const int32_t primary_count = std::max<int32_t>(1, _primaries.size());
+    for (quota *q : {&_write_qps, &_write_size, &_read_qps}) {
+        double rate = 0;
+        if (q->table_units > 0 && _partition_count > 0) {
+            rate = std::max(
+                1.0, static_cast<double>(q->table_units) * primary_count / _partition_count);
+        }
+        q->burst.store(rate * FLAGS_table_throttling_burst_seconds, std::memory_order_relaxed);
+        q->rate.store(rate, std::memory_order_relaxed);
+    }
+}
+
+/*static*/ bool table_throttler::consume(quota &q, double units)
+{
+    const double rate = q.rate.load(std::memory_order_relaxed);
+    if (rate <= 0) {
+        return true;
+    }
+    const double burst = std::max(1.0, q.burst.load(std::memory_order_relaxed));
+    // a request larger than the burst is admitted once the bucket is full, otherwise it would
+    // never succeed
+    return q.bucket.consume(std::min(units, burst), rate, burst);
+}
+
+/*static*/ void table_throttler::give_back(quota &q, double units)
+{
+    const double rate = q.rate.load(std::memory_order_relaxed);
+    if (rate > 0) {
+        q.bucket.returnTokens(units, rate);
+    }
+}
+
+} // namespace replication
+} // namespace dsn
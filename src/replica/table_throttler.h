@@ -0,0 +1,96 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/tool-api/zlocks.h>
+#include <dsn/utility/TokenBucket.h>
+
+namespace dsn {
+namespace replication {
+
+// Used for table-level throttling on a replica server.
+//
+// The quotas of app-envs replica.table_write_throttling, replica.table_write_throttling_by_size
+// and replica.table_read_throttling are the units per second of the whole table. Every node
+// enforces the share of its local primaries, that is `quota * local primary count /
+// partition count`, by token buckets shared by all the local primaries of the table, so a hot
+// partition is able to use the credit left by the idle ones instead of being throttled by a
+// per-partition limit. The buckets hold up to [replication] table_throttling_burst_seconds of
+// the share.
+//
+// One table_throttler per table, which is shared by the local replicas of the table, see
+// replica_stub::get_table_throttler. The primaries are reported on every update of app-envs and
+// every change of the partition status.
+//
+// thread safe
+class table_throttler
+{
+public:
+    explicit table_throttler(const std::string &app_name);
+
+    // update the quotas from app-envs and whether the partition of `pidx` is a local primary.
+    void update(int32_t pidx,
+                int32_t partition_count,
+                bool is_primary,
+                const std::map<std::string, std::string> &envs);
+
+    // the partition of `pidx` becomes or stops being a local primary.
+    void update_primary(int32_t pidx, bool is_primary);
+
+    // the partition of `pidx` is closed.
+    void remove(int32_t pidx);
+
+    // return false if the request should be rejected.
+    bool consume_write(int64_t request_bytes);
+    // only the reads of local primaries are counted, as the share of a node is computed from them
+    bool consume_read();
+
+private:
+    friend class table_throttler_test;
+
+    struct quota
+    {
+        // units per second of the whole table, 0 means unlimited
+        int64_t table_units{0};
+        std::atomic<double> rate{0};
+        std::atomic<double> burst{0};
+        folly::DynamicTokenBucket bucket;
+    };
+
+    // the units may be followed by 'K' or 'M', e.g. "20K"
+    static bool parse_units(std::string env_value, /*out*/ int64_t &units);
+
+    void update_quota(const std::map<std::string, std::string> &envs,
+                      const std::string &key,
+                      quota &q);
+    // update the rates of the quotas by the current local primaries
+    void update_rates();
+    static bool consume(quota &q, double units);
+    // give back the units consumed by a request rejected by another quota
+    static void give_back(quota &q, double units);
+
+    const std::string _app_name;
+
+    zlock _lock;
+    int32_t _partition_count{0};
+    std::set<int32_t> _primaries;
+
+    quota _write_qps;
+    quota _write_size;
+    quota _read_qps;
+
+    perf_counter_wrapper _counter_recent_write_reject_count;
+    perf_counter_wrapper _counter_recent_write_reject_bytes;
+    perf_counter_wrapper _counter_recent_read_reject_count;
+};
+
+} // namespace replication
+} // namespace dsn
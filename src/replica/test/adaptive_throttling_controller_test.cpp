@@ -0,0 +1,152 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "utils/adaptive_throttling_controller.h"
+
+#include <algorithm>
+
+#include <dsn/utility/flags.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+namespace replication {
+
+DSN_DECLARE_uint64(adaptive_throttling_window_ms);
+DSN_DECLARE_uint64(adaptive_throttling_target_latency_ms);
+DSN_DECLARE_int64(adaptive_throttling_min_qps);
+DSN_DECLARE_int64(adaptive_throttling_increase_qps);
+DSN_DECLARE_double(adaptive_throttling_decrease_ratio);
+
+class adaptive_throttling_controller_test : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        FLAGS_adaptive_throttling_window_ms = 1000;
+        FLAGS_adaptive_throttling_target_latency_ms = 50;
+        FLAGS_adaptive_throttling_min_qps = 10;
+        FLAGS_adaptive_throttling_increase_qps = 100;
+        FLAGS_adaptive_throttling_decrease_ratio = 0.7;
+    }
+
+    struct window_result
+    {
+        int64_t admitted;
+        int64_t rejected;
+        uint64_t latency_ms;
+    };
+
+    // Simulate a window of a replica which can serve `CAPACITY` writes per second: the latency
+    // is low under the capacity, and grows with the queue once the admitted writes exceed it.
+    // `static_limit` simulates the static throttling ahead of the controller, 0 means none.
+    window_result run_window(adaptive_throttling_controller &cntl,
+                             int64_t offered,
+                             int64_t static_limit = 0)
+    {
+        window_result result{0, 0, 0};
+        const int64_t passed = static_limit > 0 ? std::min(offered, static_limit) : offered;
+        for (int64_t i = 0; i < passed; i++) {
+            if (cntl.control(_now_ms + i * 1000 / passed)) {
+                result.admitted++;
+            } else {
+                result.rejected++;
+            }
+        }
+        result.latency_ms = BASE_LATENCY_MS;
+        if (result.admitted > CAPACITY) {
+            result.latency_ms += (result.admitted - CAPACITY) * 1000 / CAPACITY;
+        }
+        for (int64_t i = 0; i < result.admitted; i++) {
+            cntl.add_latency(result.latency_ms * 1000);
+        }
+        _now_ms += 1000;
+        return result;
+    }
+
+    int64_t limit(const adaptive_throttling_controller &cntl) const { return cntl._limit; }
+
+    const int64_t CAPACITY = 1000;
+    const uint64_t BASE_LATENCY_MS = 10;
+    uint64_t _now_ms = 1000000;
+};
+
+TEST_F(adaptive_throttling_controller_test, simulated_overload)
+{
+    adaptive_throttling_controller cntl;
+
+    // under the capacity, nothing is rejected
+    for (int i = 0; i < 10; i++) {
+        window_result r = run_window(cntl, 800);
+        ASSERT_EQ(800, r.admitted);
+        ASSERT_EQ(0, r.rejected);
+    }
+    ASSERT_EQ(0, limit(cntl));
+
+    // overloaded by 3 times the capacity, the admitted writes converge around the capacity
+    int overloaded_windows = 0;
+    for (int i = 0; i < 40; i++) {
+        window_result r = run_window(cntl, 3 * CAPACITY);
+        if (i < 5) {
+            continue;
+        }
+        ASSERT_GT(limit(cntl), 0);
+        ASSERT_GE(r.admitted, CAPACITY / 2) << i;
+        ASSERT_LE(r.admitted, CAPACITY + 2 * FLAGS_adaptive_throttling_increase_qps) << i;
+        if (r.latency_ms > FLAGS_adaptive_throttling_target_latency_ms) {
+            overloaded_windows++;
+        }
+    }
+    // AIMD probes above the capacity once in a while
+    ASSERT_LE(overloaded_windows, 35 / 3);
+
+    // the static limit is the upper limit
+    const int64_t static_limit = CAPACITY / 2;
+    cntl.set_upper_limit(static_limit);
+    for (int i = 0; i < 10; i++) {
+        run_window(cntl, 3 * CAPACITY, static_limit);
+        ASSERT_LE(limit(cntl), static_limit);
+    }
+
+    // the load drops, the limit is increased until nothing is rejected
+    cntl.set_upper_limit(0);
+    for (int i = 0; i < 10; i++) {
+        window_result r = run_window(cntl, 800);
+        if (i >= 5) {
+            ASSERT_EQ(800, r.admitted);
+            ASSERT_EQ(0, r.rejected);
+        }
+    }
+}
+
+TEST_F(adaptive_throttling_controller_test, static_limit_above_capacity)
+{
+    adaptive_throttling_controller cntl;
+    const int64_t static_limit = 2 * CAPACITY;
+    cntl.set_upper_limit(static_limit);
+
+    // the limit converges around the capacity rather than oscillating up to the static limit
+    for (int i = 0; i < 40; i++) {
+        window_result r = run_window(cntl, 3 * CAPACITY, static_limit);
+        if (i < 5) {
+            continue;
+        }
+        ASSERT_GT(limit(cntl), 0) << i;
+        ASSERT_LE(limit(cntl), static_limit) << i;
+        ASSERT_LE(r.admitted, CAPACITY + 2 * FLAGS_adaptive_throttling_increase_qps) << i;
+    }
+}
+
+TEST_F(adaptive_throttling_controller_test, min_limit)
+{
+    adaptive_throttling_controller cntl;
+    cntl.control(_now_ms);
+    // extremely slow even if only a few writes
+    cntl.add_latency(10 * 1000 * 1000);
+    _now_ms += 1000;
+    cntl.control(_now_ms);
+    ASSERT_EQ(FLAGS_adaptive_throttling_min_qps, limit(cntl));
+}
+
+} // namespace replication
+} // namespace dsn
@@ -363,9 +363,12 @@ struct mock_mutation_duplicator : public mutation_duplicator
 
     void duplicate(mutation_tuple_set mut, callback cb) override { _func(mut, cb); }
 
+    bool allows_concurrent_batches() const override { return _concurrent; }
+
     typedef std::function<void(mutation_tuple_set, callback)> duplicate_function;
     static void mock(duplicate_function hook) { _func = std::move(hook); }
     static duplicate_function _func;
+    static bool _concurrent;
 };
 
 } // namespace replication
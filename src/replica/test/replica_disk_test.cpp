@@ -2,6 +2,8 @@
 // This source code is licensed under the Apache License Version 2.0, which
 // can be found in the LICENSE file in the root directory of this source tree.
 
+#include <atomic>
+#include <thread>
 #include <gtest/gtest.h>
 
 #include <dsn/utility/fail_point.h>
@@ -39,6 +41,8 @@ public:
         return stub->_fs_manager._dir_nodes;
     }
 
+    fs_manager &get_fs_manager() { return stub->_fs_manager; }
+
 private:
     void generate_mock_app_info()
     {
@@ -172,5 +176,47 @@ TEST_F(replica_disk_test, on_query_disk_info_one_app)
     }
 }
 
+TEST_F(replica_disk_test, download_slot)
+{
+    // 4 slots for each disk by default
+    const std::string dir_1 = "full_dir_1/1.1.replica";
+    const std::string dir_2 = "full_dir_2/1.2.replica";
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(get_fs_manager().try_acquire_download_slot(dir_1));
+    }
+    ASSERT_FALSE(get_fs_manager().try_acquire_download_slot(dir_1));
+    ASSERT_TRUE(get_fs_manager().try_acquire_download_slot(dir_2));
+
+    get_fs_manager().release_download_slot(dir_1);
+    ASSERT_TRUE(get_fs_manager().try_acquire_download_slot(dir_1));
+    for (int i = 0; i < 4; i++) {
+        get_fs_manager().release_download_slot(dir_1);
+    }
+    get_fs_manager().release_download_slot(dir_2);
+
+    // acquire_download_slot waits for a slot to be released
+    for (int i = 0; i < 4; i++) {
+        get_fs_manager().acquire_download_slot(dir_1);
+    }
+    std::atomic_bool acquired(false);
+    std::thread waiter([this, &dir_1, &acquired]() {
+        get_fs_manager().acquire_download_slot(dir_1);
+        acquired = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(acquired);
+    get_fs_manager().release_download_slot(dir_1);
+    waiter.join();
+    ASSERT_TRUE(acquired);
+    for (int i = 0; i < 4; i++) {
+        get_fs_manager().release_download_slot(dir_1);
+    }
+
+    // the dir not on any disk isn't limited
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(get_fs_manager().try_acquire_download_slot("not_exist_dir"));
+    }
+}
+
 } // namespace replication
 } // namespace dsn
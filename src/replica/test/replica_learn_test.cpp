@@ -12,6 +12,7 @@ namespace dsn {
 namespace replication {
 
 /*static*/ mock_mutation_duplicator::duplicate_function mock_mutation_duplicator::_func;
+/*static*/ bool mock_mutation_duplicator::_concurrent = false;
 
 class replica_learn_test : public duplication_test_base
 {
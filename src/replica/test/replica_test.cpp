@@ -36,6 +36,8 @@ public:
         return _mock_replica->_counter_backup_request_qps->get_integer_value();
     }
 
+    size_t table_throttler_count() const { return stub->_table_throttlers.size(); }
+
     void mock_app_info()
     {
         _app_info.app_id = 2;
@@ -81,5 +83,17 @@ TEST_F(replica_test, backup_request_qps)
     ASSERT_GT(get_table_level_backup_request_qps(), 0);
 }
 
+TEST_F(replica_test, table_throttler_lifetime)
+{
+    auto throttler = stub->get_table_throttler(3, "table_throttler_lifetime");
+    ASSERT_EQ(throttler, stub->get_table_throttler(3, "table_throttler_lifetime"));
+    ASSERT_EQ(2, table_throttler_count());
+
+    // the throttler is gone along with the last replica of the table
+    throttler.reset();
+    stub->get_table_throttler(_app_info.app_id, _app_info.app_name);
+    ASSERT_EQ(1, table_throttler_count());
+}
+
 } // namespace replication
 } // namespace dsn
@@ -0,0 +1,134 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "replica/table_throttler.h"
+
+#include <dsn/dist/replication/replica_envs.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+namespace replication {
+
+class table_throttler_test : public ::testing::Test
+{
+public:
+    bool parse_units(const std::string &env_value, int64_t &units) const
+    {
+        return table_throttler::parse_units(env_value, units);
+    }
+
+    double write_qps_rate(const table_throttler &throttler) const
+    {
+        return throttler._write_qps.rate.load();
+    }
+
+    // the writes admitted in a burst, a few more may be admitted by the refilled tokens
+    int admitted_writes(table_throttler &throttler, int64_t request_bytes, int max_count)
+    {
+        int admitted = 0;
+        while (admitted < max_count && throttler.consume_write(request_bytes)) {
+            admitted++;
+        }
+        return admitted;
+    }
+};
+
+TEST_F(table_throttler_test, parse_units)
+{
+    struct test_case
+    {
+        std::string env_value;
+        bool ok;
+        int64_t units;
+    } tests[] = {{"100", true, 100},
+                 {"20K", true, 20000},
+                 {"3M", true, 3000000},
+                 {"0", true, 0},
+                 {"-1", false, 0},
+                 {"20A", false, 0},
+                 {"", false, 0}};
+    for (const auto &test : tests) {
+        int64_t units = 0;
+        ASSERT_EQ(test.ok, parse_units(test.env_value, units)) << test.env_value;
+        if (test.ok) {
+            ASSERT_EQ(test.units, units) << test.env_value;
+        }
+    }
+}
+
+TEST_F(table_throttler_test, share_of_local_primaries)
+{
+    table_throttler throttler("table_throttler_test");
+    std::map<std::string, std::string> envs = {{replica_envs::TABLE_WRITE_QPS_THROTTLING, "400"}};
+
+    throttler.update(0, 4, true, envs);
+    ASSERT_DOUBLE_EQ(100, write_qps_rate(throttler));
+    throttler.update(1, 4, true, envs);
+    throttler.update(2, 4, false, envs);
+    ASSERT_DOUBLE_EQ(200, write_qps_rate(throttler));
+
+    // the status of a partition changes between the updates of app-envs
+    throttler.update_primary(2, true);
+    ASSERT_DOUBLE_EQ(300, write_qps_rate(throttler));
+    throttler.update_primary(2, false);
+    ASSERT_DOUBLE_EQ(200, write_qps_rate(throttler));
+
+    // the writes of all the local primaries share the quota, so a hot partition is able to use
+    // the whole burst of the node
+    int admitted = admitted_writes(throttler, 1, 1000);
+    ASSERT_GE(admitted, 200);
+    ASSERT_LT(admitted, 220);
+
+    throttler.remove(1);
+    ASSERT_DOUBLE_EQ(100, write_qps_rate(throttler));
+
+    // unlimited once the env is removed
+    throttler.update(0, 4, true, {});
+    ASSERT_DOUBLE_EQ(0, write_qps_rate(throttler));
+    ASSERT_EQ(1000, admitted_writes(throttler, 1, 1000));
+}
+
+TEST_F(table_throttler_test, write_size)
+{
+    table_throttler throttler("table_throttler_test");
+    throttler.update(0, 1, true, {{replica_envs::TABLE_WRITE_SIZE_THROTTLING, "1K"}});
+
+    ASSERT_TRUE(throttler.consume_write(600));
+    ASSERT_FALSE(throttler.consume_write(600));
+}
+
+TEST_F(table_throttler_test, write_size_reject_keeps_qps)
+{
+    table_throttler throttler("table_throttler_test");
+    throttler.update(0,
+                     1,
+                     true,
+                     {{replica_envs::TABLE_WRITE_QPS_THROTTLING, "10"},
+                      {replica_envs::TABLE_WRITE_SIZE_THROTTLING, "1K"}});
+
+    ASSERT_TRUE(throttler.consume_write(600));
+    for (int i = 0; i < 20; i++) {
+        ASSERT_FALSE(throttler.consume_write(600));
+    }
+    // the writes rejected by size don't use up the qps quota
+    ASSERT_GE(admitted_writes(throttler, 1, 100), 9);
+}
+
+TEST_F(table_throttler_test, read_qps)
+{
+    table_throttler throttler("table_throttler_test");
+    throttler.update(0, 1, true, {{replica_envs::TABLE_READ_QPS_THROTTLING, "10"}});
+
+    int admitted = 0;
+    while (admitted < 100 && throttler.consume_read()) {
+        admitted++;
+    }
+    ASSERT_GE(admitted, 10);
+    ASSERT_LT(admitted, 20);
+    // writes are not limited by the read quota
+    ASSERT_EQ(100, admitted_writes(throttler, 1, 100));
+}
+
+} // namespace replication
+} // namespace dsn
@@ -427,6 +427,12 @@ struct replica_info
     6:i64                    last_durable_decree;
     7:string                 app_type;
     8:string                 disk_tag;
+
+    // load statistics of this replica, reported in config-sync and
+    // used by the load-aware balancer
+    9:optional i64           read_qps;
+    10:optional i64          write_qps;
+    11:optional i64          storage_mb;
 }
 
 struct query_replica_info_request
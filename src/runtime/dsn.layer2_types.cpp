@@ -340,6 +340,18 @@ void configuration_query_by_index_request::__set_partition_indices(const std::ve
     this->partition_indices = val;
 }
 
+void configuration_query_by_index_request::__set_known_ballot_sum(const int64_t val)
+{
+    this->known_ballot_sum = val;
+    __isset.known_ballot_sum = true;
+}
+
+void configuration_query_by_index_request::__set_known_app_id(const int32_t val)
+{
+    this->known_app_id = val;
+    __isset.known_app_id = true;
+}
+
 uint32_t configuration_query_by_index_request::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -386,6 +398,22 @@ uint32_t configuration_query_by_index_request::read(::apache::thrift::protocol::
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 3:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->known_ballot_sum);
+                this->__isset.known_ballot_sum = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 4:
+            if (ftype == ::apache::thrift::protocol::T_I32) {
+                xfer += iprot->readI32(this->known_app_id);
+                this->__isset.known_app_id = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -422,6 +450,16 @@ configuration_query_by_index_request::write(::apache::thrift::protocol::TProtoco
     }
     xfer += oprot->writeFieldEnd();
 
+    if (this->__isset.known_ballot_sum) {
+        xfer += oprot->writeFieldBegin("known_ballot_sum", ::apache::thrift::protocol::T_I64, 3);
+        xfer += oprot->writeI64(this->known_ballot_sum);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.known_app_id) {
+        xfer += oprot->writeFieldBegin("known_app_id", ::apache::thrift::protocol::T_I32, 4);
+        xfer += oprot->writeI32(this->known_app_id);
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -432,6 +470,8 @@ void swap(configuration_query_by_index_request &a, configuration_query_by_index_
     using ::std::swap;
     swap(a.app_name, b.app_name);
     swap(a.partition_indices, b.partition_indices);
+    swap(a.known_ballot_sum, b.known_ballot_sum);
+    swap(a.known_app_id, b.known_app_id);
     swap(a.__isset, b.__isset);
 }
 
@@ -440,6 +480,8 @@ configuration_query_by_index_request::configuration_query_by_index_request(
 {
     app_name = other22.app_name;
     partition_indices = other22.partition_indices;
+    known_ballot_sum = other22.known_ballot_sum;
+    known_app_id = other22.known_app_id;
     __isset = other22.__isset;
 }
 configuration_query_by_index_request::configuration_query_by_index_request(
@@ -447,6 +489,8 @@ configuration_query_by_index_request::configuration_query_by_index_request(
 {
     app_name = std::move(other23.app_name);
     partition_indices = std::move(other23.partition_indices);
+    known_ballot_sum = std::move(other23.known_ballot_sum);
+    known_app_id = std::move(other23.known_app_id);
     __isset = std::move(other23.__isset);
 }
 configuration_query_by_index_request &configuration_query_by_index_request::
@@ -454,6 +498,8 @@ operator=(const configuration_query_by_index_request &other24)
 {
     app_name = other24.app_name;
     partition_indices = other24.partition_indices;
+    known_ballot_sum = other24.known_ballot_sum;
+    known_app_id = other24.known_app_id;
     __isset = other24.__isset;
     return *this;
 }
@@ -462,6 +508,8 @@ operator=(configuration_query_by_index_request &&other25)
 {
     app_name = std::move(other25.app_name);
     partition_indices = std::move(other25.partition_indices);
+    known_ballot_sum = std::move(other25.known_ballot_sum);
+    known_app_id = std::move(other25.known_app_id);
     __isset = std::move(other25.__isset);
     return *this;
 }
@@ -472,6 +520,12 @@ void configuration_query_by_index_request::printTo(std::ostream &out) const
     out << "app_name=" << to_string(app_name);
     out << ", "
         << "partition_indices=" << to_string(partition_indices);
+    out << ", "
+        << "known_ballot_sum=";
+    (__isset.known_ballot_sum ? (out << to_string(known_ballot_sum)) : (out << "<null>"));
+    out << ", "
+        << "known_app_id=";
+    (__isset.known_app_id ? (out << to_string(known_app_id)) : (out << "<null>"));
     out << ")";
 }
 
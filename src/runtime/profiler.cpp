@@ -47,6 +47,7 @@ START<== queue(server) == ENQUEUE <===== net(reply) ======= REPLY <=============
   \/
  END
 */
+#include <algorithm>
 #include <dsn/toollet/profiler.h>
 #include <dsn/service_api_c.h>
 #include <dsn/tool-api/aio_task.h>
@@ -65,6 +66,9 @@ std::unique_ptr<task_spec_profiler[]> s_spec_profilers;
 
 int s_task_code_max = 0;
 
+// whether the light profiling is enabled for any task code
+bool s_light_profile_enabled = false;
+
 std::map<std::string, perf_counter_ptr_type> counter_info::pointer_type;
 
 counter_info *counter_info_ptr[] = {
@@ -150,6 +154,9 @@ static void profiler_on_task_begin(task *this_)
     auto ptr = s_spec_profilers[code].ptr[TASK_QUEUEING_TIME_NS].get();
     if (ptr != nullptr)
         ptr->set(now - qts);
+    auto stats = s_spec_profilers[code].stats;
+    if (stats != nullptr)
+        stats->record_queue_time(now - qts);
     qts = now;
 
     ptr = s_spec_profilers[code].ptr[TASK_IN_QUEUE].get();
@@ -167,6 +174,9 @@ static void profiler_on_task_end(task *this_)
     auto ptr = s_spec_profilers[code].ptr[TASK_EXEC_TIME_NS].get();
     if (ptr != nullptr)
         ptr->set(now - qts);
+    auto stats = s_spec_profilers[code].stats;
+    if (stats != nullptr)
+        stats->record_exec_time(now - qts);
 
     ptr = s_spec_profilers[code].ptr[TASK_THROUGHPUT].get();
     if (ptr != nullptr)
@@ -330,6 +340,69 @@ static void profiler_on_rpc_response_enqueue(rpc_response_task *resp)
         ptr->increment();
 }
 
+// the join points of the task codes which are only light profiled, which just keep the time
+// the tasks are enqueued so that the queueing time can be got when they begin
+static void profiler_light_on_task_enqueue(task *caller, task *callee)
+{
+    task_ext_for_profiler::get(callee) = dsn_now_ns();
+}
+
+static void profiler_light_on_aio_enqueue(aio_task *this_)
+{
+    task_ext_for_profiler::get(this_) = dsn_now_ns();
+}
+
+static void profiler_light_on_rpc_request_enqueue(rpc_request_task *callee)
+{
+    task_ext_for_profiler::get(callee) = dsn_now_ns();
+}
+
+static void profiler_light_on_rpc_response_enqueue(rpc_response_task *resp)
+{
+    task_ext_for_profiler::get(resp) = dsn_now_ns();
+}
+
+bool get_task_code_stats(int top, /*out*/ std::vector<task_code_stats_info> &stats)
+{
+    stats.clear();
+    if (!s_light_profile_enabled) {
+        return false;
+    }
+
+    task_code_stats::snapshot snap;
+    for (int i = 0; i <= s_task_code_max; i++) {
+        if (s_spec_profilers[i].stats == nullptr) {
+            continue;
+        }
+        s_spec_profilers[i].stats->get_snapshot(snap);
+        if (snap.count == 0) {
+            continue;
+        }
+
+        task_code_stats_info info;
+        info.task_code = dsn::task_code(i).to_string();
+        info.count = snap.count;
+        info.total_queue_ns = snap.total_queue_ns;
+        info.total_exec_ns = snap.total_exec_ns;
+        info.queue_ns_p50 = snap.queue_ns.percentile(0.5);
+        info.queue_ns_p99 = snap.queue_ns.percentile(0.99);
+        info.exec_ns_p50 = snap.exec_ns.percentile(0.5);
+        info.exec_ns_p99 = snap.exec_ns.percentile(0.99);
+        stats.emplace_back(std::move(info));
+    }
+
+    auto by_exec_time = [](const task_code_stats_info &l, const task_code_stats_info &r) {
+        return l.total_exec_ns > r.total_exec_ns;
+    };
+    if (top > 0 && top < (int)stats.size()) {
+        std::partial_sort(stats.begin(), stats.begin() + top, stats.end(), by_exec_time);
+        stats.resize(top);
+    } else {
+        std::sort(stats.begin(), stats.end(), by_exec_time);
+    }
+    return true;
+}
+
 void register_command_profiler()
 {
     std::stringstream textp, textpjs, textpd, textquery, textarg;
@@ -423,6 +496,11 @@ void profiler::install(service_spec &)
 
     auto profile = dsn_config_get_value_bool(
         "task..default", "is_profile", false, "whether to profile this kind of task");
+    auto light_profile = dsn_config_get_value_bool(
+        "task..default",
+        "is_light_profile",
+        false,
+        "whether to only record the queueing and executing time of this kind of task");
     auto collect_call_count = dsn_config_get_value_bool(
         "task..default",
         "collect_call_count",
@@ -451,8 +529,28 @@ void profiler::install(service_spec &)
         s_spec_profilers[i].is_profile = dsn_config_get_value_bool(
             section_name.c_str(), "is_profile", profile, "whether to profile this kind of task");
 
-        if (!s_spec_profilers[i].is_profile)
+        if (dsn_config_get_value_bool(
+                section_name.c_str(),
+                "is_light_profile",
+                light_profile,
+                "whether to only record the queueing and executing time of this kind of task")) {
+            s_spec_profilers[i].stats = new task_code_stats();
+            s_light_profile_enabled = true;
+        }
+
+        if (!s_spec_profilers[i].is_profile) {
+            if (s_spec_profilers[i].stats != nullptr) {
+                spec->on_task_enqueue.put_back(profiler_light_on_task_enqueue, "profiler");
+                spec->on_task_begin.put_back(profiler_on_task_begin, "profiler");
+                spec->on_task_end.put_back(profiler_on_task_end, "profiler");
+                spec->on_aio_enqueue.put_back(profiler_light_on_aio_enqueue, "profiler");
+                spec->on_rpc_request_enqueue.put_back(profiler_light_on_rpc_request_enqueue,
+                                                      "profiler");
+                spec->on_rpc_response_enqueue.put_back(profiler_light_on_rpc_response_enqueue,
+                                                       "profiler");
+            }
             continue;
+        }
 
         if (dsn_config_get_value_bool(
                 section_name.c_str(),
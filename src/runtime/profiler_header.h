@@ -27,6 +27,7 @@
 #pragma once
 #include <iomanip>
 #include <dsn/perf_counter/perf_counter_wrapper.h>
+#include "task_code_stats.h"
 
 namespace dsn {
 namespace tools {
@@ -209,12 +210,15 @@ struct task_spec_profiler
     bool collect_call_count;
     bool is_profile;
     std::atomic<int64_t> *call_counts;
+    // not null if the light profiling is enabled
+    task_code_stats *stats;
 
     task_spec_profiler()
     {
         collect_call_count = false;
         is_profile = false;
         call_counts = nullptr;
+        stats = nullptr;
         memset((void *)ptr, 0, sizeof(ptr));
     }
 };
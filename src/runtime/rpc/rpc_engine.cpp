@@ -534,6 +534,7 @@ bool rpc_engine::unregister_rpc_handler(dsn::task_code rpc_code)
 
 void rpc_engine::on_recv_request(network *net, message_ex *msg, int delay_ms)
 {
+    msg->receive_ts_ns = dsn_now_ns();
     if (!_is_serving) {
         dwarn("recv message with rpc name %s from %s when rpc engine is not serving, trace_id = "
               "%" PRIu64,
@@ -611,8 +612,11 @@ void rpc_engine::call(message_ex *request, const rpc_response_task_ptr &call)
 {
     auto &hdr = *request->header;
     hdr.from_address = primary_address();
-    hdr.trace_id = rand::next_u64(std::numeric_limits<decltype(hdr.trace_id)>::min(),
-                                  std::numeric_limits<decltype(hdr.trace_id)>::max());
+    // a sampled request keeps the trace_id of the request it's sent on behalf of
+    if (!hdr.context.u.is_trace_sampled) {
+        hdr.trace_id = rand::next_u64(std::numeric_limits<decltype(hdr.trace_id)>::min(),
+                                      std::numeric_limits<decltype(hdr.trace_id)>::max());
+    }
 
     call_address(request->server_address, request, call);
 }
@@ -55,6 +55,7 @@ message_ex::message_ex()
       local_rpc_code(::dsn::TASK_CODE_INVALID),
       hdr_format(NET_HDR_INVALID),
       send_retry_count(0),
+      receive_ts_ns(0),
       _rw_index(-1),
       _rw_offset(0),
       _rw_committed(true),
@@ -182,6 +182,13 @@ service_engine::service_engine()
         "system.queue - get queue internal information",
         "system.queue",
         &service_engine::get_queue_info);
+    ::dsn::command_manager::instance().register_command(
+        {"system.threadpool"},
+        "system.threadpool - get the saturation of the thread pools, in json format",
+        "system.threadpool: the busy ratio of the workers, the queue length, the enqueue and "
+        "dequeue rates, the average dequeue batch size and the age of the oldest task in the "
+        "queues, where the rates and the busy ratios are of the period since the last call",
+        &service_engine::get_thread_pool_stats);
 }
 
 service_engine::~service_engine() = default;
@@ -278,4 +285,50 @@ std::string service_engine::get_queue_info(const std::vector<std::string> &args)
     return ss.str();
 }
 
+std::string service_engine::get_thread_pool_stats(const std::vector<std::string> &args)
+{
+    utils::table_printer pool_tp("pools");
+    pool_tp.add_title("pool");
+    pool_tp.add_column("worker_count", utils::table_printer::alignment::kRight);
+    pool_tp.add_column("busy_ratio", utils::table_printer::alignment::kRight);
+    pool_tp.add_column("queue_length", utils::table_printer::alignment::kRight);
+    pool_tp.add_column("enqueue_qps", utils::table_printer::alignment::kRight);
+    pool_tp.add_column("dequeue_qps", utils::table_printer::alignment::kRight);
+    pool_tp.add_column("oldest_task_age_ms", utils::table_printer::alignment::kRight);
+    pool_tp.add_column("interval_s", utils::table_printer::alignment::kRight);
+
+    utils::table_printer queue_tp("queues");
+    queue_tp.add_title("queue");
+    queue_tp.add_column("length", utils::table_printer::alignment::kRight);
+    queue_tp.add_column("enqueue_qps", utils::table_printer::alignment::kRight);
+    queue_tp.add_column("dequeue_qps", utils::table_printer::alignment::kRight);
+    queue_tp.add_column("avg_batch_size", utils::table_printer::alignment::kRight);
+    queue_tp.add_column("oldest_task_age_ms", utils::table_printer::alignment::kRight);
+    queue_tp.add_column("dequeued_count", utils::table_printer::alignment::kRight);
+
+    utils::table_printer worker_tp("workers");
+    worker_tp.add_title("worker");
+    worker_tp.add_column("queue");
+    worker_tp.add_column("busy_ratio", utils::table_printer::alignment::kRight);
+    worker_tp.add_column("processed_tps", utils::table_printer::alignment::kRight);
+    worker_tp.add_column("running_batch_ms", utils::table_printer::alignment::kRight);
+    worker_tp.add_column("processed_count", utils::table_printer::alignment::kRight);
+
+    for (auto &kv : service_engine::instance()._nodes_by_app_id) {
+        for (task_worker_pool *pool : kv.second->computation()->pools()) {
+            if (pool != nullptr) {
+                pool->get_stats(pool_tp, queue_tp, worker_tp);
+            }
+        }
+    }
+
+    utils::multi_table_printer mtp;
+    mtp.add(std::move(pool_tp));
+    mtp.add(std::move(queue_tp));
+    mtp.add(std::move(worker_tp));
+    std::ostringstream out;
+    mtp.output(out, utils::table_printer::output_format::kJsonCompact);
+    return out.str();
+}
+
 } // namespace dsn
@@ -117,6 +117,7 @@ public:
     env_provider *env() const { return _env; }
     static std::string get_runtime_info(const std::vector<std::string> &args);
     static std::string get_queue_info(const std::vector<std::string> &args);
+    static std::string get_thread_pool_stats(const std::vector<std::string> &args);
 
     void init_before_toollets(const service_spec &spec);
     void init_after_toollets();
@@ -118,6 +118,7 @@ task::task(dsn::task_code code, int hash, service_node *node)
     _wait_for_cancel = false;
     _is_null = false;
     next = nullptr;
+    enqueue_ts_ns = 0;
 
     if (node != nullptr) {
         _node = node;
@@ -109,6 +109,15 @@ void task_worker_pool::start()
            _spec.worker_share_core ? "true" : "false",
            _spec.partitioned ? "true" : "false");
 
+    // the first call of get_stats() takes the values since now
+    _last_stats.ts_ns = dsn_now_ns();
+    _last_stats.enqueued_task_counts.resize(_queues.size(), 0);
+    _last_stats.dequeued_task_counts.resize(_queues.size(), 0);
+    _last_stats.dequeue_batch_counts.resize(_queues.size(), 0);
+    _last_stats.busy_ns.resize(_workers.size(), 0);
+    _last_stats.idle_ns.resize(_workers.size(), 0);
+    _last_stats.processed_task_counts.resize(_workers.size(), 0);
+
     _is_running = true;
 }
 
@@ -200,6 +209,91 @@ void task_worker_pool::get_queue_info(/*out*/ std::stringstream &ss)
     ss << "]\n";
 }
 
+// the times read from a worker are consistent, the clamping only guards against the clock
+static uint64_t time_delta(uint64_t now, uint64_t last) { return now > last ? now - last : 0; }
+
+void task_worker_pool::get_stats(/*out*/ utils::table_printer &pool_tp,
+                                 /*out*/ utils::table_printer &queue_tp,
+                                 /*out*/ utils::table_printer &worker_tp)
+{
+    utils::auto_lock<utils::ex_lock_nr> l(_stats_lock);
+
+    stats_snapshot now;
+    now.ts_ns = dsn_now_ns();
+    for (task_queue *q : _queues) {
+        now.enqueued_task_counts.push_back(q->enqueued_task_count());
+        now.dequeued_task_counts.push_back(q->dequeued_task_count());
+        now.dequeue_batch_counts.push_back(q->dequeue_batch_count());
+    }
+    std::vector<uint64_t> busy_since_ns;
+    for (task_worker *wk : _workers) {
+        uint64_t busy = 0, idle = 0, since = 0;
+        wk->get_busy_idle_time(now.ts_ns, busy, idle, since);
+        now.busy_ns.push_back(busy);
+        now.idle_ns.push_back(idle);
+        busy_since_ns.push_back(since);
+        now.processed_task_counts.push_back(wk->processed_task_count());
+    }
+
+    uint64_t interval_ns = std::max<uint64_t>(1, now.ts_ns - _last_stats.ts_ns);
+    double interval_s = interval_ns / 1e9;
+    std::string node_name = _node->full_name();
+
+    int total_length = 0;
+    uint64_t total_enqueued = 0, total_dequeued = 0, max_age_ns = 0;
+    for (size_t i = 0; i < _queues.size(); i++) {
+        task_queue *q = _queues[i];
+        uint64_t enqueued = now.enqueued_task_counts[i] - _last_stats.enqueued_task_counts[i];
+        uint64_t dequeued = now.dequeued_task_counts[i] - _last_stats.dequeued_task_counts[i];
+        uint64_t batches = now.dequeue_batch_counts[i] - _last_stats.dequeue_batch_counts[i];
+        uint64_t age_ns = q->oldest_task_age_ns(now.ts_ns);
+        total_length += q->count();
+        total_enqueued += enqueued;
+        total_dequeued += dequeued;
+        max_age_ns = std::max(max_age_ns, age_ns);
+
+        queue_tp.add_row(node_name + "." + q->get_name());
+        queue_tp.append_data(q->count());
+        queue_tp.append_data(enqueued / interval_s);
+        queue_tp.append_data(dequeued / interval_s);
+        queue_tp.append_data(batches == 0 ? 0.0 : (double)dequeued / batches);
+        queue_tp.append_data(age_ns / 1000000);
+        queue_tp.append_data(now.dequeued_task_counts[i]);
+    }
+
+    uint64_t total_busy = 0, total_time = 0;
+    for (size_t i = 0; i < _workers.size(); i++) {
+        task_worker *wk = _workers[i];
+        uint64_t busy = time_delta(now.busy_ns[i], _last_stats.busy_ns[i]);
+        uint64_t time = busy + time_delta(now.idle_ns[i], _last_stats.idle_ns[i]);
+        uint64_t processed = now.processed_task_counts[i] - _last_stats.processed_task_counts[i];
+        total_busy += busy;
+        total_time += time;
+
+        worker_tp.add_row(wk->name());
+        worker_tp.append_data(wk->queue()->get_name());
+        worker_tp.append_data(time == 0 ? 0.0 : (double)busy / time);
+        worker_tp.append_data(processed / interval_s);
+        // how long the current batch of tasks has been running, a large value means the
+        // worker is stalled
+        worker_tp.append_data(busy_since_ns[i] == 0 || busy_since_ns[i] > now.ts_ns
+                                  ? 0
+                                  : (now.ts_ns - busy_since_ns[i]) / 1000000);
+        worker_tp.append_data(now.processed_task_counts[i]);
+    }
+
+    pool_tp.add_row(node_name + "." + _spec.name);
+    pool_tp.append_data(_workers.size());
+    pool_tp.append_data(total_time == 0 ? 0.0 : (double)total_busy / total_time);
+    pool_tp.append_data(total_length);
+    pool_tp.append_data(total_enqueued / interval_s);
+    pool_tp.append_data(total_dequeued / interval_s);
+    pool_tp.append_data(max_age_ns / 1000000);
+    pool_tp.append_data(interval_s);
+
+    _last_stats = std::move(now);
+}
+
 task_engine::task_engine(service_node *node)
 {
     _is_running = false;
@@ -40,6 +40,7 @@
 #include <dsn/tool-api/admission_controller.h>
 #include <dsn/tool-api/task_worker.h>
 #include <dsn/tool-api/timer_service.h>
+#include <dsn/utility/output_utils.h>
 
 namespace dsn {
 
@@ -76,6 +77,11 @@ public:
                           const std::vector<std::string> &args,
                           /*out*/ std::stringstream &ss);
     void get_queue_info(/*out*/ std::stringstream &ss);
+    // add the statistics of this pool, its queues and its workers to the tables, the rates
+    // and the busy ratios are of the period since the last call
+    void get_stats(/*out*/ utils::table_printer &pool_tp,
+                   /*out*/ utils::table_printer &queue_tp,
+                   /*out*/ utils::table_printer &worker_tp);
     std::vector<task_queue *> &queues() { return _queues; }
     std::vector<task_worker *> &workers() { return _workers; }
     std::vector<admission_controller *> &controllers() { return _controllers; }
@@ -92,6 +98,19 @@ private:
     std::vector<timer_service *> _per_queue_timer_svcs;
 
     bool _is_running;
+
+    struct stats_snapshot
+    {
+        uint64_t ts_ns = 0;
+        std::vector<uint64_t> enqueued_task_counts;
+        std::vector<uint64_t> dequeued_task_counts;
+        std::vector<uint64_t> dequeue_batch_counts;
+        std::vector<uint64_t> busy_ns;
+        std::vector<uint64_t> idle_ns;
+        std::vector<uint64_t> processed_task_counts;
+    };
+    ::dsn::utils::ex_lock_nr _stats_lock;
+    stats_snapshot _last_stats;
 };
 
 class task_engine
@@ -32,7 +32,14 @@
 namespace dsn {
 
 task_queue::task_queue(task_worker_pool *pool, int index, task_queue *inner_provider)
-    : _pool(pool), _controller(nullptr), _queue_length(0)
+    : _pool(pool),
+      _controller(nullptr),
+      _queue_length(0),
+      _enqueued_task_count(0),
+      _dequeued_task_count(0),
+      _dequeue_batch_count(0),
+      _last_dequeued_enqueue_ts_ns(0),
+      _non_empty_since_ns(0)
 {
     char num[30];
     sprintf(num, "%u", index);
@@ -94,7 +101,22 @@ void task_queue::enqueue_internal(task *task)
         }
     }
 
+    task->enqueue_ts_ns = dsn_now_ns();
+    _enqueued_task_count.fetch_add(1, std::memory_order_relaxed);
     tls_dsn.last_worker_queue_size = increase_count();
+    if (tls_dsn.last_worker_queue_size == 1) {
+        _non_empty_since_ns.store(task->enqueue_ts_ns, std::memory_order_relaxed);
+    }
     enqueue(task);
 }
+
+uint64_t task_queue::oldest_task_age_ns(uint64_t now_ns) const
+{
+    if (count() <= 0) {
+        return 0;
+    }
+    uint64_t since = std::max(_last_dequeued_enqueue_ts_ns.load(std::memory_order_relaxed),
+                              _non_empty_since_ns.load(std::memory_order_relaxed));
+    return now_ns > since ? now_ns - since : 0;
+}
 }
@@ -51,7 +51,12 @@ task_worker::task_worker(task_worker_pool *pool,
     _is_running = false;
 
     _thread = nullptr;
-    _processed_task_count = 0;
+    _processed_task_count.store(0, std::memory_order_relaxed);
+    _busy_ns.store(0, std::memory_order_relaxed);
+    _idle_ns.store(0, std::memory_order_relaxed);
+    _busy_since_ns.store(0, std::memory_order_relaxed);
+    _idle_since_ns.store(0, std::memory_order_relaxed);
+    _time_version.store(0, std::memory_order_relaxed);
 }
 
 task_worker::~task_worker()
@@ -196,11 +201,34 @@ void task_worker::loop()
     task_queue *q = queue();
     int best_batch_size = pool_spec().dequeue_batch_size;
 
+    begin_time_update();
+    uint64_t now = dsn_now_ns();
+    _idle_since_ns.store(now, std::memory_order_relaxed);
+    end_time_update();
+
     while (_is_running) {
         int batch_size = best_batch_size;
         task *task = q->dequeue(batch_size), *next;
 
+        // the timestamps are taken inside the update, so that a reader sees either the period
+        // in progress or the ended one, and never a period ending before the time it has
+        // already counted the period to
+        begin_time_update();
+        uint64_t dequeued = dsn_now_ns();
+        _idle_ns.store(_idle_ns.load(std::memory_order_relaxed) + (dequeued - now),
+                       std::memory_order_relaxed);
+        if (batch_size == 0) {
+            _idle_since_ns.store(dequeued, std::memory_order_relaxed);
+            end_time_update();
+            now = dequeued;
+            continue;
+        }
+        _idle_since_ns.store(0, std::memory_order_relaxed);
+        _busy_since_ns.store(dequeued, std::memory_order_relaxed);
+        end_time_update();
+
         q->decrease_count(batch_size);
+        q->on_dequeue(task, batch_size);
 
 #ifndef NDEBUG
         int count = 0;
@@ -222,7 +250,58 @@ void task_worker::loop()
                 batch_size);
 #endif
 
-        _processed_task_count += batch_size;
+        begin_time_update();
+        now = dsn_now_ns();
+        _busy_since_ns.store(0, std::memory_order_relaxed);
+        _busy_ns.store(_busy_ns.load(std::memory_order_relaxed) + (now - dequeued),
+                       std::memory_order_relaxed);
+        _idle_since_ns.store(now, std::memory_order_relaxed);
+        end_time_update();
+        _processed_task_count.store(_processed_task_count.load(std::memory_order_relaxed) +
+                                        batch_size,
+                                    std::memory_order_relaxed);
+    }
+}
+
+// a seqlock with the worker thread as the only writer: the version is odd during an update
+void task_worker::begin_time_update()
+{
+    _time_version.store(_time_version.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void task_worker::end_time_update()
+{
+    _time_version.store(_time_version.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_release);
+}
+
+void task_worker::get_busy_idle_time(uint64_t now_ns,
+                                     /*out*/ uint64_t &busy_ns,
+                                     /*out*/ uint64_t &idle_ns,
+                                     /*out*/ uint64_t &busy_since_ns) const
+{
+    uint64_t idle_since_ns = 0;
+    for (;;) {
+        uint64_t version = _time_version.load(std::memory_order_acquire);
+        if (version & 1) {
+            continue;
+        }
+        busy_since_ns = _busy_since_ns.load(std::memory_order_relaxed);
+        idle_since_ns = _idle_since_ns.load(std::memory_order_relaxed);
+        busy_ns = _busy_ns.load(std::memory_order_relaxed);
+        idle_ns = _idle_ns.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_time_version.load(std::memory_order_relaxed) == version) {
+            break;
+        }
+    }
+    if (busy_since_ns != 0 && now_ns > busy_since_ns) {
+        busy_ns += now_ns - busy_since_ns;
+    }
+    if (idle_since_ns != 0 && now_ns > idle_since_ns) {
+        idle_ns += now_ns - idle_since_ns;
     }
 }
 
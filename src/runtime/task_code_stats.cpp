@@ -0,0 +1,73 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "task_code_stats.h"
+
+#include <limits>
+
+#include <dsn/utility/process_utils.h>
+
+namespace dsn {
+namespace tools {
+
+const int task_code_stats::SHARD_COUNT;
+const int task_code_stats::BUCKET_COUNT;
+
+task_code_stats::task_code_stats()
+{
+    for (shard &s : _shards) {
+        s.count.store(0, std::memory_order_relaxed);
+        s.total_queue_ns.store(0, std::memory_order_relaxed);
+        s.total_exec_ns.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            s.queue_buckets[i].store(0, std::memory_order_relaxed);
+            s.exec_buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+task_code_stats::shard &task_code_stats::local_shard()
+{
+    return _shards[static_cast<uint32_t>(utils::get_current_tid()) % SHARD_COUNT];
+}
+
+static int64_t bucket_middle(int index)
+{
+    if (index <= 1) {
+        return index;
+    }
+    if (index == task_code_stats::BUCKET_COUNT - 1) {
+        return std::numeric_limits<int64_t>::max();
+    }
+    // [2^(index-1), 2^index)
+    uint64_t lower = static_cast<uint64_t>(1) << (index - 1);
+    return static_cast<int64_t>(lower + (lower - 1) / 2);
+}
+
+void task_code_stats::get_snapshot(/*out*/ snapshot &snap) const
+{
+    snap.count = 0;
+    snap.total_queue_ns = 0;
+    snap.total_exec_ns = 0;
+    snap.queue_ns.clear();
+    snap.exec_ns.clear();
+    for (const shard &s : _shards) {
+        snap.count += s.count.load(std::memory_order_relaxed);
+        snap.total_queue_ns += s.total_queue_ns.load(std::memory_order_relaxed);
+        snap.total_exec_ns += s.total_exec_ns.load(std::memory_order_relaxed);
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            uint64_t count = s.queue_buckets[i].load(std::memory_order_relaxed);
+            if (count != 0) {
+                snap.queue_ns.record(bucket_middle(i), count);
+            }
+            count = s.exec_buckets[i].load(std::memory_order_relaxed);
+            if (count != 0) {
+                snap.exec_ns.record(bucket_middle(i), count);
+            }
+        }
+    }
+}
+
+} // namespace tools
+} // namespace dsn
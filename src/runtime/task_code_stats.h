@@ -0,0 +1,84 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <dsn/perf_counter/number_histogram.h>
+
+namespace dsn {
+namespace tools {
+
+// The queueing time and the executing time of the tasks of one task code, recorded by the
+// lightweight profiling of the profiler toollet ([task..default] is_light_profile).
+//
+// It's recorded for every task, so the times are put into power-of-2 buckets by relaxed
+// atomic increments only, and the buckets are sharded by thread, each shard on its own cache
+// lines. The percentiles computed from the buckets are accurate within a factor of 2, while
+// the total times are exact, which are used to attribute the CPU time to the task codes.
+class task_code_stats
+{
+public:
+    static const int SHARD_COUNT = 8;
+    // bucket i holds the values in [2^(i-1), 2^i), and bucket 0 holds 0
+    static const int BUCKET_COUNT = 65;
+
+    struct snapshot
+    {
+        uint64_t count;
+        uint64_t total_queue_ns;
+        uint64_t total_exec_ns;
+        // the values in a bucket are taken as the middle of the bucket
+        number_histogram queue_ns;
+        number_histogram exec_ns;
+    };
+
+    task_code_stats();
+
+    void record_queue_time(uint64_t queue_ns)
+    {
+        shard &s = local_shard();
+        s.queue_buckets[bucket_index(queue_ns)].fetch_add(1, std::memory_order_relaxed);
+        s.total_queue_ns.fetch_add(queue_ns, std::memory_order_relaxed);
+    }
+
+    void record_exec_time(uint64_t exec_ns)
+    {
+        shard &s = local_shard();
+        s.exec_buckets[bucket_index(exec_ns)].fetch_add(1, std::memory_order_relaxed);
+        s.total_exec_ns.fetch_add(exec_ns, std::memory_order_relaxed);
+        s.count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // the statistics since the process started, the shards may be updated during reading
+    // so they're not exactly consistent with each other
+    void get_snapshot(/*out*/ snapshot &snap) const;
+
+    static int bucket_index(uint64_t value)
+    {
+        return value == 0 ? 0 : 64 - __builtin_clzll(value);
+    }
+
+private:
+    // not alignas(64): the stats are allocated by plain new, which doesn't honor an extended
+    // alignment before c++17, so the shards are kept off each other's cache lines by padding
+    struct shard
+    {
+        char padding[64];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> total_queue_ns;
+        std::atomic<uint64_t> total_exec_ns;
+        std::atomic<uint64_t> queue_buckets[BUCKET_COUNT];
+        std::atomic<uint64_t> exec_buckets[BUCKET_COUNT];
+    };
+
+    shard &local_shard();
+
+    shard _shards[SHARD_COUNT];
+};
+
+} // namespace tools
+} // namespace dsn
@@ -0,0 +1,82 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "runtime/task_code_stats.h"
+
+namespace dsn {
+namespace tools {
+
+TEST(task_code_stats_test, bucket_index)
+{
+    ASSERT_EQ(0, task_code_stats::bucket_index(0));
+    ASSERT_EQ(1, task_code_stats::bucket_index(1));
+    ASSERT_EQ(2, task_code_stats::bucket_index(2));
+    ASSERT_EQ(2, task_code_stats::bucket_index(3));
+    ASSERT_EQ(11, task_code_stats::bucket_index(1024));
+    ASSERT_EQ(11, task_code_stats::bucket_index(2047));
+    ASSERT_EQ(64, task_code_stats::bucket_index(UINT64_MAX));
+}
+
+TEST(task_code_stats_test, snapshot)
+{
+    task_code_stats stats;
+    task_code_stats::snapshot snap;
+    stats.get_snapshot(snap);
+    ASSERT_EQ(0, snap.count);
+    ASSERT_EQ(0, snap.exec_ns.percentile(0.5));
+
+    // 99 fast tasks and a slow one
+    for (int i = 0; i < 99; i++) {
+        stats.record_queue_time(1000);
+        stats.record_exec_time(10000);
+    }
+    stats.record_queue_time(1000000);
+    stats.record_exec_time(100000000);
+
+    stats.get_snapshot(snap);
+    ASSERT_EQ(100, snap.count);
+    ASSERT_EQ(99 * 1000 + 1000000, snap.total_queue_ns);
+    ASSERT_EQ(99 * 10000 + 100000000, snap.total_exec_ns);
+
+    // accurate within a factor of 2
+    ASSERT_GE(snap.queue_ns.percentile(0.5), 1000 / 2);
+    ASSERT_LE(snap.queue_ns.percentile(0.5), 1000 * 2);
+    ASSERT_GE(snap.exec_ns.percentile(0.5), 10000 / 2);
+    ASSERT_LE(snap.exec_ns.percentile(0.5), 10000 * 2);
+    ASSERT_GE(snap.exec_ns.percentile(1), 100000000 / 2);
+    ASSERT_LE(snap.exec_ns.percentile(1), 100000000 * 2);
+}
+
+TEST(task_code_stats_test, concurrent_record)
+{
+    task_code_stats stats;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 16; t++) {
+        threads.emplace_back([&stats]() {
+            for (int i = 0; i < 10000; i++) {
+                stats.record_queue_time(i);
+                stats.record_exec_time(2 * i);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    task_code_stats::snapshot snap;
+    stats.get_snapshot(snap);
+    ASSERT_EQ(16 * 10000, snap.count);
+    ASSERT_EQ(16 * 10000, snap.queue_ns.count());
+    ASSERT_EQ(16 * 10000, snap.exec_ns.count());
+    ASSERT_EQ(16ULL * 9999 * 10000 / 2, snap.total_queue_ns);
+    ASSERT_EQ(16ULL * 9999 * 10000, snap.total_exec_ns);
+}
+
+} // namespace tools
+} // namespace dsn
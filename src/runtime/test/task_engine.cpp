@@ -36,6 +36,8 @@
 #include "runtime/task/task_engine.h"
 #include "test_utils.h"
 #include <dsn/tool_api.h>
+#include <dsn/tool-api/command_manager.h>
+#include <dsn/tool-api/async_calls.h>
 #include <gtest/gtest.h>
 #include <sstream>
 
@@ -132,6 +134,57 @@ TEST(core, task_engine)
     ASSERT_EQ(nullptr, controllers2[1]);
 }
 
+DEFINE_TASK_CODE(LPC_TEST_POOL_STATS, TASK_PRIORITY_COMMON, THREAD_POOL_FOR_TEST_1)
+
+TEST(core, task_worker_pool_stats)
+{
+    if (dsn::service_engine::instance().spec().tool == "simulator")
+        return;
+    task_worker_pool *pool =
+        task::get_current_node2()->computation()->get_pool(THREAD_POOL_FOR_TEST_1);
+    ASSERT_NE(nullptr, pool);
+    task_queue *q = pool->queues()[0];
+
+    uint64_t enqueued = q->enqueued_task_count();
+    uint64_t dequeued = q->dequeued_task_count();
+    uint64_t batches = q->dequeue_batch_count();
+    uint64_t processed = 0, busy_ns = 0;
+    for (task_worker *wk : pool->workers()) {
+        uint64_t busy = 0, idle = 0, since = 0;
+        wk->get_busy_idle_time(dsn_now_ns(), busy, idle, since);
+        processed += wk->processed_task_count();
+        busy_ns += busy;
+    }
+
+    auto t = tasking::enqueue(LPC_TEST_POOL_STATS, nullptr, []() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+    t->wait();
+    // wait for the worker to finish the batch
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    ASSERT_EQ(enqueued + 1, q->enqueued_task_count());
+    ASSERT_EQ(dequeued + 1, q->dequeued_task_count());
+    ASSERT_EQ(batches + 1, q->dequeue_batch_count());
+    ASSERT_EQ(0, q->oldest_task_age_ns(dsn_now_ns()));
+
+    uint64_t processed2 = 0, busy_ns2 = 0;
+    for (task_worker *wk : pool->workers()) {
+        uint64_t busy = 0, idle = 0, since = 0;
+        wk->get_busy_idle_time(dsn_now_ns(), busy, idle, since);
+        ASSERT_EQ(0, since);
+        processed2 += wk->processed_task_count();
+        busy_ns2 += busy;
+    }
+    ASSERT_EQ(processed + 1, processed2);
+    ASSERT_GE(busy_ns2 - busy_ns, 100000000);
+
+    std::string output;
+    ASSERT_TRUE(command_manager::instance().run_command("system.threadpool", {}, output));
+    ASSERT_NE(std::string::npos, output.find("\"client.THREAD_POOL_FOR_TEST_1\""));
+    ASSERT_NE(std::string::npos, output.find("\"busy_ratio\""));
+}
+
 /*
 TEST(core, task_engine)
 {
@@ -0,0 +1,108 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "adaptive_throttling_controller.h"
+
+#include <algorithm>
+
+#include <dsn/c/api_utilities.h>
+#include <dsn/utility/flags.h>
+
+namespace dsn {
+namespace replication {
+
+DSN_DEFINE_uint64("replication",
+                  adaptive_throttling_window_ms,
+                  1000,
+                  "the window to adjust the limit of adaptive throttling");
+DSN_DEFINE_validator(adaptive_throttling_window_ms, [](uint64_t value) { return value > 0; });
+
+DSN_DEFINE_uint64("replication",
+                  adaptive_throttling_target_latency_ms,
+                  50,
+                  "adaptive throttling decreases the limit if the average latency of a window "
+                  "exceeds it");
+
+DSN_DEFINE_int64("replication",
+                 adaptive_throttling_min_qps,
+                 10,
+                 "the min limit of requests per second of adaptive throttling");
+DSN_DEFINE_validator(adaptive_throttling_min_qps, [](int64_t value) { return value > 0; });
+
+DSN_DEFINE_int64("replication",
+                 adaptive_throttling_increase_qps,
+                 100,
+                 "the step adaptive throttling increases the limit by");
+
+DSN_DEFINE_double("replication",
+                  adaptive_throttling_decrease_ratio,
+                  0.7,
+                  "the ratio adaptive throttling decreases the limit by");
+DSN_DEFINE_validator(adaptive_throttling_decrease_ratio,
+                     [](double value) { return value > 0 && value < 1; });
+
+adaptive_throttling_controller::adaptive_throttling_controller()
+    : _window_ms(FLAGS_adaptive_throttling_window_ms),
+      _target_latency_us(FLAGS_adaptive_throttling_target_latency_ms * 1000),
+      _min_limit(FLAGS_adaptive_throttling_min_qps),
+      _increase_step(FLAGS_adaptive_throttling_increase_qps),
+      _decrease_ratio(FLAGS_adaptive_throttling_decrease_ratio)
+{
+}
+
+void adaptive_throttling_controller::set_upper_limit(int64_t upper_limit)
+{
+    _upper_limit = upper_limit;
+    if (_upper_limit > 0 && _limit > _upper_limit) {
+        _limit = _upper_limit;
+    }
+}
+
+bool adaptive_throttling_controller::control(uint64_t now_ms)
+{
+    if (_window_start_ms == 0) {
+        _window_start_ms = now_ms;
+    } else if (now_ms >= _window_start_ms + _window_ms) {
+        adjust(now_ms);
+    }
+
+    const int64_t window_quota = _limit * static_cast<int64_t>(_window_ms) / 1000;
+    if (_limit > 0 && _window_admitted >= std::max<int64_t>(1, window_quota)) {
+        _window_rejected++;
+        return false;
+    }
+    _window_admitted++;
+    return true;
+}
+
+void adaptive_throttling_controller::add_latency(uint64_t latency_us)
+{
+    _latency_sum_us += latency_us;
+    _latency_count++;
+}
+
+void adaptive_throttling_controller::adjust(uint64_t now_ms)
+{
+    const uint64_t elapsed_ms = now_ms - _window_start_ms;
+    // the window is stale if there's no request for a long time, don't adjust by it
+    if (elapsed_ms < 2 * _window_ms) {
+        const int64_t admitted_rate = _window_admitted * 1000 / static_cast<int64_t>(elapsed_ms);
+        if (_latency_count > 0 && _latency_sum_us / _latency_count > _target_latency_us) {
+            const int64_t base = _limit > 0 ? std::min(_limit, admitted_rate) : admitted_rate;
+            _limit = std::max(_min_limit, static_cast<int64_t>(base * _decrease_ratio));
+        } else if (_limit > 0 && _window_rejected > 0) {
+            _limit += _increase_step;
+        }
+        set_upper_limit(_upper_limit);
+    }
+
+    _window_start_ms = now_ms;
+    _window_admitted = 0;
+    _window_rejected = 0;
+    _latency_sum_us = 0;
+    _latency_count = 0;
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,67 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace dsn {
+namespace replication {
+
+// Used for adaptive replica throttling.
+//
+// The limit of requests per second is adjusted by AIMD (additive increase, multiplicative
+// decrease) from the latencies observed in every window of
+// [replication] adaptive_throttling_window_ms:
+// - if the average latency exceeds [replication] adaptive_throttling_target_latency_ms, the
+//   limit is decreased to [replication] adaptive_throttling_decrease_ratio of the rate admitted
+//   in the window.
+// - otherwise, if some requests are rejected in the window, the limit is increased by
+//   [replication] adaptive_throttling_increase_qps.
+//
+// The limit is unlimited until the first overload, it's never less than
+// [replication] adaptive_throttling_min_qps, and never greater than the upper limit, which is
+// usually the static throttling of app-envs.
+//
+// not thread safe
+class adaptive_throttling_controller
+{
+public:
+    adaptive_throttling_controller();
+
+    // 0 means no upper limit
+    void set_upper_limit(int64_t upper_limit);
+
+    // return true if the request is admitted, otherwise it should be rejected.
+    bool control(uint64_t now_ms);
+
+    // the latency of an admitted request, e.g. its queueing delay plus log-append latency.
+    void add_latency(uint64_t latency_us);
+
+    // the current limit of requests per second, 0 means unlimited.
+    int64_t limit() const { return _limit; }
+
+private:
+    friend class adaptive_throttling_controller_test;
+
+    void adjust(uint64_t now_ms);
+
+    const uint64_t _window_ms;
+    const uint64_t _target_latency_us;
+    const int64_t _min_limit;
+    const int64_t _increase_step;
+    const double _decrease_ratio;
+
+    int64_t _upper_limit{0};
+    int64_t _limit{0};
+
+    uint64_t _window_start_ms{0};
+    int64_t _window_admitted{0};
+    int64_t _window_rejected{0};
+    uint64_t _latency_sum_us{0};
+    uint64_t _latency_count{0};
+};
+
+} // namespace replication
+} // namespace dsn
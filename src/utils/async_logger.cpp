@@ -0,0 +1,421 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "async_logger.h"
+
+#include <unistd.h>
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+
+#include <dsn/utility/flags.h>
+#include <dsn/utility/process_utils.h>
+#include <dsn/utility/time_utils.h>
+
+namespace dsn {
+namespace tools {
+
+DSN_DECLARE_bool(fast_flush);
+DSN_DECLARE_bool(short_header);
+
+DSN_DEFINE_uint32("tools.async_logger",
+                  buffer_size_kb_per_thread,
+                  64,
+                  "size of the ring buffer of each logging thread, rounded up to a power of 2");
+DSN_DEFINE_bool("tools.async_logger",
+                block_when_full,
+                false,
+                "whether to wait for the writer when the ring buffer of a thread is full, "
+                "the message is dropped otherwise");
+DSN_DEFINE_uint32("tools.async_logger",
+                  flush_interval_ms,
+                  100,
+                  "max interval that the buffered messages are written to the log file");
+
+// size of the batch written to the log file at a time
+static const size_t s_batch_size = 256 * 1024;
+static const int s_max_lines_per_file = 200000;
+
+static std::atomic<uint64_t> s_next_logger_id(1);
+
+// A ring buffer of variable-length records, written by the owner thread and read by the
+// thread holding the _lock of async_logger.
+//
+// The positions grow monotonically and are masked into the buffer. A record never wraps
+// around the end of the buffer: the producer skips the rest of the buffer, marking it by a
+// header of size 0 if there is room for one.
+class async_logger::record_ring
+{
+public:
+    struct record_header
+    {
+        // size of the whole record aligned to 8 bytes, 0 means skipping to the buffer end
+        uint32_t size;
+        uint32_t message_len;
+        uint64_t ts;
+        int32_t tid;
+        int32_t level;
+    };
+
+    explicit record_ring(size_t capacity)
+        : _capacity(capacity), _buffer(new char[capacity]), _head(0), _tail(0), closed(false)
+    {
+    }
+
+    size_t max_message_len() const { return _capacity / 4 - sizeof(record_header); }
+
+    size_t used() const
+    {
+        return _tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return _capacity; }
+
+    bool try_push(uint64_t ts, int tid, dsn_log_level_t level, const char *message, size_t len)
+    {
+        uint32_t size = static_cast<uint32_t>((sizeof(record_header) + len + 7) & ~7);
+        uint64_t tail = _tail.load(std::memory_order_relaxed);
+        uint64_t head = _head.load(std::memory_order_acquire);
+        size_t offset = tail & (_capacity - 1);
+        size_t contiguous = _capacity - offset;
+        size_t skip = contiguous < size ? contiguous : 0;
+        if (tail + skip + size - head > _capacity) {
+            return false;
+        }
+
+        if (skip > 0) {
+            if (skip >= sizeof(record_header)) {
+                reinterpret_cast<record_header *>(_buffer.get() + offset)->size = 0;
+            }
+            offset = 0;
+        }
+        auto *header = reinterpret_cast<record_header *>(_buffer.get() + offset);
+        header->size = size;
+        header->message_len = static_cast<uint32_t>(len);
+        header->ts = ts;
+        header->tid = tid;
+        header->level = level;
+        memcpy(_buffer.get() + offset + sizeof(record_header), message, len);
+        _tail.store(tail + skip + size, std::memory_order_release);
+        return true;
+    }
+
+    // call `callback(header, message)` for each of the records, and release their space
+    template <typename TCallback>
+    void consume(TCallback &&callback)
+    {
+        uint64_t head = _head.load(std::memory_order_relaxed);
+        uint64_t tail = _tail.load(std::memory_order_acquire);
+        while (head < tail) {
+            size_t offset = head & (_capacity - 1);
+            size_t contiguous = _capacity - offset;
+            if (contiguous >= sizeof(record_header)) {
+                auto *header = reinterpret_cast<const record_header *>(_buffer.get() + offset);
+                if (header->size != 0) {
+                    callback(*header, _buffer.get() + offset + sizeof(record_header));
+                    head += header->size;
+                    _head.store(head, std::memory_order_release);
+                    continue;
+                }
+            }
+            head += contiguous;
+            _head.store(head, std::memory_order_release);
+        }
+    }
+
+private:
+    const size_t _capacity;
+    std::unique_ptr<char[]> _buffer;
+    // written by different threads, keep them in different cache lines
+    std::atomic<uint64_t> _head;
+    char _padding[64];
+    std::atomic<uint64_t> _tail;
+
+public:
+    // set when the owner thread exits, then the ring is removed once it is drained
+    std::atomic<bool> closed;
+};
+
+namespace {
+// the ring of the current thread, one thread logs to one async_logger at a time
+struct thread_ring_holder
+{
+    uint64_t logger_id = 0;
+    std::shared_ptr<void> ring;
+    std::atomic<bool> *closed = nullptr;
+
+    ~thread_ring_holder()
+    {
+        if (closed != nullptr) {
+            closed->store(true, std::memory_order_release);
+        }
+    }
+};
+thread_local thread_ring_holder s_thread_ring;
+} // anonymous namespace
+
+static size_t round_up_power_of_2(size_t value)
+{
+    size_t result = 4096;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+async_logger::async_logger(const char *log_dir)
+    : simple_logger(log_dir),
+      _id(s_next_logger_id++),
+      _ring_capacity(round_up_power_of_2(FLAGS_buffer_size_kb_per_thread * 1024)),
+      _dropped_count(0),
+      _reported_dropped_count(0),
+      _wake_pending(false),
+      _stopped(false)
+{
+    _writer = std::thread(&async_logger::writer_loop, this);
+}
+
+async_logger::~async_logger(void)
+{
+    {
+        std::lock_guard<std::mutex> l(_wake_lock);
+        _stopped = true;
+    }
+    _wake_cond.notify_one();
+    _writer.join();
+
+    flush();
+}
+
+async_logger::record_ring *async_logger::get_thread_ring()
+{
+    if (s_thread_ring.logger_id != _id) {
+        if (s_thread_ring.closed != nullptr) {
+            s_thread_ring.closed->store(true, std::memory_order_release);
+        }
+        auto ring = std::make_shared<record_ring>(_ring_capacity);
+        {
+            std::lock_guard<std::mutex> l(_rings_lock);
+            _rings.push_back(ring);
+        }
+        s_thread_ring.logger_id = _id;
+        s_thread_ring.closed = &ring->closed;
+        s_thread_ring.ring = std::move(ring);
+    }
+    return static_cast<record_ring *>(s_thread_ring.ring.get());
+}
+
+std::string &async_logger::prepare_message(const char *file, const char *function, const int line)
+{
+    // reused by the messages of the thread, so formatting a message doesn't allocate
+    static thread_local std::string s_message;
+
+    s_message = log_prefixed_message_func();
+    if (!FLAGS_short_header) {
+        char location[512];
+        int n = snprintf(location, sizeof(location), "%s:%d:%s(): ", file, line, function);
+        s_message.append(location, std::min<size_t>(n, sizeof(location) - 1));
+    }
+    return s_message;
+}
+
+void async_logger::push_message(dsn_log_level_t log_level, const std::string &message)
+{
+    record_ring *ring = get_thread_ring();
+    size_t len = std::min(message.size(), ring->max_message_len());
+    uint64_t ts = dsn_now_ns();
+    int tid = utils::get_current_tid();
+    while (!ring->try_push(ts, tid, log_level, message.data(), len)) {
+        if (!FLAGS_block_when_full) {
+            _dropped_count.fetch_add(1, std::memory_order_relaxed);
+            wake_writer();
+            return;
+        }
+        wake_writer();
+        std::this_thread::yield();
+    }
+
+    if (log_level >= LOG_LEVEL_FATAL) {
+        // the process may abort right after this
+        flush();
+    } else if (FLAGS_fast_flush || log_level >= LOG_LEVEL_ERROR ||
+               ring->used() > ring->capacity() / 2) {
+        wake_writer();
+    }
+}
+
+void async_logger::dsn_logv(const char *file,
+                            const char *function,
+                            const int line,
+                            dsn_log_level_t log_level,
+                            const char *fmt,
+                            va_list args)
+{
+    std::string &message = prepare_message(file, function, line);
+    size_t offset = message.size();
+    message.resize(offset + 256);
+
+    va_list args2;
+    va_copy(args2, args);
+    int n = vsnprintf(&message[offset], 256, fmt, args);
+    if (n >= 256) {
+        message.resize(offset + n + 1);
+        vsnprintf(&message[offset], n + 1, fmt, args2);
+    }
+    va_end(args2);
+    message.resize(offset + std::max(n, 0));
+
+    push_message(log_level, message);
+}
+
+void async_logger::dsn_log(const char *file,
+                           const char *function,
+                           const int line,
+                           dsn_log_level_t log_level,
+                           const char *str)
+{
+    std::string &message = prepare_message(file, function, line);
+    message.append(str);
+    push_message(log_level, message);
+}
+
+void async_logger::flush()
+{
+    {
+        utils::auto_lock<::dsn::utils::ex_lock> l(_lock);
+        drain();
+    }
+    ::fflush(stdout);
+}
+
+void async_logger::wake_writer()
+{
+    {
+        std::lock_guard<std::mutex> l(_wake_lock);
+        _wake_pending = true;
+    }
+    _wake_cond.notify_one();
+}
+
+void async_logger::writer_loop()
+{
+    while (true) {
+        {
+            std::unique_lock<std::mutex> l(_wake_lock);
+            _wake_cond.wait_for(l, std::chrono::milliseconds(FLAGS_flush_interval_ms), [this]() {
+                return _wake_pending || _stopped;
+            });
+            if (_stopped) {
+                return;
+            }
+            _wake_pending = false;
+        }
+
+        utils::auto_lock<::dsn::utils::ex_lock> l(_lock);
+        drain();
+    }
+}
+
+void async_logger::write_batch(std::string &batch, std::string &stdout_batch)
+{
+    const char *data = batch.data();
+    size_t left = batch.size();
+    int fd = fileno(_log);
+    while (left > 0) {
+        ssize_t n = ::write(fd, data, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // nowhere to report the error, give up the batch
+            break;
+        }
+        data += n;
+        left -= n;
+    }
+    batch.clear();
+
+    if (!stdout_batch.empty()) {
+        ::fwrite(stdout_batch.data(), 1, stdout_batch.size(), stdout);
+        stdout_batch.clear();
+    }
+}
+
+void async_logger::drain()
+{
+    static char s_level_char[] = "IDWEF";
+
+    std::vector<std::shared_ptr<record_ring>> rings;
+    {
+        std::lock_guard<std::mutex> l(_rings_lock);
+        rings = _rings;
+    }
+
+    std::string batch;
+    std::string stdout_batch;
+    batch.reserve(s_batch_size);
+    uint64_t last_ms = UINT64_MAX;
+    char time_str[24];
+    char header[64];
+
+    auto append = [&](dsn_log_level_t level, uint64_t ts, int tid, const char *msg, size_t len) {
+        uint64_t ms = ts / 1000000;
+        if (ms != last_ms) {
+            dsn::utils::time_ms_to_string(ms, time_str);
+            last_ms = ms;
+        }
+        int n = snprintf(header,
+                         sizeof(header),
+                         "%c%s (%" PRIu64 " %04x) ",
+                         s_level_char[level],
+                         time_str,
+                         ts,
+                         tid);
+        batch.append(header, n).append(msg, len).push_back('\n');
+        if (level >= _stderr_start_level) {
+            stdout_batch.append(header, n).append(msg, len).push_back('\n');
+        }
+
+        if (++_lines >= s_max_lines_per_file) {
+            write_batch(batch, stdout_batch);
+            create_log_file();
+        } else if (batch.size() >= s_batch_size) {
+            write_batch(batch, stdout_batch);
+        }
+    };
+
+    uint64_t dropped = _dropped_count.load(std::memory_order_relaxed);
+    if (dropped > _reported_dropped_count) {
+        std::string msg = "async_logger: " + std::to_string(dropped - _reported_dropped_count) +
+                          " messages are dropped as the ring buffers are full";
+        append(LOG_LEVEL_WARNING, dsn_now_ns(), utils::get_current_tid(), msg.data(), msg.size());
+        _reported_dropped_count = dropped;
+    }
+
+    bool has_closed = false;
+    for (const auto &ring : rings) {
+        // no more messages will be pushed after it's closed
+        bool closed = ring->closed.load(std::memory_order_acquire);
+        ring->consume([&](const record_ring::record_header &h, const char *msg) {
+            append(static_cast<dsn_log_level_t>(h.level), h.ts, h.tid, msg, h.message_len);
+        });
+        has_closed = has_closed || closed;
+    }
+    write_batch(batch, stdout_batch);
+
+    if (has_closed) {
+        std::lock_guard<std::mutex> l(_rings_lock);
+        for (auto it = _rings.begin(); it != _rings.end();) {
+            // the closed rings have been drained above
+            if ((*it)->closed.load(std::memory_order_relaxed) && (*it)->used() == 0) {
+                it = _rings.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+} // namespace tools
+} // namespace dsn
@@ -0,0 +1,88 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "simple_logger.h"
+
+namespace dsn {
+namespace tools {
+
+/*
+ * async_logger writes the same log files as simple_logger, but the logging threads don't
+ * share any lock or touch the disk.
+ *
+ * Each logging thread formats its message into a private single-producer/single-consumer
+ * ring buffer. A background thread drains all of the rings, adds the headers and writes
+ * them in batches. When the ring of a thread is full, the message is dropped and counted,
+ * or the thread waits for the writer if [tools.async_logger] block_when_full is set.
+ *
+ * The messages of a thread are written in order, while the messages of different threads
+ * may interleave out of timestamp order within one batch. FATAL messages and flush() wait
+ * until all of the buffered messages are written, so nothing is lost on dassert.
+ */
+class async_logger : public simple_logger
+{
+public:
+    async_logger(const char *log_dir);
+    virtual ~async_logger(void);
+
+    virtual void dsn_logv(const char *file,
+                          const char *function,
+                          const int line,
+                          dsn_log_level_t log_level,
+                          const char *fmt,
+                          va_list args);
+
+    virtual void dsn_log(const char *file,
+                         const char *function,
+                         const int line,
+                         dsn_log_level_t log_level,
+                         const char *str);
+
+    virtual void flush();
+
+    // count of the messages dropped because the ring buffers are full
+    uint64_t dropped_count() const { return _dropped_count.load(std::memory_order_relaxed); }
+
+private:
+    class record_ring;
+
+    std::string &prepare_message(const char *file, const char *function, const int line);
+    void push_message(dsn_log_level_t log_level, const std::string &message);
+    record_ring *get_thread_ring();
+    void wake_writer();
+
+    void writer_loop();
+    // write out the messages in all of the rings, user should hold _lock
+    void drain();
+    void write_batch(std::string &batch, std::string &stdout_batch);
+
+private:
+    // identifies the logger in the thread local ring holders
+    const uint64_t _id;
+    const size_t _ring_capacity;
+
+    std::mutex _rings_lock;
+    std::vector<std::shared_ptr<record_ring>> _rings;
+
+    std::atomic<uint64_t> _dropped_count;
+    uint64_t _reported_dropped_count; // protected by _lock
+
+    std::mutex _wake_lock;
+    std::condition_variable _wake_cond;
+    bool _wake_pending;
+    bool _stopped;
+    std::thread _writer;
+};
+} // namespace tools
+} // namespace dsn
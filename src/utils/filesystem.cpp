@@ -38,11 +38,14 @@
 #include <dsn/c/api_utilities.h>
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/defer.h>
 #include <dsn/utility/utils.h>
 #include <dsn/utility/safe_strerror_posix.h>
 
 #include <sys/stat.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <stdio.h>
 #include <boost/filesystem.hpp>
 #include <openssl/md5.h>
@@ -701,6 +704,18 @@ bool link_file(const std::string &src, const std::string &target)
     return (err == 0);
 }
 
+static std::string md5_final(MD5_CTX &c)
+{
+    unsigned char out[MD5_DIGEST_LENGTH];
+    MD5_Final(out, &c);
+
+    char str[MD5_DIGEST_LENGTH * 2 + 1];
+    str[MD5_DIGEST_LENGTH * 2] = 0;
+    for (int n = 0; n < MD5_DIGEST_LENGTH; n++)
+        sprintf(str + n + n, "%02x", out[n]);
+    return std::string(str);
+}
+
 error_code md5sum(const std::string &file_path, /*out*/ std::string &result)
 {
     result.clear();
@@ -717,7 +732,6 @@ error_code md5sum(const std::string &file_path, /*out*/ std::string &result)
     }
 
     char buf[4096];
-    unsigned char out[MD5_DIGEST_LENGTH];
     MD5_CTX c;
     MD5_Init(&c);
     while (true) {
@@ -736,23 +750,139 @@ error_code md5sum(const std::string &file_path, /*out*/ std::string &result)
                        err,
                        safe_strerror(err).c_str());
                 fclose(fp);
-                MD5_Final(out, &c);
+                md5_final(c);
                 return ERR_FILE_OPERATION_FAILED;
             }
         }
     }
     fclose(fp);
-    MD5_Final(out, &c);
+    result = md5_final(c);
+    return ERR_OK;
+}
 
-    char str[MD5_DIGEST_LENGTH * 2 + 1];
-    str[MD5_DIGEST_LENGTH * 2] = 0;
-    for (int n = 0; n < MD5_DIGEST_LENGTH; n++)
-        sprintf(str + n + n, "%02x", out[n]);
-    result.assign(str);
+// the buffer is aligned to the page so that the kernel copies it in whole pages
+static const size_t COPY_BUFFER_SIZE = 1 << 20;
+static const size_t COPY_BUFFER_ALIGNMENT = 4096;
+
+// copy `length` bytes (to the end of `src_fd` if -1) at `offset` of `src_fd` to the same
+// offset of `dst_fd`, and update `md5_ctx` with them if it's not null
+static error_code copy_fd_range(int src_fd,
+                                int dst_fd,
+                                uint64_t offset,
+                                int64_t length,
+                                MD5_CTX *md5_ctx,
+                                /*out*/ int64_t &copied_size)
+{
+    copied_size = 0;
+    void *buf = nullptr;
+    if (::posix_memalign(&buf, COPY_BUFFER_ALIGNMENT, COPY_BUFFER_SIZE) != 0) {
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    std::unique_ptr<char, decltype(&::free)> buffer(static_cast<char *>(buf), &::free);
 
+    while (length == -1 || copied_size < length) {
+        size_t n = COPY_BUFFER_SIZE;
+        if (length != -1) {
+            n = std::min(n, static_cast<size_t>(length - copied_size));
+        }
+        ssize_t read_size = ::pread(src_fd, buffer.get(), n, offset + copied_size);
+        if (read_size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            derror_f("read failed: {}", safe_strerror(errno));
+            return ERR_FILE_OPERATION_FAILED;
+        }
+        if (read_size == 0) {
+            break;
+        }
+        if (md5_ctx != nullptr) {
+            MD5_Update(md5_ctx, buffer.get(), read_size);
+        }
+        for (ssize_t written = 0; written < read_size;) {
+            ssize_t ret = ::pwrite(dst_fd,
+                                   buffer.get() + written,
+                                   read_size - written,
+                                   offset + copied_size + written);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                derror_f("write failed: {}", safe_strerror(errno));
+                return ERR_FILE_OPERATION_FAILED;
+            }
+            written += ret;
+        }
+        copied_size += read_size;
+    }
+    return ERR_OK;
+}
+
+error_code copy_file_with_md5(const std::string &src,
+                              const std::string &dst,
+                              /*out*/ int64_t &copied_size,
+                              /*out*/ std::string &md5)
+{
+    copied_size = 0;
+    md5.clear();
+    int src_fd = ::open(src.c_str(), O_RDONLY);
+    if (src_fd < 0) {
+        derror_f("open file({}) for read failed: {}", src, safe_strerror(errno));
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    auto close_src = dsn::defer([src_fd]() { ::close(src_fd); });
+    ::posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    int dst_fd = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0664);
+    if (dst_fd < 0) {
+        derror_f("open file({}) for write failed: {}", dst, safe_strerror(errno));
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    auto close_dst = dsn::defer([dst_fd]() { ::close(dst_fd); });
+
+    MD5_CTX c;
+    MD5_Init(&c);
+    error_code err = copy_fd_range(src_fd, dst_fd, 0, -1, &c, copied_size);
+    if (err != ERR_OK) {
+        derror_f("copy file({}) to file({}) failed", src, dst);
+        return err;
+    }
+    md5 = md5_final(c);
     return ERR_OK;
 }
 
+error_code copy_file_part(const std::string &src,
+                          const std::string &dst,
+                          uint64_t offset,
+                          int64_t length,
+                          /*out*/ int64_t &copied_size)
+{
+    copied_size = 0;
+    int src_fd = ::open(src.c_str(), O_RDONLY);
+    if (src_fd < 0) {
+        derror_f("open file({}) for read failed: {}", src, safe_strerror(errno));
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    auto close_src = dsn::defer([src_fd]() { ::close(src_fd); });
+
+    int dst_fd = ::open(dst.c_str(), O_WRONLY | O_CREAT, 0664);
+    if (dst_fd < 0) {
+        derror_f("open file({}) for write failed: {}", dst, safe_strerror(errno));
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    auto close_dst = dsn::defer([dst_fd]() { ::close(dst_fd); });
+
+    error_code err = copy_fd_range(src_fd, dst_fd, offset, length, nullptr, copied_size);
+    if (err != ERR_OK) {
+        derror_f("copy part of file({}) to file({}) failed, offset = {}, length = {}",
+                 src,
+                 dst,
+                 offset,
+                 length);
+    }
+    return err;
+}
+
 std::pair<error_code, bool> is_directory_empty(const std::string &dirname)
 {
     std::pair<error_code, bool> res;
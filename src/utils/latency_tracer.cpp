@@ -20,14 +20,87 @@
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/flags.h>
 
+#include <algorithm>
+#include <mutex>
+
 namespace dsn {
 namespace utils {
 
 DSN_DEFINE_bool("replication", enable_latency_tracer, false, "whether enable the latency tracer");
 
+const int latency_tracer::MAX_STAGE_COUNT;
+const int latency_tracer::MAX_POINT_COUNT;
+
+namespace {
+
+struct stage_registry
+{
+    std::mutex lock;
+    std::atomic<int> count{0};
+    std::string names[latency_tracer::MAX_STAGE_COUNT];
+    std::string metric_names[latency_tracer::MAX_STAGE_COUNT];
+};
+
+stage_registry &get_stage_registry()
+{
+    static stage_registry registry;
+    return registry;
+}
+
+} // anonymous namespace
+
+/*static*/ int latency_tracer::register_stage(const std::string &name,
+                                             const std::string &metric_name)
+{
+    stage_registry &registry = get_stage_registry();
+    std::lock_guard<std::mutex> l(registry.lock);
+    int count = registry.count.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; ++i) {
+        if (registry.names[i] == name) {
+            return i;
+        }
+    }
+    if (count == MAX_STAGE_COUNT) {
+        derror_f("too many latency tracer stages, ignore stage {}", name);
+        return -1;
+    }
+    registry.names[count] = name;
+    registry.metric_names[count] = metric_name.empty() ? name : metric_name;
+    registry.count.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+/*static*/ const std::string &latency_tracer::stage_name(int stage_id)
+{
+    stage_registry &registry = get_stage_registry();
+    dassert_f(stage_id >= 0 && stage_id < registry.count.load(std::memory_order_acquire),
+              "invalid stage id {}",
+              stage_id);
+    return registry.names[stage_id];
+}
+
+/*static*/ const std::string &latency_tracer::stage_metric_name(int stage_id)
+{
+    stage_registry &registry = get_stage_registry();
+    dassert_f(stage_id >= 0 && stage_id < registry.count.load(std::memory_order_acquire),
+              "invalid stage id {}",
+              stage_id);
+    return registry.metric_names[stage_id];
+}
+
+/*static*/ std::string latency_tracer::point_metric_name(const std::string &file_name,
+                                                        const char *function)
+{
+    return fmt::format("{}.{}", file_name.substr(0, file_name.find('.')), function);
+}
+
 latency_tracer::latency_tracer(const std::string &name, bool is_sub, uint64_t threshold)
-    : _name(name), _threshold(threshold), _is_sub(is_sub), _start_time(dsn_now_ns())
+    : _name(name), _threshold(threshold), _is_sub(is_sub), _start_time(dsn_now_ns()),
+      _point_count(0)
 {
+    for (point &p : _points) {
+        p.ts.store(0, std::memory_order_relaxed);
+    }
 }
 
 latency_tracer::~latency_tracer()
@@ -40,15 +113,15 @@ latency_tracer::~latency_tracer()
     dump_trace_points(traces);
 }
 
-void latency_tracer::add_point(const std::string &stage_name)
+void latency_tracer::add_point_internal(int stage_id)
 {
-    if (!FLAGS_enable_latency_tracer) {
+    int index = _point_count.fetch_add(1, std::memory_order_relaxed);
+    if (index >= MAX_POINT_COUNT) {
         return;
     }
-
-    uint64_t ts = dsn_now_ns();
-    utils::auto_write_lock write(_lock);
-    _points[ts] = stage_name;
+    point &p = _points[index];
+    p.stage_id = stage_id;
+    p.ts.store(std::max<uint64_t>(dsn_now_ns(), 1), std::memory_order_release);
 }
 
 void latency_tracer::set_sub_tracer(const std::shared_ptr<latency_tracer> &tracer)
@@ -60,15 +133,53 @@ void latency_tracer::set_sub_tracer(const std::shared_ptr<latency_tracer> &trace
     _sub_tracer = tracer;
 }
 
+int latency_tracer::get_points(/*out*/ point_value *points) const
+{
+    int count = std::min(_point_count.load(std::memory_order_acquire), MAX_POINT_COUNT);
+    int ready = 0;
+    for (int i = 0; i < count; ++i) {
+        uint64_t ts = _points[i].ts.load(std::memory_order_acquire);
+        if (ts == 0) {
+            // claimed but not written yet
+            continue;
+        }
+        points[ready].ts = ts;
+        points[ready].stage_id = _points[i].stage_id;
+        ready++;
+    }
+
+    // the points added by different threads may be slightly out of order
+    std::sort(points, points + ready, [](const point_value &l, const point_value &r) {
+        return l.ts < r.ts;
+    });
+    return ready;
+}
+
+void latency_tracer::for_each_span(const std::function<void(int, uint64_t)> &callback) const
+{
+    point_value points[MAX_POINT_COUNT];
+    int count = get_points(points);
+    uint64_t previous_time = _start_time;
+    for (int i = 0; i < count; ++i) {
+        uint64_t ts = points[i].ts;
+        callback(points[i].stage_id, ts > previous_time ? ts - previous_time : 0);
+        previous_time = ts;
+    }
+}
+
 void latency_tracer::dump_trace_points(/*out*/ std::string &traces)
 {
-    if (!FLAGS_enable_latency_tracer || _threshold < 0 || _points.empty()) {
+    if (!FLAGS_enable_latency_tracer || _threshold < 0) {
         return;
     }
 
-    utils::auto_read_lock read(_lock);
+    point_value points[MAX_POINT_COUNT];
+    int count = get_points(points);
+    if (count == 0) {
+        return;
+    }
 
-    uint64_t time_used = _points.rbegin()->first - _start_time;
+    uint64_t time_used = points[count - 1].ts - _start_time;
 
     if (time_used < _threshold) {
         return;
@@ -76,15 +187,16 @@ void latency_tracer::dump_trace_points(/*out*/ std::string &traces)
 
     traces.append(fmt::format("\t***************[TRACE:{}]***************\n", _name));
     uint64_t previous_time = _start_time;
-    for (const auto &point : _points) {
+    for (int i = 0; i < count; ++i) {
+        uint64_t ts = points[i].ts;
         std::string trace = fmt::format("\tTRACE:name={:<70}, span={:>20}, total={:>20}, "
                                         "ts={:<20}\n",
-                                        point.second,
-                                        point.first - previous_time,
-                                        point.first - _start_time,
-                                        point.first);
+                                        stage_name(points[i].stage_id),
+                                        ts - previous_time,
+                                        ts - _start_time,
+                                        ts);
         traces.append(trace);
-        previous_time = point.first;
+        previous_time = ts;
     }
 
     if (_sub_tracer == nullptr) {
@@ -30,6 +30,7 @@
 #include <dsn/utility/flags.h>
 #include <dsn/utility/smart_pointers.h>
 #include "simple_logger.h"
+#include "async_logger.h"
 
 DSN_API dsn_log_level_t dsn_log_start_level = dsn_log_level_t::LOG_LEVEL_INFORMATION;
 DSN_DEFINE_string("core",
@@ -44,6 +45,7 @@ namespace dsn {
 using namespace tools;
 DSN_REGISTER_COMPONENT_PROVIDER(screen_logger, "dsn::tools::screen_logger");
 DSN_REGISTER_COMPONENT_PROVIDER(simple_logger, "dsn::tools::simple_logger");
+DSN_REGISTER_COMPONENT_PROVIDER(async_logger, "dsn::tools::async_logger");
 
 std::function<std::string()> log_prefixed_message_func = []() {
     static thread_local std::string prefixed_message;
@@ -88,10 +88,10 @@ public:
 
     virtual void flush();
 
-private:
+protected:
     void create_log_file();
 
-private:
+protected:
     std::string _log_dir;
     ::dsn::utils::ex_lock _lock; // use recursive lock to avoid dead lock when flush() is called
                                  // in signal handler if cored for bad logging format reason.
@@ -2,6 +2,8 @@
 // This source code is licensed under the Apache License Version 2.0, which
 // can be found in the LICENSE file in the root directory of this source tree.
 
+#include <fstream>
+
 #include <dsn/utility/filesystem.h>
 #include <gtest/gtest.h>
 
@@ -25,6 +27,65 @@ TEST(verify_file, verify_file_test)
     remove_path(fname);
 }
 
+TEST(copy_file, copy_file_with_md5)
+{
+    const std::string src = "copy_src_file";
+    const std::string dst = "copy_dst_file";
+    // larger than the copy buffer
+    std::string content((5 << 20) / 2, '\0');
+    for (size_t i = 0; i < content.size(); i++) {
+        content[i] = static_cast<char>(i * 13 % 255);
+    }
+    {
+        std::ofstream os(src, std::ios::out | std::ios::trunc);
+        os.write(content.data(), content.size());
+        std::ofstream dst_os(dst, std::ios::out | std::ios::trunc);
+        dst_os << "an existing file is truncated";
+    }
+    std::string expected_md5;
+    ASSERT_EQ(ERR_OK, md5sum(src, expected_md5));
+
+    int64_t copied_size = 0;
+    std::string md5;
+    ASSERT_EQ(ERR_OK, copy_file_with_md5(src, dst, copied_size, md5));
+    ASSERT_EQ(content.size(), copied_size);
+    ASSERT_EQ(expected_md5, md5);
+    ASSERT_TRUE(verify_file(dst, expected_md5, content.size()));
+
+    ASSERT_EQ(ERR_FILE_OPERATION_FAILED,
+              copy_file_with_md5("file_not_exists", dst, copied_size, md5));
+
+    remove_path(src);
+    remove_path(dst);
+}
+
+TEST(copy_file, copy_file_part)
+{
+    const std::string src = "copy_part_src_file";
+    const std::string dst = "copy_part_dst_file";
+    const std::string content = "0123456789abcdefghij";
+    {
+        std::ofstream os(src, std::ios::out | std::ios::trunc);
+        os << content;
+    }
+
+    // the parts are copied in any order to the same offsets
+    int64_t copied_size = 0;
+    ASSERT_EQ(ERR_OK, copy_file_part(src, dst, 10, -1, copied_size));
+    ASSERT_EQ(10, copied_size);
+    ASSERT_EQ(ERR_OK, copy_file_part(src, dst, 0, 4, copied_size));
+    ASSERT_EQ(4, copied_size);
+    ASSERT_EQ(ERR_OK, copy_file_part(src, dst, 4, 100, copied_size));
+    ASSERT_EQ(16, copied_size);
+
+    std::string result;
+    ASSERT_EQ(ERR_OK, read_file(dst, result));
+    ASSERT_EQ(content, result);
+
+    remove_path(src);
+    remove_path(dst);
+}
+
 } // namespace filesystem
 } // namespace utils
 } // namespace dsn
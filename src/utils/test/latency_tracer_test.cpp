@@ -43,13 +43,13 @@ public:
     {
         _tracer1 = std::make_shared<latency_tracer>("name1");
         for (int i = 0; i < _tracer1_stage_count; i++) {
-            ADD_CUSTOM_POINT(_tracer1, fmt::format("stage{}", i));
+            _tracer1->add_point(latency_tracer::register_stage(fmt::format("stage{}", i)));
         }
 
         _tracer2 = std::make_shared<latency_tracer>("name2");
 
         for (int i = 0; i < _tracer2_stage_count; i++) {
-            ADD_CUSTOM_POINT(_tracer2, fmt::format("stage{}", i));
+            _tracer2->add_point(latency_tracer::register_stage(fmt::format("stage{}", i)));
         }
 
         _sub_tracer = std::make_shared<latency_tracer>("sub", true);
@@ -58,13 +58,17 @@ public:
         _tracer2->set_sub_tracer(_sub_tracer);
 
         for (int i = 0; i < _sub_tracer_stage_count; i++) {
-            ADD_CUSTOM_POINT(_sub_tracer, fmt::format("stage{}", i));
+            ADD_CUSTOM_POINT(_sub_tracer, "sub_stage");
         }
     }
 
-    std::map<int64_t, std::string> get_points(std::shared_ptr<latency_tracer> tracer)
+    std::vector<std::string> get_points(std::shared_ptr<latency_tracer> tracer)
     {
-        return tracer->_points;
+        std::vector<std::string> points;
+        tracer->for_each_span([&points](int stage_id, uint64_t span_ns) {
+            points.emplace_back(latency_tracer::stage_name(stage_id));
+        });
+        return points;
     }
 
     std::shared_ptr<latency_tracer> get_sub_tracer(std::shared_ptr<latency_tracer> tracer)
@@ -79,16 +83,14 @@ TEST_F(latency_tracer_test, add_point)
     ASSERT_EQ(tracer1_points.size(), _tracer1_stage_count);
     int count1 = 0;
     for (auto point : tracer1_points) {
-        ASSERT_EQ(point.second,
-                  fmt::format("latency_tracer_test.cpp:46:init_trace_points[stage{}]", count1++));
+        ASSERT_EQ(point, fmt::format("stage{}", count1++));
     }
 
     auto tracer2_points = get_points(_tracer2);
     ASSERT_EQ(tracer2_points.size(), _tracer2_stage_count);
     int count2 = 0;
     for (auto point : tracer2_points) {
-        ASSERT_EQ(point.second,
-                  fmt::format("latency_tracer_test.cpp:52:init_trace_points[stage{}]", count2++));
+        ASSERT_EQ(point, fmt::format("stage{}", count2++));
     }
 
     auto tracer1_sub_tracer = get_sub_tracer(_tracer1);
@@ -98,11 +100,69 @@ TEST_F(latency_tracer_test, add_point)
     auto points = get_points(tracer1_sub_tracer);
     ASSERT_TRUE(get_sub_tracer(tracer1_sub_tracer) == nullptr);
     ASSERT_EQ(points.size(), _sub_tracer_stage_count);
-    int count3 = 0;
     for (auto point : points) {
-        ASSERT_EQ(point.second,
-                  fmt::format("latency_tracer_test.cpp:61:init_trace_points[stage{}]", count3++));
+        ASSERT_EQ(point, "latency_tracer_test.cpp:61:init_trace_points[sub_stage]");
     }
 }
+
+static void add_named_points(latency_tracer *tracer)
+{
+    ADD_POINT(tracer);
+    ADD_CUSTOM_POINT(tracer, "custom_stage");
+}
+
+TEST_F(latency_tracer_test, register_stage)
+{
+    int id = latency_tracer::register_stage("register_stage_test");
+    ASSERT_GE(id, 0);
+    ASSERT_EQ(id, latency_tracer::register_stage("register_stage_test"));
+    ASSERT_EQ("register_stage_test", latency_tracer::stage_name(id));
+    ASSERT_NE(id, latency_tracer::register_stage("register_stage_test2"));
+    ASSERT_EQ("register_stage_test", latency_tracer::stage_metric_name(id));
+
+    // the metric name is the file and the function, or the message, rather than the line
+    int line_id = -1;
+    int custom_id = -1;
+    latency_tracer tracer("metric_name");
+    add_named_points(&tracer);
+    tracer.for_each_span([&line_id, &custom_id](int stage_id, uint64_t) {
+        (line_id == -1 ? line_id : custom_id) = stage_id;
+    });
+    ASSERT_NE(std::string::npos, latency_tracer::stage_name(line_id).find("latency_tracer_test"));
+    ASSERT_EQ("latency_tracer_test.add_named_points",
+              latency_tracer::stage_metric_name(line_id));
+    ASSERT_EQ("custom_stage", latency_tracer::stage_metric_name(custom_id));
+}
+
+TEST_F(latency_tracer_test, max_point_count)
+{
+    latency_tracer tracer("max_point_count");
+    int id = latency_tracer::register_stage("max_point_count");
+    for (int i = 0; i < latency_tracer::MAX_POINT_COUNT + 10; ++i) {
+        tracer.add_point(id);
+    }
+
+    int count = 0;
+    uint64_t total_ns = 0;
+    tracer.for_each_span([&](int stage_id, uint64_t span_ns) {
+        ASSERT_EQ(id, stage_id);
+        count++;
+        total_ns += span_ns;
+    });
+    ASSERT_EQ(latency_tracer::MAX_POINT_COUNT, count);
+    ASSERT_GT(total_ns, 0);
+}
+
+TEST_F(latency_tracer_test, disabled)
+{
+    FLAGS_enable_latency_tracer = false;
+    latency_tracer tracer("disabled");
+    tracer.add_point(latency_tracer::register_stage("disabled"));
+    int count = 0;
+    tracer.for_each_span([&count](int, uint64_t) { count++; });
+    ASSERT_EQ(0, count);
+    FLAGS_enable_latency_tracer = true;
+}
+
 } // namespace utils
 } // namespace dsn
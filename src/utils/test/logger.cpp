@@ -34,8 +34,11 @@
  */
 
 #include "utils/simple_logger.h"
+#include "utils/async_logger.h"
 #include <gtest/gtest.h>
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/time_utils.h>
 
 using namespace dsn;
 using namespace dsn::tools;
@@ -125,3 +128,113 @@ TEST(tools_common, simple_logger)
     clear_files(index);
     finish_test_dir();
 }
+
+namespace dsn {
+namespace tools {
+DSN_DECLARE_bool(block_when_full);
+DSN_DECLARE_uint32(buffer_size_kb_per_thread);
+} // namespace tools
+} // namespace dsn
+
+static int count_logged_lines(const std::vector<int> &log_index, const char *pattern)
+{
+    int count = 0;
+    char file[256];
+    char line[1024];
+    for (auto i : log_index) {
+        snprintf_p(file, 256, "log.%d.txt", i);
+        FILE *fp = fopen(file, "r");
+        if (fp == nullptr) {
+            continue;
+        }
+        while (fgets(line, sizeof(line), fp) != nullptr) {
+            if (strstr(line, pattern) != nullptr) {
+                count++;
+            }
+        }
+        fclose(fp);
+    }
+    return count;
+}
+
+// log `count` messages in each of the threads, return the messages logged per second
+static double concurrent_log(logging_provider *logger, int thread_count, int count)
+{
+    uint64_t start_ns = dsn_now_ns();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([logger, t, count]() {
+            for (int i = 0; i < count; ++i) {
+                log_print(logger, "test_print from thread %d, index %d", t, i);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    logger->flush();
+    return thread_count * count * 1e9 / (dsn_now_ns() - start_ns);
+}
+
+TEST(tools_common, async_logger)
+{
+    prepare_test_dir();
+    bool old_block_when_full = FLAGS_block_when_full;
+
+    // all of the messages are written in blocking mode
+    FLAGS_block_when_full = true;
+    async_logger *logger = new async_logger("./");
+    concurrent_log(logger, 8, 10000);
+    delete logger;
+
+    std::vector<int> index;
+    get_log_file_index(index);
+    ASSERT_EQ(8 * 10000, count_logged_lines(index, "test_print"));
+    clear_files(index);
+
+    // the messages are either written or counted as dropped
+    uint32_t old_buffer_size = FLAGS_buffer_size_kb_per_thread;
+    FLAGS_block_when_full = false;
+    FLAGS_buffer_size_kb_per_thread = 4;
+    logger = new async_logger("./");
+    concurrent_log(logger, 8, 10000);
+    uint64_t dropped = logger->dropped_count();
+    delete logger;
+
+    index.clear();
+    get_log_file_index(index);
+    ASSERT_EQ(8 * 10000 - static_cast<int>(dropped), count_logged_lines(index, "test_print"));
+    clear_files(index);
+
+    FLAGS_buffer_size_kb_per_thread = old_buffer_size;
+    FLAGS_block_when_full = old_block_when_full;
+    finish_test_dir();
+}
+
+// compare the throughput of the loggers, run it manually with --gtest_also_run_disabled_tests
+TEST(tools_common, DISABLED_logger_benchmark)
+{
+    prepare_test_dir();
+    bool old_block_when_full = FLAGS_block_when_full;
+    FLAGS_block_when_full = true;
+
+    const int count = 20000;
+    for (int thread_count : {1, 4, 16, 64}) {
+        simple_logger *sync_logger = new simple_logger("./");
+        double sync_qps = concurrent_log(sync_logger, thread_count, count);
+        delete sync_logger;
+
+        async_logger *logger = new async_logger("./");
+        double async_qps = concurrent_log(logger, thread_count, count);
+        delete logger;
+
+        std::cout << "threads: " << thread_count << ", simple_logger: " << sync_qps
+                  << " msgs/s, async_logger: " << async_qps << " msgs/s" << std::endl;
+    }
+
+    std::vector<int> index;
+    get_log_file_index(index);
+    clear_files(index);
+    FLAGS_block_when_full = old_block_when_full;
+    finish_test_dir();
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <dsn/utils/trace_span.h>
+
+namespace dsn {
+namespace utils {
+
+static trace_span make_span(uint64_t trace_id, int64_t decree)
+{
+    trace_span span;
+    span.trace_id = trace_id;
+    span.name = "test";
+    span.start_ns = 1000;
+    span.end_ns = 3500;
+    span.app_id = 1;
+    span.partition_index = 2;
+    span.decree = decree;
+    span.tid = 100;
+    return span;
+}
+
+TEST(trace_span_test, ring)
+{
+    trace_span_ring ring(5);
+    ASSERT_EQ(8, ring.capacity());
+    ASSERT_TRUE(ring.get_spans().empty());
+
+    for (int i = 0; i < 3; ++i) {
+        ring.add(make_span(i % 2 + 1, i));
+    }
+    auto spans = ring.get_spans();
+    ASSERT_EQ(3, spans.size());
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(i, spans[i].decree);
+    }
+
+    spans = ring.get_spans(2);
+    ASSERT_EQ(1, spans.size());
+    ASSERT_EQ(1, spans[0].decree);
+
+    // the oldest spans are overwritten
+    for (int i = 3; i < 20; ++i) {
+        ring.add(make_span(i % 2 + 1, i));
+    }
+    spans = ring.get_spans();
+    ASSERT_EQ(8, spans.size());
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_EQ(12 + i, spans[i].decree);
+    }
+}
+
+TEST(trace_span_test, concurrent_add)
+{
+    trace_span_ring ring(1024);
+    std::vector<std::thread> threads;
+    for (int t = 1; t <= 4; ++t) {
+        threads.emplace_back([&ring, t]() {
+            for (int i = 0; i < 10000; ++i) {
+                ring.add(make_span(t, i));
+            }
+        });
+    }
+    for (int i = 0; i < 100; ++i) {
+        // the spans read are never torn
+        for (const trace_span &span : ring.get_spans()) {
+            ASSERT_GE(span.trace_id, 1);
+            ASSERT_LE(span.trace_id, 4);
+            ASSERT_EQ(2, span.partition_index);
+        }
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(1024, ring.get_spans().size());
+}
+
+TEST(trace_span_test, sample)
+{
+    uint32_t old_interval = FLAGS_trace_sample_interval;
+
+    FLAGS_trace_sample_interval = 0;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_FALSE(should_sample_trace());
+    }
+
+    FLAGS_trace_sample_interval = 10;
+    int sampled = 0;
+    for (int i = 0; i < 100; ++i) {
+        if (should_sample_trace()) {
+            sampled++;
+        }
+    }
+    ASSERT_EQ(10, sampled);
+
+    FLAGS_trace_sample_interval = old_interval;
+}
+
+TEST(trace_span_test, format)
+{
+    std::string json;
+    format_trace_spans({}, json);
+    ASSERT_EQ("{\"traceEvents\":[],\"displayTimeUnit\":\"ns\"}", json);
+
+    format_trace_spans({make_span(0xab, 7)}, json);
+    ASSERT_NE(std::string::npos,
+              json.find("{\"name\":\"test\",\"cat\":\"rdsn\",\"ph\":\"X\",\"ts\":1.000,"
+                        "\"dur\":2.500,"));
+    ASSERT_NE(std::string::npos,
+              json.find("\"tid\":100,\"args\":{\"trace_id\":\"00000000000000ab\","
+                        "\"gpid\":\"1.2\",\"decree\":7}}]"));
+}
+
+} // namespace utils
+} // namespace dsn
@@ -149,6 +149,17 @@ void throttling_controller::reset(bool &changed, std::string &old_env_value)
     }
 }
 
+int64_t throttling_controller::limit_units() const
+{
+    if (!_enabled) {
+        return 0;
+    }
+    if (_delay_units > 0 && _reject_units > 0) {
+        return std::min(_delay_units, _reject_units);
+    }
+    return std::max(_delay_units, _reject_units);
+}
+
 throttling_controller::throttling_type throttling_controller::control(
     const int64_t client_timeout_ms, int32_t request_units, int64_t &delay_ms)
 {
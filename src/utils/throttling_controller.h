@@ -78,6 +78,10 @@ public:
     // return the current env value.
     const std::string &env_value() const { return _env_value; }
 
+    // return the units per second above which requests are delayed or rejected,
+    // 0 if not enabled.
+    int64_t limit_units() const;
+
     // do throttling control, return throttling type.
     // 'delay_ms' is set when the return type is not PASS.
     throttling_type
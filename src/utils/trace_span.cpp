@@ -0,0 +1,160 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <dsn/utils/trace_span.h>
+
+#include <unistd.h>
+
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/process_utils.h>
+
+namespace dsn {
+namespace utils {
+
+DSN_DEFINE_uint32("replication",
+                  trace_sample_interval,
+                  0,
+                  "sample one in every N client writes for tracing, 0 means disabled");
+
+DSN_DEFINE_uint32("replication",
+                  trace_span_ring_capacity,
+                  65536,
+                  "how many of the latest trace spans are kept in memory");
+
+trace_span_ring::trace_span_ring(uint32_t capacity) : _next_index(0)
+{
+    uint32_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    _mask = size - 1;
+    _slots.reset(new slot[size]);
+    for (uint32_t i = 0; i < size; ++i) {
+        _slots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+}
+
+void trace_span_ring::add(const trace_span &span)
+{
+    uint64_t index = _next_index.fetch_add(1, std::memory_order_relaxed);
+    slot &s = _slots[index & _mask];
+
+    // a seqlock on each slot, the readers skip the slot if it's changed during read
+    s.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.trace_id.store(span.trace_id, std::memory_order_relaxed);
+    s.name.store(span.name, std::memory_order_relaxed);
+    s.start_ns.store(span.start_ns, std::memory_order_relaxed);
+    s.end_ns.store(span.end_ns, std::memory_order_relaxed);
+    s.app_id.store(span.app_id, std::memory_order_relaxed);
+    s.partition_index.store(span.partition_index, std::memory_order_relaxed);
+    s.decree.store(span.decree, std::memory_order_relaxed);
+    s.tid.store(span.tid, std::memory_order_relaxed);
+    s.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+std::vector<trace_span> trace_span_ring::get_spans(uint64_t trace_id) const
+{
+    std::vector<trace_span> spans;
+    uint64_t end = _next_index.load(std::memory_order_acquire);
+    uint64_t begin = end > capacity() ? end - capacity() : 0;
+    for (uint64_t index = begin; index < end; ++index) {
+        const slot &s = _slots[index & _mask];
+        if (s.sequence.load(std::memory_order_acquire) != 2 * index + 2) {
+            // still being written, or overwritten by a newer one
+            continue;
+        }
+
+        trace_span span;
+        span.trace_id = s.trace_id.load(std::memory_order_relaxed);
+        span.name = s.name.load(std::memory_order_relaxed);
+        span.start_ns = s.start_ns.load(std::memory_order_relaxed);
+        span.end_ns = s.end_ns.load(std::memory_order_relaxed);
+        span.app_id = s.app_id.load(std::memory_order_relaxed);
+        span.partition_index = s.partition_index.load(std::memory_order_relaxed);
+        span.decree = s.decree.load(std::memory_order_relaxed);
+        span.tid = s.tid.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.sequence.load(std::memory_order_relaxed) != 2 * index + 2) {
+            continue;
+        }
+        if (trace_id == 0 || span.trace_id == trace_id) {
+            spans.emplace_back(span);
+        }
+    }
+    return spans;
+}
+
+trace_span_ring &process_trace_spans()
+{
+    static trace_span_ring ring(FLAGS_trace_span_ring_capacity);
+    return ring;
+}
+
+bool should_sample_trace_slow()
+{
+    // no need to be exact across threads, so the counter is thread local
+    static thread_local uint32_t count = 0;
+    if (++count < FLAGS_trace_sample_interval) {
+        return false;
+    }
+    count = 0;
+    return true;
+}
+
+void add_trace_span(uint64_t trace_id,
+                    const char *name,
+                    uint64_t start_ns,
+                    uint64_t end_ns,
+                    int32_t app_id,
+                    int32_t partition_index,
+                    int64_t decree)
+{
+    trace_span span;
+    span.trace_id = trace_id;
+    span.name = name;
+    span.start_ns = start_ns;
+    span.end_ns = end_ns;
+    span.app_id = app_id;
+    span.partition_index = partition_index;
+    span.decree = decree;
+    span.tid = get_current_tid();
+    process_trace_spans().add(span);
+}
+
+void format_trace_spans(const std::vector<trace_span> &spans, /*out*/ std::string &json)
+{
+    static const int pid = ::getpid();
+
+    json = "{\"traceEvents\":[";
+    bool first = true;
+    for (const trace_span &span : spans) {
+        if (!first) {
+            json.push_back(',');
+        }
+        first = false;
+
+        // "ts" and "dur" are in microseconds
+        json.append(fmt::format("{{\"name\":\"{}\",\"cat\":\"rdsn\",\"ph\":\"X\","
+                                "\"ts\":{}.{:03},\"dur\":{}.{:03},\"pid\":{},\"tid\":{},"
+                                "\"args\":{{\"trace_id\":\"{:016x}\",\"gpid\":\"{}.{}\","
+                                "\"decree\":{}}}}}",
+                                span.name,
+                                span.start_ns / 1000,
+                                span.start_ns % 1000,
+                                (span.end_ns - span.start_ns) / 1000,
+                                (span.end_ns - span.start_ns) % 1000,
+                                pid,
+                                span.tid,
+                                span.trace_id,
+                                span.app_id,
+                                span.partition_index,
+                                span.decree));
+    }
+    json.append("],\"displayTimeUnit\":\"ns\"}");
+}
+
+} // namespace utils
+} // namespace dsn